@@ -0,0 +1,69 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vforge/voxel.hpp>
+#include <vforge/internal.hpp>
+#include <vector>
+
+namespace voxelforge {
+
+class VoxelObject;
+
+/**
+ * Collects voxel edits to be applied to a VoxelObject in one pass, see VoxelObject::apply().
+ * Edits are sorted by chunk, subchunk and voxel, so every chunk is looked up and marked dirty once.
+ * When one voxel is edited more than once, the last edit wins.
+ * Chunk coordinates are limited to 17 bits per axis (voxel coordinates below 2^21), edits further out are dropped.
+ */
+class VoxelEditBatch {
+public:
+    VoxelEditBatch() {}
+
+    void set(glm::uvec3 position, VoxelData vox) { this->push(position, vox, false); }
+    void clear(glm::uvec3 position) { this->push(position, VoxelData(), true); }
+
+    void reserve(size_t count) { this->edits.reserve(count); }
+    size_t size() const { return this->edits.size(); }
+    bool empty() const { return this->edits.empty(); }
+    void reset() { this->edits.clear(); }
+
+private:
+    friend class VoxelObject;
+
+    static constexpr unsigned int CHUNK_BITS = 17;
+    static constexpr uint64_t CLEAR_BIT = 1ull << 63;
+
+        // [chunk z | chunk y | chunk x | subchunk bit | voxel bit], top bit flags a clear
+    struct Edit {
+        uint64_t key;
+        VoxelData data;
+
+        uint64_t chunkKey() const { return (this->key & ~CLEAR_BIT) >> 12; }
+        unsigned int subChunkBit() const { return (this->key >> 6) & 63; }
+        unsigned int voxelBit() const { return this->key & 63; }
+        bool isClear() const { return this->key & CLEAR_BIT; }
+    };
+
+    void push(glm::uvec3 position, VoxelData vox, bool clear) {
+        glm::uvec3 chunk = position / 16u;
+        if ((chunk.x | chunk.y | chunk.z) >> CHUNK_BITS) return; // out of range
+
+        glm::uvec3 sc = (position / 4u) % 4u;
+        glm::uvec3 v = position % 4u;
+        uint64_t key = ((uint64_t)chunk.z << (2 * CHUNK_BITS + 12)) | ((uint64_t)chunk.y << (CHUNK_BITS + 12)) | ((uint64_t)chunk.x << 12)
+                     | ((uint64_t)internal::bitIndex(sc.x, sc.y, sc.z) << 6) | internal::bitIndex(v.x, v.y, v.z);
+
+        this->edits.push_back({ key | (clear ? CLEAR_BIT : 0), vox });
+    }
+
+        // by key, stable so repeated edits of a voxel stay in submission order and the last one wins
+    void sort();
+
+    static glm::uvec3 chunkPosition(uint64_t chunkKey) {
+        const uint64_t mask = (1ull << CHUNK_BITS) - 1;
+        return glm::uvec3(chunkKey & mask, (chunkKey >> CHUNK_BITS) & mask, chunkKey >> (2 * CHUNK_BITS));
+    }
+
+    std::vector<Edit> edits;
+};
+}
@@ -0,0 +1,185 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace voxelforge {
+
+struct AABB {
+    glm::vec3 lo = glm::vec3(std::numeric_limits<float>::infinity());
+    glm::vec3 hi = glm::vec3(-std::numeric_limits<float>::infinity());
+
+    AABB() = default;
+    AABB(glm::vec3 lo, glm::vec3 hi) : lo(lo), hi(hi) {}
+
+    void grow(const AABB& other) {
+        this->lo = glm::min(this->lo, other.lo);
+        this->hi = glm::max(this->hi, other.hi);
+    }
+    bool empty() const { return this->lo.x > this->hi.x || this->lo.y > this->hi.y || this->lo.z > this->hi.z; }
+    bool overlaps(const AABB& other) const {
+        return this->lo.x <= other.hi.x && this->lo.y <= other.hi.y && this->lo.z <= other.hi.z
+            && other.lo.x <= this->hi.x && other.lo.y <= this->hi.y && other.lo.z <= this->hi.z;
+    }
+    glm::vec3 center() const { return (this->lo + this->hi) * 0.5f; }
+        // half the surface area, the SAH only compares ratios
+    float area() const {
+        if (this->empty()) return 0.0f;
+        glm::vec3 d = this->hi - this->lo;
+        return d.x * d.y + d.y * d.z + d.z * d.x;
+    }
+
+        // bounds of this box after an affine transform, from the transformed center and the absolute matrix
+    AABB transformed(const glm::mat4& m) const;
+        // entry distance of the ray along `direction` (0 from inside), infinity if it misses or doesn't enter before `maxDistance`
+    float intersect(glm::vec3 origin, glm::vec3 invDirection, float maxDistance) const;
+};
+
+    // the six clip planes of a GL projection, normals pointing inwards
+struct Frustum {
+    enum Test { Outside, Intersecting, Inside };
+
+    explicit Frustum(const glm::mat4& viewProj);
+
+    Test test(const AABB& box) const;
+
+    glm::vec4 planes[6];
+};
+
+/**
+ * Bounding volume hierarchy over a set of boxes, built top-down with binned SAH splits.
+ * Items are the indices of the boxes passed to build(). A subtree's items are contiguous, so a subtree that lies
+ * completely inside a frustum is reported without testing further. Nodes follow their parents in memory, refitting
+ * after boxes moved is a single backwards pass (or a walk up from one leaf) and keeps the topology, so call build()
+ * again when boxes have moved far enough to make the tree loose.
+ */
+class ObjectBVH {
+public:
+    struct Node {
+        AABB bounds;
+        uint32_t left;      // first child, the second one follows it. 0 for leaves
+        uint32_t first;     // items of the subtree, in `items`
+        uint32_t count;
+
+        bool isLeaf() const { return this->left == 0; }
+    };
+
+        // items per leaf the build aims for
+    static constexpr uint32_t LEAF_SIZE = 4;
+
+    void build(const std::vector<AABB>& bounds);
+        // every box changed, `bounds` must hold as many boxes as the last build()
+    void refit(const std::vector<AABB>& bounds);
+        // one box changed, only its leaf and the nodes above it are updated
+    void refit(uint32_t item, const AABB& bounds);
+
+        // calls fn(item) for every box touching the frustum
+    template <typename F>
+    void cull(const Frustum& frustum, F&& fn) const {
+        if (this->nodes.empty()) return;
+
+        uint32_t stack[STACK_SIZE];
+        unsigned int top = 0;
+        stack[top++] = 0;
+        while (top) {
+            const Node& node = this->nodes[stack[--top]];
+            Frustum::Test test = frustum.test(node.bounds);
+            if (test == Frustum::Outside) continue;
+
+            if (test == Frustum::Inside) {
+                for (uint32_t i = node.first; i < node.first + node.count; i++) {
+                    if (!this->itemBounds[this->items[i]].empty()) fn(this->items[i]);
+                }
+            } else if (node.isLeaf()) {
+                for (uint32_t i = node.first; i < node.first + node.count; i++) {
+                    if (frustum.test(this->itemBounds[this->items[i]]) != Frustum::Outside) fn(this->items[i]);
+                }
+            } else {
+                stack[top++] = node.left;
+                stack[top++] = node.left + 1;
+            }
+        }
+    }
+
+        // calls fn(item) for every box overlapping `box`
+    template <typename F>
+    void overlap(const AABB& box, F&& fn) const {
+        if (this->nodes.empty()) return;
+
+        uint32_t stack[STACK_SIZE];
+        unsigned int top = 0;
+        stack[top++] = 0;
+        while (top) {
+            const Node& node = this->nodes[stack[--top]];
+            if (!node.bounds.overlaps(box)) continue;
+
+            if (node.isLeaf()) {
+                for (uint32_t i = node.first; i < node.first + node.count; i++) {
+                    if (this->itemBounds[this->items[i]].overlaps(box)) fn(this->items[i]);
+                }
+            } else {
+                stack[top++] = node.left;
+                stack[top++] = node.left + 1;
+            }
+        }
+    }
+
+        // calls fn(item, maxDistance) for boxes the ray enters before maxDistance, nearer subtrees first. fn returns the
+        // new maxDistance (its hit distance, or maxDistance unchanged), which prunes everything behind it
+    template <typename F>
+    float raycast(glm::vec3 origin, glm::vec3 direction, float maxDistance, F&& fn) const {
+        if (this->nodes.empty()) return maxDistance;
+
+        const glm::vec3 invDirection = 1.0f / direction;
+        uint32_t stack[STACK_SIZE];
+        unsigned int top = 0;
+        if (this->nodes[0].bounds.intersect(origin, invDirection, maxDistance) < maxDistance) stack[top++] = 0;
+        while (top) {
+            const Node& node = this->nodes[stack[--top]];
+
+            if (node.isLeaf()) {
+                for (uint32_t i = node.first; i < node.first + node.count; i++) {
+                    if (this->itemBounds[this->items[i]].intersect(origin, invDirection, maxDistance) < maxDistance) {
+                        maxDistance = fn(this->items[i], maxDistance);
+                    }
+                }
+                continue;
+            }
+
+            uint32_t near = node.left, far = node.left + 1;
+            float tNear = this->nodes[near].bounds.intersect(origin, invDirection, maxDistance);
+            float tFar = this->nodes[far].bounds.intersect(origin, invDirection, maxDistance);
+            if (tFar < tNear) {
+                std::swap(near, far);
+                std::swap(tNear, tFar);
+            }
+                // the far child is popped after the near one, by then maxDistance may have shrunk past it. it is
+                // checked again on the way down through its own children and items
+            if (tFar < maxDistance) stack[top++] = far;
+            if (tNear < maxDistance) stack[top++] = near;
+        }
+        return maxDistance;
+    }
+
+    size_t size() const { return this->itemBounds.size(); }
+    const AABB& getBounds(uint32_t item) const { return this->itemBounds[item]; }
+    const std::vector<Node>& getNodes() const { return this->nodes; }
+private:
+        // the build switches to median splits past this depth, so the tree stays shallow enough for the fixed stacks
+        // (up to 2^24 items)
+    static constexpr unsigned int MAX_SAH_DEPTH = 40;
+    static constexpr unsigned int STACK_SIZE = MAX_SAH_DEPTH + 32;
+
+    void subdivide(uint32_t node, unsigned int depth);
+    void updateNode(uint32_t node);
+
+    std::vector<Node> nodes;
+    std::vector<uint32_t> items;
+    std::vector<uint32_t> parents;
+    std::vector<uint32_t> leafOf;       // leaf holding each item
+    std::vector<AABB> itemBounds;
+};
+}
@@ -3,48 +3,204 @@
 #include <glm/glm.hpp>
 #include <fglw/fglw.hpp>
 #include <vforge/voxel.hpp>
+#include <vforge/internal.hpp>
+#include <vforge/chunkmap.hpp>
 #include <memory>
+#include <optional>
+#include <vector>
 
 namespace voxelforge {
 
+    // a voxel yielded by the sparse iterators, `position` includes the origin the iteration was started with
+struct VoxelEntry {
+    glm::uvec3 position;
+    VoxelData data;
+};
+
+    // distinct voxels of a compressed chunk, shared by its subchunks. see VoxelChunk::compress()
+struct VoxelPalette {
+    std::vector<VoxelData> values;
+    unsigned int bits;      // per voxel index: 0 (every voxel is values[0]), 1, 2, 4 or 8
+
+    size_t memoryUsage() const { return sizeof(*this) + this->values.capacity() * sizeof(VoxelData); }
+};
+
 class VoxelSubChunk {
 public:
+        // walks the set bits of the bitmask, so empty cells cost nothing
+    class VoxelIterator {
+    public:
+        VoxelIterator() = default;
+        VoxelIterator(const VoxelSubChunk *sub, glm::uvec3 origin) : sub(sub), mask(sub->bitmask), origin(origin) {}
+
+        VoxelEntry operator*() const { return VoxelEntry{this->origin + internal::bitPosition(__builtin_ctzll(this->mask)), this->sub->getVoxel(this->index)}; }
+        VoxelIterator& operator++() { this->mask &= this->mask - 1; this->index++; return *this; }
+
+        bool operator==(const VoxelIterator& other) const { return this->mask == other.mask; }
+        bool operator!=(const VoxelIterator& other) const { return this->mask != other.mask; }
+        bool done() const { return this->mask == 0; }
+    private:
+        const VoxelSubChunk *sub = nullptr;
+        uint64_t mask = 0;
+        unsigned int index = 0;
+        glm::uvec3 origin = glm::uvec3(0);
+    };
+
     VoxelSubChunk();
 
-    void set(unsigned int x, unsigned int y, unsigned int z, std::shared_ptr<VoxelData> data);
-    std::shared_ptr<VoxelData> get(unsigned int x, unsigned int y, unsigned int z);
+    void set(unsigned int x, unsigned int y, unsigned int z, VoxelData data);
+    std::optional<VoxelData> get(unsigned int x, unsigned int y, unsigned int z) const;
     void clear(unsigned int x, unsigned int y, unsigned int z);
 
-    void set(glm::uvec3 position, std::shared_ptr<VoxelData> data) { this->set(position.x, position.y, position.z, data); }
-    std::shared_ptr<VoxelData> get(glm::uvec3 position) { return this->get(position.x, position.y, position.z); }
+    void set(glm::uvec3 position, VoxelData data) { this->set(position.x, position.y, position.z, data); }
+    std::optional<VoxelData> get(glm::uvec3 position) const { return this->get(position.x, position.y, position.z); }
     void clear(glm::uvec3 position) { this->clear(position.x, position.y, position.z); }
 
+    void set(unsigned int x, unsigned int y, unsigned int z, std::shared_ptr<VoxelData> data) { if (data) this->set(x, y, z, *data); else this->clear(x, y, z); }
+    void set(glm::uvec3 position, std::shared_ptr<VoxelData> data) { this->set(position.x, position.y, position.z, data); }
+
     void clear();
 
+        // sets the voxels in `setMask` (values given in bit order) and clears those in `clearMask`, in one pass
+    void apply(uint64_t setMask, uint64_t clearMask, const VoxelData *values);
+
     uint64_t getBitmask() const { return this->bitmask; }
+    unsigned int size() const { return __builtin_popcountll(this->bitmask); }
+        // voxels are packed in bit order, the one at bit i is voxel internal::bitRank(bitmask, i)
+    VoxelData getVoxel(unsigned int index) const {
+        if (!this->palette) return this->data[index];
+
+        unsigned int bits = this->palette->bits;
+        if (bits == 0) return this->palette->values[0];
+        unsigned int bit = index * bits;   // indices never straddle a byte
+        return this->palette->values[(this->indices[bit >> 3] >> (bit & 7)) & ((1u << bits) - 1u)];
+    }
+
+        // palette the voxels are stored as indices into, null when they are stored as they are
+    const VoxelPalette *getPalette() const { return this->palette.get(); }
+        // `palette->bits` per voxel in bit order, the first voxel in the lowest bits of the first byte
+    const std::vector<uint8_t>& getIndices() const { return this->indices; }
+        // stores the voxels as indices into `palette`, `index` holding the palette index of each voxel in bit order
+    void compress(std::shared_ptr<const VoxelPalette> palette, const uint8_t *index);
+        // back to one VoxelData per voxel, every edit does this first
+    void decompress();
+
+        // calls fn(position, data) for every voxel in bit order (x fastest, then y, then z), positions offset by `origin`
+    template <typename F>
+    void forEachVoxel(F&& fn, glm::uvec3 origin = glm::uvec3(0)) const {
+        if (!this->palette) {
+            const VoxelData *voxel = this->data.data();
+            for (uint64_t mask = this->bitmask; mask; mask &= mask - 1) {
+                fn(origin + internal::bitPosition(__builtin_ctzll(mask)), *voxel++);
+            }
+            return;
+        }
+        unsigned int index = 0;
+        for (uint64_t mask = this->bitmask; mask; mask &= mask - 1) {
+            fn(origin + internal::bitPosition(__builtin_ctzll(mask)), this->getVoxel(index++));
+        }
+    }
+    internal::Range<VoxelIterator> voxels(glm::uvec3 origin = glm::uvec3(0)) const {
+        return {VoxelIterator(this, origin), VoxelIterator()};
+    }
+
+        // the palette isn't counted, it belongs to the chunk
+    size_t memoryUsage() const { return sizeof(*this) + this->data.capacity() * sizeof(VoxelData) + this->indices.capacity(); }
 private:
     uint64_t bitmask;
-    std::shared_ptr<VoxelData> data[4][4][4];
+    std::vector<VoxelData> data;
+    std::shared_ptr<const VoxelPalette> palette;
+    std::vector<uint8_t> indices;           // `palette->bits` per voxel, first voxel in the lowest bits
 };
 
 class VoxelChunk {
 public:
+        // voxels of each subchunk in turn, subchunks in bit order
+    class VoxelIterator {
+    public:
+        VoxelIterator() = default;
+        VoxelIterator(const VoxelChunk *chunk, glm::uvec3 origin) : chunk(chunk), remaining(chunk->bitmask), origin(origin) { this->nextSubChunk(); }
+
+        VoxelEntry operator*() const { return *this->voxel; }
+        VoxelIterator& operator++() {
+            ++this->voxel;
+            if (this->voxel.done()) this->nextSubChunk();
+            return *this;
+        }
+
+        bool operator==(const VoxelIterator& other) const { return this->remaining == other.remaining && this->voxel == other.voxel; }
+        bool operator!=(const VoxelIterator& other) const { return !(*this == other); }
+        bool done() const { return this->voxel.done(); }
+    private:
+        void nextSubChunk() {
+            if (!this->remaining) return;
+
+            unsigned int bit = __builtin_ctzll(this->remaining);
+            this->remaining &= this->remaining - 1;
+            const VoxelSubChunk& sub = *this->chunk->data[bit & 3][(bit >> 2) & 3][bit >> 4];
+            this->voxel = VoxelSubChunk::VoxelIterator(&sub, this->origin + internal::bitPosition(bit) * 4u);
+        }
+
+        const VoxelChunk *chunk = nullptr;
+        uint64_t remaining = 0;     // subchunks after the current one
+        glm::uvec3 origin = glm::uvec3(0);
+        VoxelSubChunk::VoxelIterator voxel;
+    };
+
     VoxelChunk();
 
-    void set(unsigned int x, unsigned int y, unsigned int z, std::shared_ptr<VoxelData> data);
+    void set(unsigned int x, unsigned int y, unsigned int z, VoxelData data);
+    std::optional<VoxelData> get(unsigned int x, unsigned int y, unsigned int z) const;
     void clear(unsigned int x, unsigned int y, unsigned int z);
 
-    void set(glm::uvec3 position, std::shared_ptr<VoxelData> data) { this->set(position.x, position.y, position.z, data); }
+    void set(glm::uvec3 position, VoxelData data) { this->set(position.x, position.y, position.z, data); }
+    std::optional<VoxelData> get(glm::uvec3 position) const { return this->get(position.x, position.y, position.z); }
     void clear(glm::uvec3 position) { this->clear(position.x, position.y, position.z); }
 
+    void set(unsigned int x, unsigned int y, unsigned int z, std::shared_ptr<VoxelData> data) { if (data) this->set(x, y, z, *data); else this->clear(x, y, z); }
+    void set(glm::uvec3 position, std::shared_ptr<VoxelData> data) { this->set(position.x, position.y, position.z, data); }
+
     void clear();
 
-    std::shared_ptr<VoxelSubChunk> getSubChunk(unsigned int x, unsigned int y, unsigned int z);
-    std::shared_ptr<VoxelSubChunk> getSubChunk(glm::uvec3 pos) { return this->getSubChunk(pos.x, pos.y, pos.z); }
+        // VoxelSubChunk::apply() on the subchunk at `subChunkBit`, creating or freeing it as needed
+    void apply(unsigned int subChunkBit, uint64_t setMask, uint64_t clearMask, const VoxelData *values);
+
+    const std::shared_ptr<VoxelSubChunk>& getSubChunk(unsigned int x, unsigned int y, unsigned int z) const;
+    const std::shared_ptr<VoxelSubChunk>& getSubChunk(glm::uvec3 pos) const { return this->getSubChunk(pos.x, pos.y, pos.z); }
 
     uint64_t getBitmask() const { return this->bitmask; }
+
+    enum class Encoding {
+        Raw,        // one VoxelData per voxel
+        Uniform,    // a single value for every voxel
+        Palette,    // up to 256 distinct values, 1, 2, 4 or 8-bit indices per voxel
+    };
+        // re-encodes the chunk in the smallest of the encodings above. edits decode only the subchunks they touch and
+        // leave the chunk Raw until it is compressed again, reads work the same in every encoding
+    void compress();
+    Encoding getEncoding() const;
+        // null unless the chunk is Uniform or Palette
+    const VoxelPalette *getPalette() const { return this->palette.get(); }
+
+        // calls fn(position, subChunk) for every subchunk in bit order, `position` being the voxel at its corner offset by `origin`
+    template <typename F>
+    void forEachSubChunk(F&& fn, glm::uvec3 origin = glm::uvec3(0)) const {
+        for (uint64_t mask = this->bitmask; mask; mask &= mask - 1) {
+            unsigned int bit = __builtin_ctzll(mask);
+            fn(origin + internal::bitPosition(bit) * 4u, *this->data[bit & 3][(bit >> 2) & 3][bit >> 4]);
+        }
+    }
+        // calls fn(position, data) for every voxel, subchunk by subchunk in bit order, positions offset by `origin`
+    template <typename F>
+    void forEachVoxel(F&& fn, glm::uvec3 origin = glm::uvec3(0)) const {
+        this->forEachSubChunk([&](glm::uvec3 corner, const VoxelSubChunk& sub) { sub.forEachVoxel(fn, corner); }, origin);
+    }
+    internal::Range<VoxelIterator> voxels(glm::uvec3 origin = glm::uvec3(0)) const { return {VoxelIterator(this, origin), VoxelIterator()}; }
+
+    size_t memoryUsage() const;
 private:
     uint64_t bitmask;
     std::shared_ptr<VoxelSubChunk> data[4][4][4];
+    std::shared_ptr<const VoxelPalette> palette;    // as of the last compress(), reset by edits
 };
 }
\ No newline at end of file
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <vector>
+
+namespace voxelforge {
+
+class VoxelChunk;
+
+/**
+ * Chunk directory keyed by chunk position, iterated in Z-order (Morton order) so neighbouring chunks come one after another.
+ *
+ * With bounds that are small enough, chunks live in a dense array indexed by the Morton code of their position,
+ * so a lookup is one table read and spatially close chunks are mostly close in memory. Maps without bounds, and
+ * positions outside of them, go to an open addressing table instead, whose entries are sorted into Z-order on the
+ * first iteration after a modification. Dense entries are visited first, then the open addressing ones.
+ *
+ * The interface is the part of std::unordered_map the code base uses, iterators are invalidated by any modification.
+ */
+class ChunkMap {
+public:
+    struct value_type {
+        glm::uvec3 first;
+        std::shared_ptr<VoxelChunk> second;
+    };
+
+    template <bool Const>
+    class Iterator {
+    public:
+        using Map = std::conditional_t<Const, const ChunkMap, ChunkMap>;
+        using Value = std::conditional_t<Const, const value_type, value_type>;
+
+        Iterator() = default;
+        Iterator(Map *map, size_t position) : map(map), position(position) {}
+        operator Iterator<true>() const { return Iterator<true>(this->map, this->position); }
+
+        Value& operator*() const { return *this->map->entry(this->position); }
+        Value *operator->() const { return this->map->entry(this->position); }
+        Iterator& operator++() { this->position = this->map->next(this->position); return *this; }
+
+        bool operator==(const Iterator& other) const { return this->position == other.position; }
+        bool operator!=(const Iterator& other) const { return this->position != other.position; }
+    private:
+        friend class ChunkMap;
+
+        Map *map = nullptr;
+        size_t position = 0;
+    };
+    using iterator = Iterator<false>;
+    using const_iterator = Iterator<true>;
+
+        // dense storage for [0, bounds) if it fits in MAX_DENSE_SLOTS, open addressing only for a zero extent
+    explicit ChunkMap(glm::uvec3 bounds = glm::uvec3(0));
+    ChunkMap(const ChunkMap& other);
+    ChunkMap& operator=(const ChunkMap& other);
+
+        // largest dense table (power of two padded bounds), 32 bytes per slot
+    static constexpr size_t MAX_DENSE_SLOTS = 1 << 20;
+
+    iterator begin() { return iterator(this, this->first()); }
+    iterator end() { return iterator(this, END); }
+    const_iterator begin() const { return const_iterator(this, this->first()); }
+    const_iterator end() const { return const_iterator(this, END); }
+
+    iterator find(glm::uvec3 position) { return iterator(this, this->locate(position)); }
+    const_iterator find(glm::uvec3 position) const { return const_iterator(this, this->locate(position)); }
+    size_t count(glm::uvec3 position) const { return this->locate(position) != END; }
+
+        // inserts a null chunk if there is none at `position`
+    std::shared_ptr<VoxelChunk>& operator[](glm::uvec3 position);
+        // operator[] for several threads at once: only dense entries can be claimed side by side (null otherwise), calls
+        // for the same position have to be serialized by the caller and nothing else may use the map meanwhile.
+        // `created` tells whether the entry is new
+    std::shared_ptr<VoxelChunk> *concurrentSlot(glm::uvec3 position, bool& created);
+        // adds a dense entry while other threads may be looking positions up with find(): they either don't see it yet
+        // or see it whole. the position must not have an entry, false (and nothing added) outside the dense directory
+    bool publish(glm::uvec3 position, std::shared_ptr<VoxelChunk> chunk);
+    size_t erase(glm::uvec3 position);
+    void erase(const_iterator it) { this->erase(it->first); }
+    void clear();
+
+    size_t size() const { return this->denseCount + this->sparseCount; }
+    bool empty() const { return this->size() == 0; }
+    bool isDense() const { return !this->dense.empty(); }
+
+    size_t memoryUsage() const;
+
+        // Z-order comparison of two positions, interleaving x, y, z from the least significant bit up
+    static bool zLess(glm::uvec3 a, glm::uvec3 b);
+private:
+    static constexpr size_t END = ~(size_t)0;
+        // positions from find() into the open addressing table, slot index instead of sorted index
+    static constexpr size_t UNORDERED = (size_t)1 << (sizeof(size_t) * 8 - 2);
+
+    bool inBounds(glm::uvec3 position) const { return position.x < this->bounds.x && position.y < this->bounds.y && position.z < this->bounds.z; }
+    uint64_t mortonCode(glm::uvec3 position) const { return this->spread[0][position.x] | this->spread[1][position.y] | this->spread[2][position.z]; }
+
+    size_t locate(glm::uvec3 position) const;
+    size_t first() const;
+    size_t next(size_t position) const;
+    size_t nextDense(size_t slot) const;
+    value_type *entry(size_t position) { return const_cast<value_type *>(static_cast<const ChunkMap *>(this)->entry(position)); }
+    const value_type *entry(size_t position) const;
+
+    size_t findSparse(glm::uvec3 position) const;
+    void growSparse();
+    void sortSparse() const;
+
+    glm::uvec3 bounds;
+    std::vector<uint64_t> spread[3];    // Morton bits of each coordinate value, per axis
+
+    std::vector<value_type> dense;      // indexed by Morton code
+    std::vector<uint64_t> occupied;     // one bit per dense slot
+    size_t denseCount = 0;
+
+    std::vector<value_type> sparse;     // linear probing, power of two capacity
+    std::vector<uint8_t> sparseUsed;
+    size_t sparseCount = 0;
+
+        // Z-order of the open addressing entries (slot indices) and its inverse, rebuilt lazily by const iteration
+    mutable std::vector<uint32_t> order;
+    mutable std::vector<uint32_t> rank;
+    mutable std::atomic<bool> ordered;
+    mutable std::mutex orderMutex;
+};
+}
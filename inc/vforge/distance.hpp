@@ -0,0 +1,52 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vforge/chunk.hpp>
+#include <cstdint>
+#include <vector>
+
+namespace voxelforge {
+
+/**
+ * Distance from every voxel of an object to the nearest solid voxel, from an exact Euclidean distance transform.
+ *
+ * Values are floor(distance between voxel centers) in voxels, 0 for solid voxels and capped at maxDistance,
+ * so a point anywhere inside a voxel with value D is at least D - sqrt(3) away from any solid voxel.
+ * Computed in three separable passes (x, y, z) of the lower envelope of parabolas, in integer arithmetic.
+ *
+ * Each subchunk also keeps the minimum over its 64 voxels, so traversal through empty subchunks and chunks
+ * reads a table 64 times smaller than the voxel one.
+ */
+class DistanceField {
+public:
+        // largest maxDistance, (maxDistance + 1)^2 has to fit the 16 bit distances of the transform
+    static constexpr unsigned int MAX_DISTANCE = 254;
+
+        // extent in voxels (a multiple of 4), maxDistance is clamped to MAX_DISTANCE
+    DistanceField(glm::uvec3 extent, unsigned int maxDistance = 32);
+
+        // recomputes the whole field on up to `workers` threads (0 = one per core)
+    void build(const ChunkMap& chunks, unsigned int workers = 0);
+        // recomputes only the voxels whose value can depend on voxels in the box [lo, hi)
+    void update(const ChunkMap& chunks, glm::uvec3 lo, glm::uvec3 hi, unsigned int workers = 0);
+
+    uint8_t get(glm::uvec3 voxel) const { return this->data[((size_t)voxel.z * this->extent.y + voxel.y) * this->extent.x + voxel.x]; }
+        // smallest value inside a subchunk, in subchunk coordinates
+    uint8_t getSubChunk(glm::uvec3 subChunk) const {
+        glm::uvec3 n = this->extent / 4u;
+        return this->subChunks[((size_t)subChunk.z * n.y + subChunk.y) * n.x + subChunk.x];
+    }
+
+    glm::uvec3 size() const { return this->extent; }
+    unsigned int getMaxDistance() const { return this->maxDistance; }
+    size_t memoryUsage() const { return this->data.size() + this->subChunks.size(); }
+private:
+        // transforms the window [lo, hi) and writes back the part of it inside [writeLo, writeHi)
+    void compute(const ChunkMap& chunks, glm::ivec3 lo, glm::ivec3 hi, glm::ivec3 writeLo, glm::ivec3 writeHi, unsigned int workers);
+
+    glm::uvec3 extent;
+    unsigned int maxDistance;
+    std::vector<uint8_t> data;
+    std::vector<uint8_t> subChunks;
+};
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vforge/chunk.hpp>
+#include <vforge/chunkmap.hpp>
+#include <vforge/internal.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace voxelforge {
+
+/**
+ * Procedural content of an object, see VoxelObject::setGenerator(). generate() is called at most once per chunk, from
+ * any thread and for several chunks at once, so it must not depend on shared state it doesn't synchronize itself.
+ */
+class ChunkGenerator {
+public:
+    virtual ~ChunkGenerator() = default;
+
+        // voxels of the chunk at chunk position `position`, null (or an empty chunk) if there are none
+    virtual std::shared_ptr<VoxelChunk> generate(glm::uvec3 position) = 0;
+};
+
+/**
+ * Bookkeeping of an object's generated chunks, see VoxelObject::setGenerator().
+ *
+ * Every chunk position of the object is either generated (it holds what the generator made for it, or was edited or
+ * replaced before it got the chance) or not. Chunks that aren't are made either on the spot by whoever needs them or
+ * ahead of time by background workers working through a queue, nearest to the last request first. A chunk being made
+ * by one thread is waited for by the others that need it, so the generator sees every position once.
+ *
+ * Chunks the workers made wait in a list until installFinished() moves them into the ChunkMap on the thread that owns
+ * the object. generateShared() installs chunks while other threads read the map, through ChunkMap::publish(), and
+ * leaves telling the object about them to the next installFinished().
+ */
+class ChunkGeneration {
+public:
+    struct Stats {
+        size_t generated = 0;       // chunks the generator made, on the spot or ahead of time
+        size_t ahead = 0;           // of those, by the background workers
+        size_t empty = 0;           // chunks the generator left empty
+        size_t waits = 0;           // times a thread needed a chunk another one was making
+        double seconds = 0.0;       // total time in ChunkGenerator::generate()
+    };
+
+        // the chunks in `chunks` now count as generated. `workers` background threads, 0 = one per core, started on the
+        // first request
+    ChunkGeneration(ChunkMap& chunks, glm::uvec3 dim, std::shared_ptr<ChunkGenerator> generator, unsigned int workers = 0);
+    ~ChunkGeneration();
+    ChunkGeneration(const ChunkGeneration&) = delete;
+    ChunkGeneration& operator=(const ChunkGeneration&) = delete;
+
+    bool isGenerated(glm::uvec3 position) const {
+        return !this->inBounds(position) || this->state[this->index(position)].load(std::memory_order_acquire) == DONE;
+    }
+        // chunks not generated yet
+    size_t getRemaining() const { return this->remaining.load(std::memory_order_relaxed); }
+        // every chunk was generated and the object was told about all of them
+    bool isSettled() const { return this->unsettled.load(std::memory_order_acquire) == 0; }
+
+        // the generated chunk at `position`, made now or taken from the workers, null if it is empty or was already
+        // generated. the caller installs it. safe from any thread, the ChunkMap is left alone
+    std::shared_ptr<VoxelChunk> take(glm::uvec3 position);
+        // take() and publish the chunk to the ChunkMap, while other threads may be looking chunks up. the object hears of
+        // it with the next installFinished(). outside the dense directory the chunk waits for installFinished() like
+        // those of the workers
+    void generateShared(glm::uvec3 position);
+        // the chunk at `position` was replaced as a whole, it won't be generated anymore
+    void cancel(glm::uvec3 position);
+        // cancel() everywhere, the object was cleared
+    void cancelAll();
+
+        // queues the chunks within `radius` chunks of `center` that weren't generated yet, nearest first, ahead of
+        // everything queued before
+    void request(glm::uvec3 center, unsigned int radius);
+        // queues every chunk that wasn't generated yet behind the rest, nearest to the last request first. only the
+        // first call does anything
+    void requestRest();
+
+        // owner thread: moves the chunks the workers finished into the ChunkMap and appends the positions of every
+        // chunk installed since the last call, here or by generateShared(), to `installed`
+    void installFinished(std::vector<glm::uvec3>& installed);
+        // installFinished() would install something
+    bool hasFinished() const { return this->finishedCount.load(std::memory_order_acquire) != 0; }
+
+    Stats getStats() const;
+private:
+    enum : uint8_t {
+        MISSING,    // not generated, possibly queued
+        CLAIMED,    // being made, or taken from the workers' list by a thread that is about to install it
+        FINISHED,   // made by a worker, waiting in `finished`
+        DONE,
+    };
+
+    bool inBounds(glm::uvec3 p) const { return p.x < this->dim.x && p.y < this->dim.y && p.z < this->dim.z; }
+    size_t index(glm::uvec3 p) const { return ((size_t)p.z * this->dim.y + p.y) * this->dim.x + p.x; }
+
+        // claims the chunk and makes or takes it, false if it was already generated. the caller calls settle() next
+    bool claim(glm::uvec3 position, std::shared_ptr<VoxelChunk>& chunk);
+    std::shared_ptr<VoxelChunk> run(glm::uvec3 position, bool ahead);
+    void settle(glm::uvec3 position);
+    void startWorkers();
+    void workerLoop();
+
+    ChunkMap& chunks;
+    glm::uvec3 dim;
+    std::shared_ptr<ChunkGenerator> generator;
+    unsigned int workerCount;
+
+    std::unique_ptr<std::atomic<uint8_t>[]> state;
+    std::atomic<size_t> remaining{0};
+    std::atomic<size_t> unsettled{0};       // `remaining` plus the published chunks the object hasn't heard of yet
+    std::atomic<size_t> finishedCount{0};   // `finished` plus `published`
+
+        // under `mutex`
+    mutable std::mutex mutex;
+    std::condition_variable changed;        // a claimed chunk was finished or settled
+    std::condition_variable wake;           // for the workers
+    std::vector<glm::uvec3> requests;       // nearest last
+    glm::uvec3 focus;
+    bool restRequested = false;
+    std::unordered_map<glm::uvec3, std::shared_ptr<VoxelChunk>, internal::uvec3Hash> finished;
+    std::vector<glm::uvec3> published;
+    Stats stats;
+    bool stopping = false;
+    std::vector<std::thread> workers;
+};
+}
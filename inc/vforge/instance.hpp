@@ -0,0 +1,38 @@
+#pragma once
+
+#include <vforge/object.hpp>
+#include <vforge/worldobject.hpp>
+#include <memory>
+
+namespace voxelforge {
+
+/**
+ * Another placement of a VoxelObject's voxels, carrying nothing but a transform.
+ * The model's voxels, GPU textures and materials are shared by the object and all of its instances, so an edit to the
+ * model shows up in every placement. The model's own transform only applies where the model itself is drawn.
+ */
+class VoxelInstance : public WorldObject {
+public:
+    VoxelInstance(std::shared_ptr<VoxelObject> model, glm::mat4x4 modelMatrix = glm::mat4x4(1.0f)) : model(model), modelMatrix(modelMatrix) {}
+
+    const std::shared_ptr<VoxelObject>& getModel() const { return this->model; }
+
+    glm::mat4x4 getModelMatrix() const { return this->modelMatrix; }
+    void setModelMatrix(glm::mat4x4 modelMatrix) { this->modelMatrix = modelMatrix; }
+
+        // VoxelObject::raycast() with the instance's transform
+    RaycastHit raycast(glm::vec3 origin, glm::vec3 direction, float maxDistance = std::numeric_limits<float>::infinity()) const {
+        return this->model->raycastAt(this->modelMatrix, origin, direction, maxDistance);
+    }
+    std::vector<RaycastHit> raycast(const std::vector<Ray>& rays, unsigned int workers = 0, RaycastKernel kernel = RaycastKernel::Auto) const {
+        return this->model->raycastAt(this->modelMatrix, rays, workers, kernel);
+    }
+
+    virtual void draw(fglw::RenderTarget& fb, glm::mat4 view, glm::mat4 proj) override {
+        this->model->drawAt(fb, view, proj, this->modelMatrix);
+    }
+private:
+    std::shared_ptr<VoxelObject> model;
+    glm::mat4x4 modelMatrix;
+};
+}
@@ -1,10 +1,8 @@
 #pragma once
 
 #include <glm/glm.hpp>
-#include <vforge/worldobject.hpp>
-#include <vforge/chunk.hpp>
-#include <unordered_map>
-#include <fglw/fglw.hpp>
+#include <functional>
+#include <cstdint>
 
 namespace voxelforge {
 
@@ -21,5 +19,29 @@ struct uvec3Hash {
         return hash;
     }
 };
+
+    // index of a cell in a 4x4x4 bitmask
+inline unsigned int bitIndex(unsigned int x, unsigned int y, unsigned int z) {
+    return x | (y << 2) | (z << 4);
+}
+
+    // cell of bit `index` in a 4x4x4 bitmask, the inverse of bitIndex()
+inline glm::uvec3 bitPosition(unsigned int index) {
+    return glm::uvec3(index & 3, (index >> 2) & 3, index >> 4);
+}
+
+    // number of set bits below bit `index`, i.e. the slot of that bit in a packed array
+inline unsigned int bitRank(uint64_t bitmask, unsigned int index) {
+    return __builtin_popcountll(bitmask & ((1ull << index) - 1ull));
+}
+
+    // iterator pair usable in range-based for loops
+template <typename Iterator>
+struct Range {
+    Iterator first, last;
+
+    Iterator begin() const { return this->first; }
+    Iterator end() const { return this->last; }
+};
 }
 }
\ No newline at end of file
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <vforge/object.hpp>
+#include <vforge/world.hpp>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace voxelforge::files {
+
+/**
+ * Native VoxelForge file, a snapshot of every object of a world in the packed VoxelPool layout.
+ *
+ * header:      magic "VFORGE\0\0", version, object count, file size, then one fixed size record per object
+ * per object:  material table (256 x vec4), chunk table, subchunk pool, voxel pool, each section 64-byte aligned
+ *
+ * The world's instances follow its objects as records of their own that point at their model's sections, so a model
+ * is stored once however often it is placed. getWorld() turns such records back into VoxelInstances.
+ *
+ * The chunk table and pools are what VoxelPool::pack() produces (tight, in chunk table order), so a mapped file can
+ * be queried or uploaded in place, and turning it back into a VoxelObject copies whole subchunks instead of setting
+ * voxels one by one. The layout is little-endian, VERSION is bumped on any change to it.
+ */
+class NativeFile {
+public:
+    static constexpr uint32_t VERSION = 1;
+
+        // one object, pointing into the mapping
+    struct ObjectView {
+        glm::uvec3 dim;
+        glm::mat4 modelMatrix;
+        const glm::vec4 *materials;         // 256 entries
+        const glm::uvec4 *chunkTable;       // dim.x * dim.y * dim.z entries
+        const glm::uvec4 *subChunkPool;     // subChunkCount entries
+        const VoxelData *voxelPool;         // voxelCount entries
+        size_t subChunkCount;
+        size_t voxelCount;
+
+        std::optional<VoxelData> lookup(glm::uvec3 position) const {
+            return VoxelPool::lookup(this->dim, this->chunkTable, this->subChunkPool, this->voxelPool, position);
+        }
+            // copies the object out of the mapping
+        std::shared_ptr<VoxelObject> toObject() const;
+    };
+
+        // maps and validates the file, isOpen() is false (and an error printed) if it is missing or malformed
+    explicit NativeFile(const std::string& filename);
+    ~NativeFile();
+    NativeFile(const NativeFile&) = delete;
+    NativeFile& operator=(const NativeFile&) = delete;
+
+    bool isOpen() const { return this->mapping != nullptr; }
+    size_t objectCount() const { return this->objects.size(); }
+    const ObjectView& getObject(size_t index) const { return this->objects[index]; }
+
+        // copies every model out of the mapping once, further records of it become instances
+    std::shared_ptr<VoxelWorld> getWorld() const;
+private:
+    bool parse(const std::string& filename);
+    void unmap();
+
+    void *mapping = nullptr;
+    size_t mappingSize = 0;
+    std::vector<ObjectView> objects;
+};
+
+    // writes every object and instance of the world, false (and an error printed) if the file can't be written
+bool save_native_file(const std::string& filename, const VoxelWorld& world);
+    // NativeFile(filename).getWorld(), null if the file can't be loaded
+std::shared_ptr<VoxelWorld> load_native_file(const std::string& filename);
+}
@@ -4,26 +4,222 @@
 #include <vforge/worldobject.hpp>
 #include <vforge/internal.hpp>
 #include <vforge/chunk.hpp>
+#include <vforge/pool.hpp>
+#include <vforge/batch.hpp>
+#include <vforge/raycast.hpp>
+#include <vforge/distance.hpp>
+#include <vforge/shell.hpp>
+#include <vforge/pager.hpp>
+#include <vforge/generator.hpp>
 #include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <array>
+#include <vector>
+#include <unordered_map>
 
 namespace voxelforge {
 
 class VoxelObject : public WorldObject {
 public:
+    struct RebuildStats {
+        size_t rebuilds = 0;
+        size_t chunksRepacked = 0;
+        size_t bytesRepacked = 0;
+        size_t bytesUploaded = 0;
+    };
+
+        // voxels of each chunk in turn, chunks in ChunkMap (Z-)order
+    class VoxelIterator {
+    public:
+        VoxelIterator() = default;
+        VoxelIterator(ChunkMap::const_iterator it, ChunkMap::const_iterator end) : it(it), end(end) { this->skipEmpty(); }
+
+        VoxelEntry operator*() const { return *this->voxel; }
+        VoxelIterator& operator++() {
+            ++this->voxel;
+            if (this->voxel.done()) {
+                ++this->it;
+                this->skipEmpty();
+            }
+            return *this;
+        }
+
+        bool operator==(const VoxelIterator& other) const { return this->it == other.it && this->voxel == other.voxel; }
+        bool operator!=(const VoxelIterator& other) const { return !(*this == other); }
+    private:
+        void skipEmpty() {
+            for (; this->it != this->end; ++this->it) {
+                if (!this->it->second) continue;
+                this->voxel = VoxelChunk::VoxelIterator(this->it->second.get(), this->it->first * 16u);
+                if (!this->voxel.done()) return;
+            }
+            this->voxel = VoxelChunk::VoxelIterator();
+        }
+
+        ChunkMap::const_iterator it, end;
+        VoxelChunk::VoxelIterator voxel;
+    };
+
     VoxelObject(unsigned int dX, unsigned int dY, unsigned int dZ, glm::mat4x4 modelMatrix = glm::mat4x4(1.0f));
     VoxelObject(glm::uvec3 dim, glm::mat4x4 modelMatrix = glm::mat4x4(1.0f));
 
     void rebuild();
 
-    void set(glm::uvec3 position, std::shared_ptr<voxelforge::VoxelData> vox);
+    void set(glm::uvec3 position, voxelforge::VoxelData vox);
+    void set(glm::uvec3 position, std::shared_ptr<voxelforge::VoxelData> vox) { if (vox) this->set(position, *vox); else this->clear(position); }
+    std::optional<voxelforge::VoxelData> get(glm::uvec3 position) const;
+    void clear(glm::uvec3 position);
     void clear();
 
+        // between beginConcurrentEdits() and endConcurrentEdits(), set() and clear() may be called from any number of
+        // threads at once, and nothing else may be called. chunks are locked in shards, so threads working on different
+        // chunks rarely wait for each other; edits outside the object and all edits of a paged object take turns. each
+        // shard gathers the dirty state of its edits, endConcurrentEdits() merges it into the object and drops the
+        // chunks the edits left empty
+    void beginConcurrentEdits();
+    void endConcurrentEdits();
+
+        // replaces the whole chunk at chunk position `position`, the object takes it over. null or empty removes the chunk
+    void setChunk(glm::uvec3 position, std::shared_ptr<voxelforge::VoxelChunk> chunk);
+
+        // applies and empties the batch, touching each chunk once
+    void apply(VoxelEditBatch& batch);
+
+        // replaces the voxels in the box [offset, offset + dims) with a dense grid of material ids (x fastest, then y,
+        // then z, 0 = empty), as voxels with a zero normal. the box is clipped to the object. chunks are built on up to
+        // `workers` threads (0 = one per core), new chunks that would stay empty cost a single scan. T is uint8_t or uint16_t
+    template <typename T>
+    void importDense(const T *data, glm::uvec3 dims, glm::uvec3 offset = glm::uvec3(0), unsigned int workers = 0);
+        // the reverse of importDense(): fills the grid with the material ids in the box, 0 where empty or outside the object
+    template <typename T>
+    void exportDense(T *data, glm::uvec3 dims, glm::uvec3 offset = glm::uvec3(0), unsigned int workers = 0) const;
+
     void setMaterial(uint32_t index, glm::vec4 material);
+        // color of a material as the shader sees it, ids past the material table read as black
+    glm::vec4 getMaterial(uint32_t index) const { return index < this->materials.size() ? this->materials[index] : glm::vec4(0.0f); }
+
+        // world space ray query, distance in world units
+    RaycastHit raycast(glm::vec3 origin, glm::vec3 direction, float maxDistance = std::numeric_limits<float>::infinity()) const;
+        // traces many rays on up to `workers` threads (0 = one per core). neighbouring rays are traced as one packet, so keep coherent rays together
+    std::vector<RaycastHit> raycast(const std::vector<Ray>& rays, unsigned int workers = 0, RaycastKernel kernel = RaycastKernel::Auto) const;
+        // the queries above with the object placed at `modelMatrix` instead of its own transform, see VoxelInstance
+    RaycastHit raycastAt(const glm::mat4& modelMatrix, glm::vec3 origin, glm::vec3 direction, float maxDistance = std::numeric_limits<float>::infinity()) const;
+    std::vector<RaycastHit> raycastAt(const glm::mat4& modelMatrix, const std::vector<Ray>& rays, unsigned int workers = 0, RaycastKernel kernel = RaycastKernel::Auto) const;
+        // ray query in object voxel space, where voxel (x, y, z) spans [x, x+1) etc. distance is in units of `direction`
+    RaycastHit raycastVoxels(glm::vec3 origin, glm::vec3 direction, float maxDistance = std::numeric_limits<float>::infinity()) const;
+
+        // distance field raycasts use to skip empty space. the first call builds it, later calls only recompute the
+        // region around chunks edited since. raycasts ignore the field while edits are pending. the field takes one byte
+        // per voxel of the object's extent, empty or not, plus one per subchunk: 65 MiB for 64 x 4 x 64 chunks
+    void updateDistanceField(unsigned int maxDistance = 32);
+    void dropDistanceField() { this->distanceField.reset(); }
+    const DistanceField *getDistanceField() const { return this->distanceField.get(); }
+
+        // coarser copies of the object for distant views. level k has one voxel per 4^k voxels along each axis, holding
+        // the dominant material and averaged normal of the voxels one level finer, so each subchunk of a level is one
+        // voxel of the next. level 0 is the object itself. the first call builds levels 1 to `levels`, later calls only
+        // redo the parts over chunks edited since. levels are built on up to getWorkerCount() threads
+    void updateLOD(unsigned int levels = 2);
+    void dropLOD() { this->lods.clear(); }
+    unsigned int getLODCount() const { return 1 + this->lods.size(); }
+    const VoxelObject& getLOD(unsigned int level) const { return level == 0 ? *this : *this->lods[level - 1]; }
+        // transform that lays level `level` over the object placed at `modelMatrix`
+    glm::mat4 lodMatrix(unsigned int level, const glm::mat4& modelMatrix) const;
+        // coarsest level whose voxels, at the point of the object nearest the eye, project to at most `pixels` pixels of
+        // a viewport `viewportHeight` pixels high. 0 while edits are pending since the last updateLOD()
+    unsigned int selectLOD(const glm::mat4& modelMatrix, const glm::mat4& view, const glm::mat4& proj, float viewportHeight, float pixels = 1.0f) const;
+        // raycastAt() on level `level`. coarser levels are padded to whole chunks, the rays are clipped to the object's own extent
+    std::vector<RaycastHit> raycastLOD(unsigned int level, const glm::mat4& modelMatrix, const std::vector<Ray>& rays, unsigned int workers = 0, RaycastKernel kernel = RaycastKernel::Auto) const;
+
+        // voxels with at least one empty face neighbour, everything outside the object counts as empty (and is left out).
+        // chunks are processed on up to `workers` threads (0 = one per core), the result is in ChunkMap order
+    std::vector<ShellChunk> findShell(unsigned int workers = 0) const;
+        // copy of the object (voxels, materials and transform) without the voxels findShell() leaves out
+    std::shared_ptr<VoxelObject> extractShell(unsigned int workers = 0) const;
+
+    glm::mat4x4 getModelMatrix() const { return this->modelMatrix; }
+        // moving an object that is part of a VoxelWorld needs VoxelWorld::updateBounds() before its next spatial query
+    void setModelMatrix(glm::mat4x4 modelMatrix) { this->modelMatrix = modelMatrix; }
 
     virtual void draw(fglw::RenderTarget& fb, glm::mat4 view, glm::mat4 proj) override;
+        // draws the object's voxels at `modelMatrix` instead of its own transform, the GPU data is shared by every placement
+    void drawAt(fglw::RenderTarget& fb, glm::mat4 view, glm::mat4 proj, const glm::mat4& modelMatrix);
 
     glm::uvec3 size() const { return this->dim; }
 
+    const ChunkMap& getChunks() const { return this->chunks; }
+
+        // calls fn(position, subChunk) for every subchunk, `position` being the object space voxel at its corner.
+        // chunks come in ChunkMap order, subchunks within a chunk in bit order
+    template <typename F>
+    void forEachSubChunk(F&& fn) const {
+        for (const auto& [position, chunk] : this->chunks) {
+            if (chunk) chunk->forEachSubChunk(fn, position * 16u);
+        }
+    }
+        // calls fn(position, data) for every voxel in object space, in the same order as forEachSubChunk()
+    template <typename F>
+    void forEachVoxel(F&& fn) const {
+        for (const auto& [position, chunk] : this->chunks) {
+            if (chunk) chunk->forEachVoxel(fn, position * 16u);
+        }
+    }
+    internal::Range<VoxelIterator> voxels() const {
+        return {VoxelIterator(this->chunks.begin(), this->chunks.end()), VoxelIterator(this->chunks.end(), this->chunks.end())};
+    }
+        // CPU copy of the data last uploaded by rebuild()
+    const VoxelPool& getPool() const { return this->pool; }
+
+        // threads used to pack chunks in rebuild(), 0 = one per core
+    void setWorkerCount(unsigned int workers) { this->workers = workers; }
+    unsigned int getWorkerCount() const { return this->workers; }
+
+        // cumulative cost of rebuild(), reset to measure a single frame
+    const RebuildStats& getRebuildStats() const { return this->rebuildStats; }
+    void resetRebuildStats() { this->rebuildStats = RebuildStats(); }
+
+        // approximate heap footprint of the voxel hierarchy, excluding GPU-side buffers
+    size_t memoryUsage() const;
+        // re-encodes the chunks edited since the last call as compactly as they allow, see VoxelChunk::compress().
+        // rebuild() does this before packing, call it directly to shrink an object that isn't drawn
+    void compress(unsigned int workers = 0);
+
+        // out-of-core storage: keeps about `budget` bytes of chunks (by memoryUsage()) in memory and evicts the rest
+        // to a spill file at `path`, an anonymous temporary file if empty. false if the file can't be created.
+        // set(), get(), clear(), apply(), setChunk(), importDense(), exportDense() and rebuild() page chunks back in
+        // as they need them, so get() is no longer safe to call from several threads at once. everything else
+        // (raycasts, iteration, getChunks(), findShell(), the distance field and levels of detail) only sees the
+        // resident chunks, page a region in with prefetch() first. a drawn object keeps its packed copy regardless,
+        // save_native_file() reads the paged-out chunks from the spill file
+    bool enablePaging(size_t budget, const std::string& path = "");
+        // reads every chunk back and closes the spill file
+    void disablePaging();
+        // reads the paged-out chunks within `radius` chunks of voxel `focus` on a background thread, nearest first and
+        // up to half the budget. they become resident on the next access to a paged-out chunk or prefetch() call
+    void prefetch(glm::uvec3 focus, unsigned int radius);
+        // null unless paging is enabled
+    const ChunkPager *getPager() const { return this->pager.get(); }
+
+        // procedural content: the chunk positions that hold no chunk now are filled by `generator` the first time
+        // something needs them. get(), set(), clear(), apply(), importDense(), exportDense() and raycasts generate the
+        // chunks they reach on the spot, on the threads that reach them. rebuild() draws what is there and queues the
+        // rest to `workers` background threads (0 = one per core), later rebuild() calls pick up what they finished, so
+        // a drawn object fills in over the frames that follow. iteration, getChunks(), findShell(), the distance field
+        // and the levels of detail only see generated chunks, generateAll() first to include everything; raycasts
+        // ignore the distance field until every chunk is in. objects too large for a dense ChunkMap (see ChunkMap) only
+        // see the chunks get() and raycasts generate from the next rebuild() or generateAll() on. clear() empties the
+        // object for good. null drops the generator, the chunks it didn't get to stay empty
+    void setGenerator(std::shared_ptr<ChunkGenerator> generator, unsigned int workers = 0);
+        // queues the chunks within `radius` chunks of voxel `focus` that weren't generated yet for the background
+        // threads, nearest first and ahead of everything queued before
+    void requestChunks(glm::uvec3 focus, unsigned int radius);
+        // generates every chunk that is left now, on up to getWorkerCount() threads
+    void generateAll();
+        // null without a generator
+    const ChunkGeneration *getGeneration() const { return this->generation.get(); }
+
 protected:
     struct VertexLayout {
         glm::vec3 aPosition;
@@ -35,20 +231,88 @@ protected:
     };
 
 private:
+    void initGL();
+        // the raytrace program and the unit cube are the same for every object, they are made on the first initGL()
+        // and kept while any object uses them
+    static std::shared_ptr<fglw::ShaderProgram> sharedShader();
+    static std::shared_ptr<fglw::TriangleMesh<VertexLayout>> sharedCube();
+    glm::mat4 voxelFromWorld(const glm::mat4& modelMatrix) const;
+    RaycastHit raycastWorld(const glm::mat4& toVoxels, const Ray& ray) const;
+    const DistanceField *currentDistanceField() const {
+        return this->distanceFieldDirty || (this->generation && !this->generation->isSettled()) ? nullptr : this->distanceField.get();
+    }
+    void markDirty(glm::uvec3 chunkPosition, std::shared_ptr<voxelforge::VoxelChunk> chunk);
+    void upload();
+    void setVoxel(glm::uvec3 position, const VoxelData& vox);
+    void clearVoxel(glm::uvec3 position);
+        // set() (`vox` non-null) or clear() between beginConcurrentEdits() and endConcurrentEdits()
+    void editConcurrent(glm::uvec3 position, const VoxelData *vox);
+        // installs the generated chunk at `chunkPosition` unless it was generated already
+    void generateChunk(glm::uvec3 chunkPosition);
+        // marks the chunks generated since the last call dirty, installing the ones the background threads made
+    void installGenerated();
+        // generates the chunks a ray in voxel space passes through, before it is traced
+    void generateAlong(glm::vec3 origin, glm::vec3 direction, float maxDistance) const;
+
     glm::uvec3 dim;
-    std::unordered_map<glm::uvec3, std::shared_ptr<voxelforge::VoxelChunk>, internal::uvec3Hash> chunks;
+    ChunkMap chunks;
+    VoxelPool pool;
+    glm::uvec3 subChunkExtent = glm::uvec3(0);
+    glm::uvec3 voxelExtent = glm::uvec3(0);
+
     fglw::Texture3D chunkData;
     fglw::Texture3D subChunkData;
     fglw::Texture3D voxelData;
     fglw::Texture1D materialData;
     std::array<glm::vec4, 256> materials;
 
-    fglw::TriangleMesh<VertexLayout> meshRenderer;
-    fglw::ShaderProgram voxelRTShader;
+    std::shared_ptr<fglw::TriangleMesh<VertexLayout>> meshRenderer;
+    std::shared_ptr<fglw::ShaderProgram> voxelRTShader;
 
     glm::mat4x4 modelMatrix;
 
     bool ready = false;
-    std::unordered_map<glm::uvec3, std::shared_ptr<voxelforge::VoxelChunk>, internal::uvec3Hash> modificationCache;
+    bool glReady = false;
+    bool fullRebuild = true;
+    bool materialsDirty = true;
+        // chunks changed since the last rebuild, null when the chunk was removed
+    ChunkMap modificationCache;
+    RebuildStats rebuildStats;
+    unsigned int workers = 0;
+
+    std::unique_ptr<DistanceField> distanceField;
+        // chunks [lo, hi) edited since the distance field was last updated
+    bool distanceFieldDirty = false;
+    glm::uvec3 distanceDirtyLo = glm::uvec3(0);
+    glm::uvec3 distanceDirtyHi = glm::uvec3(0);
+
+    std::vector<std::unique_ptr<VoxelObject>> lods;
+        // chunks [lo, hi) edited since the levels of detail were last updated
+    bool lodDirty = false;
+    glm::uvec3 lodDirtyLo = glm::uvec3(0);
+    glm::uvec3 lodDirtyHi = glm::uvec3(0);
+
+        // chunks [lo, hi) edited since the last compress()
+    bool compressDirty = false;
+    glm::uvec3 compressDirtyLo = glm::uvec3(0);
+    glm::uvec3 compressDirtyHi = glm::uvec3(0);
+
+        // one shard of concurrent edits: the lock of its chunks and the dirty state of their edits
+    struct alignas(64) EditShard {
+        std::mutex mutex;
+        bool dirty = false;
+        glm::uvec3 lo = glm::uvec3(0);
+        glm::uvec3 hi = glm::uvec3(0);
+        std::vector<glm::uvec3> emptied;    // chunks left without voxels
+    };
+    static constexpr unsigned int EDIT_SHARDS = 256;
+        // non-null while concurrent edits are on, one more shard for the edits that take turns
+    std::unique_ptr<EditShard[]> editShards;
+
+        // chunks still to be made on first use, null without a generator
+    std::unique_ptr<ChunkGeneration> generation;
+
+        // last, it refers to `chunks` and `modificationCache`
+    std::unique_ptr<ChunkPager> pager;
 };
 }
\ No newline at end of file
@@ -0,0 +1,161 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vforge/chunk.hpp>
+#include <vforge/chunkmap.hpp>
+#include <vforge/internal.hpp>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace voxelforge {
+
+/**
+ * Out-of-core storage for the chunks of an object, see VoxelObject::enablePaging().
+ *
+ * The chunks in the object's ChunkMap are resident, each counting its memoryUsage() against the budget. Once they
+ * exceed it, a clock sweep (second chance, an approximation of LRU) evicts chunks that weren't accessed since the hand
+ * last passed them to a spill file. Chunks waiting for the next rebuild() (the `pinned` map) stay resident.
+ *
+ * Records are written compressed (VoxelChunk::compress()) into power of two slots of the file, freed slots are reused
+ * by later records of the same size. A chunk read back keeps its record until it is edited, so evicting it unchanged
+ * writes nothing.
+ *
+ * prefetch() reads and decodes records on a background thread; they are installed by the next fault or prefetch().
+ * Everything else has to be called from the thread that owns the object.
+ */
+class ChunkPager {
+public:
+    struct Stats {
+        size_t hits = 0;            // accesses to resident chunks
+        size_t prefetchHits = 0;    // accesses to paged-out chunks a prefetch had already read
+        size_t faults = 0;          // accesses that had to read the chunk back
+        size_t evictions = 0;
+        size_t prefetched = 0;      // chunks installed by prefetches, used or not
+        uint64_t bytesIn = 0;       // spill file bytes read, prefetches included
+        uint64_t bytesOut = 0;      // and written
+        double faultSeconds = 0.0;  // total and worst time of the faults that read the file
+        double maxFaultSeconds = 0.0;
+
+        double hitRate() const {
+            size_t accesses = this->hits + this->prefetchHits + this->faults;
+            return accesses ? (double)(this->hits + this->prefetchHits) / accesses : 1.0;
+        }
+    };
+
+        // spill file at `path`, an anonymous temporary file if empty. the file is removed again on destruction
+    ChunkPager(ChunkMap& chunks, const ChunkMap& pinned, size_t budget, const std::string& path = "");
+    ~ChunkPager();
+    ChunkPager(const ChunkPager&) = delete;
+    ChunkPager& operator=(const ChunkPager&) = delete;
+
+        // false if the spill file couldn't be created
+    bool isOpen() const { return this->file != nullptr; }
+
+        // an access to the chunk at `position`, paged back in if it was evicted
+    void access(glm::uvec3 position);
+        // the chunk at `position` was created or edited in the ChunkMap, or removed from it (null) and the spill file
+    void edited(glm::uvec3 position, const std::shared_ptr<VoxelChunk>& chunk);
+        // queues the paged-out chunks within `radius` chunks of `center`, nearest first, up to half the budget
+    void prefetch(glm::uvec3 center, unsigned int radius);
+        // reads every paged-out chunk back, regardless of the budget
+    void pageInAll();
+        // forgets every chunk, the ChunkMap was cleared
+    void clear();
+        // every chunk, paged out or not, without paging anything in: a copy of the ChunkMap plus the paged-out chunks
+        // decoded from the spill file. for readers that need the whole object once, like save_native_file()
+    ChunkMap snapshot() const;
+
+        // the budget isn't enforced between suspendEviction() and the matching resumeEviction(), for operations that
+        // need a whole region of chunks resident at once
+    void suspendEviction() { this->held++; }
+    void resumeEviction() { if (--this->held == 0) this->trim(); }
+
+        // evicts until the resident chunks fit the budget, never the chunk at `keep`
+    void trim(glm::uvec3 keep = glm::uvec3(~0u));
+
+    bool isPagedOut(glm::uvec3 position) const;
+    size_t getBudget() const { return this->budget; }
+    size_t getResidentBytes() const { return this->residentBytes; }
+    size_t getResidentCount() const { return this->ring.size(); }
+    size_t getPagedOutCount() const;
+
+    const Stats& getStats() const { return this->stats; }
+    void resetStats() { this->stats = Stats(); }
+
+        // chunk <-> spill record, exposed for tests
+    static void encode(VoxelChunk& chunk, std::vector<uint8_t>& out);
+    static std::shared_ptr<VoxelChunk> decode(const uint8_t *data, size_t size);
+private:
+        // a chunk in the spill file, `version` changes whenever it is rewritten
+    struct Record {
+        uint64_t offset;
+        uint32_t size;
+        uint32_t sizeClass;
+        uint64_t version;
+        size_t memory;      // memoryUsage() when it was evicted
+    };
+        // a resident chunk
+    struct Slot {
+        glm::uvec3 position;
+        size_t bytes;
+        bool referenced;    // accessed since the clock hand last passed
+        bool dirty;         // differs from its record, if there is one
+        bool stale;         // edited since `bytes` was measured
+    };
+    struct Prefetched {
+        glm::uvec3 position;
+        uint64_t version;
+        uint32_t size;
+        std::shared_ptr<VoxelChunk> chunk;
+    };
+
+    void fault(glm::uvec3 position);
+    void admit(glm::uvec3 position, const std::shared_ptr<VoxelChunk>& chunk, bool dirty);
+    bool evict(size_t slot);
+    void removeSlot(size_t slot);
+
+        // the following need `mutex` held
+    void installPrefetched();
+    void dropRecord(glm::uvec3 position);
+    bool readRecord(const Record& record, std::vector<uint8_t>& out) const;
+    bool writeRecord(glm::uvec3 position, const std::vector<uint8_t>& data, size_t memory);
+
+    void prefetchLoop();
+
+    ChunkMap& chunks;
+    const ChunkMap& pinned;
+    size_t budget;
+    std::string path;
+    std::FILE *file = nullptr;
+
+        // resident chunks, owner thread only
+    std::vector<Slot> ring;
+    std::unordered_map<glm::uvec3, uint32_t, internal::uvec3Hash> slots;
+    std::vector<glm::uvec3> stale;
+    size_t hand = 0;
+    size_t residentBytes = 0;
+    unsigned int held = 0;
+    bool failed = false;        // writing the spill file failed, nothing is evicted anymore
+    Stats stats;
+
+        // spill file, shared with the prefetch thread under `mutex`
+    mutable std::mutex mutex;
+    std::unordered_map<glm::uvec3, Record, internal::uvec3Hash> records;
+    std::vector<std::vector<uint64_t>> freeSlots;   // offsets of free slots of 2^k bytes, by k
+    uint64_t fileEnd = 0;
+    uint64_t nextVersion = 1;
+
+    std::thread worker;
+    std::condition_variable wake;
+    bool stopping = false;
+    std::vector<glm::uvec3> requests;               // nearest last
+    std::vector<Prefetched> prefetched;
+};
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vforge/chunk.hpp>
+#include <vforge/voxel.hpp>
+#include <optional>
+#include <vector>
+
+namespace voxelforge {
+
+/**
+ * Sparse GPU layout of a VoxelObject, built on the CPU without needing a GL context.
+ *
+ * chunk table:     one entry per chunk cell, (bitmask lo, bitmask hi, subchunk pool base, 0)
+ * subchunk pool:   one entry per occupied subchunk, (bitmask lo, bitmask hi, voxel pool base, 0)
+ * voxel pool:      one VoxelData per occupied voxel
+ *
+ * Subchunk `i` of a chunk lives at its base + internal::bitRank(chunk bitmask, i), voxels are found the same way.
+ * The pools are padded to the extent of the textures they are uploaded to, see textureExtent().
+ *
+ * Every chunk owns a segment of each pool, so single chunks can be repacked in place with update().
+ * The ranges touched since the last clearDirty() are tracked so only those need to be uploaded.
+ */
+class VoxelPool {
+public:
+        // pools are stored in WIDTH x WIDTH x N textures, keep in sync with POOL_WIDTH in voxel-raytracing.glsl
+    static constexpr unsigned int WIDTH = 256;
+
+        // half-open range of pool entries
+    struct Range {
+        uint32_t begin;
+        uint32_t end;
+    };
+
+    VoxelPool(glm::uvec3 dim = glm::uvec3(0));
+
+        // repacks every chunk, tightly, on up to `workers` threads (0 = one per core)
+    void pack(const ChunkMap& chunks, unsigned int workers = 1);
+        // repacks only the given chunks, a null or empty chunk removes that chunk from the pool
+    void update(const ChunkMap& dirty, unsigned int workers = 1);
+
+        // reads a voxel back through the packed layout, the same way the shader does
+    std::optional<VoxelData> lookup(glm::uvec3 position) const;
+        // the same lookup on a layout stored elsewhere, e.g. a mapped file
+    static std::optional<VoxelData> lookup(glm::uvec3 dim, const glm::uvec4 *chunkTable, const glm::uvec4 *subChunkPool, const VoxelData *voxelPool, glm::uvec3 position);
+
+    glm::uvec3 getDim() const { return this->dim; }
+    const std::vector<glm::uvec4>& getChunkTable() const { return this->chunkTable; }
+    const std::vector<glm::uvec4>& getSubChunkPool() const { return this->subChunkPool; }
+    const std::vector<VoxelData>& getVoxelPool() const { return this->voxelPool; }
+
+    size_t subChunkCount() const { return this->numSubChunks; }
+    size_t voxelCount() const { return this->numVoxels; }
+
+    glm::uvec3 subChunkExtent() const { return textureExtent(this->subChunkTop); }
+    glm::uvec3 voxelExtent() const { return textureExtent(this->voxelTop); }
+
+        // true when freed segments waste more of the pools than a full pack() would reclaim
+    bool needsCompaction() const;
+
+        // chunk table offsets and pool ranges written since the last clearDirty(), sorted and merged
+    const std::vector<size_t>& getDirtyChunks() const { return this->dirtyChunks; }
+    std::vector<Range> getDirtySubChunkRanges() const { return merge(this->dirtySubChunks); }
+    std::vector<Range> getDirtyVoxelRanges() const { return merge(this->dirtyVoxels); }
+        // set by pack(), the whole layout changed
+    bool isFullyDirty() const { return this->fullyDirty; }
+    void clearDirty();
+
+        // total bytes of pool data written by pack() and update()
+    size_t bytesRepacked() const { return this->repackedBytes; }
+
+        // texture size needed to hold `entries` pool entries
+    static glm::uvec3 textureExtent(size_t entries);
+
+        // bytes of texel data this layout uploads
+    size_t memoryUsage() const;
+        // bytes of texel data the dense per-voxel layout needs for the same object
+    static size_t denseMemoryUsage(glm::uvec3 dim);
+
+private:
+    struct Segment {
+        uint32_t base = 0;
+        uint32_t capacity = 0;
+        uint32_t count = 0;
+    };
+    struct ChunkSlot {
+        Segment subChunks;
+        Segment voxels;
+    };
+
+    static uint32_t allocate(std::vector<Range>& freeList, uint32_t& top, uint32_t count);
+    static void release(std::vector<Range>& freeList, Segment& segment);
+    static std::vector<Range> merge(std::vector<Range> ranges);
+
+    size_t writeChunk(size_t offset, const VoxelChunk *chunk);
+    void writeChunks(const std::vector<std::pair<size_t, const VoxelChunk *>>& chunks, unsigned int workers);
+    void growPools();
+
+    glm::uvec3 dim;
+
+    std::vector<glm::uvec4> chunkTable;
+    std::vector<glm::uvec4> subChunkPool;
+    std::vector<VoxelData> voxelPool;
+
+    std::vector<ChunkSlot> slots;
+    std::vector<Range> freeSubChunks;
+    std::vector<Range> freeVoxels;
+    uint32_t subChunkTop = 0;
+    uint32_t voxelTop = 0;
+
+    size_t numSubChunks = 0;
+    size_t numVoxels = 0;
+
+    std::vector<size_t> dirtyChunks;
+    std::vector<Range> dirtySubChunks;
+    std::vector<Range> dirtyVoxels;
+    bool fullyDirty = true;
+    size_t repackedBytes = 0;
+};
+}
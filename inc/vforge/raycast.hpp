@@ -0,0 +1,40 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vforge/voxel.hpp>
+#include <limits>
+
+namespace voxelforge {
+
+struct Ray {
+    Ray(glm::vec3 origin, glm::vec3 direction, float maxDistance = std::numeric_limits<float>::infinity()) : origin(origin), direction(direction), maxDistance(maxDistance) {}
+
+    glm::vec3 origin;
+    glm::vec3 direction;
+    float maxDistance;
+};
+
+struct RaycastHit {
+    bool hit = false;
+
+    glm::uvec3 voxel = glm::uvec3(0);   // voxel coordinates inside the object
+    glm::ivec3 normal = glm::ivec3(0);  // face the ray entered through, in object voxel space. zero if the ray started inside the voxel
+    float distance = 0.0f;              // along the ray, in the units of the ray direction
+    VoxelData data;
+
+    uint32_t steps = 0;                 // traversal iterations, also counted for misses
+
+    explicit operator bool() const { return this->hit; }
+};
+
+    // traversal used for batched ray queries. every kernel returns exactly the same hits, kernels the CPU doesn't support fall back to the widest one it does
+enum class RaycastKernel {
+    Auto,       // widest one the CPU supports
+    Scalar,     // one ray at a time
+    SSE41,      // packets of 4 rays
+    AVX2,       // packets of 8 rays
+};
+
+    // widest packet kernel the running CPU supports
+RaycastKernel bestRaycastKernel();
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <vforge/world.hpp>
+#include <vector>
+
+namespace voxelforge {
+
+/**
+ * Draws a VoxelWorld on the CPU, without a GL context, e.g. for thumbnails on headless machines.
+ * Shows the same thing VoxelWorld::draw does: the unlit material color of the nearest voxel and its depth.
+ * The image is split into tiles that are traced on all cores with work stealing.
+ */
+class VoxelRenderer {
+public:
+    struct RenderStats {
+        double seconds = 0.0;
+        uint64_t rays = 0;      // one per pixel, like the RPS the test apps print
+        uint64_t steps = 0;     // traversal iterations over every ray and object
+
+        double raysPerSecond() const { return this->seconds > 0.0 ? this->rays / this->seconds : 0.0; }
+    };
+
+    VoxelRenderer(unsigned int width, unsigned int height);
+
+    void render(const VoxelWorld& world, glm::mat4 view, glm::mat4 proj);
+
+    unsigned int width() const { return this->w; }
+    unsigned int height() const { return this->h; }
+
+        // row major, top row first
+    const std::vector<glm::vec4>& getColor() const { return this->color; }
+        // window space depth in [0, 1] as gl_FragDepth would write it, 1 where nothing was hit
+    const std::vector<float>& getDepth() const { return this->depth; }
+
+        // binary PPM of the color buffer
+    bool savePPM(const char *filename) const;
+
+    void setClearColor(glm::vec4 clearColor) { this->clearColor = clearColor; }
+        // edge length of a tile in pixels
+    void setTileSize(unsigned int tileSize) { this->tileSize = tileSize ? tileSize : 1; }
+        // 0 = one per core
+    void setWorkerCount(unsigned int workers) { this->workers = workers; }
+        // traces objects with levels of detail at the coarsest level whose voxels cover at most `pixels` pixels, see
+        // VoxelObject::selectLOD(). 0 (the default) always traces the full resolution
+    void setLODPixels(float pixels) { this->lodPixels = pixels; }
+
+    const RenderStats& getRenderStats() const { return this->stats; }
+private:
+    unsigned int w, h;
+    std::vector<glm::vec4> color;
+    std::vector<float> depth;
+
+    glm::vec4 clearColor = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+    unsigned int tileSize = 32;
+    unsigned int workers = 0;
+    float lodPixels = 0.0f;
+    RenderStats stats;
+};
+}
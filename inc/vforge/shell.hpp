@@ -0,0 +1,15 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <array>
+#include <cstdint>
+
+namespace voxelforge {
+
+    // the voxels of one chunk that have at least one empty face neighbour, and so can be seen from outside
+struct ShellChunk {
+    glm::uvec3 position = glm::uvec3(0);    // chunk position
+    uint64_t subChunks = 0;                 // subchunks with shell voxels, same bit order as VoxelChunk
+    std::array<uint64_t, 64> voxels = {};   // shell voxels, indexed by subchunk bit
+};
+}
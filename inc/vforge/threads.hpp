@@ -0,0 +1,120 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+namespace voxelforge {
+
+    // worker count used when 0 is requested
+inline unsigned int defaultWorkerCount() {
+    unsigned int n = std::thread::hardware_concurrency();
+    return n ? n : 1;
+}
+
+/**
+ * Calls fn(begin, end) over [0, count) in blocks of `grain`, on up to `workers` threads (0 = one per core).
+ * Blocks are handed out dynamically, the calling thread takes part and the call returns when all blocks are done.
+ */
+template <typename F>
+void parallelFor(size_t count, unsigned int workers, size_t grain, F&& fn) {
+    if (count == 0) return;
+    if (workers == 0) workers = defaultWorkerCount();
+    grain = std::max<size_t>(grain, 1);
+
+    size_t blocks = (count + grain - 1) / grain;
+    if (workers > blocks) workers = blocks;
+    if (workers <= 1) {
+        fn((size_t)0, count);
+        return;
+    }
+
+    std::atomic<size_t> next(0);
+    auto work = [&]() {
+        for (;;) {
+            size_t block = next.fetch_add(1, std::memory_order_relaxed);
+            if (block >= blocks) break;
+            fn(block * grain, std::min(count, (block + 1) * grain));
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(workers - 1);
+    for (unsigned int i = 1; i < workers; i++) threads.emplace_back(work);
+    work();
+    for (auto& thread : threads) thread.join();
+}
+
+/**
+ * Calls fn(index) for every index in [0, count) on up to `workers` threads (0 = one per core).
+ * Each thread starts on its own contiguous share of the indices and works through it in order. A thread that runs
+ * out steals the back half of the largest remaining share, so neighbouring items mostly stay on one thread while
+ * uneven work (e.g. image tiles covering very different amounts of geometry) still gets balanced.
+ */
+template <typename F>
+void workStealingFor(size_t count, unsigned int workers, F&& fn) {
+    if (count == 0) return;
+    if (workers == 0) workers = defaultWorkerCount();
+    if (workers > count) workers = count;
+    if (workers <= 1) {
+        for (size_t i = 0; i < count; i++) fn(i);
+        return;
+    }
+
+        // [begin, end) packed into one word so owner and thieves can both update it with a CAS
+    struct alignas(64) Share {
+        std::atomic<uint64_t> range;
+    };
+    auto pack = [](uint64_t begin, uint64_t end) { return begin | (end << 32); };
+    std::vector<Share> shares(workers);
+    for (unsigned int i = 0; i < workers; i++) {
+        shares[i].range.store(pack(count * i / workers, count * (i + 1) / workers), std::memory_order_relaxed);
+    }
+
+    auto work = [&](unsigned int self) {
+        for (;;) {
+                // own share, front to back
+            uint64_t range = shares[self].range.load(std::memory_order_acquire);
+            while ((uint32_t)range < (range >> 32)) {
+                uint64_t begin = (uint32_t)range;
+                if (shares[self].range.compare_exchange_weak(range, pack(begin + 1, range >> 32), std::memory_order_acq_rel)) {
+                    fn((size_t)begin);
+                    range = shares[self].range.load(std::memory_order_acquire);
+                }
+            }
+
+                // steal the back half of the largest share left
+            bool stolen = false;
+            while (!stolen) {
+                unsigned int victim = self;
+                uint64_t victimRange = 0, most = 0;
+                for (unsigned int i = 0; i < workers; i++) {
+                    uint64_t r = shares[i].range.load(std::memory_order_acquire);
+                    uint64_t left = (r >> 32) - std::min<uint64_t>((uint32_t)r, r >> 32);
+                    if (i != self && left > most) {
+                        most = left;
+                        victim = i;
+                        victimRange = r;
+                    }
+                }
+                if (victim == self) return;
+
+                uint64_t begin = (uint32_t)victimRange, end = victimRange >> 32;
+                uint64_t middle = begin + (end - begin) / 2;
+                if (shares[victim].range.compare_exchange_strong(victimRange, pack(begin, middle), std::memory_order_acq_rel)) {
+                    shares[self].range.store(pack(middle, end), std::memory_order_release);
+                    stolen = true;
+                }
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(workers - 1);
+    for (unsigned int i = 1; i < workers; i++) threads.emplace_back(work, i);
+    work(0);
+    for (auto& thread : threads) thread.join();
+}
+}
@@ -1,6 +1,9 @@
 #include "chunk.hpp"
 #include "voxel.hpp"
 #include "object.hpp"
+#include "instance.hpp"
 #include "world.hpp"
 #include "worldobject.hpp"
-#include "vox_file.hpp"
\ No newline at end of file
+#include "vox_file.hpp"
+#include "native_file.hpp"
+#include "renderer.hpp"
\ No newline at end of file
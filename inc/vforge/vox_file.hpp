@@ -11,7 +11,8 @@ namespace voxelforge::files {
  */
 class MagicaVoxelVOX {
 public:
-    MagicaVoxelVOX(const char *filename);
+        // the shapes are decoded and built on up to `workers` threads (0 = one per core), the objects come out in the same order whatever the count
+    MagicaVoxelVOX(const char *filename, unsigned int workers = 0);
 
     std::shared_ptr<voxelforge::VoxelWorld> getWorld() { return this->world; }
 private:
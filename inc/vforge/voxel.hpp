@@ -1,13 +1,25 @@
 #pragma once
 
 #include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+#include <cstdint>
 
 namespace voxelforge {
 
+/**
+ * Compact by-value voxel record (8 bytes).
+ * The normal is stored quantized as 10:10:10 signed-normalized components.
+ */
 struct VoxelData {
-    VoxelData(glm::vec3 norm, uint32_t mat) : normal(norm), matID(mat) {}
+    VoxelData() : packedNormal(0), matID(0) {}
+    VoxelData(glm::vec3 norm, uint32_t mat) : packedNormal(glm::packSnorm3x10_1x2(glm::vec4(norm, 0.0f))), matID(mat) {}
 
-    glm::vec3 normal;
+    glm::vec3 normal() const { return glm::vec3(glm::unpackSnorm3x10_1x2(this->packedNormal)); }
+
+    bool operator==(const VoxelData& other) const { return this->packedNormal == other.packedNormal && this->matID == other.matID; }
+    bool operator!=(const VoxelData& other) const { return !(*this == other); }
+
+    uint32_t packedNormal;
     uint32_t matID;
 };
 }
\ No newline at end of file
@@ -1,23 +1,72 @@
 #pragma once
 
 #include <vforge/object.hpp>
+#include <vforge/instance.hpp>
+#include <vforge/bvh.hpp>
 #include <vforge/worldobject.hpp>
 #include <vector>
 
 namespace voxelforge {
 
+/**
+ * Objects and instances share one index space for the spatial queries, "items": objects first, in getObjects() order,
+ * then instances. The queries use a BVH over their world space bounds as of the last updateBounds(), which draw() calls.
+ */
 class VoxelWorld : public voxelforge::WorldObject {
 public:
+        // nearest hit of a world raycast, `item` is the object or instance it hit
+    struct Hit : RaycastHit {
+        size_t item = 0;
+    };
+
     VoxelWorld(std::vector<std::shared_ptr<voxelforge::VoxelObject>> objects) : objects(objects) {}
     VoxelWorld() : objects(0) {}
 
     uint32_t addObject(std::shared_ptr<voxelforge::VoxelObject> obj) {
         objects.push_back(obj);
+        this->bvhDirty = true;
         return objects.size() - 1;
     }
 
+    const std::vector<std::shared_ptr<voxelforge::VoxelObject>>& getObjects() const { return this->objects; }
+
+        // further placements of objects, drawn after all objects
+    uint32_t addInstance(std::shared_ptr<voxelforge::VoxelInstance> instance) {
+        instances.push_back(instance);
+        this->bvhDirty = true;
+        return instances.size() - 1;
+    }
+
+    const std::vector<std::shared_ptr<voxelforge::VoxelInstance>>& getInstances() const { return this->instances; }
+
+    size_t itemCount() const { return this->objects.size() + this->instances.size(); }
+        // voxels and transform of an item, null for a null object or instance
+    const VoxelObject *itemModel(size_t item) const;
+    glm::mat4 itemModelMatrix(size_t item) const;
+        // world space bounds of an item's transformed extent, empty for null items
+    AABB itemBounds(size_t item) const;
+
+        // rebuilds the BVH if items were added since the last call, otherwise refits it to the current transforms
+    void updateBounds();
+        // rebuilds the BVH, e.g. after many items moved far and refits left it loose
+    void rebuildBounds();
+        // refits the BVH after a single item moved, only the nodes above it are touched
+    void updateBounds(size_t item);
+    const ObjectBVH& getBVH() const { return this->bvh; }
+
+        // items whose bounds touch the view frustum, front to back by the distance of their bounds from the eye
+    std::vector<size_t> cull(glm::mat4 view, glm::mat4 proj) const;
+        // nearest voxel along the ray over all items, distance in units of `direction`
+    Hit raycast(glm::vec3 origin, glm::vec3 direction, float maxDistance = std::numeric_limits<float>::infinity()) const;
+        // items whose bounds overlap the box
+    std::vector<size_t> query(const AABB& box) const;
+
     virtual void draw(fglw::RenderTarget& fb, glm::mat4x4 view, glm::mat4x4 proj) override;
 private:
     std::vector<std::shared_ptr<voxelforge::VoxelObject>> objects;
+    std::vector<std::shared_ptr<voxelforge::VoxelInstance>> instances;
+
+    ObjectBVH bvh;
+    bool bvhDirty = true;
 };
 }
\ No newline at end of file
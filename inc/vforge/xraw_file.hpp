@@ -6,7 +6,10 @@
 namespace voxelforge::files {
 
 /**
- * UNFINISHED, DO NOT USE
+ * Loads a MagicaVoxel XRAW volume, swapping its z up to y up like the .vox loader.
+ * Palette indices become material ids and the palette the object's materials. Only 8-bit indices (0 being empty) are
+ * supported. The dense volume is streamed 16 layers at a time, so memory stays at one slab plus the sparse result.
+ * Returns null (and prints an error) if the file is missing, malformed or unsupported.
  */
 std::shared_ptr<voxelforge::VoxelObject> load_xraw_file(const std::string& filename);
 }
\ No newline at end of file
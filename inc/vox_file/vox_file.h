@@ -235,19 +235,16 @@ class VoxFile final {
   std::vector<VoxSparseModel>& sparseModels() noexcept { return sparse_models_; }
 
  private:
-  // Reads a 4-character ID from the file, and asserts that it matches the given one.
-  void ReadId(std::ifstream& file, const std::string& id) const;
-
-  // Reads the next chunk (RIFF-like structure)
-  void ReadChunk(std::ifstream& file);
-  void ReadMainChunk(std::ifstream& file, uint32_t contents_size,
-                     uint32_t children_size);
-  void ReadSizeChunk(std::ifstream& file, uint32_t contents_size,
-                     uint32_t children_size);
-  void ReadXyziChunk(std::ifstream& file, uint32_t contents_size,
-                     uint32_t children_size);
-  void ReadRgbaChunk(std::ifstream& file, uint32_t contents_size,
-                     uint32_t children_size);
+  // Asserts that the 4-character ID at `fid` matches the given one.
+  void ReadId(const uint8_t* fid, const std::string& id) const;
+
+  // Reads the next chunk (RIFF-like structure) from the in-memory file,
+  // advancing `cursor` past it. Throws if the chunk runs past `end`.
+  void ReadChunk(const uint8_t*& cursor, const uint8_t* end);
+  void ReadMainChunk(const uint8_t* children, uint32_t children_size);
+  void ReadSizeChunk(const uint8_t* contents, uint32_t contents_size);
+  void ReadXyziChunk(const uint8_t* contents, uint32_t contents_size);
+  void ReadRgbaChunk(const uint8_t* contents, uint32_t contents_size);
   void RemoveHiddenVoxels(VoxDenseModel& dense, VoxSparseModel& sparse,
                           const std::vector<Voxel>& voxels);
  private:
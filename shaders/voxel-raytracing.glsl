@@ -12,18 +12,61 @@ struct VoxelData {
     int matID;
 };
 
+    // keep in sync with VoxelPool::WIDTH
+const uint POOL_WIDTH = 256u;
+
+uint popcount32(uint v) {
+    v = v - ((v >> 1u) & 0x55555555u);
+    v = (v & 0x33333333u) + ((v >> 2u) & 0x33333333u);
+    return (((v + (v >> 4u)) & 0x0F0F0F0Fu) * 0x01010101u) >> 24u;
+}
+    // number of set bits below `index`, the slot of that bit in the packed pools
+uint bitRank(uvec2 bitmask, uint index) {
+    if (index < 32u) return popcount32(bitmask.x & ((1u << index) - 1u));
+    return popcount32(bitmask.x) + popcount32(bitmask.y & ((1u << (index - 32u)) - 1u));
+}
+bool hasBit(uvec2 bitmask, uint index) {
+    return 0u != ((index < 32u ? bitmask.x : bitmask.y) & (1u << (index % 32u)));
+}
+ivec3 poolTexel(uint slot) {
+    return ivec3(slot % POOL_WIDTH, (slot / POOL_WIDTH) % POOL_WIDTH, slot / (POOL_WIDTH * POOL_WIDTH));
+}
+
+    // (bitmask lo, bitmask hi, subchunk pool base, 0)
+uvec4 readChunk(vec3 loc_ws) {
+    return texelFetch(uChunkData, ivec3(floor(loc_ws)), 0);
+}
 uvec2 readChunkBitmask(vec3 loc_ws) {
-    return texelFetch(uChunkData, ivec3(floor(loc_ws)), 0).rg;
+    return readChunk(loc_ws).rg;
+}
+    // (bitmask lo, bitmask hi, voxel pool base, 0), zero for empty subchunks
+uvec4 readSubChunk(vec3 loc_ws) {
+    uvec4 chunk = readChunk(loc_ws);
+    uvec3 sc = uvec3(floor(loc_ws*4.0)) & 3u;
+    uint bitIndex = sc.x | (sc.y << 2u) | (sc.z << 4u);
+
+    if (!hasBit(chunk.rg, bitIndex)) return uvec4(0u);
+    return texelFetch(uSubChunkData, poolTexel(chunk.b + bitRank(chunk.rg, bitIndex)), 0);
 }
 uvec2 readSubChunkBitmask(vec3 loc_ws) {
-    return texelFetch(uSubChunkData, ivec3(floor(loc_ws*4.0)), 0).rg;
+    return readSubChunk(loc_ws).rg;
 }
 VoxelData readVoxelData(vec3 loc_ws) {
-    uvec4 texelData = texelFetch(uVoxelData, ivec3(floor(loc_ws*16.0)), 0);
+    uvec4 subChunk = readSubChunk(loc_ws);
+    uvec3 v = uvec3(floor(loc_ws*16.0)) & 3u;
+    uint bitIndex = v.x | (v.y << 2u) | (v.z << 4u);
 
     VoxelData data;
-    data.normal = uintBitsToFloat(texelData.xyz);
-    data.matID = int(texelData.a);
+    data.normal = vec3(0.0);
+    data.matID = 0;
+    if (!hasBit(subChunk.rg, bitIndex)) return data;
+
+    uvec2 texelData = texelFetch(uVoxelData, poolTexel(subChunk.b + bitRank(subChunk.rg, bitIndex)), 0).rg;
+
+        // 10:10:10 signed normalized normal
+    ivec3 n = (ivec3(texelData.xxx << uvec3(22u, 12u, 2u))) >> 22;
+    data.normal = clamp(vec3(n) / 511.0, -1.0, 1.0);
+    data.matID = int(texelData.y);
 
     return data;
 }
@@ -23,6 +23,7 @@
  ******************************************************************************/
 
 #include <vox_file/vox_file.h>
+#include <cstring>
 #include <fstream>
 #include <sstream>
 #include <vector>
@@ -30,29 +31,25 @@
 using namespace magicavoxel;
 using namespace std;
 
-// Reads a little-endian uint32 from a (binary) file
-uint32_t le_u32read(ifstream& file) {
-  char data[4];
-  file.read(data, 4);
-  return (static_cast<uint8_t>(data[0])) |
-         (static_cast<uint8_t>(data[1]) << 8) |
-         (static_cast<uint8_t>(data[2]) << 16) |
-         (static_cast<uint8_t>(data[3]) << 24);
+// Reads a little-endian uint32 from memory
+static uint32_t le_u32read(const uint8_t* data) {
+  return (static_cast<uint32_t>(data[0])) |
+         (static_cast<uint32_t>(data[1]) << 8) |
+         (static_cast<uint32_t>(data[2]) << 16) |
+         (static_cast<uint32_t>(data[3]) << 24);
 }
 
-// Reads a little-endian int32 from a (binary) file.
-int32_t le_i32read(ifstream& file) {
-  return static_cast<int32_t>(le_u32read(file));
-}
-
-int read_byte(ifstream& file) {
-  char byte;
-  file.read(&byte, 1);
-  return static_cast<int>(byte);
-}
-
-uint8_t read_uint8(ifstream& file) {
-  return static_cast<uint8_t>(read_byte(file));
+// Takes `size` bytes from the cursor, throwing if that runs past `end`.
+static const uint8_t* take(const uint8_t*& cursor, const uint8_t* end,
+                           size_t size, const char* what) {
+  if (size > static_cast<size_t>(end - cursor)) {
+    stringstream ss;
+    ss << "Unexpected end of file while reading " << what;
+    throw VoxException(ss.str());
+  }
+  const uint8_t* data = cursor;
+  cursor += size;
+  return data;
 }
 
 
@@ -64,27 +61,37 @@ VoxFile::VoxFile(bool load_dense, bool load_sparse, bool remove_hidden_voxels)
       palette_(kDefaultPalette) {}
 
 void VoxFile::Load(const std::string& path) {
-  ifstream file(path, ios::in | ios::binary);
+  // The whole file is read with one bulk read and parsed from memory.
+  ifstream file(path, ios::in | ios::binary | ios::ate);
+  if (!file.is_open()) throw VoxException("Could not open '" + path + "'");
+
+  vector<uint8_t> buffer(static_cast<size_t>(file.tellg()));
+  file.seekg(0);
+  file.read(reinterpret_cast<char*>(buffer.data()), buffer.size());
+  if (!file) throw VoxException("Could not read '" + path + "'");
+
   dense_models_.clear();
-  ReadId(file, "VOX ");
-  auto version = le_i32read(file);
+  sparse_models_.clear();
+
+  const uint8_t* cursor = buffer.data();
+  const uint8_t* end = buffer.data() + buffer.size();
+  ReadId(take(cursor, end, 4, "file ID"), "VOX ");
+  auto version = le_u32read(take(cursor, end, 4, "version"));
+  (void)version;
 
   // Read MAIN chunk. If the file has other chunks beyond MAIN, we are ignoring
   // them currently. (Current 3.x format appears to only have MAIN though, with
   // its child chunks.)
-  ReadChunk(file);  
+  ReadChunk(cursor, end);
 
   for (auto& model : dense_models_) {
     model.palette() = palette_;
   }
 }
 
-void VoxFile::ReadId(ifstream& file, const string& id) const {
+void VoxFile::ReadId(const uint8_t* fid, const string& id) const {
   if (id.length() != 4) throw std::logic_error("ID must be 4 characters");
 
-  char fid[4];
-  file.read(fid, 4);
-
   if (fid[0] != id[0] || fid[1] != id[1] || fid[2] != id[2] ||
       fid[3] != id[3]) {
     stringstream ss;
@@ -94,50 +101,53 @@ void VoxFile::ReadId(ifstream& file, const string& id) const {
   }
 }
 
-void VoxFile::ReadChunk(ifstream& file) {
-  char chunk_id_chars[5];
-  file.read(chunk_id_chars, 4);
-  chunk_id_chars[4] = '\0';
-  string chunk_id(chunk_id_chars);
+void VoxFile::ReadChunk(const uint8_t*& cursor, const uint8_t* end) {
+  const uint8_t* header = take(cursor, end, 12, "chunk header");
+  string chunk_id(reinterpret_cast<const char*>(header), 4);
 
-  const uint32_t contents_size = le_u32read(file);
-  const uint32_t children_size = le_u32read(file);
-  const uint32_t contents_start = static_cast<uint32_t>(file.tellg());
+  const uint32_t contents_size = le_u32read(header + 4);
+  const uint32_t children_size = le_u32read(header + 8);
+  const uint8_t* contents = take(cursor, end, contents_size, "chunk contents");
+  const uint8_t* children = take(cursor, end, children_size, "chunk children");
 
   if (chunk_id == "MAIN")
-    ReadMainChunk(file, contents_size, children_size);
+    ReadMainChunk(children, children_size);
   else if (chunk_id == "SIZE")
-    ReadSizeChunk(file, contents_size, children_size);
+    ReadSizeChunk(contents, contents_size);
   else if (chunk_id == "XYZI")
-    ReadXyziChunk(file, contents_size, children_size);
+    ReadXyziChunk(contents, contents_size);
   else if (chunk_id == "RGBA")
-    ReadRgbaChunk(file, contents_size, children_size);
+    ReadRgbaChunk(contents, contents_size);
   //else if (chunk_id == "MATT")
 
   // RIFF format enforces even byte boundaries between chunks.
   // if (contents_size & 1) ++contents_size;
-
-  const uint32_t next_chunk_pos =
-      contents_start + contents_size + children_size;
-  file.seekg(next_chunk_pos);
 }
 
-void VoxFile::ReadMainChunk(std::ifstream& file, uint32_t contents_size,
-                            uint32_t children_size) {
-  // skip contents, to get to the beginning of the children
-  file.seekg(contents_size, ios_base::cur);
+void VoxFile::ReadMainChunk(const uint8_t* children, uint32_t children_size) {
+  const uint8_t* end = children + children_size;
 
-  uint32_t end_pos = static_cast<uint32_t>(file.tellg()) + children_size;
-  while (file.tellg() < end_pos) {
-    ReadChunk(file);
+  // Count the models first, so the model vectors are allocated once.
+  size_t n_models = 0;
+  for (const uint8_t* cursor = children; end - cursor >= 12;) {
+    if (memcmp(cursor, "XYZI", 4) == 0) ++n_models;
+    uint64_t skip = 12ull + le_u32read(cursor + 4) + le_u32read(cursor + 8);
+    if (skip > static_cast<uint64_t>(end - cursor)) break;
+    cursor += skip;
   }
-}
+  if (load_dense_) dense_models_.reserve(n_models);
+  if (load_sparse_) sparse_models_.reserve(n_models);
 
-void VoxFile::ReadSizeChunk(std::ifstream& file, uint32_t contents_size,
-                            uint32_t children_size) {
-  cur_size_ = {le_u32read(file), le_u32read(file), le_u32read(file)};
+  while (children < end) {
+    ReadChunk(children, end);
+  }
 }
 
+void VoxFile::ReadSizeChunk(const uint8_t* contents, uint32_t contents_size) {
+  const uint8_t* cursor = contents;
+  const uint8_t* size = take(cursor, contents + contents_size, 12, "SIZE chunk");
+  cur_size_ = {le_u32read(size), le_u32read(size + 4), le_u32read(size + 8)};
+}
 void VoxFile::RemoveHiddenVoxels(VoxDenseModel& dense, VoxSparseModel& sparse, const vector<Voxel>& voxels)
 {
   int n_removed = 0;
@@ -161,37 +171,43 @@ void VoxFile::RemoveHiddenVoxels(VoxDenseModel& dense, VoxSparseModel& sparse, c
   }
 }
 
-void VoxFile::ReadXyziChunk(std::ifstream& file, uint32_t contents_size,
-                            uint32_t children_size) {
+void VoxFile::ReadXyziChunk(const uint8_t* contents, uint32_t contents_size) {
+  const uint8_t* cursor = contents;
+  const uint8_t* end = contents + contents_size;
+  const uint32_t n_voxels = le_u32read(take(cursor, end, 4, "XYZI chunk"));
+  const uint8_t* data = take(cursor, end, static_cast<size_t>(n_voxels) * 4, "XYZI voxels");
+
   VoxDenseModel dense(cur_size_);
   VoxSparseModel sparse(cur_size_);
-  vector<Voxel> voxels;
-  uint32_t n_voxels = le_u32read(file);
-
-  for (uint32_t i = 0; i < n_voxels; ++i) {
-    Voxel voxel{read_uint8(file), read_uint8(file), read_uint8(file),
-                read_uint8(file)};
-    //sparse.voxels().push_back(voxel);
-    voxels.push_back(voxel);
+  vector<Voxel> voxels(n_voxels);
+  static_assert(sizeof(Voxel) == 4, "Voxel must match the XYZI layout");
+  memcpy(voxels.data(), data, static_cast<size_t>(n_voxels) * 4);
+
+  for (const Voxel& voxel : voxels) {
+    if (voxel.x >= cur_size_.x || voxel.y >= cur_size_.y || voxel.z >= cur_size_.z) {
+      stringstream ss;
+      ss << "Voxel (" << +voxel.x << ", " << +voxel.y << ", " << +voxel.z
+         << ") outside of the " << cur_size_.x << "x" << cur_size_.y << "x"
+         << cur_size_.z << " model";
+      throw VoxException(ss.str());
+    }
     dense.voxel(voxel.x, voxel.y, voxel.z) = voxel.color;
   }
 
   if (remove_hidden_voxels_) {
+    sparse.voxels().reserve(voxels.size());
     RemoveHiddenVoxels(dense, sparse, voxels);
   } else {
-    sparse.voxels().assign(voxels.begin(), voxels.end());
+    sparse.voxels() = std::move(voxels);
   }
 
-  if (load_dense_) dense_models_.push_back(dense);
-  if (load_sparse_) sparse_models_.push_back(sparse);
+  if (load_dense_) dense_models_.push_back(std::move(dense));
+  if (load_sparse_) sparse_models_.push_back(std::move(sparse));
 }
 
-void VoxFile::ReadRgbaChunk(std::ifstream& file, uint32_t contents_size,
-                            uint32_t children_size) {
-  for (int i = 0; i < 256; ++i) {
-    palette_[i].r = read_byte(file);
-    palette_[i].g = read_byte(file);
-    palette_[i].b = read_byte(file);
-    palette_[i].a = read_byte(file);
-  }
+void VoxFile::ReadRgbaChunk(const uint8_t* contents, uint32_t contents_size) {
+  const uint8_t* cursor = contents;
+  const uint8_t* colors = take(cursor, contents + contents_size, 256 * 4, "RGBA chunk");
+  static_assert(sizeof(Color) == 4, "Color must match the RGBA layout");
+  memcpy(palette_.data(), colors, 256 * 4);
 }
@@ -0,0 +1,39 @@
+#include <vforge/batch.hpp>
+#include <algorithm>
+
+namespace voxelforge {
+
+    // stable LSD radix sort on the edit keys, skipping digits that are the same in every key
+void VoxelEditBatch::sort() {
+    const unsigned int digitBits = 11;
+    const uint64_t keyMask = ~CLEAR_BIT;
+
+    uint64_t allBits = keyMask, anyBits = 0;
+    for (const auto& edit : this->edits) {
+        allBits &= edit.key;
+        anyBits |= edit.key & keyMask;
+    }
+    uint64_t varying = allBits ^ anyBits;
+
+    std::vector<Edit> scratch(this->edits.size());
+    std::vector<size_t> offsets(1u << digitBits);
+
+    for (unsigned int shift = 0; shift < 64; shift += digitBits) {
+        uint64_t digitMask = (1ull << digitBits) - 1;
+        if (!((varying >> shift) & digitMask)) continue;
+
+        std::fill(offsets.begin(), offsets.end(), 0);
+        for (const auto& edit : this->edits) offsets[((edit.key & keyMask) >> shift) & digitMask]++;
+
+        size_t sum = 0;
+        for (size_t& offset : offsets) {
+            size_t count = offset;
+            offset = sum;
+            sum += count;
+        }
+
+        for (const auto& edit : this->edits) scratch[offsets[((edit.key & keyMask) >> shift) & digitMask]++] = edit;
+        this->edits.swap(scratch);
+    }
+}
+}
\ No newline at end of file
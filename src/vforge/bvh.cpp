@@ -0,0 +1,212 @@
+#include <vforge/bvh.hpp>
+#include <algorithm>
+#include <cmath>
+
+namespace voxelforge {
+
+AABB AABB::transformed(const glm::mat4& m) const {
+    if (this->empty()) return AABB();
+
+    glm::vec3 center = glm::vec3(m * glm::vec4(this->center(), 1.0f));
+    glm::vec3 half = (this->hi - this->lo) * 0.5f;
+    glm::vec3 extent(0.0f);
+    for (int c = 0; c < 3; c++) {
+        extent += glm::abs(glm::vec3(m[c])) * half[c];
+    }
+    return AABB(center - extent, center + extent);
+}
+
+float AABB::intersect(glm::vec3 origin, glm::vec3 invDirection, float maxDistance) const {
+    const float inf = std::numeric_limits<float>::infinity();
+    if (this->empty()) return inf;
+
+    float tMin = 0.0f, tMax = maxDistance;
+    for (int a = 0; a < 3; a++) {
+        float t0 = (this->lo[a] - origin[a]) * invDirection[a];
+        float t1 = (this->hi[a] - origin[a]) * invDirection[a];
+        if (t0 > t1) std::swap(t0, t1);
+            // a ray parallel to the slab and inside it gives (-inf, inf), outside it (inf, inf) or (-inf, -inf).
+            // a NaN (origin exactly on the slab) leaves the interval as it was
+        tMin = t0 > tMin ? t0 : tMin;
+        tMax = t1 < tMax ? t1 : tMax;
+    }
+    return tMin <= tMax && tMin < maxDistance ? tMin : inf;
+}
+
+    // Gribb & Hartmann, rows of the matrix added and subtracted
+Frustum::Frustum(const glm::mat4& viewProj) {
+    glm::vec4 row[4];
+    for (int r = 0; r < 4; r++) row[r] = glm::vec4(viewProj[0][r], viewProj[1][r], viewProj[2][r], viewProj[3][r]);
+
+    this->planes[0] = row[3] + row[0];
+    this->planes[1] = row[3] - row[0];
+    this->planes[2] = row[3] + row[1];
+    this->planes[3] = row[3] - row[1];
+    this->planes[4] = row[3] + row[2];
+    this->planes[5] = row[3] - row[2];
+}
+
+Frustum::Test Frustum::test(const AABB& box) const {
+    if (box.empty()) return Outside;
+
+    Test result = Inside;
+    for (const glm::vec4& plane : this->planes) {
+        glm::vec3 normal(plane);
+            // the corner furthest along the normal and the one furthest against it
+        glm::vec3 positive(normal.x >= 0.0f ? box.hi.x : box.lo.x, normal.y >= 0.0f ? box.hi.y : box.lo.y, normal.z >= 0.0f ? box.hi.z : box.lo.z);
+        glm::vec3 negative(normal.x >= 0.0f ? box.lo.x : box.hi.x, normal.y >= 0.0f ? box.lo.y : box.hi.y, normal.z >= 0.0f ? box.lo.z : box.hi.z);
+
+        if (glm::dot(normal, positive) + plane.w < 0.0f) return Outside;
+        if (glm::dot(normal, negative) + plane.w < 0.0f) result = Intersecting;
+    }
+    return result;
+}
+
+    // empty boxes (null objects) still need a position to be sorted by
+static glm::vec3 centroid(const AABB& box) {
+    return box.empty() ? glm::vec3(0.0f) : box.center();
+}
+
+void ObjectBVH::build(const std::vector<AABB>& bounds) {
+    this->itemBounds = bounds;
+    this->items.resize(bounds.size());
+    for (uint32_t i = 0; i < bounds.size(); i++) this->items[i] = i;
+
+    this->nodes.clear();
+    this->parents.clear();
+    if (bounds.empty()) return;
+
+    this->nodes.reserve(2 * (bounds.size() / LEAF_SIZE + 1));
+    this->nodes.push_back(Node{ AABB(), 0, 0, (uint32_t)bounds.size() });
+    this->subdivide(0, 0);
+
+    this->parents.assign(this->nodes.size(), 0);
+    this->leafOf.resize(bounds.size());
+    for (uint32_t n = 0; n < this->nodes.size(); n++) {
+        const Node& node = this->nodes[n];
+        if (!node.isLeaf()) {
+            this->parents[node.left] = n;
+            this->parents[node.left + 1] = n;
+            continue;
+        }
+        for (uint32_t i = node.first; i < node.first + node.count; i++) this->leafOf[this->items[i]] = n;
+    }
+}
+
+void ObjectBVH::subdivide(uint32_t index, unsigned int depth) {
+    AABB bounds, centroids;
+    {
+        const Node& node = this->nodes[index];
+        for (uint32_t i = node.first; i < node.first + node.count; i++) {
+            const AABB& box = this->itemBounds[this->items[i]];
+            bounds.grow(box);
+            glm::vec3 c = centroid(box);
+            centroids.grow(AABB(c, c));
+        }
+        this->nodes[index].bounds = bounds;
+    }
+
+    const uint32_t first = this->nodes[index].first, count = this->nodes[index].count;
+    if (count <= LEAF_SIZE) return;
+
+    glm::vec3 extent = centroids.hi - centroids.lo;
+    int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+    uint32_t *begin = this->items.data() + first, *end = begin + count;
+    uint32_t *middle = begin + count / 2;
+
+    if (extent[axis] > 0.0f && depth < MAX_SAH_DEPTH) {
+            // binned SAH along the widest centroid axis
+        constexpr int BINS = 12;
+        struct Bin {
+            AABB bounds;
+            uint32_t count = 0;
+        } bins[BINS];
+
+        float scale = BINS / extent[axis];
+        auto binOf = [&](uint32_t item) {
+            int b = (int)((centroid(this->itemBounds[item])[axis] - centroids.lo[axis]) * scale);
+            return std::min(b, BINS - 1);
+        };
+        for (uint32_t *it = begin; it != end; ++it) {
+            Bin& bin = bins[binOf(*it)];
+            bin.bounds.grow(this->itemBounds[*it]);
+            bin.count++;
+        }
+
+        float rightArea[BINS];
+        uint32_t rightCount[BINS];
+        AABB right;
+        uint32_t n = 0;
+        for (int b = BINS - 1; b > 0; b--) {
+            right.grow(bins[b].bounds);
+            n += bins[b].count;
+            rightArea[b] = right.area();
+            rightCount[b] = n;
+        }
+
+        float bestCost = std::numeric_limits<float>::infinity();
+        int bestSplit = -1;
+        AABB left;
+        n = 0;
+        for (int b = 1; b < BINS; b++) {
+            left.grow(bins[b - 1].bounds);
+            n += bins[b - 1].count;
+            if (n == 0 || rightCount[b] == 0) continue;
+            float cost = left.area() * n + rightArea[b] * rightCount[b];
+            if (cost < bestCost) {
+                bestCost = cost;
+                bestSplit = b;
+            }
+        }
+
+        if (bestSplit > 0) {
+            middle = std::partition(begin, end, [&](uint32_t item) { return binOf(item) < bestSplit; });
+        } else {
+            std::nth_element(begin, middle, end, [&](uint32_t a, uint32_t b) { return centroid(this->itemBounds[a])[axis] < centroid(this->itemBounds[b])[axis]; });
+        }
+    } else {
+            // all centroids in one spot, or deep enough that the depth has to be bounded: halve the items
+        std::nth_element(begin, middle, end, [&](uint32_t a, uint32_t b) { return centroid(this->itemBounds[a])[axis] < centroid(this->itemBounds[b])[axis]; });
+    }
+
+    uint32_t leftCount = middle - begin;
+    if (leftCount == 0 || leftCount == count) leftCount = count / 2;
+
+    uint32_t left = this->nodes.size();
+    this->nodes.push_back(Node{ AABB(), 0, first, leftCount });
+    this->nodes.push_back(Node{ AABB(), 0, first + leftCount, count - leftCount });
+    this->nodes[index].left = left;
+
+    this->subdivide(left, depth + 1);
+    this->subdivide(left + 1, depth + 1);
+}
+
+void ObjectBVH::updateNode(uint32_t index) {
+    Node& node = this->nodes[index];
+    AABB bounds;
+    if (node.isLeaf()) {
+        for (uint32_t i = node.first; i < node.first + node.count; i++) bounds.grow(this->itemBounds[this->items[i]]);
+    } else {
+        bounds = this->nodes[node.left].bounds;
+        bounds.grow(this->nodes[node.left + 1].bounds);
+    }
+    node.bounds = bounds;
+}
+
+void ObjectBVH::refit(const std::vector<AABB>& bounds) {
+    this->itemBounds = bounds;
+    for (size_t n = this->nodes.size(); n-- > 0;) this->updateNode(n);
+}
+
+void ObjectBVH::refit(uint32_t item, const AABB& bounds) {
+    this->itemBounds[item] = bounds;
+    if (this->nodes.empty()) return;
+
+    uint32_t node = this->leafOf[item];
+    for (;;) {
+        this->updateNode(node);
+        if (node == 0) break;
+        node = this->parents[node];
+    }
+}
+}
@@ -1,4 +1,6 @@
 #include <vforge/chunk.hpp>
+#include <algorithm>
+#include <iterator>
 
 namespace voxelforge {
 
@@ -10,39 +12,103 @@ VoxelChunk::VoxelChunk() {
     this->bitmask = 0;
 }
 
-void VoxelSubChunk::set(unsigned int x, unsigned int y, unsigned int z, std::shared_ptr<VoxelData> vox) {
+void VoxelSubChunk::set(unsigned int x, unsigned int y, unsigned int z, VoxelData vox) {
     if (x > 3 || y > 3 || z > 3) return; // voxel out of bounds
-    this->data[x][y][z] = vox;
 
-    unsigned int bitIndex = x | (y << 2) | (z << 4);
+    if (this->palette) this->decompress();
+    unsigned int bitIndex = internal::bitIndex(x, y, z);
     uint64_t voxelBit = 1ull << (uint64_t)bitIndex;
+    unsigned int slot = internal::bitRank(this->bitmask, bitIndex);
+
+    if (this->bitmask & voxelBit) {
+        this->data[slot] = vox; // overwrite in place
+        return;
+    }
+
+    if (this->data.empty()) this->data.reserve(8);
+    this->data.insert(this->data.begin() + slot, vox);
     this->bitmask |= voxelBit; // set the bit in the bitmask, indicating that there's a voxel here
 }
 
-std::shared_ptr<VoxelData> VoxelSubChunk::get(unsigned int x, unsigned int y, unsigned int z) {
-    if (x > 3 || y > 3 || z > 3) return std::shared_ptr<VoxelData>(nullptr);
-    return this->data[x][y][z];
+std::optional<VoxelData> VoxelSubChunk::get(unsigned int x, unsigned int y, unsigned int z) const {
+    if (x > 3 || y > 3 || z > 3) return std::nullopt;
+
+    unsigned int bitIndex = internal::bitIndex(x, y, z);
+    if (!(this->bitmask & (1ull << (uint64_t)bitIndex))) return std::nullopt;
+
+    return this->getVoxel(internal::bitRank(this->bitmask, bitIndex));
 }
 
 void VoxelSubChunk::clear(unsigned int x, unsigned int y, unsigned int z) {
     if (x > 3 || y > 3 || z > 3) return; // voxel out of bounds
-    this->data[x][y][z].reset();
 
-    unsigned int bitIndex = x | (y << 2) | (z << 4);
+    unsigned int bitIndex = internal::bitIndex(x, y, z);
     uint64_t voxelBit = 1ull << (uint64_t)bitIndex;
+    if (!(this->bitmask & voxelBit)) return; // nothing here
+
+    if (this->palette) this->decompress();
+    this->data.erase(this->data.begin() + internal::bitRank(this->bitmask, bitIndex));
     this->bitmask &= ~voxelBit; // clear the bit in the bitmask, indicating that there's no voxel here
 }
 
 void VoxelSubChunk::clear() {
-    for (unsigned int x = 0; x < 4; x++)
-    for (unsigned int y = 0; y < 4; y++)
-    for (unsigned int z = 0; z < 4; z++) {
-        data[x][y][z].reset();
-    }
+    this->data.clear();
+    this->palette.reset();
+    this->indices.clear();
     this->bitmask = 0;
 }
 
-void VoxelChunk::set(unsigned int x, unsigned int y, unsigned int z, std::shared_ptr<VoxelData> vox) {
+void VoxelSubChunk::apply(uint64_t setMask, uint64_t clearMask, const VoxelData *values) {
+    uint64_t newMask = (this->bitmask & ~clearMask) | setMask;
+
+    if ((this->bitmask & ~setMask) == 0) { // every old voxel is overwritten or cleared
+        this->data.assign(values, values + __builtin_popcountll(setMask));
+        this->palette.reset();
+        this->indices.clear();
+        this->bitmask = setMask;
+        return;
+    }
+    if (this->palette) this->decompress();
+
+    std::vector<VoxelData> merged;
+    merged.reserve(__builtin_popcountll(newMask));
+
+        // walk the new bitmask in order, taking each voxel from the edits or the old data
+    uint64_t mask = newMask;
+    while (mask) {
+        unsigned int bitIndex = __builtin_ctzll(mask);
+        mask &= mask - 1;
+
+        if (setMask & (1ull << bitIndex)) merged.push_back(*values++);
+        else merged.push_back(this->data[internal::bitRank(this->bitmask, bitIndex)]);
+    }
+
+    this->data.swap(merged);
+    this->bitmask = newMask;
+}
+
+void VoxelSubChunk::compress(std::shared_ptr<const VoxelPalette> palette, const uint8_t *index) {
+    unsigned int count = this->size(), bits = palette->bits;
+    std::vector<uint8_t> packed((count * bits + 7) / 8, 0);
+    if (bits) {
+        for (unsigned int i = 0; i < count; i++) packed[i * bits >> 3] |= index[i] << (i * bits & 7);
+    }
+
+    this->indices.swap(packed);
+    this->palette = std::move(palette);
+    std::vector<VoxelData>().swap(this->data);
+}
+
+void VoxelSubChunk::decompress() {
+    std::vector<VoxelData> voxels(this->size());
+    for (unsigned int i = 0; i < voxels.size(); i++) voxels[i] = this->getVoxel(i);
+
+    this->data.swap(voxels);
+    this->palette.reset();
+    std::vector<uint8_t>().swap(this->indices);
+}
+
+void VoxelChunk::set(unsigned int x, unsigned int y, unsigned int z, VoxelData vox) {
     if (x > 15 || y > 15 || z > 15) return; // voxel out of bounds
 
     unsigned int chX = x >> 2;
@@ -54,42 +120,165 @@ void VoxelChunk::set(unsigned int x, unsigned int y, unsigned int z, std::shared
         sub = std::make_shared<VoxelSubChunk>();
     }
     sub->set(x % 4, y % 4, z % 4, vox);
+    this->palette.reset();
 
-    unsigned int bitIndex = chX | (chY << 2) | (chZ << 4);
+    unsigned int bitIndex = internal::bitIndex(chX, chY, chZ);
     uint64_t voxelBit = 1ull << (uint64_t)bitIndex;
     this->bitmask |= voxelBit; // set the bit in the bitmask, indicating that there's a voxel subchunk here
 }
 
+std::optional<VoxelData> VoxelChunk::get(unsigned int x, unsigned int y, unsigned int z) const {
+    if (x > 15 || y > 15 || z > 15) return std::nullopt;
+
+    const std::shared_ptr<VoxelSubChunk>& sub = this->data[x >> 2][y >> 2][z >> 2];
+    if (!sub) return std::nullopt;
+
+    return sub->get(x % 4, y % 4, z % 4);
+}
+
 void VoxelChunk::clear(unsigned int x, unsigned int y, unsigned int z) {
     if (x > 15 || y > 15 || z > 15) return; // voxel out of bounds
 
     unsigned int chX = x >> 2;
     unsigned int chY = y >> 2;
     unsigned int chZ = z >> 2;
-    std::shared_ptr<VoxelSubChunk> sub = this->data[chX][chY][chZ];
+    std::shared_ptr<VoxelSubChunk>& sub = this->data[chX][chY][chZ];
 
     if (!sub) return; // voxel subchunk doesn't exist
     sub->clear(x % 4, y % 4, z % 4);
+    this->palette.reset();
 
     if (sub->getBitmask() == 0) {   // the entire subchunk is empty, we can free it and clear the bit in the bitmask
         sub.reset();
 
-        unsigned int bitIndex = chX | (chY << 2) | (chZ << 4);
+        unsigned int bitIndex = internal::bitIndex(chX, chY, chZ);
         uint64_t voxelBit = 1ull << (uint64_t)bitIndex;
         this->bitmask &= ~voxelBit; // clear the bit in the bitmask, indicating that there's no voxel subchunk here
     }
 }
 
 void VoxelChunk::clear() {
-    for (unsigned int x = 0; x < 4; x++)
-    for (unsigned int y = 0; y < 4; y++)
-    for (unsigned int z = 0; z < 4; z++) {
-        data[x][y][z].reset();
+    for (uint64_t mask = this->bitmask; mask; mask &= mask - 1) {
+        unsigned int bit = __builtin_ctzll(mask);
+        this->data[bit & 3][(bit >> 2) & 3][bit >> 4].reset();
     }
     this->bitmask = 0;
+    this->palette.reset();
 }
 
-std::shared_ptr<VoxelSubChunk> VoxelChunk::getSubChunk(unsigned int x, unsigned int y, unsigned int z) {
+void VoxelChunk::apply(unsigned int subChunkBit, uint64_t setMask, uint64_t clearMask, const VoxelData *values) {
+    std::shared_ptr<VoxelSubChunk>& sub = this->data[subChunkBit & 3][(subChunkBit >> 2) & 3][subChunkBit >> 4];
+
+    if (!sub) {
+        if (setMask == 0) return; // only clears, nothing to do
+        sub = std::make_shared<VoxelSubChunk>();
+    }
+    sub->apply(setMask, clearMask, values);
+    this->palette.reset();
+
+    uint64_t subChunkMask = 1ull << (uint64_t)subChunkBit;
+    if (sub->getBitmask() == 0) {
+        sub.reset();
+        this->bitmask &= ~subChunkMask;
+    } else {
+        this->bitmask |= subChunkMask;
+    }
+}
+
+const std::shared_ptr<VoxelSubChunk>& VoxelChunk::getSubChunk(unsigned int x, unsigned int y, unsigned int z) const {
     return this->data[x][y][z];
 }
+
+size_t VoxelChunk::memoryUsage() const {
+    size_t bytes = sizeof(*this);
+        // make_shared allocates the control block alongside the subchunk. subchunks not edited since the last
+        // compress() share its palette, which may outlive the chunk's own reference to it
+    const VoxelPalette *counted = nullptr;
+    this->forEachSubChunk([&](glm::uvec3, const VoxelSubChunk& sub) {
+        bytes += sub.memoryUsage() + 2 * sizeof(void *);
+        if (sub.getPalette() && sub.getPalette() != counted) {
+            counted = sub.getPalette();
+            bytes += counted->memoryUsage() + 2 * sizeof(void *);
+        }
+    });
+    return bytes;
+}
+
+    // distinct values seen so far and the index of each, open addressing on the 8 bytes of a VoxelData
+class PaletteBuilder {
+public:
+    static constexpr unsigned int MAX_VALUES = 256;
+
+    PaletteBuilder() { std::fill(std::begin(this->slots), std::end(this->slots), 0); }
+
+        // palette index of `value`, added if it is new. -1 once there would be more than MAX_VALUES
+    int find(VoxelData value) {
+        uint64_t key = (uint64_t)value.packedNormal | (uint64_t)value.matID << 32;
+        unsigned int slot = (unsigned int)((key * 0x9E3779B97F4A7C15ull) >> (64 - TABLE_BITS));
+        for (;; slot = (slot + 1) & (TABLE_SIZE - 1)) {
+            uint16_t entry = this->slots[slot];
+            if (entry == 0) break;
+            if (this->keys[entry - 1] == key) return entry - 1;
+        }
+        if (this->values.size() == MAX_VALUES) return -1;
+
+        this->keys[this->values.size()] = key;
+        this->values.push_back(value);
+        this->slots[slot] = (uint16_t)this->values.size();
+        return (int)this->values.size() - 1;
+    }
+
+    std::vector<VoxelData> values;
+private:
+    static constexpr unsigned int TABLE_BITS = 10, TABLE_SIZE = 1u << TABLE_BITS;
+    uint16_t slots[TABLE_SIZE];     // index + 1 into `keys`, 0 for free slots
+    uint64_t keys[MAX_VALUES];
+};
+
+void VoxelChunk::compress() {
+    if (this->palette || this->bitmask == 0) return;
+
+    PaletteBuilder builder;
+    uint8_t index[16 * 16 * 16];
+    unsigned int count = 0;
+    bool fits = true;
+    this->forEachVoxel([&](glm::uvec3, const VoxelData& voxel) {
+        if (!fits) return;
+        int i = builder.find(voxel);
+        if (i < 0) fits = false;
+        else index[count++] = (uint8_t)i;
+    });
+
+    unsigned int distinct = builder.values.size();
+    unsigned int bits = distinct == 1 ? 0 : distinct <= 2 ? 1 : distinct <= 4 ? 2 : distinct <= 16 ? 4 : 8;
+
+        // a palette only pays off when it and the indices are smaller than the voxels themselves
+    size_t paletteBytes = sizeof(VoxelPalette) + 2 * sizeof(void *) + distinct * sizeof(VoxelData) + (size_t)count * bits / 8;
+    if (!fits || paletteBytes >= (size_t)count * sizeof(VoxelData)) {
+        for (uint64_t mask = this->bitmask; mask; mask &= mask - 1) {
+            unsigned int bit = __builtin_ctzll(mask);
+            VoxelSubChunk& sub = *this->data[bit & 3][(bit >> 2) & 3][bit >> 4];
+            if (sub.getPalette()) sub.decompress();
+        }
+        return;
+    }
+
+    auto palette = std::make_shared<VoxelPalette>();
+    palette->values = std::move(builder.values);
+    palette->bits = bits;
+    this->palette = palette;
+
+    unsigned int first = 0;
+    for (uint64_t mask = this->bitmask; mask; mask &= mask - 1) {
+        unsigned int bit = __builtin_ctzll(mask);
+        VoxelSubChunk& sub = *this->data[bit & 3][(bit >> 2) & 3][bit >> 4];
+        sub.compress(this->palette, index + first);
+        first += sub.size();
+    }
+}
+
+VoxelChunk::Encoding VoxelChunk::getEncoding() const {
+    if (!this->palette) return Encoding::Raw;
+    return this->palette->bits == 0 ? Encoding::Uniform : Encoding::Palette;
+}
 }
\ No newline at end of file
@@ -0,0 +1,284 @@
+#include <vforge/chunkmap.hpp>
+#include <vforge/chunk.hpp>
+#include <algorithm>
+
+namespace voxelforge {
+
+static uint32_t nextPowerOfTwo(uint32_t v) {
+    uint32_t p = 1;
+    while (p < v) p <<= 1;
+    return p;
+}
+
+static size_t slotHash(glm::uvec3 p) {
+    uint64_t h = p.x * 0x9E3779B97F4A7C15ull ^ p.y * 0xC2B2AE3D27D4EB4Full ^ p.z * 0x165667B19E3779F9ull;
+    return (size_t)(h ^ (h >> 29));
+}
+
+ChunkMap::ChunkMap(glm::uvec3 bounds) : bounds(0), ordered(true) {
+    glm::uvec3 padded(nextPowerOfTwo(bounds.x), nextPowerOfTwo(bounds.y), nextPowerOfTwo(bounds.z));
+    size_t slots = (size_t)padded.x * padded.y * padded.z;
+    if (bounds.x == 0 || bounds.y == 0 || bounds.z == 0 || slots > MAX_DENSE_SLOTS) return;
+
+        // interleave the bits of all axes that still have bits left, lowest first, so uneven bounds pack tightly
+    this->bounds = bounds;
+    for (int a = 0; a < 3; a++) this->spread[a].assign(bounds[a], 0);
+    unsigned int codeBit = 0;
+    for (unsigned int bit = 0; bit < 32; bit++) {
+        for (int a = 0; a < 3; a++) {
+            if ((1u << bit) >= padded[a]) continue;
+            for (uint32_t v = 0; v < bounds[a]; v++) {
+                if (v >> bit & 1) this->spread[a][v] |= 1ull << codeBit;
+            }
+            codeBit++;
+        }
+    }
+
+    this->dense.resize(slots);
+    this->occupied.assign((slots + 63) / 64, 0);
+}
+
+ChunkMap::ChunkMap(const ChunkMap& other) : ordered(false) {
+    *this = other;
+}
+
+ChunkMap& ChunkMap::operator=(const ChunkMap& other) {
+    if (this == &other) return *this;
+
+    this->bounds = other.bounds;
+    for (int a = 0; a < 3; a++) this->spread[a] = other.spread[a];
+    this->dense = other.dense;
+    this->occupied = other.occupied;
+    this->denseCount = other.denseCount;
+    this->sparse = other.sparse;
+    this->sparseUsed = other.sparseUsed;
+    this->sparseCount = other.sparseCount;
+    this->ordered.store(false);
+    return *this;
+}
+
+bool ChunkMap::zLess(glm::uvec3 a, glm::uvec3 b) {
+        // the axis whose differing bits are the most significant decides, z above y above x on the same bit
+    auto lessMsb = [](uint32_t x, uint32_t y) { return x < y && x < (x ^ y); };
+    int axis = 2;
+    uint32_t highest = a.z ^ b.z;
+    for (int i = 1; i >= 0; i--) {
+        uint32_t diff = a[i] ^ b[i];
+        if (lessMsb(highest, diff)) {
+            highest = diff;
+            axis = i;
+        }
+    }
+    return a[axis] < b[axis];
+}
+
+size_t ChunkMap::locate(glm::uvec3 position) const {
+    if (this->inBounds(position)) {
+        uint64_t code = this->mortonCode(position);
+        return __atomic_load_n(&this->occupied[code >> 6], __ATOMIC_ACQUIRE) >> (code & 63) & 1 ? (size_t)code : END;
+    }
+    size_t slot = this->findSparse(position);
+    return slot == END ? END : (slot | UNORDERED);
+}
+
+size_t ChunkMap::findSparse(glm::uvec3 position) const {
+    if (this->sparseCount == 0) return END;
+
+    size_t mask = this->sparse.size() - 1;
+    for (size_t slot = slotHash(position) & mask; this->sparseUsed[slot]; slot = (slot + 1) & mask) {
+        if (this->sparse[slot].first == position) return slot;
+    }
+    return END;
+}
+
+std::shared_ptr<VoxelChunk>& ChunkMap::operator[](glm::uvec3 position) {
+    if (this->inBounds(position)) {
+        uint64_t code = this->mortonCode(position);
+        uint64_t& word = this->occupied[code >> 6];
+        if (!(word >> (code & 63) & 1)) {
+            word |= 1ull << (code & 63);
+            this->dense[code].first = position;
+            this->denseCount++;
+        }
+        return this->dense[code].second;
+    }
+
+    size_t slot = this->findSparse(position);
+    if (slot != END) return this->sparse[slot].second;
+
+    if ((this->sparseCount + 1) * 2 > this->sparse.size()) this->growSparse();
+    size_t mask = this->sparse.size() - 1;
+    slot = slotHash(position) & mask;
+    while (this->sparseUsed[slot]) slot = (slot + 1) & mask;
+
+    this->sparseUsed[slot] = 1;
+    this->sparse[slot].first = position;
+    this->sparse[slot].second = nullptr;
+    this->sparseCount++;
+    this->ordered.store(false, std::memory_order_relaxed);
+    return this->sparse[slot].second;
+}
+
+std::shared_ptr<VoxelChunk> *ChunkMap::concurrentSlot(glm::uvec3 position, bool& created) {
+    created = false;
+    if (!this->inBounds(position)) return nullptr;
+
+        // 64 entries share an occupancy word, other threads may be claiming its other bits
+    uint64_t code = this->mortonCode(position), bit = 1ull << (code & 63);
+    uint64_t *word = &this->occupied[code >> 6];
+    if (!(__atomic_load_n(word, __ATOMIC_ACQUIRE) & bit)) {
+        this->dense[code].first = position;
+        __atomic_fetch_or(word, bit, __ATOMIC_RELEASE);
+        __atomic_fetch_add(&this->denseCount, 1, __ATOMIC_RELAXED);
+        created = true;
+    }
+    return &this->dense[code].second;
+}
+
+bool ChunkMap::publish(glm::uvec3 position, std::shared_ptr<VoxelChunk> chunk) {
+    if (!this->inBounds(position)) return false;
+
+        // the entry is complete before its occupancy bit, which lookups read with acquire
+    uint64_t code = this->mortonCode(position);
+    this->dense[code].first = position;
+    this->dense[code].second = std::move(chunk);
+    __atomic_fetch_or(&this->occupied[code >> 6], 1ull << (code & 63), __ATOMIC_RELEASE);
+    __atomic_fetch_add(&this->denseCount, 1, __ATOMIC_RELAXED);
+    return true;
+}
+
+size_t ChunkMap::erase(glm::uvec3 position) {
+    if (this->inBounds(position)) {
+        uint64_t code = this->mortonCode(position);
+        uint64_t& word = this->occupied[code >> 6];
+        if (!(word >> (code & 63) & 1)) return 0;
+
+        word &= ~(1ull << (code & 63));
+        this->dense[code].second.reset();
+        this->denseCount--;
+        return 1;
+    }
+
+    size_t slot = this->findSparse(position);
+    if (slot == END) return 0;
+
+        // backward shift deletion, no tombstones
+    size_t mask = this->sparse.size() - 1;
+    size_t hole = slot;
+    for (size_t i = (slot + 1) & mask; this->sparseUsed[i]; i = (i + 1) & mask) {
+        size_t home = slotHash(this->sparse[i].first) & mask;
+        if (((i - home) & mask) >= ((i - hole) & mask)) {
+            this->sparse[hole] = std::move(this->sparse[i]);
+            hole = i;
+        }
+    }
+    this->sparseUsed[hole] = 0;
+    this->sparse[hole].second.reset();
+    this->sparseCount--;
+    this->ordered.store(false, std::memory_order_relaxed);
+    return 1;
+}
+
+void ChunkMap::clear() {
+    for (size_t w = 0; w < this->occupied.size(); w++) {
+        for (uint64_t bits = this->occupied[w]; bits; bits &= bits - 1) {
+            this->dense[w * 64 + __builtin_ctzll(bits)].second.reset();
+        }
+        this->occupied[w] = 0;
+    }
+    this->denseCount = 0;
+
+    this->sparse.clear();
+    this->sparseUsed.clear();
+    this->sparseCount = 0;
+    this->ordered.store(false, std::memory_order_relaxed);
+}
+
+void ChunkMap::growSparse() {
+    std::vector<value_type> entries = std::move(this->sparse);
+    std::vector<uint8_t> used = std::move(this->sparseUsed);
+
+    size_t capacity = std::max<size_t>(16, entries.size() * 2);
+    this->sparse.assign(capacity, value_type());
+    this->sparseUsed.assign(capacity, 0);
+    for (size_t i = 0; i < entries.size(); i++) {
+        if (!used[i]) continue;
+
+        size_t slot = slotHash(entries[i].first) & (capacity - 1);
+        while (this->sparseUsed[slot]) slot = (slot + 1) & (capacity - 1);
+        this->sparseUsed[slot] = 1;
+        this->sparse[slot] = std::move(entries[i]);
+    }
+}
+
+void ChunkMap::sortSparse() const {
+    if (this->ordered.load(std::memory_order_acquire)) return;
+
+    std::lock_guard<std::mutex> lock(this->orderMutex);
+    if (this->ordered.load(std::memory_order_relaxed)) return;
+
+    this->order.clear();
+    for (size_t slot = 0; slot < this->sparse.size(); slot++) {
+        if (this->sparseUsed[slot]) this->order.push_back(slot);
+    }
+    std::sort(this->order.begin(), this->order.end(), [&](uint32_t a, uint32_t b) { return zLess(this->sparse[a].first, this->sparse[b].first); });
+
+    this->rank.assign(this->sparse.size(), 0);
+    for (size_t i = 0; i < this->order.size(); i++) this->rank[this->order[i]] = i;
+    this->ordered.store(true, std::memory_order_release);
+}
+
+size_t ChunkMap::nextDense(size_t slot) const {
+    size_t w = slot >> 6;
+    if (w >= this->occupied.size()) return END;
+
+    uint64_t bits = this->occupied[w] & (~0ull << (slot & 63));
+    while (!bits) {
+        if (++w >= this->occupied.size()) return END;
+        bits = this->occupied[w];
+    }
+    return w * 64 + __builtin_ctzll(bits);
+}
+
+size_t ChunkMap::first() const {
+    if (this->denseCount) return this->nextDense(0);
+    if (!this->sparseCount) return END;
+
+    this->sortSparse();
+    return this->dense.size();
+}
+
+size_t ChunkMap::next(size_t position) const {
+    if (position == END) return END;
+    if (position & UNORDERED) {
+        this->sortSparse();
+        position = this->dense.size() + this->rank[position & ~UNORDERED];
+    }
+
+    position++;
+    if (position < this->dense.size()) {
+        position = this->nextDense(position);
+        if (position != END) return position;
+        position = this->dense.size();
+    }
+    if (!this->sparseCount) return END;
+
+    this->sortSparse();
+    return position - this->dense.size() < this->order.size() ? position : END;
+}
+
+const ChunkMap::value_type *ChunkMap::entry(size_t position) const {
+    if (position < this->dense.size()) return &this->dense[position];
+    if (position & UNORDERED) return &this->sparse[position & ~UNORDERED];
+    return &this->sparse[this->order[position - this->dense.size()]];
+}
+
+size_t ChunkMap::memoryUsage() const {
+    size_t bytes = sizeof(*this);
+    for (int a = 0; a < 3; a++) bytes += this->spread[a].capacity() * sizeof(uint64_t);
+    bytes += this->dense.capacity() * sizeof(value_type) + this->occupied.capacity() * sizeof(uint64_t);
+    bytes += this->sparse.capacity() * sizeof(value_type) + this->sparseUsed.capacity();
+    bytes += (this->order.capacity() + this->rank.capacity()) * sizeof(uint32_t);
+    return bytes;
+}
+}
@@ -0,0 +1,193 @@
+#include <vforge/object.hpp>
+#include <vforge/threads.hpp>
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace voxelforge {
+
+    // chunks [lo, hi) covering a voxel box, enumerated x fastest
+struct _ChunkRange {
+    glm::uvec3 lo, count;
+
+    _ChunkRange(glm::uvec3 voxelLo, glm::uvec3 voxelHi) : lo(voxelLo / 16u), count((voxelHi + 15u) / 16u - voxelLo / 16u) {}
+
+    size_t size() const { return (size_t)this->count.x * this->count.y * this->count.z; }
+    glm::uvec3 operator[](size_t i) const {
+        return this->lo + glm::uvec3(i % this->count.x, i / this->count.x % this->count.y, i / this->count.x / this->count.y);
+    }
+};
+
+    // whether any of `count` material ids is non-zero, a word at a time
+template <typename T>
+static bool anyOccupied(const T *row, unsigned int count) {
+    const uint8_t *bytes = (const uint8_t *)row;
+    const size_t size = count * sizeof(T);
+    uint64_t any = 0;
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, bytes + i, 8);
+        any |= word;
+    }
+    for (; i < size; i++) any |= bytes[i];
+    return any != 0;
+}
+
+    // bit x set for every non-zero voxel x in [lo, hi) of a row, `row` pointing at voxel lo
+template <typename T>
+static uint32_t occupiedBits(const T *row, unsigned int lo, unsigned int hi) {
+#ifdef __SSE2__
+    if (lo == 0 && hi == 16) {
+        const __m128i zero = _mm_setzero_si128();
+        if constexpr (sizeof(T) == 1) {
+            return ~_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)row), zero)) & 0xffff;
+        } else {
+            __m128i a = _mm_cmpeq_epi16(_mm_loadu_si128((const __m128i *)row), zero);
+            __m128i b = _mm_cmpeq_epi16(_mm_loadu_si128((const __m128i *)(row + 8)), zero);
+            return ~_mm_movemask_epi8(_mm_packs_epi16(a, b)) & 0xffff;
+        }
+    }
+#endif
+    uint32_t bits = 0;
+    for (unsigned int x = lo; x < hi; x++) bits |= (uint32_t)(row[x - lo] != 0) << x;
+    return bits;
+}
+
+template <typename T>
+void VoxelObject::importDense(const T *data, glm::uvec3 dims, glm::uvec3 offset, unsigned int workers) {
+    static_assert(std::is_same_v<T, uint8_t> || std::is_same_v<T, uint16_t>, "dense grids hold uint8_t or uint16_t material ids");
+
+    const glm::uvec3 hi = glm::min(offset + dims, this->dim * 16u);
+    if (offset.x >= hi.x || offset.y >= hi.y || offset.z >= hi.z) return;
+
+        // chunks are independent: each one is built (or edited in place) on a worker, the map is only read there and
+        // updated afterwards. null means the chunk was neither present nor given any voxels
+    _ChunkRange range(offset, hi);
+    for (size_t i = 0; i < range.size() && this->generation; i++) {
+            // chunks the box covers whole are replaced, the others are edited
+        const glm::uvec3 base = range[i] * 16u;
+        if (!glm::any(glm::lessThan(base, offset)) && !glm::any(glm::lessThan(hi, base + 16u))) this->generation->cancel(range[i]);
+        else this->generateChunk(range[i]);
+    }
+    if (this->pager) {
+        this->pager->suspendEviction();
+        for (size_t i = 0; i < range.size(); i++) this->pager->access(range[i]);
+    }
+    std::vector<std::shared_ptr<VoxelChunk>> built(range.size());
+    parallelFor(range.size(), workers, 4, [&](size_t begin, size_t end) {
+            // voxels of each subchunk in bit order. rows are scanned z, y, x like the bits within a subchunk, so
+            // appending while scanning keeps that order
+        std::vector<VoxelData> values(64 * 64);
+        unsigned int counts[64];
+        for (size_t i = begin; i < end; i++) {
+            const glm::uvec3 position = range[i], base = position * 16u;
+            const glm::uvec3 lo = glm::max(offset, base) - base, top = glm::min(hi, base + 16u) - base;
+
+                // first voxel of a row of the box, at local x = lo.x
+            auto row = [&](unsigned int y, unsigned int z) {
+                return data + ((size_t)(base.z + z - offset.z) * dims.y + (base.y + y - offset.y)) * dims.x + (base.x + lo.x - offset.x);
+            };
+
+            auto it = this->chunks.find(position);
+            std::shared_ptr<VoxelChunk> chunk = it == this->chunks.end() ? nullptr : it->second;
+            if (!chunk) {
+                    // nothing to clear, so an all-zero box is done after one pass over it
+                bool any = false;
+                for (unsigned int z = lo.z; z < top.z && !any; z++)
+                for (unsigned int y = lo.y; y < top.y && !any; y++) any = anyOccupied(row(y, z), top.x - lo.x);
+                if (!any) continue;
+            }
+
+                // every 16 voxel row becomes a nibble in four subchunk masks, see internal::bitIndex()
+            uint64_t setMasks[64] = {}, boxMasks[64] = {};
+            std::fill(counts, counts + 64, 0u);
+            const uint32_t boxRow = ((1u << top.x) - 1u) & ~((1u << lo.x) - 1u);
+            VoxelData voxel(glm::vec3(0.0f), 0);
+            for (unsigned int z = lo.z; z < top.z; z++)
+            for (unsigned int y = lo.y; y < top.y; y++) {
+                const T *r = row(y, z);
+                uint32_t bits = occupiedBits(r, lo.x, top.x);
+
+                unsigned int subChunk = internal::bitIndex(0, y >> 2, z >> 2);
+                unsigned int shift = internal::bitIndex(0, y & 3, z & 3);
+                for (unsigned int sx = 0; sx < 4; sx++) {
+                    setMasks[subChunk | sx] |= (uint64_t)((bits >> (sx * 4)) & 15) << shift;
+                    boxMasks[subChunk | sx] |= (uint64_t)((boxRow >> (sx * 4)) & 15) << shift;
+                }
+                for (; bits; bits &= bits - 1) {
+                    unsigned int x = __builtin_ctz(bits), sub = subChunk | (x >> 2);
+                    voxel.matID = r[x - lo.x];
+                    values[sub * 64 + counts[sub]++] = voxel;
+                }
+            }
+
+            for (unsigned int sub = 0; sub < 64; sub++) {
+                if (!boxMasks[sub] || (!setMasks[sub] && !(chunk && (chunk->getBitmask() >> sub) & 1))) continue;
+
+                if (!chunk) chunk = std::make_shared<VoxelChunk>();
+                chunk->apply(sub, setMasks[sub], boxMasks[sub] & ~setMasks[sub], &values[sub * 64]);
+            }
+            built[i] = chunk;
+        }
+    });
+
+    for (size_t i = 0; i < built.size(); i++) {
+        if (built[i]) this->setChunk(range[i], built[i]);
+    }
+    if (this->pager) this->pager->resumeEviction();
+}
+
+template <typename T>
+void VoxelObject::exportDense(T *data, glm::uvec3 dims, glm::uvec3 offset, unsigned int workers) const {
+    static_assert(std::is_same_v<T, uint8_t> || std::is_same_v<T, uint16_t>, "dense grids hold uint8_t or uint16_t material ids");
+    if (dims.x == 0 || dims.y == 0 || dims.z == 0) return;
+
+        // each chunk clears and fills its own part of the grid, chunks outside the object only clear
+    const glm::uvec3 hi = offset + dims;
+    _ChunkRange range(offset, hi);
+    if (this->generation) {
+        parallelFor(range.size(), workers, 1, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) this->generation->generateShared(range[i]);
+        });
+    }
+    if (this->pager) {
+        this->pager->suspendEviction();
+        for (size_t i = 0; i < range.size(); i++) this->pager->access(range[i]);
+    }
+    parallelFor(range.size(), workers, 4, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            const glm::uvec3 position = range[i], base = position * 16u;
+            const glm::uvec3 lo = glm::max(offset, base) - base, top = glm::min(hi, base + 16u) - base;
+
+            auto row = [&](unsigned int y, unsigned int z) {
+                return data + ((size_t)(base.z + z - offset.z) * dims.y + (base.y + y - offset.y)) * dims.x + (base.x + lo.x - offset.x);
+            };
+            for (unsigned int z = lo.z; z < top.z; z++)
+            for (unsigned int y = lo.y; y < top.y; y++) std::fill(row(y, z), row(y, z) + (top.x - lo.x), T(0));
+
+            if (position.x >= this->dim.x || position.y >= this->dim.y || position.z >= this->dim.z) continue;
+            auto it = this->chunks.find(position);
+            if (it == this->chunks.end() || !it->second) continue;
+
+            it->second->forEachSubChunk([&](glm::uvec3 corner, const VoxelSubChunk& sub) {
+                if (corner.x + 4 <= lo.x || corner.y + 4 <= lo.y || corner.z + 4 <= lo.z || corner.x >= top.x || corner.y >= top.y || corner.z >= top.z) return;
+                sub.forEachVoxel([&](glm::uvec3 p, const VoxelData& voxel) {
+                    if (p.x < lo.x || p.y < lo.y || p.z < lo.z || p.x >= top.x || p.y >= top.y || p.z >= top.z) return;
+                    row(p.y, p.z)[p.x - lo.x] = (T)voxel.matID;
+                }, corner);
+            });
+        }
+    });
+    if (this->pager) this->pager->resumeEviction();
+}
+
+template void VoxelObject::importDense<uint8_t>(const uint8_t *, glm::uvec3, glm::uvec3, unsigned int);
+template void VoxelObject::importDense<uint16_t>(const uint16_t *, glm::uvec3, glm::uvec3, unsigned int);
+template void VoxelObject::exportDense<uint8_t>(uint8_t *, glm::uvec3, glm::uvec3, unsigned int) const;
+template void VoxelObject::exportDense<uint16_t>(uint16_t *, glm::uvec3, glm::uvec3, unsigned int) const;
+}
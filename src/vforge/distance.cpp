@@ -0,0 +1,158 @@
+#include <vforge/distance.hpp>
+#include <vforge/threads.hpp>
+#include <algorithm>
+#include <cmath>
+
+namespace voxelforge {
+
+DistanceField::DistanceField(glm::uvec3 extent, unsigned int maxDistance)
+    : extent(extent), maxDistance(std::min(maxDistance, MAX_DISTANCE)),
+      data((size_t)extent.x * extent.y * extent.z, 0), subChunks(data.size() / 64, 0) {}
+
+void DistanceField::build(const ChunkMap& chunks, unsigned int workers) {
+    glm::ivec3 extent(this->extent);
+    this->compute(chunks, glm::ivec3(0), extent, glm::ivec3(0), extent, workers);
+}
+
+void DistanceField::update(const ChunkMap& chunks, glm::uvec3 lo, glm::uvec3 hi, unsigned int workers) {
+        // voxels further than maxDistance + 1 from the box keep their (capped) value, and the ones that can change
+        // only see solid voxels up to that far away
+    glm::ivec3 extent(this->extent);
+    int reach = this->maxDistance + 1;
+    glm::ivec3 writeLo = glm::max(glm::ivec3(lo) - reach, glm::ivec3(0));
+    glm::ivec3 writeHi = glm::min(glm::ivec3(hi) + reach, extent);
+    if (glm::any(glm::greaterThanEqual(writeLo, writeHi))) return;
+
+    this->compute(chunks, glm::max(writeLo - reach, glm::ivec3(0)), glm::min(writeHi + reach, extent), writeLo, writeHi, workers);
+}
+
+    // squared distance transform of one line in place: out[x] = min over i of (x - i)^2 + f[i], after Meijster et al.
+static void envelope(uint32_t *f, int n, int *site, int *start, uint32_t *out) {
+    auto value = [&](int64_t x, int i) { return (x - i) * (x - i) + (int64_t)f[i]; };
+        // first x at which the parabola of site u is below the one of site i (i < u)
+    auto separation = [&](int64_t i, int64_t u) {
+        int64_t num = u * u - i * i + (int64_t)f[u] - (int64_t)f[i], den = 2 * (u - i);
+        return num >= 0 ? num / den : -((-num + den - 1) / den);
+    };
+
+    int q = 0;
+    site[0] = 0;
+    start[0] = 0;
+    for (int u = 1; u < n; u++) {
+        while (q >= 0 && value(start[q], site[q]) > value(start[q], u)) q--;
+        if (q < 0) {
+            q = 0;
+            site[0] = u;
+        } else {
+            int64_t w = 1 + separation(site[q], u);
+            if (w < n) {
+                q++;
+                site[q] = u;
+                start[q] = w;
+            }
+        }
+    }
+    for (int u = n - 1; u >= 0; u--) {
+        out[u] = (uint32_t)value(u, site[q]);
+        if (u == start[q]) q--;
+    }
+    std::copy(out, out + n, f);
+}
+
+void DistanceField::compute(const ChunkMap& chunks, glm::ivec3 lo, glm::ivec3 hi, glm::ivec3 writeLo, glm::ivec3 writeHi, unsigned int workers) {
+    const glm::ivec3 n = hi - lo;
+        // anything at or beyond this squared distance ends up capped, so it doubles as "no solid voxel in range".
+        // at most 255^2, which keeps the window in 16 bits per voxel
+    const uint16_t far = (this->maxDistance + 1) * (this->maxDistance + 1);
+    std::vector<uint16_t> g((size_t)n.x * n.y * n.z, far);
+    auto index = [&](glm::ivec3 p) { return ((size_t)p.z * n.y + p.y) * n.x + p.x; };
+
+        // solid voxels straight from the bitmasks, chunks never share voxels so they can be filled in parallel
+    std::vector<std::pair<glm::ivec3, const VoxelChunk *>> overlapping;
+    glm::ivec3 chunkLo = lo >> 4, chunkHi = (hi + 15) >> 4;
+    for (int z = chunkLo.z; z < chunkHi.z; z++)
+    for (int y = chunkLo.y; y < chunkHi.y; y++)
+    for (int x = chunkLo.x; x < chunkHi.x; x++) {
+        auto it = chunks.find(glm::uvec3(x, y, z));
+        if (it != chunks.end() && it->second && it->second->getBitmask()) overlapping.emplace_back(glm::ivec3(x, y, z), it->second.get());
+    }
+
+    parallelFor(overlapping.size(), workers, 16, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            const auto& [chunkPos, chunk] = overlapping[i];
+            glm::ivec3 origin = chunkPos * 16 - lo;
+            bool inside = glm::all(glm::greaterThanEqual(origin, glm::ivec3(0))) && glm::all(glm::lessThan(origin + 15, n));
+
+            chunk->forEachVoxel([&](glm::uvec3 voxel, const VoxelData&) {
+                glm::ivec3 p = glm::ivec3(voxel) - lo;
+                if (inside || (glm::all(glm::greaterThanEqual(p, glm::ivec3(0))) && glm::all(glm::lessThan(p, n)))) g[index(p)] = 0;
+            }, glm::uvec3(chunkPos * 16));
+        }
+    });
+
+        // one pass per axis. y and z lines are strided, so they are gathered BLOCK neighbouring lines at a time
+        // to read whole cache lines. lines without anything in range stay as they are
+    constexpr int BLOCK = 32;
+    for (int axis = 0; axis < 3; axis++) {
+        const int length = n[axis];
+        const size_t stride = axis == 0 ? 1 : (axis == 1 ? (size_t)n.x : (size_t)n.x * n.y);
+        const int width = axis == 0 ? 1 : BLOCK;
+        const size_t blocksPerRow = axis == 0 ? 1 : (n.x + BLOCK - 1) / BLOCK;
+            // x pass: one task per (y, z) line. y pass: per (z, x block), z pass: per (y, x block)
+        const size_t rows = axis == 0 ? (size_t)n.y * n.z : (axis == 1 ? n.z : n.y);
+        const size_t rowStride = axis == 0 ? n.x : (axis == 1 ? (size_t)n.x * n.y : n.x);
+
+        parallelFor(rows * blocksPerRow, workers, axis == 0 ? 64 : 4, [&](size_t begin, size_t end) {
+            std::vector<uint32_t> lines((size_t)width * length), out(length);
+            std::vector<int> site(length), start(length);
+
+            for (size_t task = begin; task < end; task++) {
+                int x0 = (task % blocksPerRow) * BLOCK;
+                int count = axis == 0 ? 1 : std::min(BLOCK, n.x - x0);
+                uint16_t *first = g.data() + task / blocksPerRow * rowStride + (axis == 0 ? 0 : x0);
+
+                for (int i = 0; i < length; i++) {
+                    for (int k = 0; k < count; k++) lines[k * length + i] = first[i * stride + k];
+                }
+                for (int k = 0; k < count; k++) {
+                    uint32_t *line = lines.data() + k * length;
+                    if (*std::min_element(line, line + length) >= far) continue;
+
+                    envelope(line, length, site.data(), start.data(), out.data());
+                    for (int i = 0; i < length; i++) first[i * stride + k] = (uint16_t)std::min<uint32_t>(line[i], far);
+                }
+            }
+        });
+    }
+
+        // capped distance of every squared distance that can come out of the passes
+    std::vector<uint8_t> root(far + 1);
+    for (uint32_t squared = 0; squared <= far; squared++) root[squared] = std::min((unsigned int)std::sqrt((double)squared), this->maxDistance);
+
+    parallelFor(writeHi.z - writeLo.z, workers, 1, [&](size_t begin, size_t end) {
+        for (int z = writeLo.z + begin; z < writeLo.z + (int)end; z++)
+        for (int y = writeLo.y; y < writeHi.y; y++) {
+            const uint16_t *from = g.data() + index(glm::ivec3(writeLo.x, y, z) - lo);
+            uint8_t *to = this->data.data() + ((size_t)z * this->extent.y + y) * this->extent.x + writeLo.x;
+            for (int x = 0; x < writeHi.x - writeLo.x; x++) to[x] = root[from[x]];
+        }
+    });
+
+        // subchunk minimums for every subchunk the written box touches
+    glm::ivec3 subLo = writeLo >> 2, subHi = (writeHi + 3) >> 2;
+    glm::ivec3 subN = glm::ivec3(this->extent) / 4;
+    parallelFor(subHi.z - subLo.z, workers, 1, [&](size_t begin, size_t end) {
+        for (int sz = subLo.z + begin; sz < subLo.z + (int)end; sz++)
+        for (int sy = subLo.y; sy < subHi.y; sy++)
+        for (int sx = subLo.x; sx < subHi.x; sx++) {
+            uint8_t least = 255;
+            for (int z = sz * 4; z < sz * 4 + 4; z++)
+            for (int y = sy * 4; y < sy * 4 + 4; y++) {
+                const uint8_t *row = this->data.data() + ((size_t)z * this->extent.y + y) * this->extent.x + sx * 4;
+                least = std::min({ least, row[0], row[1], row[2], row[3] });
+            }
+            this->subChunks[((size_t)sz * subN.y + sy) * subN.x + sx] = least;
+        }
+    });
+}
+}
@@ -1,132 +1,255 @@
 #include <vforge/xraw_file.hpp>
 #include <vforge/vox_file.hpp>
+#include <vforge/threads.hpp>
+#include <algorithm>
+#include <atomic>
 #include <fstream>
+#include <charconv>
+#include <cstring>
+#include <string_view>
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/gtx/string_cast.hpp>
 #include <unordered_map>
+#include <unordered_set>
 #include <variant>
 #include <optional>
-#include <sstream>
 #include <glm/gtc/type_ptr.hpp>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 namespace voxelforge::files {
 
+struct _XRAWHeader {
+    char magic[4];
+    uint8_t channelType;        // 0 unsigned integer, 1 signed integer, 2 float
+    uint8_t channels;           // RGBA, RGB, RG or R
+    uint8_t bitsPerChannel;
+    uint8_t bitsPerIndex;       // 8 or 16 with a palette, 0 for colors stored in the voxels
+    uint32_t size[3];           // x, y, z (z up)
+    uint32_t paletteSize;
+};
+static_assert(sizeof(_XRAWHeader) == 24, "XRAW header layout changed");
+
+    // occupied voxels of a 16 voxel row, bit i set for a non-zero index at byte i
+static uint32_t occupiedBits(const uint8_t *row) {
+#ifdef __SSE2__
+    __m128i zero = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)row), _mm_setzero_si128());
+    return ~_mm_movemask_epi8(zero) & 0xffff;
+#else
+    uint64_t lo, hi;
+    std::memcpy(&lo, row, 8);
+    std::memcpy(&hi, row + 8, 8);
+    if ((lo | hi) == 0) return 0;
+    uint32_t bits = 0;
+    for (int i = 0; i < 16; i++) bits |= (uint32_t)(row[i] != 0) << i;
+    return bits;
+#endif
+}
+
+    // the voxels are streamed in slabs 16 layers thick, so only one slab of the dense volume is ever held. each slab is
+    // one layer of chunks: every 16 voxel row of a chunk becomes a nibble in each of four subchunk masks with a single
+    // zero compare, then only the occupied subchunks are filled, each with one VoxelChunk::apply()
 std::shared_ptr<voxelforge::VoxelObject> load_xraw_file(const std::string& filename) {
-    std::ifstream file(filename.c_str(), std::ios::binary);
+    std::ifstream file(filename.c_str(), std::ios::binary | std::ios::ate);
 
     if (!file.is_open()) {
         std::cerr << "Error opening file: " << filename << std::endl;
         return nullptr;
     }
-
-    std::string magic;
-    magic.resize(4);
-
-    file.read(magic.data(), magic.size());
-
-    if (magic != "XRAW") {
-        std::cerr << "Invalid XRAW file: " << filename << std::endl;
+    auto invalid = [&](const char *reason) {
+        std::cerr << "Invalid XRAW file: " << filename << " (" << reason << ")" << std::endl;
         return nullptr;
+    };
+
+    uint64_t fileSize = file.tellg();
+    file.seekg(0);
+
+    _XRAWHeader header;
+    if (!file.read((char *)&header, sizeof(header)) || std::memcmp(header.magic, "XRAW", 4) != 0) return invalid("bad magic");
+    if (header.bitsPerIndex != 8) return invalid("only 8-bit palette indices are supported");
+    if (header.channels < 1 || header.channels > 4) return invalid("bad channel count");
+    if (header.paletteSize > 256) return invalid("palette larger than 256 colors");
+    bool floatColors = header.channelType == 2 && header.bitsPerChannel == 32;
+    if (!floatColors && !(header.channelType == 0 && header.bitsPerChannel == 8)) return invalid("only 8-bit unsigned or 32-bit float colors are supported");
+
+    const uint64_t sizeX = header.size[0], sizeY = header.size[1], sizeZ = header.size[2];
+    const uint64_t colorBytes = header.channels * header.bitsPerChannel / 8;
+    if (sizeX == 0 || sizeY == 0 || sizeZ == 0 || sizeX > (1u << 20) || sizeY > (1u << 20) || sizeZ > (1u << 20)
+        || fileSize != sizeof(header) + sizeX * sizeY * sizeZ + header.paletteSize * colorBytes) {
+        return invalid("size doesn't match the header");
     }
 
-    char colorDataType;
-    file.read(&colorDataType, sizeof(colorDataType));
-
-    char colorNumChannels;
-    file.read(&colorNumChannels, sizeof(colorNumChannels));
-
-    char colorBitsPerChannel;
-    file.read(&colorBitsPerChannel, sizeof(colorBitsPerChannel));
+        // rows padded to whole chunks with zeros (empty), so every row can be tested 16 voxels at a time
+    const uint64_t padX = (sizeX + 15) & ~15ull, padY = (sizeY + 15) & ~15ull;
+    std::vector<uint8_t> slab(padX * padY * 16, 0);
+    auto row = [&](uint64_t layer, uint64_t y) { return slab.data() + (layer * padY + y) * padX; };
 
-    uint32_t dim[3];
-    file.read((char *)dim, sizeof(dim));
+        // z up in the file, y up in the object
+    auto object = std::make_shared<voxelforge::VoxelObject>(glm::uvec3(sizeX / 16 + 1, sizeZ / 16 + 1, sizeY / 16 + 1));
 
-    uint32_t numColorPalleteColors;
-    file.read((char *)&numColorPalleteColors, sizeof(numColorPalleteColors));
+    VoxelData values[64];
+    for (uint64_t z0 = 0; z0 < sizeZ; z0 += 16) {
+        uint64_t layers = std::min<uint64_t>(16, sizeZ - z0);
+        for (uint64_t l = 0; l < layers; l++) {
+            for (uint64_t y = 0; y < sizeY; y++) file.read((char *)row(l, y), sizeX);
+        }
+        if (!file) return invalid("truncated voxel data");
+        if (layers < 16) std::memset(row(layers, 0), 0, (16 - layers) * padY * padX);
+
+        for (uint64_t cy = 0; cy < padY; cy += 16)
+        for (uint64_t cx = 0; cx < padX; cx += 16) {
+                // voxel masks of the chunk's subchunks, by subchunk bit
+            uint64_t masks[64] = {};
+            for (unsigned int l = 0; l < 16; l++)
+            for (unsigned int y = 0; y < 16; y++) {
+                uint32_t bits = occupiedBits(row(l, cy + y) + cx);
+                if (!bits) continue;
+
+                unsigned int subChunk = internal::bitIndex(0, l >> 2, y >> 2);
+                unsigned int shift = internal::bitIndex(0, l & 3, y & 3);
+                for (unsigned int sx = 0; sx < 4; sx++) {
+                    masks[subChunk | sx] |= (uint64_t)((bits >> (sx * 4)) & 15) << shift;
+                }
+            }
 
-    // end of header
+            std::shared_ptr<VoxelChunk> chunk;
+            for (unsigned int sub = 0; sub < 64; sub++) {
+                if (!masks[sub]) continue;
 
-    std::vector<uint8_t> voxelBuffer(dim[0] * dim[1] * dim[2]);
-    file.read((char *)voxelBuffer.data(), voxelBuffer.size());
+                glm::uvec3 corner = internal::bitPosition(sub) * 4u;
+                unsigned int n = 0;
+                for (uint64_t mask = masks[sub]; mask; mask &= mask - 1) {
+                    glm::uvec3 p = corner + internal::bitPosition(__builtin_ctzll(mask));
+                    values[n++] = VoxelData(glm::vec3(0.0f), row(p.y, cy + p.z)[cx + p.x]);
+                }
 
-    std::vector<uint8_t> palleteBuffer(numColorPalleteColors * colorBitsPerChannel * colorNumChannels);
-    file.read((char *)palleteBuffer.data(), palleteBuffer.size());
+                if (!chunk) chunk = std::make_shared<VoxelChunk>();
+                chunk->apply(sub, masks[sub], 0, values);
+            }
+            if (chunk) object->setChunk(glm::uvec3(cx / 16, z0 / 16, cy / 16), chunk);
+        }
+    }
 
-    auto world = std::make_shared<voxelforge::VoxelObject>(glm::uvec3(
-        dim[0] / 16 + 1,
-        dim[1] / 16 + 1,
-        dim[2] / 16 + 1
-    ));
+        // palette index i is material i, 0 being empty. 8-bit colors are scaled like the .vox loader's
+    std::vector<uint8_t> palette(header.paletteSize * colorBytes);
+    if (!file.read((char *)palette.data(), palette.size())) return invalid("truncated palette");
+    for (uint32_t i = 0; i < header.paletteSize; i++) {
+        glm::vec4 color(0.0f, 0.0f, 0.0f, 1.0f);
+        for (unsigned int c = 0; c < header.channels; c++) {
+            if (floatColors) {
+                std::memcpy(&color[c], &palette[(i * header.channels + c) * 4], 4);
+            } else {
+                color[c] = palette[i * header.channels + c] / 256.0f;
+            }
+        }
+        object->setMaterial(i, color);
+    }
 
-    // TODO
+    return object;
 }
 
-struct _VOXFileChunk {
-    _VOXFileChunk(std::ifstream& file) {
-        this->id.resize(4);
-        file.read(this->id.data(), 4);
-        file.read((char *)&this->dataSize, sizeof(this->dataSize));
-        file.read((char *)&this->numChildren, sizeof(this->numChildren));
-
-        this->data.resize(this->dataSize);
-        file.read(this->data.data(), this->dataSize);
-
-        this->children.resize(this->numChildren);
-        for (int i = 0; i < this->numChildren; i++) {
-            this->children[i] = _VOXFileChunk(file);
+    // little-endian reader over a byte range. a read past the end fails the reader and yields zeros / empty views,
+    // so parsers can read a whole record and check ok() once
+struct _VOXReader {
+    _VOXReader(std::string_view data) : data(data) {}
+
+    int32_t readInt() {
+        std::string_view bytes = this->readBytes(4);
+        int32_t value = 0;
+        if (bytes.size() == 4) std::memcpy(&value, bytes.data(), 4);
+        return value;
+    }
+    std::string_view readBytes(size_t count) {
+        if (this->failed || count > this->data.size() - this->position) {
+            this->failed = true;
+            return std::string_view();
+        }
+        std::string_view bytes = this->data.substr(this->position, count);
+        this->position += count;
+        return bytes;
+    }
+    std::string_view readString() {
+        int32_t length = this->readInt();
+        if (length < 0) this->failed = true;
+        return this->readBytes(length);
+    }
+        // element count of a following array, each element taking at least `minBytes`
+    int32_t readCount(size_t minBytes) {
+        int32_t count = this->readInt();
+        if (count < 0 || (size_t)count > (this->data.size() - this->position) / minBytes) {
+            this->failed = true;
+            return 0;
         }
+        return count;
     }
-    _VOXFileChunk() {}
 
-    std::string id;
-    int dataSize;
-    int numChildren;
+    bool ok() const { return !this->failed; }
+    bool atEnd() const { return this->failed || this->position == this->data.size(); }
 
-    std::vector<char> data;
-    std::vector<_VOXFileChunk> children;
+    std::string_view data;
+    size_t position = 0;
+    bool failed = false;
 };
 
-using _VOXFileDict = std::unordered_map<std::string, std::string>;
+    // a chunk header with views of its content and children, nothing is copied
+struct _VOXFileChunk {
+    _VOXFileChunk(_VOXReader& reader) {
+        this->id = reader.readBytes(4);
+        int32_t contentSize = reader.readInt();
+        int32_t childrenSize = reader.readInt();
+        if (contentSize < 0 || childrenSize < 0) reader.failed = true;
+
+        this->content = reader.readBytes(contentSize);
+        this->children = reader.readBytes(childrenSize);
+    }
+
+    std::string_view id;
+    std::string_view content;
+    std::string_view children;
+};
 
-static std::string loadString(std::vector<char>& data, int& start) {
-    int len = *(int*)&data[start];
-    start += 4;
-    int sData = start;
-    start += len;
-    return std::string(&data[sData], len);
-}
-static _VOXFileDict loadDict(std::vector<char>& data, int& start) {
-    _VOXFileDict d;
-    int n = *(int*)&data[start];
-    start += 4;
-    for (int i = 0; i < n; i++) {
-        std::string key = loadString(data, start);
-        std::string val = loadString(data, start);
-        d[key] = val;
-    }
-    return d;
-} 
+    // a DICT, kept as a view of its validated entries and searched on lookup (they hold a handful of keys)
+struct _VOXFileDict {
+    _VOXFileDict() {}
+    _VOXFileDict(_VOXReader& reader) {
+        this->count = reader.readCount(8);
+        size_t start = reader.position;
+        for (int32_t i = 0; i < this->count && reader.ok(); i++) {
+            reader.readString();
+            reader.readString();
+        }
+        if (reader.ok()) this->entries = reader.data.substr(start, reader.position - start);
+    }
+
+    std::optional<std::string_view> find(std::string_view key) const {
+        _VOXReader reader(this->entries);
+        for (int32_t i = 0; i < this->count; i++) {
+            std::string_view k = reader.readString();
+            std::string_view v = reader.readString();
+            if (k == key) return v;
+        }
+        return std::nullopt;
+    }
+
+    std::string_view entries;
+    int32_t count = 0;
+};
 
 struct _VOXFilenTRN {
-    _VOXFilenTRN(std::vector<char> chunkData) {
-        int i = 0;
-        this->nodeID = *(int*)&chunkData[i];
-        i += 4;
-        this->attribs = loadDict(chunkData, i);
-        this->childID = *(int*)&chunkData[i];
-        i += 4;
-        this->reserved = *(int*)&chunkData[i];
-        i += 4;
-        this->layerID = *(int*)&chunkData[i];
-        i += 4;
-        this->nFrames = *(int*)&chunkData[i];
-        i += 4;
-        this->frameAttribs.resize(this->nFrames);
-        for (int f = 0; f < this->nFrames; ++f) {
-            this->frameAttribs[f] = loadDict(chunkData, i);
+    _VOXFilenTRN(_VOXReader& reader) {
+        this->nodeID = reader.readInt();
+        this->attribs = _VOXFileDict(reader);
+        this->childID = reader.readInt();
+        this->reserved = reader.readInt();
+        this->layerID = reader.readInt();
+        this->nFrames = reader.readCount(4);
+        this->frameAttribs.reserve(this->nFrames);
+        for (int f = 0; f < this->nFrames && reader.ok(); ++f) {
+            this->frameAttribs.emplace_back(reader);
         }
     }
-    _VOXFilenTRN() {}
 
     int nodeID;
     _VOXFileDict attribs;
@@ -138,44 +261,34 @@ struct _VOXFilenTRN {
 };
 
 struct _VOXFilenGRP {
-    _VOXFilenGRP(std::vector<char> chunkData) {
-        int i = 0;
-        this->nodeID = *(int*)&chunkData[i];
-        i += 4;
-        this->attribs = loadDict(chunkData, i);
-        this->nChildren = *(int*)&chunkData[i];
-        i += 4;
+    _VOXFilenGRP(_VOXReader& reader) {
+        this->nodeID = reader.readInt();
+        this->attribs = _VOXFileDict(reader);
+        this->nChildren = reader.readCount(4);
         this->childIDs.resize(this->nChildren);
         for (int c = 0; c < this->nChildren; c++) {
-            this->childIDs[c] = *(int*)&chunkData[i];
-            i += 4;
+            this->childIDs[c] = reader.readInt();
         }
     }
-    _VOXFilenGRP() {}
-    
+
     int nodeID;
     _VOXFileDict attribs;
     int nChildren;
     std::vector<int> childIDs;
 };
 
-struct _VOXFilenSHP {    
-    _VOXFilenSHP(std::vector<char> chunkData) {
-        int i = 0;
-        this->nodeID = *(int*)&chunkData[i];
-        i += 4;
-        this->attribs = loadDict(chunkData, i);
-        this->nModels = *(int*)&chunkData[i];
-        i += 4;
+struct _VOXFilenSHP {
+    _VOXFilenSHP(_VOXReader& reader) {
+        this->nodeID = reader.readInt();
+        this->attribs = _VOXFileDict(reader);
+        this->nModels = reader.readCount(8);
         this->modelIDs.resize(this->nModels);
-        this->modelAttribs.resize(this->nModels);
-        for (int m = 0; m < this->nModels; m++) {
-            this->modelIDs[m] = *(int*)&chunkData[i];
-            i += 4;
-            this->modelAttribs[m] = loadDict(chunkData, i);
+        this->modelAttribs.reserve(this->nModels);
+        for (int m = 0; m < this->nModels && reader.ok(); m++) {
+            this->modelIDs[m] = reader.readInt();
+            this->modelAttribs.emplace_back(reader);
         }
     }
-    _VOXFilenSHP() {}
 
     int nodeID;
     _VOXFileDict attribs;
@@ -184,19 +297,27 @@ struct _VOXFilenSHP {
     std::vector<_VOXFileDict> modelAttribs;
 };
 
-using _VOXFileSceneNodeData = std::optional<std::variant<_VOXFilenTRN, _VOXFilenGRP, _VOXFilenSHP>>;
+using _VOXFileSceneNodeData = std::variant<_VOXFilenTRN, _VOXFilenGRP, _VOXFilenSHP>;
 
 struct _VOXFileModelData {
-    _VOXFileModelData(glm::uvec3 size, std::vector<glm::u8vec4> data) : size(size), data(data) {}
-    _VOXFileModelData() {
-        this->size = glm::uvec3(0);
-        this->data.clear();
-    }
-    glm::uvec3 size;
-    std::vector<glm::u8vec4> data;
+    _VOXFileModelData(glm::uvec3 size, std::string_view voxels) : size(size), voxels(voxels) {}
+
+    glm::uvec3 size;            // y up, like the objects
+    std::string_view voxels;    // XYZI payload, 4 bytes per voxel: x, y, z (z up), color index
     bool instanced = false;
 };
 
+    // sets the voxels of a model, swapping the file's z up to y up. false if a voxel lies outside the model
+static bool fillObject(voxelforge::VoxelObject& object, const _VOXFileModelData& model) {
+    const uint8_t *voxel = (const uint8_t *)model.voxels.data();
+    for (size_t i = 0; i < model.voxels.size(); i += 4, voxel += 4) {
+        glm::uvec3 position(voxel[0], voxel[2], voxel[1]);
+        if (position.x >= model.size.x || position.y >= model.size.y || position.z >= model.size.z) return false;
+        object.set(position, voxelforge::VoxelData(glm::vec3(0.0), voxel[3]));
+    }
+    return true;
+}
+
 struct _VOXFileSceneNode;
 struct _VOXFileTransformNode;
 struct _VOXFileGroupingNode;
@@ -258,16 +379,18 @@ public:
     }
 };
 
-static std::vector<int32_t> parseBCDString(const std::string& input) {
-    std::istringstream iss(input);
+    // space separated integers, e.g. a "_t" translation
+static std::vector<int32_t> parseBCDString(std::string_view input) {
     std::vector<int32_t> numbers;
-    int32_t number;
+    const char *p = input.data(), *end = input.data() + input.size();
 
-    while (iss >> number) {
+    while (p < end) {
+        while (p < end && *p == ' ') p++;
+        int32_t number;
+        auto [next, error] = std::from_chars(p, end, number);
+        if (error != std::errc()) break;
         numbers.push_back(number);
-        if (iss.peek() == ' ') {
-            iss.ignore();
-        }
+        p = next;
     }
 
     return numbers;
@@ -297,13 +420,42 @@ static glm::mat3 byteToRotationMatrix(unsigned char byte) {
     return rotationMatrix;
 }
 
-static _VOXFileSceneNode::Ptr buildSceneGraph(const std::unordered_map<int, _VOXFileSceneNodeData>& nodes, int parentID, _VOXFileSceneNode::Ptr parent = nullptr) {
-    if (nodes.find(parentID) == nodes.end()) return nullptr; // no root node
-    _VOXFileSceneNodeData root = nodes.at(parentID);
+    // deeper than any real scene, keeps a long chain of nodes in a malformed file from overflowing the stack
+static constexpr size_t MAX_SCENE_DEPTH = 256;
+
+    // the graph of a file is a tree, so every node is built at most once. a node reached again is either one of its own
+    // ancestors or shared by several parents, and building it anyway would loop forever or double the work per level
+struct _VOXFileSceneGraphBuild {
+    explicit _VOXFileSceneGraphBuild(const std::unordered_map<int, _VOXFileSceneNodeData>& nodes) : nodes(nodes) {}
+
+    const std::unordered_map<int, _VOXFileSceneNodeData>& nodes;
+    std::unordered_set<int> visited;
+    std::unordered_set<int> path;       // nodes from the root down to the one being built
+    const char *error = nullptr;        // set when the graph isn't a tree, the result is null then
+};
+
+static _VOXFileSceneNode::Ptr buildSceneNode(_VOXFileSceneGraphBuild& build, const _VOXFileSceneNodeData& var, _VOXFileSceneNode::Ptr parent);
 
-    if (!root.has_value()) return nullptr; // no root node
+static _VOXFileSceneNode::Ptr buildSceneGraph(_VOXFileSceneGraphBuild& build, int parentID, _VOXFileSceneNode::Ptr parent = nullptr) {
+    if (build.error) return nullptr;
+    auto it = build.nodes.find(parentID);
+    if (it == build.nodes.end()) return nullptr; // no root node
 
-    auto var = root.value();
+    if (!build.visited.insert(parentID).second) {
+        build.error = build.path.count(parentID) ? "scene graph cycle" : "scene graph node with several parents";
+        return nullptr;
+    }
+    if (build.path.size() >= MAX_SCENE_DEPTH) {
+        build.error = "scene graph too deep";
+        return nullptr;
+    }
+    build.path.insert(parentID);
+    _VOXFileSceneNode::Ptr node = buildSceneNode(build, it->second, parent);
+    build.path.erase(parentID);
+    return build.error ? nullptr : node;
+}
+
+static _VOXFileSceneNode::Ptr buildSceneNode(_VOXFileSceneGraphBuild& build, const _VOXFileSceneNodeData& var, _VOXFileSceneNode::Ptr parent) {
     if (std::holds_alternative<_VOXFilenTRN>(var)) {
         const auto& node = std::get<_VOXFilenTRN>(var);
 
@@ -313,17 +465,15 @@ static _VOXFileSceneNode::Ptr buildSceneGraph(const std::unordered_map<int, _VOX
         for (const auto& f : node.frameAttribs) {
             glm::mat4x4 m = glm::identity<glm::mat4x4>();
 
-            if (f.find("_t") != f.end()) {
-                std::string translation = f.at("_t");
-                std::vector<int32_t> translationValues = parseBCDString(translation);
+            if (auto translation = f.find("_t")) {
+                std::vector<int32_t> translationValues = parseBCDString(*translation);
                 if (translationValues.size() == 3) {
                     m = glm::translate(m, glm::vec3((float)translationValues[0] / 16.0f, (float)translationValues[2] / 16.0f, (float)translationValues[1] / 16.0f));
                 }
             }
-            if (f.find("_r") != f.end()) {
-                std::string rotation = f.at("_r");
-                std::cout << rotation << std::endl;
-                uint8_t b = atoi(rotation.c_str());
+            if (auto rotation = f.find("_r")) {
+                unsigned int b = 0;
+                std::from_chars(rotation->data(), rotation->data() + rotation->size(), b);
 
                 glm::mat3x3 r = byteToRotationMatrix(b);
 
@@ -338,7 +488,7 @@ static _VOXFileSceneNode::Ptr buildSceneGraph(const std::unordered_map<int, _VOX
             transform->transformFrames.push_back(m);
         }
 
-        _VOXFileSceneNode::Ptr child = buildSceneGraph(nodes, node.childID, transform);
+        _VOXFileSceneNode::Ptr child = buildSceneGraph(build, node.childID, transform);
         transform->add_child(child);
         transform->attributes = node.attribs;
         transform->layer = node.layerID;
@@ -352,7 +502,7 @@ static _VOXFileSceneNode::Ptr buildSceneGraph(const std::unordered_map<int, _VOX
         grouping->parent = parent;
 
         for (int c : node.childIDs) {
-            _VOXFileSceneNode::Ptr child = buildSceneGraph(nodes, c, grouping);
+            _VOXFileSceneNode::Ptr child = buildSceneGraph(build, c, grouping);
             grouping->add_child(child);
         }
 
@@ -409,6 +559,13 @@ public:
     }
 };
 
+    // a shape reached by the scene graph walk, built into an object once the walk is done
+struct _VOXFileModelPlacement {
+    int modelID;
+    glm::mat4x4 modelMatrix;
+};
+
+    // collects the shapes in scene graph order, the objects themselves are built afterwards in parallel
 struct _VOXFileSceneGraphObjectExtractor : public _VOXFileSceneGraphVisitor {
 public:
     using _VOXFileSceneGraphVisitor::visit;
@@ -416,7 +573,7 @@ public:
     _VOXFileSceneGraphObjectExtractor(std::vector<_VOXFileModelData>& models) : models(models) {}
 
     virtual void visit(_VOXFileTransformNode *node) override {
-        glm::mat4x4 m = node->transformFrames[0];
+        glm::mat4x4 m = node->transformFrames.empty() ? glm::identity<glm::mat4x4>() : node->transformFrames[0];
         glm::mat4x4 modelOld = this->modelMatrix;
         this->modelMatrix = m * this->modelMatrix;
         this->visit(node->children[0]);
@@ -430,50 +587,54 @@ public:
     }
 
     virtual void visit(_VOXFileShapeNode *node) override {
-        int modelID = node->modelIDs[0];
-        _VOXFileModelData& model = this->models[modelID];
-        glm::uvec3 szChunks = model.size / 16u + 1u;
-        auto object = std::make_shared<voxelforge::VoxelObject>(szChunks, this->modelMatrix);
-
-        model.instanced = true;
-
-        for (const auto& vox : model.data) {
-            std::shared_ptr<voxelforge::VoxelData> vd = std::make_shared<voxelforge::VoxelData>(glm::vec3(0.0), vox.w);
-            object->set(glm::uvec3(vox.x, vox.y, vox.z), vd);
-        }
+        if (node->modelIDs.empty() || node->modelIDs[0] < 0 || node->modelIDs[0] >= (int)this->models.size()) return; // dangling model reference
 
-        this->objects.push_back(object);
+        int modelID = node->modelIDs[0];
+        this->models[modelID].instanced = true;
+        this->placements.push_back({ modelID, this->modelMatrix });
     }
 
     std::vector<_VOXFileModelData>& models;
-    std::vector<std::shared_ptr<voxelforge::VoxelObject>> objects;
+    std::vector<_VOXFileModelPlacement> placements;
     glm::mat4x4 modelMatrix = glm::identity<glm::mat4x4>();
 };
 
-MagicaVoxelVOX::MagicaVoxelVOX(const char *filename) {
-    std::ifstream file(filename, std::ios::binary);
+    // reads the whole file with one read, the parser only takes views of it
+static std::unique_ptr<char[]> readFile(const char *filename, size_t& size) {
+    std::ifstream file(filename, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) return nullptr;
 
-    if (!file.is_open()) {
+    size = file.tellg();
+    file.seekg(0);
+    std::unique_ptr<char[]> buffer(new char[size]);
+    if (!file.read(buffer.get(), size)) return nullptr;
+    return buffer;
+}
+
+MagicaVoxelVOX::MagicaVoxelVOX(const char *filename, unsigned int workers) {
+    size_t fileSize = 0;
+    std::unique_ptr<char[]> buffer = readFile(filename, fileSize);
+
+    if (!buffer) {
         std::cerr << "Error opening file: " << filename << std::endl;
         return;
     }
+    auto invalid = [&](const char *reason) {
+        std::cerr << "Invalid VOX file: " << filename << " (" << reason << ")" << std::endl;
+    };
 
-    std::string magic;
-    magic.resize(4);
-
-    file.read(magic.data(), magic.size());
-
-    if (magic != "VOX ") {
-        std::cerr << "Invalid VOX file: " << filename << std::endl;
+    _VOXReader file(std::string_view(buffer.get(), fileSize));
+    if (file.readBytes(4) != "VOX ") {
+        invalid("bad magic");
         return;
     }
 
-    int vers;
-    file.read((char *)&vers, sizeof(int));
+    int vers = file.readInt();
+    (void)vers;
 
-    _VOXFileChunk mainChunk = _VOXFileChunk(file);
-    if (mainChunk.id != "MAIN") {
-        std::cerr << "Invalid VOX file: " << filename << " (missing MAIN chunk)" << std::endl;
+    _VOXFileChunk mainChunk(file);
+    if (!file.ok() || mainChunk.id != "MAIN") {
+        invalid("missing MAIN chunk");
         return;
     }
 
@@ -481,92 +642,140 @@ MagicaVoxelVOX::MagicaVoxelVOX(const char *filename) {
     std::unordered_map<int, _VOXFileSceneNodeData> sceneGraphData;
 
     glm::vec4 palette[256];
+    for (int i = 0; i < 256; i++) palette[i] = glm::vec4(0.0f);
 
-    for (int i = 0; i < mainChunk.children.size(); ++i) {
-        const auto& chunk = mainChunk.children[i];
-        if (chunk.id == "SIZE") {
-            glm::uvec3 size;
-            size.x = *(int*)&chunk.data[0];
-            size.z = *(int*)&chunk.data[4];
-            size.y = *(int*)&chunk.data[8];
+    std::optional<glm::uvec3> pendingSize; // a SIZE chunk waiting for its XYZI chunk
 
-            std::cout << glm::to_string(size) << std::endl;
+    _VOXReader children(mainChunk.children);
+    while (!children.atEnd()) {
+        _VOXFileChunk chunk(children);
+        if (!children.ok()) {
+            invalid("chunk runs past the end of MAIN");
+            return;
+        }
+        _VOXReader content(chunk.content);
 
-            i++;
-            const auto& xyziChunk = mainChunk.children[i];
-            if (xyziChunk.id != "XYZI") {
-                std::cerr << "Invalid VOX file: " << filename << " (expected XYZI after SIZE chunk)";
+        if (chunk.id == "SIZE") {
+            glm::uvec3 size;
+            size.x = content.readInt();
+            size.z = content.readInt();
+            size.y = content.readInt();
+            if (!content.ok() || size.x > 256 || size.y > 256 || size.z > 256) {
+                invalid("bad SIZE chunk");
+                return;
+            }
+            pendingSize = size;
+        }
+        else if (chunk.id == "XYZI") {
+            if (!pendingSize) {
+                invalid("expected SIZE before XYZI chunk");
                 return;
             }
 
-            auto& model = models.emplace_back(size, std::vector<glm::u8vec4>{});
-            
-            int nVoxels = *(int*)&xyziChunk.data[0];
-            for (int j = 0; j < nVoxels; j++) {
-                uint8_t x = xyziChunk.data[4 + 4 * j];
-                uint8_t z = xyziChunk.data[5 + 4 * j];
-                uint8_t y = xyziChunk.data[6 + 4 * j];
-                uint8_t i = xyziChunk.data[7 + 4 * j];
-                model.data.push_back(glm::u8vec4(x, y, z, i));
+            int nVoxels = content.readCount(4);
+            std::string_view voxels = content.readBytes((size_t)nVoxels * 4);
+            if (!content.ok()) {
+                invalid("voxel count past the end of XYZI chunk");
+                return;
             }
+
+                // only indexed here, the voxels are checked and decoded by the workers building the objects
+            models.emplace_back(*pendingSize, voxels);
+            pendingSize.reset();
         }
-        if (chunk.id == "RGBA") {
+        else if (chunk.id == "RGBA") {
+            std::string_view colors = content.readBytes(256 * 4);
+            if (!content.ok()) {
+                invalid("short RGBA chunk");
+                return;
+            }
             for (int i = 0; i < 255; i++) {
-                uint8_t r = chunk.data[i * 4 + 0];
-                uint8_t g = chunk.data[i * 4 + 1];
-                uint8_t b = chunk.data[i * 4 + 2];
-                uint8_t a = chunk.data[i * 4 + 3];
-                glm::vec4 mat = glm::vec4(r, g, b, a) / 256.0f;
+                const uint8_t *c = (const uint8_t *)colors.data() + i * 4;
+                glm::vec4 mat = glm::vec4(c[0], c[1], c[2], c[3]) / 256.0f;
                 palette[i + 1] = mat;
             }
         }
-        if (chunk.id == "nTRN") {
-            _VOXFilenTRN trnNode(chunk.data);
-            int i = trnNode.nodeID;
-            
-            sceneGraphData[i] = trnNode;
-        }
-        if (chunk.id == "nGRP") {
-            _VOXFilenGRP grpNode(chunk.data);
-            int i = grpNode.nodeID;
-
-            sceneGraphData[i] = grpNode;
-        }
-        if (chunk.id == "nSHP") {
-            _VOXFilenSHP shpNode(chunk.data);
-            int i = shpNode.nodeID;
+        else if (chunk.id == "nTRN" || chunk.id == "nGRP" || chunk.id == "nSHP") {
+            if (chunk.id == "nTRN") {
+                _VOXFilenTRN node(content);
+                sceneGraphData.insert_or_assign(node.nodeID, std::move(node));
+            } else if (chunk.id == "nGRP") {
+                _VOXFilenGRP node(content);
+                sceneGraphData.insert_or_assign(node.nodeID, std::move(node));
+            } else {
+                _VOXFilenSHP node(content);
+                sceneGraphData.insert_or_assign(node.nodeID, std::move(node));
+            }
 
-            sceneGraphData[i] = shpNode;
+            if (!content.ok()) {
+                invalid("scene graph node past the end of its chunk");
+                return;
+            }
         }
     }
 
         // TODO: better root node picking function. this area is completely undocumented in the file format.
-    _VOXFileSceneNode::Ptr sceneGraph = buildSceneGraph(sceneGraphData, 0);
+    _VOXFileSceneGraphBuild build(sceneGraphData);
+    _VOXFileSceneNode::Ptr sceneGraph = buildSceneGraph(build, 0);
+    if (build.error) {
+        invalid(build.error);
+        return;
+    }
 
     _VOXFileSceneGraphObjectExtractor gen(models);
     gen.visit(sceneGraph);
 
-    this->world = std::make_shared<voxelforge::VoxelWorld>();
+        // models no nSHP chunk references draw at the root, after the scene graph objects
+    std::vector<_VOXFileModelPlacement> placements = std::move(gen.placements);
+    for (size_t i = 0; i < models.size(); i++) {
+        if (!models[i].instanced) placements.push_back({ (int)i, glm::identity<glm::mat4x4>() });
+    }
 
-    for (auto& object : gen.objects) {
-        for (int i = 0; i < 256; i++) {
-            object->setMaterial(i, palette[i]);
-        }
-        this->world->addObject(object);
+        // each model is built once, at its first placement. further placements become VoxelInstances of that object,
+        // so memory and upload cost follow the unique models rather than the shapes
+    std::vector<size_t> firstPlacement(models.size(), SIZE_MAX);
+    std::vector<size_t> order;
+    for (size_t i = 0; i < placements.size(); i++) {
+        size_t& first = firstPlacement[placements[i].modelID];
+        if (first != SIZE_MAX) continue;
+        first = i;
+        order.push_back(i);
     }
 
-    for (auto& model : models) {
-            // the model is referenced by an nSHP chunk, it doesn't draw at the root
-        if (model.instanced) continue;
-        std::shared_ptr<voxelforge::VoxelObject> obj = std::make_shared<voxelforge::VoxelObject>(model.size / 16u + 1u);
-        for (int i = 0; i < 256; i++) {
-            obj->setMaterial(i, palette[i]);
+        // the workers share nothing but the file buffer. the biggest models are handed out first to keep one large
+        // shape from finishing last, results stay in placement order
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return models[placements[a].modelID].voxels.size() > models[placements[b].modelID].voxels.size();
+    });
+
+    std::vector<std::shared_ptr<voxelforge::VoxelObject>> objects(placements.size());
+    std::atomic<bool> outside(false);
+    voxelforge::parallelFor(order.size(), workers, 1, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            const _VOXFileModelPlacement& placement = placements[order[i]];
+            const _VOXFileModelData& model = models[placement.modelID];
+
+            auto object = std::make_shared<voxelforge::VoxelObject>(model.size / 16u + 1u, placement.modelMatrix);
+            for (int m = 0; m < 256; m++) {
+                object->setMaterial(m, palette[m]);
+            }
+            if (!fillObject(*object, model)) outside = true;
+            objects[order[i]] = object;
         }
-        for (auto v : model.data) {
-            std::shared_ptr<voxelforge::VoxelData> vox = std::make_shared<voxelforge::VoxelData>(glm::vec3(0.0), v.w);
-            obj->set(glm::uvec3(v.x, v.y, v.z), vox);
+    });
+    if (outside) {
+        invalid("voxel outside of its model");
+        return;
+    }
+
+    this->world = std::make_shared<voxelforge::VoxelWorld>();
+    for (size_t i = 0; i < placements.size(); i++) {
+        size_t first = firstPlacement[placements[i].modelID];
+        if (first == i) {
+            this->world->addObject(objects[i]);
+        } else {
+            this->world->addInstance(std::make_shared<voxelforge::VoxelInstance>(objects[first], placements[i].modelMatrix));
         }
-        this->world->addObject(obj);
     }
 }
-}
\ No newline at end of file
+}
@@ -0,0 +1,265 @@
+#include <vforge/generator.hpp>
+#include <vforge/threads.hpp>
+#include <algorithm>
+#include <chrono>
+
+namespace voxelforge {
+
+ChunkGeneration::ChunkGeneration(ChunkMap& chunks, glm::uvec3 dim, std::shared_ptr<ChunkGenerator> generator, unsigned int workers)
+    : chunks(chunks), dim(dim), generator(std::move(generator)), workerCount(workers ? workers : defaultWorkerCount()), focus(dim / 2u) {
+    size_t count = (size_t)dim.x * dim.y * dim.z, missing = 0;
+    this->state = std::make_unique<std::atomic<uint8_t>[]>(count);
+    for (unsigned int z = 0; z < dim.z; z++)
+    for (unsigned int y = 0; y < dim.y; y++)
+    for (unsigned int x = 0; x < dim.x; x++) {
+        bool present = this->chunks.find(glm::uvec3(x, y, z)) != this->chunks.end();
+        this->state[this->index(glm::uvec3(x, y, z))].store(present ? DONE : MISSING, std::memory_order_relaxed);
+        missing += !present;
+    }
+    this->remaining.store(missing);
+    this->unsettled.store(missing);
+}
+
+ChunkGeneration::~ChunkGeneration() {
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->stopping = true;
+    }
+    this->wake.notify_all();
+    for (auto& worker : this->workers) worker.join();
+}
+
+std::shared_ptr<VoxelChunk> ChunkGeneration::run(glm::uvec3 position, bool ahead) {
+    auto start = std::chrono::steady_clock::now();
+    std::shared_ptr<VoxelChunk> chunk = this->generator->generate(position);
+    if (chunk && chunk->getBitmask() == 0) chunk = nullptr;
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->stats.generated++;
+    this->stats.ahead += ahead;
+    this->stats.empty += !chunk;
+    this->stats.seconds += seconds;
+    return chunk;
+}
+
+bool ChunkGeneration::claim(glm::uvec3 position, std::shared_ptr<VoxelChunk>& chunk) {
+    if (!this->inBounds(position)) return false;
+
+    std::atomic<uint8_t>& state = this->state[this->index(position)];
+    for (;;) {
+        uint8_t current = state.load(std::memory_order_acquire);
+        if (current == DONE) return false;
+        if (current == MISSING) {
+            if (!state.compare_exchange_weak(current, CLAIMED, std::memory_order_acq_rel)) continue;
+            chunk = this->run(position, false);
+            return true;
+        }
+
+        std::unique_lock<std::mutex> lock(this->mutex);
+        current = state.load(std::memory_order_acquire);
+        if (current == FINISHED) {
+            auto it = this->finished.find(position);
+            chunk = std::move(it->second);
+            this->finished.erase(it);
+            this->finishedCount.fetch_sub(1, std::memory_order_release);
+            state.store(CLAIMED, std::memory_order_release);
+            return true;
+        }
+        if (current == CLAIMED) {
+            this->stats.waits++;
+            this->changed.wait(lock, [&]() { return state.load(std::memory_order_acquire) != CLAIMED; });
+        }
+    }
+}
+
+void ChunkGeneration::settle(glm::uvec3 position) {
+    this->state[this->index(position)].store(DONE, std::memory_order_release);
+    this->remaining.fetch_sub(1, std::memory_order_relaxed);
+
+        // under the lock, so a thread about to wait for the chunk can't miss it
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->changed.notify_all();
+}
+
+std::shared_ptr<VoxelChunk> ChunkGeneration::take(glm::uvec3 position) {
+    std::shared_ptr<VoxelChunk> chunk;
+    if (!this->claim(position, chunk)) return nullptr;
+
+    this->settle(position);
+    this->unsettled.fetch_sub(1, std::memory_order_release);
+    return chunk;
+}
+
+void ChunkGeneration::generateShared(glm::uvec3 position) {
+    if (this->isGenerated(position)) return;
+
+    std::shared_ptr<VoxelChunk> chunk;
+    if (!this->claim(position, chunk)) return;
+    if (!chunk) {
+        this->settle(position);
+        this->unsettled.fetch_sub(1, std::memory_order_release);
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->finishedCount.fetch_add(1, std::memory_order_release);
+    if (!this->chunks.publish(position, chunk)) {
+            // outside the dense directory the map can't take it while it is being read, the owner installs it
+        this->finished[position] = std::move(chunk);
+        this->state[this->index(position)].store(FINISHED, std::memory_order_release);
+        this->changed.notify_all();
+        return;
+    }
+    this->published.push_back(position);
+    this->state[this->index(position)].store(DONE, std::memory_order_release);
+    this->remaining.fetch_sub(1, std::memory_order_relaxed);
+    this->changed.notify_all();
+}
+
+void ChunkGeneration::cancel(glm::uvec3 position) {
+    if (!this->inBounds(position)) return;
+
+    uint8_t missing = MISSING;
+    if (this->state[this->index(position)].compare_exchange_strong(missing, DONE, std::memory_order_acq_rel)) {
+        this->remaining.fetch_sub(1, std::memory_order_relaxed);
+        this->unsettled.fetch_sub(1, std::memory_order_release);
+        return;
+    }
+    this->take(position);
+}
+
+void ChunkGeneration::cancelAll() {
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->requests.clear();
+    }
+    for (unsigned int z = 0; z < this->dim.z; z++)
+    for (unsigned int y = 0; y < this->dim.y; y++)
+    for (unsigned int x = 0; x < this->dim.x; x++) this->cancel(glm::uvec3(x, y, z));
+
+        // the published chunks went with the rest of the map
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->unsettled.fetch_sub(this->published.size(), std::memory_order_release);
+    this->finishedCount.fetch_sub(this->published.size(), std::memory_order_release);
+    this->published.clear();
+}
+
+void ChunkGeneration::startWorkers() {
+    if (!this->workers.empty()) return;
+    for (unsigned int i = 0; i < this->workerCount; i++) this->workers.emplace_back(&ChunkGeneration::workerLoop, this);
+}
+
+void ChunkGeneration::request(glm::uvec3 center, unsigned int radius) {
+    struct Candidate {
+        glm::uvec3 position;
+        uint64_t distance;
+    };
+    std::vector<Candidate> candidates;
+    const glm::ivec3 c(center);
+    const int r = (int)radius;
+    for (int z = std::max(c.z - r, 0); z <= std::min(c.z + r, (int)this->dim.z - 1); z++)
+    for (int y = std::max(c.y - r, 0); y <= std::min(c.y + r, (int)this->dim.y - 1); y++)
+    for (int x = std::max(c.x - r, 0); x <= std::min(c.x + r, (int)this->dim.x - 1); x++) {
+        glm::uvec3 position(x, y, z);
+        if (this->state[this->index(position)].load(std::memory_order_relaxed) != MISSING) continue;
+
+        glm::ivec3 d = glm::ivec3(position) - c;
+        candidates.push_back({ position, (uint64_t)(d.x * d.x + d.y * d.y + d.z * d.z) });
+    }
+    std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) { return a.distance > b.distance; });
+
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->focus = center;
+        for (const Candidate& candidate : candidates) this->requests.push_back(candidate.position);
+        this->startWorkers();
+    }
+    this->wake.notify_all();
+}
+
+void ChunkGeneration::requestRest() {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    if (this->restRequested) return;
+    this->restRequested = true;
+
+    struct Candidate {
+        glm::uvec3 position;
+        uint64_t distance;
+    };
+    std::vector<Candidate> candidates;
+    const glm::ivec3 c(this->focus);
+    for (unsigned int z = 0; z < this->dim.z; z++)
+    for (unsigned int y = 0; y < this->dim.y; y++)
+    for (unsigned int x = 0; x < this->dim.x; x++) {
+        glm::uvec3 position(x, y, z);
+        if (this->state[this->index(position)].load(std::memory_order_relaxed) != MISSING) continue;
+
+        glm::ivec3 d = glm::ivec3(position) - c;
+        candidates.push_back({ position, (uint64_t)(d.x * d.x + d.y * d.y + d.z * d.z) });
+    }
+    std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) { return a.distance > b.distance; });
+
+        // nearest last is taken first, so the rest goes in front of what was requested before
+    std::vector<glm::uvec3> requests;
+    requests.reserve(candidates.size() + this->requests.size());
+    for (const Candidate& candidate : candidates) requests.push_back(candidate.position);
+    requests.insert(requests.end(), this->requests.begin(), this->requests.end());
+    this->requests = std::move(requests);
+
+    this->startWorkers();
+    this->wake.notify_all();
+}
+
+void ChunkGeneration::installFinished(std::vector<glm::uvec3>& installed) {
+    std::unordered_map<glm::uvec3, std::shared_ptr<VoxelChunk>, internal::uvec3Hash> finished;
+    std::vector<glm::uvec3> published;
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        finished.swap(this->finished);
+        published.swap(this->published);
+        this->finishedCount.fetch_sub(finished.size() + published.size(), std::memory_order_release);
+    }
+
+    for (auto& [position, chunk] : finished) {
+        this->chunks[position] = std::move(chunk);
+        this->state[this->index(position)].store(DONE, std::memory_order_release);
+        this->remaining.fetch_sub(1, std::memory_order_relaxed);
+        installed.push_back(position);
+    }
+    installed.insert(installed.end(), published.begin(), published.end());
+    this->unsettled.fetch_sub(finished.size() + published.size(), std::memory_order_release);
+}
+
+ChunkGeneration::Stats ChunkGeneration::getStats() const {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    return this->stats;
+}
+
+void ChunkGeneration::workerLoop() {
+    std::unique_lock<std::mutex> lock(this->mutex);
+    while (true) {
+        this->wake.wait(lock, [this]() { return this->stopping || !this->requests.empty(); });
+        if (this->stopping) return;
+
+        glm::uvec3 position = this->requests.back();
+        this->requests.pop_back();
+        uint8_t missing = MISSING;
+        if (!this->state[this->index(position)].compare_exchange_strong(missing, CLAIMED, std::memory_order_acq_rel)) continue;
+
+        lock.unlock();
+        std::shared_ptr<VoxelChunk> chunk = this->run(position, true);
+        if (!chunk) {
+            this->settle(position);
+            this->unsettled.fetch_sub(1, std::memory_order_release);
+            lock.lock();
+            continue;
+        }
+        lock.lock();
+        this->finished[position] = std::move(chunk);
+        this->state[this->index(position)].store(FINISHED, std::memory_order_release);
+        this->finishedCount.fetch_add(1, std::memory_order_release);
+        this->changed.notify_all();
+    }
+}
+}
@@ -0,0 +1,170 @@
+#include <vforge/object.hpp>
+#include <vforge/bvh.hpp>
+#include <vforge/threads.hpp>
+#include "traversal.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace voxelforge {
+
+    // one voxel standing for the voxels of a subchunk: the most common material (the lowest id on ties) and the
+    // normalized mean of their normals
+static VoxelData summarize(const VoxelSubChunk& sub) {
+    const unsigned int count = sub.size();
+
+    uint32_t ids[64];
+    glm::vec3 normal(0.0f);
+    for (unsigned int i = 0; i < count; i++) {
+        VoxelData voxel = sub.getVoxel(i);
+        ids[i] = voxel.matID;
+        if (voxel.packedNormal) normal += voxel.normal();
+    }
+    std::sort(ids, ids + count);
+
+    uint32_t dominant = ids[0];
+    size_t best = 0;
+    for (size_t i = 0; i < count;) {
+        size_t j = i + 1;
+        while (j < count && ids[j] == ids[i]) j++;
+        if (j - i > best) {
+            best = j - i;
+            dominant = ids[i];
+        }
+        i = j;
+    }
+
+    float length = glm::length(normal);
+    return VoxelData(length > 1e-6f ? normal / length : glm::vec3(0.0f), dominant);
+}
+
+    // rebuilds the chunks of `coarse` over the chunks [lo, hi) of `fine`. each fine chunk is one coarse subchunk, each
+    // of its subchunks one coarse voxel
+static void downsample(const VoxelObject& fine, VoxelObject& coarse, glm::uvec3 lo, glm::uvec3 hi, unsigned int workers) {
+    const glm::uvec3 coarseLo = lo / 4u, count = (hi + 3u) / 4u - coarseLo;
+    std::vector<std::shared_ptr<VoxelChunk>> built((size_t)count.x * count.y * count.z);
+    auto position = [&](size_t i) { return coarseLo + glm::uvec3(i % count.x, i / count.x % count.y, i / count.x / count.y); };
+
+    parallelFor(built.size(), workers, 1, [&](size_t begin, size_t end) {
+        VoxelData values[64];
+        for (size_t i = begin; i < end; i++) {
+            auto chunk = std::make_shared<VoxelChunk>();
+            for (unsigned int sub = 0; sub < 64; sub++) {
+                glm::uvec3 source = position(i) * 4u + internal::bitPosition(sub);
+                if (source.x >= fine.size().x || source.y >= fine.size().y || source.z >= fine.size().z) continue;
+
+                auto it = fine.getChunks().find(source);
+                if (it == fine.getChunks().end() || !it->second) continue;
+
+                unsigned int n = 0;
+                it->second->forEachSubChunk([&](glm::uvec3, const VoxelSubChunk& s) { values[n++] = summarize(s); });
+                chunk->apply(sub, it->second->getBitmask(), 0, values);
+            }
+            built[i] = chunk;
+        }
+    });
+
+    for (size_t i = 0; i < built.size(); i++) coarse.setChunk(position(i), built[i]);
+}
+
+void VoxelObject::updateLOD(unsigned int levels) {
+    if (this->lods.size() != levels) {
+        this->lods.clear();
+        glm::uvec3 dim = this->dim;
+        for (unsigned int level = 1; level <= levels; level++) {
+            dim = (dim + 3u) / 4u;
+            this->lods.push_back(std::make_unique<VoxelObject>(dim));
+        }
+        this->lodDirtyLo = glm::uvec3(0);
+        this->lodDirtyHi = this->dim;
+        this->lodDirty = true;
+    }
+
+    for (unsigned int level = 1; level <= this->lods.size(); level++) {
+        VoxelObject& coarse = *this->lods[level - 1];
+        if (coarse.materials != this->materials) {
+            coarse.materials = this->materials;
+            coarse.materialsDirty = true;
+            coarse.ready = false;
+        }
+        coarse.modelMatrix = this->lodMatrix(level, this->modelMatrix);
+    }
+    if (!this->lodDirty) return;
+
+    glm::uvec3 lo = this->lodDirtyLo, hi = this->lodDirtyHi;
+    for (unsigned int level = 1; level <= this->lods.size(); level++) {
+        downsample(this->getLOD(level - 1), *this->lods[level - 1], lo, hi, this->workers);
+        lo /= 4u;
+        hi = (hi + 3u) / 4u;
+    }
+    this->lodDirty = false;
+}
+
+    // level k spans 4^k times as much per voxel and starts at the same corner, see voxelFromWorld()
+glm::mat4 VoxelObject::lodMatrix(unsigned int level, const glm::mat4& modelMatrix) const {
+    if (level == 0) return modelMatrix;
+
+    float scale = (float)(1u << (2 * level));
+    glm::vec3 corner = -glm::vec3(this->dim) * 0.5f + glm::vec3(this->getLOD(level).dim) * (scale * 0.5f);
+    return glm::scale(glm::translate(modelMatrix, corner), glm::vec3(scale));
+}
+
+unsigned int VoxelObject::selectLOD(const glm::mat4& modelMatrix, const glm::mat4& view, const glm::mat4& proj, float viewportHeight, float pixels) const {
+    if (this->lods.empty() || this->lodDirty) return 0;
+
+    glm::vec3 half = glm::vec3(this->dim) * 0.5f;
+    AABB bounds = AABB(-half, half).transformed(modelMatrix);
+    glm::vec3 eye = glm::vec3(glm::inverse(view)[3]);
+    glm::vec3 nearest = glm::clamp(eye, bounds.lo, bounds.hi);
+
+        // pixels per world unit at the nearest point, distance 1 for orthographic projections
+    float distance = proj[2][3] != 0.0f ? glm::length(nearest - eye) : 1.0f;
+    if (distance <= 0.0f) return 0;
+    float pixelsPerUnit = proj[1][1] * viewportHeight * 0.5f / distance;
+
+        // longest edge of a level 0 voxel in world units
+    float voxel = std::max({ glm::length(glm::vec3(modelMatrix[0])), glm::length(glm::vec3(modelMatrix[1])), glm::length(glm::vec3(modelMatrix[2])) }) / 16.0f;
+
+    unsigned int level = 0;
+    while (level < this->lods.size() && voxel * (float)(1u << (2 * (level + 1))) * pixelsPerUnit <= pixels) level++;
+    return level;
+}
+
+std::vector<RaycastHit> VoxelObject::raycastLOD(unsigned int level, const glm::mat4& modelMatrix, const std::vector<Ray>& rays, unsigned int workers, RaycastKernel kernel) const {
+    if (level == 0) return this->raycastAt(modelMatrix, rays, workers, kernel);
+
+        // each ray starts where it enters the level 0 extent and ends where it leaves it, or misses outright
+    const glm::mat4 toVoxels = this->voxelFromWorld(modelMatrix);
+    const glm::vec3 extent = glm::vec3(this->dim) * 16.0f;
+    std::vector<Ray> clipped;
+    std::vector<float> offsets(rays.size(), 0.0f);
+    clipped.reserve(rays.size());
+    for (size_t i = 0; i < rays.size(); i++) {
+        glm::vec3 o, d;
+        internal::toVoxelSpace(toVoxels, rays[i], o, d);
+
+        float tEnter = 0.0f, tExit = rays[i].maxDistance;
+        for (int a = 0; a < 3; a++) {
+            if (d[a] == 0.0f) {
+                if (o[a] < 0.0f || o[a] >= extent[a]) tExit = -1.0f;
+                continue;
+            }
+            float t0 = -o[a] / d[a], t1 = (extent[a] - o[a]) / d[a];
+            tEnter = std::max(tEnter, std::min(t0, t1));
+            tExit = std::min(tExit, std::max(t0, t1));
+        }
+
+        if (tEnter > tExit) {
+            clipped.emplace_back(rays[i].origin, rays[i].direction, -1.0f);
+        } else {
+            clipped.emplace_back(rays[i].origin + glm::normalize(rays[i].direction) * tEnter, rays[i].direction, tExit - tEnter);
+            offsets[i] = tEnter;
+        }
+    }
+
+    std::vector<RaycastHit> hits = this->getLOD(level).raycastAt(this->lodMatrix(level, modelMatrix), clipped, workers, kernel);
+    for (size_t i = 0; i < hits.size(); i++) {
+        if (hits[i]) hits[i].distance += offsets[i];
+    }
+    return hits;
+}
+}
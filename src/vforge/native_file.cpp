@@ -0,0 +1,289 @@
+#include <vforge/native_file.hpp>
+#include <vforge/pool.hpp>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <unordered_map>
+#include <iostream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace voxelforge::files {
+
+static const char NATIVE_MAGIC[8] = { 'V', 'F', 'O', 'R', 'G', 'E', 0, 0 };
+static constexpr uint64_t SECTION_ALIGNMENT = 64;
+    // chunks per axis, far beyond any real object. bounds the chunk count so it can't wrap around
+static constexpr uint32_t MAX_NATIVE_DIM = 1 << 20;
+
+struct NativeHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t objectCount;
+    uint64_t fileSize;
+};
+static_assert(sizeof(NativeHeader) == 24, "native file header layout changed");
+
+struct NativeObject {
+    uint32_t dim[3];
+    uint32_t reserved;
+    float modelMatrix[16];      // column major
+    uint64_t materials;         // section offsets from the start of the file
+    uint64_t chunkTable;
+    uint64_t subChunkPool;
+    uint64_t voxelPool;
+    uint64_t subChunkCount;
+    uint64_t voxelCount;
+};
+static_assert(sizeof(NativeObject) == 128, "native file object layout changed");
+static_assert(sizeof(VoxelData) == 8 && sizeof(glm::uvec4) == 16 && sizeof(glm::vec4) == 16, "native file sections assume tightly packed entries");
+
+static uint64_t alignUp(uint64_t offset) {
+    return (offset + SECTION_ALIGNMENT - 1) & ~(SECTION_ALIGNMENT - 1);
+}
+
+bool save_native_file(const std::string& filename, const VoxelWorld& world) {
+        // objects first, then instances. a model is written once, later records of it point at the same sections.
+        // empty slots of the world (null objects, instances or models) aren't written
+    std::vector<std::pair<const VoxelObject *, glm::mat4>> placements;
+    for (const auto& object : world.getObjects()) {
+        if (object) placements.emplace_back(object.get(), object->getModelMatrix());
+    }
+    for (const auto& instance : world.getInstances()) {
+        if (instance && instance->getModel()) placements.emplace_back(instance->getModel().get(), instance->getModelMatrix());
+    }
+
+    std::vector<VoxelPool> pools;
+    std::vector<NativeObject> records(placements.size());
+    std::vector<size_t> owners;                                 // records whose sections are written
+    std::unordered_map<const VoxelObject *, size_t> firstRecord; // model -> its first record
+    pools.reserve(placements.size());
+
+        // lay the sections out first so the header can be written in one go
+    uint64_t offset = alignUp(sizeof(NativeHeader) + records.size() * sizeof(NativeObject));
+    for (size_t i = 0; i < placements.size(); i++) {
+        const VoxelObject& object = *placements[i].first;
+        NativeObject& record = records[i];
+
+        auto [first, inserted] = firstRecord.emplace(&object, i);
+        if (!inserted) {
+            record = records[first->second];
+            std::memcpy(record.modelMatrix, &placements[i].second[0][0], sizeof(record.modelMatrix));
+            continue;
+        }
+
+        VoxelPool& pool = pools.emplace_back(object.size());
+        const ChunkPager *pager = object.getPager();
+        pool.pack(pager ? pager->snapshot() : object.getChunks());
+        owners.push_back(i);
+
+        std::memset(&record, 0, sizeof(record));
+        record.dim[0] = object.size().x;
+        record.dim[1] = object.size().y;
+        record.dim[2] = object.size().z;
+        std::memcpy(record.modelMatrix, &placements[i].second[0][0], sizeof(record.modelMatrix));
+
+        record.subChunkCount = pool.subChunkCount();
+        record.voxelCount = pool.voxelCount();
+        record.materials = offset;
+        offset = alignUp(offset + 256 * sizeof(glm::vec4));
+        record.chunkTable = offset;
+        offset = alignUp(offset + pool.getChunkTable().size() * sizeof(glm::uvec4));
+        record.subChunkPool = offset;
+        offset = alignUp(offset + record.subChunkCount * sizeof(glm::uvec4));
+        record.voxelPool = offset;
+        offset = alignUp(offset + record.voxelCount * sizeof(VoxelData));
+    }
+
+    NativeHeader header;
+    std::memcpy(header.magic, NATIVE_MAGIC, sizeof(header.magic));
+    header.version = NativeFile::VERSION;
+    header.objectCount = records.size();
+    header.fileSize = offset;
+
+    std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        std::cerr << "Error opening file: " << filename << std::endl;
+        return false;
+    }
+
+    uint64_t written = 0;
+    auto write = [&](const void *data, uint64_t size) {
+        file.write((const char *)data, size);
+        written += size;
+    };
+    auto pad = [&](uint64_t to) {
+        static const char zeros[SECTION_ALIGNMENT] = {};
+        write(zeros, to - written);
+    };
+
+    write(&header, sizeof(header));
+    write(records.data(), records.size() * sizeof(NativeObject));
+    for (size_t i = 0; i < owners.size(); i++) {
+        const NativeObject& record = records[owners[i]];
+        const VoxelPool& pool = pools[i];
+
+        glm::vec4 materials[256];
+        for (uint32_t m = 0; m < 256; m++) materials[m] = placements[owners[i]].first->getMaterial(m);
+
+        pad(record.materials);
+        write(materials, sizeof(materials));
+        pad(record.chunkTable);
+        write(pool.getChunkTable().data(), pool.getChunkTable().size() * sizeof(glm::uvec4));
+        pad(record.subChunkPool);
+        write(pool.getSubChunkPool().data(), record.subChunkCount * sizeof(glm::uvec4));
+        pad(record.voxelPool);
+        write(pool.getVoxelPool().data(), record.voxelCount * sizeof(VoxelData));
+    }
+    pad(header.fileSize);
+
+    if (!file) {
+        std::cerr << "Error writing file: " << filename << std::endl;
+        return false;
+    }
+    return true;
+}
+
+NativeFile::NativeFile(const std::string& filename) {
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Error opening file: " << filename << std::endl;
+        return;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) == 0 && info.st_size > 0) {
+        this->mappingSize = info.st_size;
+        this->mapping = mmap(nullptr, this->mappingSize, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (this->mapping == MAP_FAILED) this->mapping = nullptr;
+    }
+    close(fd); // the mapping keeps the file alive
+
+    if (!this->mapping) {
+        std::cerr << "Error mapping file: " << filename << std::endl;
+        return;
+    }
+    if (!this->parse(filename)) this->unmap();
+}
+
+NativeFile::~NativeFile() {
+    this->unmap();
+}
+
+void NativeFile::unmap() {
+    if (this->mapping) munmap(this->mapping, this->mappingSize);
+    this->mapping = nullptr;
+    this->mappingSize = 0;
+    this->objects.clear();
+}
+
+    // checks every offset and count against the mapping, and every chunk and subchunk against the pools,
+    // so lookups and toObject() can trust the data. that's per chunk and subchunk, never per voxel
+bool NativeFile::parse(const std::string& filename) {
+    const uint8_t *base = (const uint8_t *)this->mapping;
+    auto invalid = [&](const char *reason) {
+        std::cerr << "Invalid VoxelForge file: " << filename << " (" << reason << ")" << std::endl;
+        return false;
+    };
+
+    if (this->mappingSize < sizeof(NativeHeader)) return invalid("truncated header");
+    const NativeHeader& header = *(const NativeHeader *)base;
+    if (std::memcmp(header.magic, NATIVE_MAGIC, sizeof(NATIVE_MAGIC)) != 0) return invalid("bad magic");
+    if (header.version != VERSION) return invalid("unsupported version");
+    if (header.fileSize != this->mappingSize) return invalid("size mismatch");
+    if (header.objectCount > (this->mappingSize - sizeof(NativeHeader)) / sizeof(NativeObject)) return invalid("truncated object table");
+
+        // [offset, offset + count * size) inside the file and aligned
+    auto section = [&](uint64_t offset, uint64_t count, uint64_t size) {
+        return offset % SECTION_ALIGNMENT == 0 && offset <= this->mappingSize && count <= (this->mappingSize - offset) / size;
+    };
+
+    const NativeObject *records = (const NativeObject *)(base + sizeof(NativeHeader));
+    for (uint32_t i = 0; i < header.objectCount; i++) {
+        const NativeObject& record = records[i];
+        if (record.dim[0] > MAX_NATIVE_DIM || record.dim[1] > MAX_NATIVE_DIM || record.dim[2] > MAX_NATIVE_DIM) return invalid("object size out of range");
+            // VoxelPool::lookup() indexes the chunk table in 32 bits
+        uint64_t chunkCount = (uint64_t)record.dim[0] * record.dim[1] * record.dim[2];
+        if (chunkCount > UINT32_MAX) return invalid("object size out of range");
+
+        if (!section(record.materials, 256, sizeof(glm::vec4)) || !section(record.chunkTable, chunkCount, sizeof(glm::uvec4))
+            || !section(record.subChunkPool, record.subChunkCount, sizeof(glm::uvec4)) || !section(record.voxelPool, record.voxelCount, sizeof(VoxelData))) {
+            return invalid("section out of bounds");
+        }
+
+        ObjectView view;
+        view.dim = glm::uvec3(record.dim[0], record.dim[1], record.dim[2]);
+        std::memcpy(&view.modelMatrix[0][0], record.modelMatrix, sizeof(record.modelMatrix));
+        view.materials = (const glm::vec4 *)(base + record.materials);
+        view.chunkTable = (const glm::uvec4 *)(base + record.chunkTable);
+        view.subChunkPool = (const glm::uvec4 *)(base + record.subChunkPool);
+        view.voxelPool = (const VoxelData *)(base + record.voxelPool);
+        view.subChunkCount = record.subChunkCount;
+        view.voxelCount = record.voxelCount;
+
+        for (uint64_t c = 0; c < chunkCount; c++) {
+            const glm::uvec4& chunk = view.chunkTable[c];
+            uint64_t mask = (uint64_t)chunk.x | ((uint64_t)chunk.y << 32);
+            if (mask == 0) continue;
+            if ((uint64_t)chunk.z + __builtin_popcountll(mask) > view.subChunkCount) return invalid("chunk points past the subchunk pool");
+
+            for (uint32_t s = chunk.z; s < chunk.z + __builtin_popcountll(mask); s++) {
+                const glm::uvec4& subChunk = view.subChunkPool[s];
+                uint64_t voxels = (uint64_t)subChunk.x | ((uint64_t)subChunk.y << 32);
+                if (voxels == 0 || (uint64_t)subChunk.z + __builtin_popcountll(voxels) > view.voxelCount) return invalid("subchunk points past the voxel pool");
+            }
+        }
+
+        this->objects.push_back(view);
+    }
+    return true;
+}
+
+std::shared_ptr<VoxelObject> NativeFile::ObjectView::toObject() const {
+    auto object = std::make_shared<VoxelObject>(this->dim, this->modelMatrix);
+    for (uint32_t m = 0; m < 256; m++) object->setMaterial(m, this->materials[m]);
+
+    size_t offset = 0;
+    for (uint32_t z = 0; z < this->dim.z; z++)
+    for (uint32_t y = 0; y < this->dim.y; y++)
+    for (uint32_t x = 0; x < this->dim.x; x++, offset++) {
+        const glm::uvec4& entry = this->chunkTable[offset];
+        uint64_t mask = (uint64_t)entry.x | ((uint64_t)entry.y << 32);
+        if (mask == 0) continue;
+
+            // subchunks are stored in bit order, each one's voxels land in a fresh subchunk in a single copy
+        auto chunk = std::make_shared<VoxelChunk>();
+        const glm::uvec4 *subChunk = this->subChunkPool + entry.z;
+        for (; mask; mask &= mask - 1, subChunk++) {
+            uint64_t voxels = (uint64_t)subChunk->x | ((uint64_t)subChunk->y << 32);
+            chunk->apply(__builtin_ctzll(mask), voxels, 0, this->voxelPool + subChunk->z);
+        }
+        object->setChunk(glm::uvec3(x, y, z), chunk);
+    }
+    return object;
+}
+
+std::shared_ptr<VoxelWorld> NativeFile::getWorld() const {
+    if (!this->isOpen()) return nullptr;
+
+        // records sharing their sections with an earlier one were saved from instances and load as instances again
+    auto world = std::make_shared<VoxelWorld>();
+    std::unordered_map<const glm::uvec4 *, std::shared_ptr<VoxelObject>> models;
+    for (const ObjectView& view : this->objects) {
+        auto it = models.find(view.chunkTable);
+        if (it != models.end() && it->second->size() == view.dim) {
+            world->addInstance(std::make_shared<VoxelInstance>(it->second, view.modelMatrix));
+            continue;
+        }
+        auto object = view.toObject();
+        models.emplace(view.chunkTable, object);
+        world->addObject(object);
+    }
+    return world;
+}
+
+std::shared_ptr<VoxelWorld> load_native_file(const std::string& filename) {
+    return NativeFile(filename).getWorld();
+}
+}
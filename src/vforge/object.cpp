@@ -1,23 +1,38 @@
 #include <vforge/object.hpp>
+#include <vforge/threads.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/gtx/string_cast.hpp>
-
-static uint32_t floatBitsToUint(float x) {
-    return *(uint32_t *)&x;
-}
+#include <algorithm>
 
 namespace voxelforge {
 
-VoxelObject::VoxelObject(unsigned int dX, unsigned int dY, unsigned int dZ, glm::mat4x4 modelMatrix) : chunks({}) {
+VoxelObject::VoxelObject(unsigned int dX, unsigned int dY, unsigned int dZ, glm::mat4x4 modelMatrix) : chunks(glm::uvec3(dX, dY, dZ)), pool(glm::uvec3(dX, dY, dZ)), modificationCache(glm::uvec3(dX, dY, dZ)) {
     this->dim = glm::uvec3(dX, dY, dZ);
 
-    this->chunkData = fglw::Texture3D(dX, dY, dZ, GL_RG32UI);
-    this->subChunkData = fglw::Texture3D(dX  * 4, dY * 4, dZ * 4, GL_RG32UI);
-    this->voxelData = fglw::Texture3D(dX * 16, dY * 16, dZ * 16, GL_RGBA32UI);
+    this->modelMatrix = glm::identity<glm::mat4>();
+    this->modelMatrix = modelMatrix * this->modelMatrix;
 
-        // TODO: figure out how to do materials better
-    this->materialData = fglw::Texture1D(256, GL_RGBA32F);
+    this->ready = false;
+}
+VoxelObject::VoxelObject(glm::uvec3 dim, glm::mat4x4 modelMatrix) : VoxelObject(dim.x, dim.y, dim.z, modelMatrix) { }
+
+std::shared_ptr<fglw::ShaderProgram> VoxelObject::sharedShader() {
+    static std::weak_ptr<fglw::ShaderProgram> cache;
+
+    std::shared_ptr<fglw::ShaderProgram> shader = cache.lock();
+    if (!shader) {
+        shader = std::make_shared<fglw::ShaderProgram>(fglw::ShaderProgram::loadGLSLFiles("shaders/voxel-world-raytrace.vsh", "shaders/voxel-world-raytrace.fsh"));
+        cache = shader;
+    }
+    return shader;
+}
+
+std::shared_ptr<fglw::TriangleMesh<VoxelObject::VertexLayout>> VoxelObject::sharedCube() {
+    static std::weak_ptr<fglw::TriangleMesh<VertexLayout>> cache;
+
+    std::shared_ptr<fglw::TriangleMesh<VertexLayout>> cube = cache.lock();
+    if (cube) return cube;
 
         // cube vertices
     const std::vector<VertexLayout> vertices = {
@@ -52,103 +67,512 @@ VoxelObject::VoxelObject(unsigned int dX, unsigned int dY, unsigned int dZ, glm:
         1, 0, 4
     };
 
-    this->meshRenderer = fglw::TriangleMesh<VertexLayout>(vertices, indices);
-
-    this->modelMatrix = glm::identity<glm::mat4>();
-    this->modelMatrix = modelMatrix * this->modelMatrix;
+    cube = std::make_shared<fglw::TriangleMesh<VertexLayout>>(vertices, indices);
+    cache = cube;
+    return cube;
+}
 
-    this->voxelRTShader = fglw::ShaderProgram::loadGLSLFiles("shaders/voxel-world-raytrace.vsh", "shaders/voxel-world-raytrace.fsh");
+    // GL resources are created on first use, so objects can be built and edited without a context
+void VoxelObject::initGL() {
+    if (this->glReady) return;
+    this->glReady = true;
 
-    this->voxelRTShader.uniform("uModelMatrix", this->modelMatrix);
+    this->chunkData = fglw::Texture3D(this->dim.x, this->dim.y, this->dim.z, GL_RGBA32UI);
+        // the subchunk and voxel pools are sized by rebuild()
 
-    this->voxelRTShader.uniform("uChunkData", this->chunkData);
-    this->voxelRTShader.uniform("uSubChunkData", this->subChunkData);
-    this->voxelRTShader.uniform("uVoxelData", this->voxelData);
+        // TODO: figure out how to do materials better
+    this->materialData = fglw::Texture1D(256, GL_RGBA32F);
 
-    this->voxelRTShader.uniform("uMaterialData", this->materialData);
+    this->meshRenderer = sharedCube();
+    this->voxelRTShader = sharedShader();
+}
 
-    this->voxelRTShader.uniform("uWorldSize_chunks", this->dim);
+    // fglw only uploads whole textures, sub-regions go through GL directly
+static void uploadRegion(fglw::Texture3D& texture, glm::uvec3 offset, glm::uvec3 size, GLenum format, const void *data) {
+    texture.bind();
+    glTexSubImage3D(GL_TEXTURE_3D, 0, offset.x, offset.y, offset.z, size.x, size.y, size.z, format, GL_UNSIGNED_INT, data);
+}
 
-    this->ready = false;
+    // uploads the whole rows of a pool texture covering `range`, returns the number of bytes sent
+template <typename T>
+static size_t uploadPoolRange(fglw::Texture3D& texture, const std::vector<T>& pool, VoxelPool::Range range, GLenum format) {
+    const uint32_t width = VoxelPool::WIDTH;
+    uint32_t row = range.begin / width;
+    uint32_t rowEnd = (range.end + width - 1) / width;
+    size_t bytes = 0;
+
+    while (row < rowEnd) {
+        uint32_t slice = row / width;
+        uint32_t y = row % width;
+        uint32_t rows = std::min(rowEnd - row, width - y); // a region can't cross slices
+
+        uploadRegion(texture, glm::uvec3(0, y, slice), glm::uvec3(width, rows, 1), format, pool.data() + (size_t)row * width);
+        bytes += (size_t)rows * width * sizeof(T);
+        row += rows;
+    }
+    return bytes;
 }
-VoxelObject::VoxelObject(glm::uvec3 dim, glm::mat4x4 modelMatrix) : VoxelObject(dim.x, dim.y, dim.z, modelMatrix) { }
 
-    // TODO: make this only rebuild changed chunks
 void VoxelObject::rebuild() {
+    if (this->generation) {
+            // what the background threads finished is drawn from this frame on, they make the rest meanwhile
+        this->installGenerated();
+        this->generation->requestRest();
+    }
     if (this->ready) return;
+    this->initGL();
     this->ready = true;
 
-    std::vector<uint64_t> chunkDataBuf(this->dim.x * this->dim.y * this->dim.z, 0);
-    std::vector<uint64_t> subChunkDataBuf(this->dim.x * this->dim.y * this->dim.z * 4 * 4 * 4, 0);
-    std::vector<uint32_t> voxelDataBuf((unsigned long long)this->dim.x * (unsigned long long)this->dim.y * (unsigned long long)this->dim.z * 16ull * 16ull * 16ull * 4ull, 0);
-
-    for (const auto& [position, chunk] : this->chunks) {
-        size_t offset = position.x + position.y*this->dim.x + position.z*this->dim.x*this->dim.y;
+    this->compress(this->workers);
+    size_t repacked = this->pool.bytesRepacked();
+    if (this->fullRebuild || this->pool.needsCompaction()) {
+            // a full pack needs every chunk at once, evictions wait until it's done
+        if (this->pager) {
+            this->pager->suspendEviction();
+            this->pager->pageInAll();
+        }
+        this->pool.pack(this->chunks, this->workers);
+        if (this->pager) this->pager->resumeEviction();
+        this->rebuildStats.chunksRepacked += this->chunks.size();
+    } else {
+        this->pool.update(this->modificationCache, this->workers);
+        this->rebuildStats.chunksRepacked += this->modificationCache.size();
+    }
+    this->fullRebuild = false;
+    this->modificationCache.clear();
 
-        if (chunk) { // should always be true, but be safe!
-            chunkDataBuf[offset] = chunk->getBitmask();
+    this->rebuildStats.rebuilds++;
+    this->rebuildStats.bytesRepacked += this->pool.bytesRepacked() - repacked;
 
-            for (size_t i = 0; i < 4; ++i)
-            for (size_t j = 0; j < 4; ++j)
-            for (size_t k = 0; k < 4; ++k) {
-                const auto& subChunk = chunk->getSubChunk(i, j, k);
-                if (!subChunk) continue;
+    this->upload();
+}
 
-                glm::uvec3 scPosition = position * 4u + glm::uvec3(i, j, k);
-                size_t scOffset = scPosition.x + scPosition.y*this->dim.x*4u + scPosition.z*this->dim.x*this->dim.y*4u*4u;
+void VoxelObject::upload() {
+    bool full = this->pool.isFullyDirty();
 
-                subChunkDataBuf[scOffset] = subChunk->getBitmask();
+        // pool textures only change size when the pools outgrow them
+    glm::uvec3 scExtent = this->pool.subChunkExtent();
+    if (scExtent != this->subChunkExtent) {
+        this->subChunkExtent = scExtent;
+        this->subChunkData = fglw::Texture3D(scExtent.x, scExtent.y, scExtent.z, GL_RGBA32UI);
+        full = true;
+    }
+    glm::uvec3 vExtent = this->pool.voxelExtent();
+    if (vExtent != this->voxelExtent) {
+        this->voxelExtent = vExtent;
+        this->voxelData = fglw::Texture3D(vExtent.x, vExtent.y, vExtent.z, GL_RG32UI);
+        full = true;
+    }
 
-                for (size_t i2 = 0; i2 < 4; ++i2)
-                for (size_t j2 = 0; j2 < 4; ++j2)
-                for (size_t k2 = 0; k2 < 4; ++k2) {
-                    const auto& voxel = subChunk->get(i2, j2, k2);
-                    if (!voxel) continue;
+    const auto& chunkTable = this->pool.getChunkTable();
+    const auto& subChunkPool = this->pool.getSubChunkPool();
+    const auto& voxelPool = this->pool.getVoxelPool();
+
+    if (full) {
+        this->chunkData.upload(chunkTable.data());
+        this->subChunkData.upload(subChunkPool.data());
+        this->voxelData.upload(voxelPool.data());
+
+        this->rebuildStats.bytesUploaded += chunkTable.size() * sizeof(glm::uvec4) + subChunkPool.size() * sizeof(glm::uvec4) + voxelPool.size() * sizeof(VoxelData);
+    } else if (!this->pool.getDirtyChunks().empty()) {
+            // bounding box of the changed chunk table entries
+        glm::uvec3 lo = this->dim, hi = glm::uvec3(0);
+        for (size_t offset : this->pool.getDirtyChunks()) {
+            glm::uvec3 p(offset % this->dim.x, (offset / this->dim.x) % this->dim.y, offset / ((size_t)this->dim.x * this->dim.y));
+            lo = glm::min(lo, p);
+            hi = glm::max(hi, p + 1u);
+        }
 
-                    glm::uvec3 voxelPosition = scPosition * 4u + glm::uvec3(i2, j2, k2);
-                    size_t voxelOffset = (voxelPosition.x + voxelPosition.y*this->dim.x*16u + voxelPosition.z*this->dim.x*this->dim.y*16u*16u) * 4u;
+        glm::uvec3 box = hi - lo;
+        std::vector<glm::uvec4> region;
+        region.reserve((size_t)box.x * box.y * box.z);
+        for (unsigned int z = lo.z; z < hi.z; z++)
+        for (unsigned int y = lo.y; y < hi.y; y++)
+        for (unsigned int x = lo.x; x < hi.x; x++) {
+            region.push_back(chunkTable[x + y*this->dim.x + z*this->dim.x*this->dim.y]);
+        }
+        uploadRegion(this->chunkData, lo, box, GL_RGBA_INTEGER, region.data());
+        this->rebuildStats.bytesUploaded += region.size() * sizeof(glm::uvec4);
 
-                    voxelDataBuf[voxelOffset+0] = floatBitsToUint(voxel->normal.x);
-                    voxelDataBuf[voxelOffset+1] = floatBitsToUint(voxel->normal.y);
-                    voxelDataBuf[voxelOffset+2] = floatBitsToUint(voxel->normal.z);
-                    voxelDataBuf[voxelOffset+3] = voxel->matID;
-                }
-            }
-            
+        for (const auto& range : this->pool.getDirtySubChunkRanges()) {
+            this->rebuildStats.bytesUploaded += uploadPoolRange(this->subChunkData, subChunkPool, range, GL_RGBA_INTEGER);
+        }
+        for (const auto& range : this->pool.getDirtyVoxelRanges()) {
+            this->rebuildStats.bytesUploaded += uploadPoolRange(this->voxelData, voxelPool, range, GL_RG_INTEGER);
         }
     }
+    this->pool.clearDirty();
 
-    this->chunkData.upload(chunkDataBuf.data());
-    this->subChunkData.upload(subChunkDataBuf.data());
-    this->voxelData.upload(voxelDataBuf.data());
-
-    this->materialData.upload(this->materials.data());
+    if (this->materialsDirty) {
+        this->materialData.upload(this->materials.data());
+        this->rebuildStats.bytesUploaded += sizeof(this->materials);
+        this->materialsDirty = false;
+    }
 }
 
 void VoxelObject::draw(fglw::RenderTarget& fb, glm::mat4 view, glm::mat4 proj) {
+    this->drawAt(fb, view, proj, this->modelMatrix);
+}
+
+void VoxelObject::drawAt(fglw::RenderTarget& fb, glm::mat4 view, glm::mat4 proj, const glm::mat4& modelMatrix) {
     this->rebuild(); // re-upload data if neccesary
-    this->voxelRTShader.uniform("uViewMatrix", view);
-    this->voxelRTShader.uniform("uProjectionMatrix", proj);
 
-    this->meshRenderer.draw(fb, this->voxelRTShader);
+        // the program is shared, so everything this object's draw reads is set every time
+    fglw::ShaderProgram& shader = *this->voxelRTShader;
+    shader.uniform("uModelMatrix", modelMatrix);
+    shader.uniform("uViewMatrix", view);
+    shader.uniform("uProjectionMatrix", proj);
+    shader.uniform("uWorldSize_chunks", this->dim);
+    shader.uniform("uChunkData", this->chunkData);
+    shader.uniform("uSubChunkData", this->subChunkData);
+    shader.uniform("uVoxelData", this->voxelData);
+    shader.uniform("uMaterialData", this->materialData);
+
+    this->meshRenderer->draw(fb, shader);
+}
+
+    // grows the box [lo, hi) of chunks edited since something derived from them was last brought up to date
+static void growDirtyBox(bool& dirty, glm::uvec3& lo, glm::uvec3& hi, glm::uvec3 chunkPosition) {
+    if (!dirty) {
+        lo = chunkPosition;
+        hi = chunkPosition + 1u;
+        dirty = true;
+    } else {
+        lo = glm::min(lo, chunkPosition);
+        hi = glm::max(hi, chunkPosition + 1u);
+    }
+}
+
+void VoxelObject::markDirty(glm::uvec3 chunkPosition, std::shared_ptr<voxelforge::VoxelChunk> chunk) {
+    if (!this->fullRebuild) this->modificationCache[chunkPosition] = chunk;
+    this->ready = false;
+
+    if (this->distanceField) growDirtyBox(this->distanceFieldDirty, this->distanceDirtyLo, this->distanceDirtyHi, chunkPosition);
+    if (!this->lods.empty()) growDirtyBox(this->lodDirty, this->lodDirtyLo, this->lodDirtyHi, chunkPosition);
+    if (chunk) growDirtyBox(this->compressDirty, this->compressDirtyLo, this->compressDirtyHi, chunkPosition);
+    if (this->pager) this->pager->edited(chunkPosition, chunk);
 }
 
-void VoxelObject::set(glm::uvec3 position, std::shared_ptr<voxelforge::VoxelData> vox) {
+void VoxelObject::set(glm::uvec3 position, voxelforge::VoxelData vox) {
+    if (this->editShards) this->editConcurrent(position, &vox);
+    else this->setVoxel(position, vox);
+}
+
+void VoxelObject::setVoxel(glm::uvec3 position, const VoxelData& vox) {
+    this->generateChunk(position / 16u);
+    if (this->pager) this->pager->access(position / 16u);
     auto& chunk = this->chunks[position / 16u]; // will create a nullptr chunk if one doesn't exist at this location
 
     if (!chunk) chunk = std::make_shared<voxelforge::VoxelChunk>();
 
     chunk->set(position % 16u, vox);
 
-    this->ready = false;
+    this->markDirty(position / 16u, chunk);
+}
+
+std::optional<voxelforge::VoxelData> VoxelObject::get(glm::uvec3 position) const {
+    if (this->generation) this->generation->generateShared(position / 16u);
+    if (this->pager) this->pager->access(position / 16u);
+    auto it = this->chunks.find(position / 16u);
+    if (it == this->chunks.end() || !it->second) return std::nullopt;
+
+    return it->second->get(position % 16u);
+}
+
+void VoxelObject::clear(glm::uvec3 position) {
+    if (this->editShards) this->editConcurrent(position, nullptr);
+    else this->clearVoxel(position);
+}
+
+void VoxelObject::clearVoxel(glm::uvec3 position) {
+    this->generateChunk(position / 16u);
+    if (this->pager) this->pager->access(position / 16u);
+    auto it = this->chunks.find(position / 16u);
+    if (it == this->chunks.end() || !it->second) return;
+
+    it->second->clear(position % 16u);
+    if (it->second->getBitmask() == 0) {
+        this->chunks.erase(it);
+        this->markDirty(position / 16u, nullptr);
+    } else {
+        this->markDirty(position / 16u, it->second);
+    }
+}
+
+void VoxelObject::beginConcurrentEdits() {
+    if (!this->editShards) this->editShards = std::make_unique<EditShard[]>(EDIT_SHARDS + 1);
+}
+
+void VoxelObject::editConcurrent(glm::uvec3 position, const VoxelData *vox) {
+    const glm::uvec3 chunkPosition = position / 16u;
+    uint32_t hash = chunkPosition.x * 73856093u ^ chunkPosition.y * 19349663u ^ chunkPosition.z * 83492791u;
+    EditShard& shard = this->editShards[hash % EDIT_SHARDS];
+
+        // the shard serializes the claims of its positions as well
+    std::unique_lock<std::mutex> lock(shard.mutex);
+    bool created = false;
+    std::shared_ptr<VoxelChunk> *slot = this->pager ? nullptr : this->chunks.concurrentSlot(chunkPosition, created);
+    if (slot && this->generation && !this->generation->isGenerated(chunkPosition)) {
+        std::shared_ptr<VoxelChunk> generated = this->generation->take(chunkPosition);
+        if (generated) *slot = generated;
+    }
+    if (!slot) {
+        lock.unlock();
+        std::lock_guard<std::mutex> serial(this->editShards[EDIT_SHARDS].mutex);
+        if (vox) this->setVoxel(position, *vox);
+        else this->clearVoxel(position);
+        return;
+    }
+
+    std::shared_ptr<VoxelChunk>& chunk = *slot;
+    if (vox) {
+        if (!chunk) chunk = std::make_shared<VoxelChunk>();
+        chunk->set(position % 16u, *vox);
+    } else {
+            // a clear can claim an entry it doesn't fill
+        if (created) shard.emptied.push_back(chunkPosition);
+        if (!chunk) return;
+
+        chunk->clear(position % 16u);
+        if (chunk->getBitmask() == 0) shard.emptied.push_back(chunkPosition);
+    }
+
+        // what markDirty() does for the object, per shard
+    if (!this->fullRebuild) {
+        bool cached;
+        *this->modificationCache.concurrentSlot(chunkPosition, cached) = chunk;
+    }
+    growDirtyBox(shard.dirty, shard.lo, shard.hi, chunkPosition);
+}
+
+void VoxelObject::endConcurrentEdits() {
+    if (!this->editShards) return;
+    std::unique_ptr<EditShard[]> shards = std::move(this->editShards);
+
+    for (unsigned int i = 0; i < EDIT_SHARDS; i++) {
+        const EditShard& shard = shards[i];
+        if (shard.dirty) {
+            this->ready = false;
+            for (glm::uvec3 corner : { shard.lo, shard.hi - 1u }) {
+                if (this->distanceField) growDirtyBox(this->distanceFieldDirty, this->distanceDirtyLo, this->distanceDirtyHi, corner);
+                if (!this->lods.empty()) growDirtyBox(this->lodDirty, this->lodDirtyLo, this->lodDirtyHi, corner);
+                growDirtyBox(this->compressDirty, this->compressDirtyLo, this->compressDirtyHi, corner);
+            }
+        }
+        for (glm::uvec3 position : shard.emptied) {
+            auto it = this->chunks.find(position);
+            if (it == this->chunks.end() || (it->second && it->second->getBitmask() != 0)) continue;
+
+            bool edited = (bool)it->second;
+            this->chunks.erase(position);
+            if (edited) this->markDirty(position, nullptr);
+        }
+    }
+}
+
+void VoxelObject::setChunk(glm::uvec3 position, std::shared_ptr<voxelforge::VoxelChunk> chunk) {
+    if (this->generation) this->generation->cancel(position);
+    if (!chunk || chunk->getBitmask() == 0) {
+        bool pagedOut = this->pager && this->pager->isPagedOut(position);
+        if (this->chunks.erase(position) || pagedOut) this->markDirty(position, nullptr);
+        return;
+    }
+
+    this->chunks[position] = chunk;
+    this->markDirty(position, chunk);
+}
+
+void VoxelObject::apply(VoxelEditBatch& batch) {
+    using Edit = VoxelEditBatch::Edit;
+    auto& edits = batch.edits;
+
+    batch.sort();
+
+    VoxelData values[64];
+    size_t i = 0;
+    while (i < edits.size()) {
+        uint64_t chunkKey = edits[i].chunkKey();
+        glm::uvec3 chunkPosition = VoxelEditBatch::chunkPosition(chunkKey);
+
+        this->generateChunk(chunkPosition);
+        if (this->pager) this->pager->access(chunkPosition);
+        auto it = this->chunks.find(chunkPosition);
+        std::shared_ptr<VoxelChunk> chunk = it == this->chunks.end() ? nullptr : it->second;
+
+        while (i < edits.size() && edits[i].chunkKey() == chunkKey) {
+            uint64_t subChunkKey = (edits[i].key & ~VoxelEditBatch::CLEAR_BIT) >> 6;
+            uint64_t setMask = 0, clearMask = 0;
+            unsigned int numValues = 0;
+
+            while (i < edits.size() && ((edits[i].key & ~VoxelEditBatch::CLEAR_BIT) >> 6) == subChunkKey) {
+                size_t last = i;
+                while (last + 1 < edits.size() && (edits[last + 1].key & ~VoxelEditBatch::CLEAR_BIT) == (edits[i].key & ~VoxelEditBatch::CLEAR_BIT)) last++;
+
+                const Edit& edit = edits[last];
+                uint64_t voxelBit = 1ull << edit.voxelBit();
+                if (edit.isClear()) {
+                    clearMask |= voxelBit;
+                } else {
+                    setMask |= voxelBit;
+                    values[numValues++] = edit.data; // in bit order, the edits are sorted
+                }
+                i = last + 1;
+            }
+
+            if (!chunk) {
+                if (setMask == 0) continue;
+                chunk = std::make_shared<VoxelChunk>();
+                this->chunks[chunkPosition] = chunk;
+            }
+            chunk->apply(subChunkKey & 63, setMask, clearMask, values);
+        }
+
+        if (!chunk) continue;
+        if (chunk->getBitmask() == 0) {
+            this->chunks.erase(chunkPosition);
+            this->markDirty(chunkPosition, nullptr);
+        } else {
+            this->markDirty(chunkPosition, chunk);
+        }
+    }
+
+    batch.reset();
 }
 
 void VoxelObject::clear() {
     this->chunks.clear();
+    this->modificationCache.clear();
+    if (this->pager) this->pager->clear();
+    if (this->generation) this->generation->cancelAll();
+    this->fullRebuild = true;
     this->ready = false;
+
+    if (this->distanceField) {
+        this->distanceDirtyLo = glm::uvec3(0);
+        this->distanceDirtyHi = this->dim;
+        this->distanceFieldDirty = true;
+    }
+    if (!this->lods.empty()) {
+        this->lodDirtyLo = glm::uvec3(0);
+        this->lodDirtyHi = this->dim;
+        this->lodDirty = true;
+    }
+}
+
+void VoxelObject::updateDistanceField(unsigned int maxDistance) {
+    if (!this->distanceField || this->distanceField->getMaxDistance() != std::min(maxDistance, DistanceField::MAX_DISTANCE)) {
+        this->distanceField = std::make_unique<DistanceField>(this->dim * 16u, maxDistance);
+        this->distanceField->build(this->chunks, this->workers);
+    } else if (this->distanceFieldDirty) {
+        this->distanceField->update(this->chunks, this->distanceDirtyLo * 16u, this->distanceDirtyHi * 16u, this->workers);
+    }
+    this->distanceFieldDirty = false;
+}
+
+bool VoxelObject::enablePaging(size_t budget, const std::string& path) {
+    this->disablePaging();
+    this->pager = std::make_unique<ChunkPager>(this->chunks, this->modificationCache, budget, path);
+    if (!this->pager->isOpen()) this->pager.reset();
+    return (bool)this->pager;
+}
+
+void VoxelObject::disablePaging() {
+    if (!this->pager) return;
+    this->pager->pageInAll();
+    this->pager.reset();
+}
+
+void VoxelObject::prefetch(glm::uvec3 focus, unsigned int radius) {
+    if (this->pager) this->pager->prefetch(focus / 16u, radius);
+}
+
+void VoxelObject::setGenerator(std::shared_ptr<ChunkGenerator> generator, unsigned int workers) {
+    this->installGenerated();
+    this->generation.reset();
+    if (!generator) return;
+
+    this->generation = std::make_unique<ChunkGeneration>(this->chunks, this->dim, std::move(generator), workers);
+    if (!this->pager) return;
+    for (unsigned int z = 0; z < this->dim.z; z++)
+    for (unsigned int y = 0; y < this->dim.y; y++)
+    for (unsigned int x = 0; x < this->dim.x; x++) {
+        if (this->pager->isPagedOut(glm::uvec3(x, y, z))) this->generation->cancel(glm::uvec3(x, y, z));
+    }
+}
+
+void VoxelObject::requestChunks(glm::uvec3 focus, unsigned int radius) {
+    if (this->generation) this->generation->request(focus / 16u, radius);
+}
+
+void VoxelObject::generateAll() {
+    if (!this->generation) return;
+
+    std::vector<glm::uvec3> missing;
+    for (unsigned int z = 0; z < this->dim.z; z++)
+    for (unsigned int y = 0; y < this->dim.y; y++)
+    for (unsigned int x = 0; x < this->dim.x; x++) {
+        if (!this->generation->isGenerated(glm::uvec3(x, y, z))) missing.push_back(glm::uvec3(x, y, z));
+    }
+    std::vector<std::shared_ptr<VoxelChunk>> made(missing.size());
+    parallelFor(missing.size(), this->workers, 1, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) made[i] = this->generation->take(missing[i]);
+    });
+    for (size_t i = 0; i < missing.size(); i++) {
+        if (!made[i]) continue;
+        this->chunks[missing[i]] = made[i];
+        this->markDirty(missing[i], made[i]);
+    }
+    this->installGenerated();
+}
+
+void VoxelObject::generateChunk(glm::uvec3 chunkPosition) {
+    if (!this->generation || this->generation->isGenerated(chunkPosition)) return;
+
+    std::shared_ptr<VoxelChunk> chunk = this->generation->take(chunkPosition);
+    if (!chunk) return;
+    this->chunks[chunkPosition] = chunk;
+    this->markDirty(chunkPosition, chunk);
+}
+
+void VoxelObject::installGenerated() {
+    if (!this->generation || !this->generation->hasFinished()) return;
+
+    std::vector<glm::uvec3> installed;
+    this->generation->installFinished(installed);
+    for (glm::uvec3 position : installed) {
+            // chunks published by readers may have been edited away since
+        auto it = this->chunks.find(position);
+        if (it != this->chunks.end()) this->markDirty(position, it->second);
+    }
+}
+
+void VoxelObject::compress(unsigned int workers) {
+    if (!this->compressDirty) return;
+    this->compressDirty = false;
+
+        // compress() is a no-op on chunks that weren't edited since, so only the box has to be narrowed down
+    std::vector<VoxelChunk *> edited;
+    for (const auto& [position, chunk] : this->chunks) {
+        if (!chunk || chunk->getEncoding() != VoxelChunk::Encoding::Raw) continue;
+        if (glm::any(glm::lessThan(position, this->compressDirtyLo)) || glm::any(glm::greaterThanEqual(position, this->compressDirtyHi))) continue;
+        edited.push_back(chunk.get());
+    }
+    parallelFor(edited.size(), workers, 16, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) edited[i]->compress();
+    });
+}
+
+size_t VoxelObject::memoryUsage() const {
+    size_t bytes = this->chunks.memoryUsage();
+    for (const auto& [position, chunk] : this->chunks) {
+        if (chunk) bytes += chunk->memoryUsage() + 2 * sizeof(void *);
+    }
+    return bytes;
 }
 
 void VoxelObject::setMaterial(uint32_t index, glm::vec4 material) {
     this->materials[index] = material;
+    this->materialsDirty = true;
+    this->ready = false;
 }
 }
\ No newline at end of file
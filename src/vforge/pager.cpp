@@ -0,0 +1,449 @@
+#include <vforge/pager.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+namespace voxelforge {
+
+    // smallest k with 2^k >= size, at least 64 bytes
+static uint32_t sizeClass(size_t size) {
+    uint32_t k = 6;
+    while (((size_t)1 << k) < size) k++;
+    return k;
+}
+
+ChunkPager::ChunkPager(ChunkMap& chunks, const ChunkMap& pinned, size_t budget, const std::string& path)
+    : chunks(chunks), pinned(pinned), budget(budget), path(path) {
+    this->file = path.empty() ? std::tmpfile() : std::fopen(path.c_str(), "w+b");
+    if (!this->file) {
+        std::cerr << "Can't create spill file: " << (path.empty() ? "(temporary)" : path) << std::endl;
+        return;
+    }
+
+    for (const auto& [position, chunk] : this->chunks) {
+        if (chunk) this->admit(position, chunk, true);
+    }
+    this->trim();
+}
+
+ChunkPager::~ChunkPager() {
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->stopping = true;
+    }
+    this->wake.notify_all();
+    if (this->worker.joinable()) this->worker.join();
+
+    if (this->file) std::fclose(this->file);
+    if (this->file && !this->path.empty()) std::remove(this->path.c_str());
+}
+
+void ChunkPager::access(glm::uvec3 position) {
+    auto it = this->slots.find(position);
+    if (it != this->slots.end()) {
+        this->ring[it->second].referenced = true;
+        this->stats.hits++;
+        return;
+    }
+    this->fault(position);
+}
+
+void ChunkPager::fault(glm::uvec3 position) {
+    auto start = std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> lock(this->mutex);
+    this->installPrefetched();
+    if (this->slots.count(position)) {
+        this->stats.prefetchHits++;
+        lock.unlock();
+        this->trim(position);
+        return;
+    }
+
+    auto it = this->records.find(position);
+    if (it == this->records.end()) return;   // no chunk there at all
+
+    auto request = std::find(this->requests.begin(), this->requests.end(), position);
+    if (request != this->requests.end()) this->requests.erase(request);
+
+    std::vector<uint8_t> data;
+    Record record = it->second;
+    bool read = this->readRecord(record, data);
+    if (!read) this->dropRecord(position);
+    lock.unlock();
+
+    std::shared_ptr<VoxelChunk> chunk = read ? decode(data.data(), data.size()) : nullptr;
+    if (!chunk) {
+        if (read) std::cerr << "Invalid spill record for chunk " << position.x << ", " << position.y << ", " << position.z << std::endl;
+        return;
+    }
+    this->chunks[position] = chunk;
+    this->admit(position, chunk, false);
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    this->stats.faults++;
+    this->stats.bytesIn += record.size;
+    this->stats.faultSeconds += seconds;
+    this->stats.maxFaultSeconds = std::max(this->stats.maxFaultSeconds, seconds);
+    this->trim(position);
+}
+
+void ChunkPager::edited(glm::uvec3 position, const std::shared_ptr<VoxelChunk>& chunk) {
+    auto it = this->slots.find(position);
+    if (!chunk) {
+        if (it != this->slots.end()) this->removeSlot(it->second);
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->dropRecord(position);
+        return;
+    }
+
+    if (it != this->slots.end()) {
+        Slot& slot = this->ring[it->second];
+        slot.referenced = true;
+        slot.dirty = true;
+        if (!slot.stale) {
+            slot.stale = true;
+            this->stale.push_back(position);
+        }
+        return;
+    }
+
+        // a new chunk, possibly replacing one that was paged out
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->dropRecord(position);
+    }
+    this->admit(position, chunk, true);
+    this->trim(position);
+}
+
+void ChunkPager::prefetch(glm::uvec3 center, unsigned int radius) {
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->installPrefetched();
+
+        struct Candidate {
+            glm::uvec3 position;
+            uint64_t distance;
+            size_t memory;
+        };
+        std::vector<Candidate> candidates;
+        const glm::ivec3 c(center);
+        const int r = (int)radius;
+        for (int z = std::max(c.z - r, 0); z <= c.z + r; z++)
+        for (int y = std::max(c.y - r, 0); y <= c.y + r; y++)
+        for (int x = std::max(c.x - r, 0); x <= c.x + r; x++) {
+            glm::uvec3 position(x, y, z);
+            auto it = this->records.find(position);
+            if (it == this->records.end() || this->slots.count(position)) continue;
+
+            glm::ivec3 d = glm::ivec3(position) - c;
+            candidates.push_back({ position, (uint64_t)(d.x * d.x + d.y * d.y + d.z * d.z), it->second.memory });
+        }
+        std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) { return a.distance < b.distance; });
+
+            // the rest of the budget stays with what is already resident
+        this->requests.clear();
+        size_t memory = 0;
+        for (const Candidate& candidate : candidates) {
+            memory += candidate.memory;
+            if (memory > this->budget / 2) break;
+            this->requests.push_back(candidate.position);
+        }
+        std::reverse(this->requests.begin(), this->requests.end());
+
+        if (!this->worker.joinable() && !this->requests.empty()) this->worker = std::thread([this]() { this->prefetchLoop(); });
+    }
+    this->wake.notify_one();
+    this->trim();
+}
+
+void ChunkPager::pageInAll() {
+    std::vector<glm::uvec3> pagedOut;
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        for (const auto& [position, record] : this->records) {
+            if (!this->slots.count(position)) pagedOut.push_back(position);
+        }
+    }
+
+    this->suspendEviction();
+    for (glm::uvec3 position : pagedOut) this->fault(position);
+    this->held--;
+}
+
+void ChunkPager::clear() {
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->records.clear();
+        this->freeSlots.clear();
+        this->fileEnd = 0;
+        this->requests.clear();
+        this->prefetched.clear();
+    }
+    this->ring.clear();
+    this->slots.clear();
+    this->stale.clear();
+    this->hand = 0;
+    this->residentBytes = 0;
+}
+
+ChunkMap ChunkPager::snapshot() const {
+    ChunkMap all(this->chunks);
+    std::vector<uint8_t> data;
+
+    std::lock_guard<std::mutex> lock(this->mutex);
+    for (const auto& [position, record] : this->records) {
+        if (this->slots.count(position)) continue;
+
+        std::shared_ptr<VoxelChunk> chunk = this->readRecord(record, data) ? decode(data.data(), data.size()) : nullptr;
+        if (!chunk) {
+            std::cerr << "Invalid spill record for chunk " << position.x << ", " << position.y << ", " << position.z << std::endl;
+            continue;
+        }
+        all[position] = chunk;
+    }
+    return all;
+}
+
+void ChunkPager::trim(glm::uvec3 keep) {
+    if (this->held || this->failed || !this->file) return;
+
+        // sizes of chunks edited since they were last measured
+    for (glm::uvec3 position : this->stale) {
+        auto it = this->slots.find(position);
+        if (it == this->slots.end()) continue;
+
+        Slot& slot = this->ring[it->second];
+        const auto& chunk = this->chunks.find(position)->second;
+        this->residentBytes -= slot.bytes;
+        slot.bytes = chunk->memoryUsage() + 2 * sizeof(void *);
+        this->residentBytes += slot.bytes;
+        slot.stale = false;
+    }
+    this->stale.clear();
+
+        // two full turns clear every reference bit, anything left after that is pinned
+    size_t passed = 0;
+    while (this->residentBytes > this->budget && !this->ring.empty() && passed < 2 * this->ring.size()) {
+        if (this->hand >= this->ring.size()) this->hand = 0;
+        Slot& slot = this->ring[this->hand];
+        passed++;
+
+        if (slot.position == keep || this->pinned.count(slot.position)) {
+            this->hand++;
+        } else if (slot.referenced) {
+            slot.referenced = false;
+            this->hand++;
+        } else if (!this->evict(this->hand)) {
+            this->failed = true;
+            return;
+        }
+    }
+}
+
+bool ChunkPager::isPagedOut(glm::uvec3 position) const {
+    if (this->slots.count(position)) return false;
+    std::lock_guard<std::mutex> lock(this->mutex);
+    return this->records.count(position) != 0;
+}
+
+size_t ChunkPager::getPagedOutCount() const {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    size_t count = 0;
+    for (const auto& [position, record] : this->records) count += !this->slots.count(position);
+    return count;
+}
+
+void ChunkPager::admit(glm::uvec3 position, const std::shared_ptr<VoxelChunk>& chunk, bool dirty) {
+    size_t bytes = chunk->memoryUsage() + 2 * sizeof(void *);
+    this->slots[position] = (uint32_t)this->ring.size();
+    this->ring.push_back(Slot{ position, bytes, true, dirty, false });
+    this->residentBytes += bytes;
+}
+
+bool ChunkPager::evict(size_t index) {
+    Slot& slot = this->ring[index];
+    auto it = this->chunks.find(slot.position);
+    std::shared_ptr<VoxelChunk> chunk = it->second;
+
+    if (slot.dirty) {
+        std::vector<uint8_t> data;
+        chunk->compress();
+        encode(*chunk, data);
+
+        std::lock_guard<std::mutex> lock(this->mutex);
+        if (!this->writeRecord(slot.position, data, slot.bytes)) {
+            std::cerr << "Can't write to spill file, chunks stay resident from now on" << std::endl;
+            return false;
+        }
+        this->stats.bytesOut += data.size();
+    } else {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->records[slot.position].memory = slot.bytes;
+    }
+
+    this->chunks.erase(slot.position);
+    this->removeSlot(index);
+    this->stats.evictions++;
+    return true;
+}
+
+void ChunkPager::removeSlot(size_t index) {
+    this->residentBytes -= this->ring[index].bytes;
+    this->slots.erase(this->ring[index].position);
+    if (index + 1 != this->ring.size()) {
+        this->ring[index] = this->ring.back();
+        this->slots[this->ring[index].position] = (uint32_t)index;
+    }
+    this->ring.pop_back();
+}
+
+void ChunkPager::installPrefetched() {
+    for (Prefetched& p : this->prefetched) {
+        auto it = this->records.find(p.position);
+        if (it == this->records.end() || it->second.version != p.version || this->slots.count(p.position)) continue;
+
+        this->chunks[p.position] = p.chunk;
+        this->admit(p.position, p.chunk, false);
+        this->stats.prefetched++;
+        this->stats.bytesIn += p.size;
+    }
+    this->prefetched.clear();
+}
+
+void ChunkPager::dropRecord(glm::uvec3 position) {
+    auto it = this->records.find(position);
+    if (it == this->records.end()) return;
+
+    if (this->freeSlots.size() <= it->second.sizeClass) this->freeSlots.resize(it->second.sizeClass + 1);
+    this->freeSlots[it->second.sizeClass].push_back(it->second.offset);
+    this->records.erase(it);
+}
+
+bool ChunkPager::readRecord(const Record& record, std::vector<uint8_t>& out) const {
+    out.resize(record.size);
+    return std::fseek(this->file, (long)record.offset, SEEK_SET) == 0 && std::fread(out.data(), 1, out.size(), this->file) == out.size();
+}
+
+bool ChunkPager::writeRecord(glm::uvec3 position, const std::vector<uint8_t>& data, size_t memory) {
+    uint32_t k = sizeClass(data.size());
+    auto it = this->records.find(position);
+
+    Record record;
+    if (it != this->records.end() && it->second.sizeClass == k) {
+        record = it->second;    // rewritten in place
+    } else {
+        this->dropRecord(position);
+        record.sizeClass = k;
+        if (k < this->freeSlots.size() && !this->freeSlots[k].empty()) {
+            record.offset = this->freeSlots[k].back();
+            this->freeSlots[k].pop_back();
+        } else {
+            record.offset = this->fileEnd;
+            this->fileEnd += (uint64_t)1 << k;
+        }
+    }
+    record.size = (uint32_t)data.size();
+    record.version = this->nextVersion++;
+    record.memory = memory;
+
+    this->records[position] = record;
+    if (std::fseek(this->file, (long)record.offset, SEEK_SET) != 0 || std::fwrite(data.data(), 1, data.size(), this->file) != data.size()) {
+        this->dropRecord(position);     // the chunk stays resident and dirty
+        return false;
+    }
+    return true;
+}
+
+void ChunkPager::prefetchLoop() {
+    std::unique_lock<std::mutex> lock(this->mutex);
+    std::vector<uint8_t> data;
+    while (true) {
+        this->wake.wait(lock, [this]() { return this->stopping || !this->requests.empty(); });
+        if (this->stopping) return;
+
+        glm::uvec3 position = this->requests.back();
+        this->requests.pop_back();
+        auto it = this->records.find(position);
+        if (it == this->records.end()) continue;
+
+        Record record = it->second;
+        if (!this->readRecord(record, data)) continue;
+
+            // decoding doesn't touch the file, the owner can fault meanwhile
+        lock.unlock();
+        std::shared_ptr<VoxelChunk> chunk = decode(data.data(), data.size());
+        lock.lock();
+        if (chunk) this->prefetched.push_back(Prefetched{ position, record.version, record.size, chunk });
+    }
+}
+
+    // record layout: chunk bitmask (8 bytes), palette size and bits (4 bytes each), the palette, then for each subchunk
+    // in bit order its bitmask (8 bytes) followed by either its packed palette indices or its voxels
+void ChunkPager::encode(VoxelChunk& chunk, std::vector<uint8_t>& out) {
+    const VoxelPalette *palette = chunk.getPalette();
+    uint64_t bitmask = chunk.getBitmask();
+    uint32_t paletteSize = palette ? (uint32_t)palette->values.size() : 0, bits = palette ? palette->bits : 0;
+
+    auto append = [&](const void *data, size_t size) {
+        out.insert(out.end(), (const uint8_t *)data, (const uint8_t *)data + size);
+    };
+    out.clear();
+    append(&bitmask, 8);
+    append(&paletteSize, 4);
+    append(&bits, 4);
+    if (palette) append(palette->values.data(), paletteSize * sizeof(VoxelData));
+
+    chunk.forEachSubChunk([&](glm::uvec3, const VoxelSubChunk& sub) {
+        uint64_t mask = sub.getBitmask();
+        append(&mask, 8);
+        if (palette) {
+            append(sub.getIndices().data(), (sub.size() * bits + 7) / 8);
+        } else {
+            sub.forEachVoxel([&](glm::uvec3, const VoxelData& voxel) { append(&voxel, sizeof(VoxelData)); });
+        }
+    });
+}
+
+std::shared_ptr<VoxelChunk> ChunkPager::decode(const uint8_t *data, size_t size) {
+    size_t at = 0;
+    auto take = [&](void *to, size_t count) {
+        if (size - at < count) return false;
+        std::memcpy(to, data + at, count);
+        at += count;
+        return true;
+    };
+
+    uint64_t bitmask;
+    uint32_t paletteSize, bits;
+    if (!take(&bitmask, 8) || !take(&paletteSize, 4) || !take(&bits, 4) || paletteSize > 256 || bits > 8) return nullptr;
+    std::vector<VoxelData> palette(paletteSize);
+    if (!take(palette.data(), paletteSize * sizeof(VoxelData))) return nullptr;
+
+    auto chunk = std::make_shared<VoxelChunk>();
+    VoxelData values[64];
+    uint8_t indices[64];
+    for (uint64_t subs = bitmask; subs; subs &= subs - 1) {
+        uint64_t mask;
+        if (!take(&mask, 8) || mask == 0) return nullptr;
+        unsigned int count = __builtin_popcountll(mask);
+
+        if (paletteSize) {
+            if (!take(indices, (count * bits + 7) / 8)) return nullptr;
+            for (unsigned int i = 0; i < count; i++) {
+                unsigned int bit = i * bits, index = bits ? (indices[bit >> 3] >> (bit & 7)) & ((1u << bits) - 1u) : 0;
+                if (index >= paletteSize) return nullptr;
+                values[i] = palette[index];
+            }
+        } else if (!take(values, count * sizeof(VoxelData))) {
+            return nullptr;
+        }
+        chunk->apply(__builtin_ctzll(subs), mask, 0, values);
+    }
+    if (at != size) return nullptr;
+
+    if (paletteSize) chunk->compress();
+    return chunk;
+}
+}
@@ -0,0 +1,276 @@
+#include <vforge/pool.hpp>
+#include <vforge/threads.hpp>
+#include <algorithm>
+
+namespace voxelforge {
+
+VoxelPool::VoxelPool(glm::uvec3 dim) : dim(dim) {
+    this->chunkTable.assign((size_t)dim.x * dim.y * dim.z, glm::uvec4(0));
+    this->slots.assign(this->chunkTable.size(), ChunkSlot());
+}
+
+glm::uvec3 VoxelPool::textureExtent(size_t entries) {
+    const size_t slice = (size_t)WIDTH * WIDTH;
+
+    if (entries <= slice) return glm::uvec3(WIDTH, std::max<size_t>(1, (entries + WIDTH - 1) / WIDTH), 1);
+    return glm::uvec3(WIDTH, WIDTH, (entries + slice - 1) / slice);
+}
+
+static size_t extentSize(glm::uvec3 extent) {
+    return (size_t)extent.x * extent.y * extent.z;
+}
+
+static void countChunk(const VoxelChunk *chunk, uint32_t& subChunks, uint32_t& voxels) {
+    subChunks = 0;
+    voxels = 0;
+    if (!chunk) return;
+
+    subChunks = __builtin_popcountll(chunk->getBitmask());
+    chunk->forEachSubChunk([&](glm::uvec3, const VoxelSubChunk& sub) { voxels += sub.size(); });
+}
+
+uint32_t VoxelPool::allocate(std::vector<Range>& freeList, uint32_t& top, uint32_t count) {
+        // first fit from the free list, otherwise grow the pool
+    for (auto it = freeList.begin(); it != freeList.end(); ++it) {
+        if (it->end - it->begin < count) continue;
+
+        uint32_t base = it->begin;
+        it->begin += count;
+        if (it->begin == it->end) freeList.erase(it);
+        return base;
+    }
+
+    uint32_t base = top;
+    top += count;
+    return base;
+}
+
+void VoxelPool::release(std::vector<Range>& freeList, Segment& segment) {
+    if (segment.capacity == 0) return;
+
+    Range range = { segment.base, segment.base + segment.capacity };
+    segment = Segment();
+
+        // keep the free list sorted and coalesced
+    auto it = std::lower_bound(freeList.begin(), freeList.end(), range, [](const Range& a, const Range& b) { return a.begin < b.begin; });
+    it = freeList.insert(it, range);
+
+    if (it + 1 != freeList.end() && it->end == (it + 1)->begin) {
+        it->end = (it + 1)->end;
+        freeList.erase(it + 1);
+    }
+    if (it != freeList.begin() && (it - 1)->end == it->begin) {
+        (it - 1)->end = it->end;
+        freeList.erase(it);
+    }
+}
+
+std::vector<VoxelPool::Range> VoxelPool::merge(std::vector<Range> ranges) {
+    std::sort(ranges.begin(), ranges.end(), [](const Range& a, const Range& b) { return a.begin < b.begin; });
+
+    std::vector<Range> merged;
+    for (const Range& r : ranges) {
+        if (!merged.empty() && r.begin <= merged.back().end) merged.back().end = std::max(merged.back().end, r.end);
+        else merged.push_back(r);
+    }
+    return merged;
+}
+
+void VoxelPool::growPools() {
+        // pools never shrink between full packs, so segments keep their place in the textures
+    size_t scSize = extentSize(textureExtent(this->subChunkTop));
+    if (scSize > this->subChunkPool.size()) {
+        this->subChunkPool.resize(scSize, glm::uvec4(0));
+        this->fullyDirty = true;
+    }
+    size_t vSize = extentSize(textureExtent(this->voxelTop));
+    if (vSize > this->voxelPool.size()) {
+        this->voxelPool.resize(vSize, VoxelData());
+        this->fullyDirty = true;
+    }
+}
+
+    // only touches the chunk's own table entry and segments, so chunks can be written concurrently
+size_t VoxelPool::writeChunk(size_t offset, const VoxelChunk *chunk) {
+    const ChunkSlot& slot = this->slots[offset];
+    uint64_t mask = chunk ? chunk->getBitmask() : 0;
+
+    this->chunkTable[offset] = glm::uvec4((uint32_t)mask, (uint32_t)(mask >> 32), slot.subChunks.base, 0);
+
+    uint32_t scCursor = slot.subChunks.base;
+    uint32_t voxelCursor = slot.voxels.base;
+
+        // subchunks in bit order, matching internal::bitRank
+    if (chunk) chunk->forEachSubChunk([&](glm::uvec3, const VoxelSubChunk& subChunk) {
+        uint64_t scMask = subChunk.getBitmask();
+
+        this->subChunkPool[scCursor++] = glm::uvec4((uint32_t)scMask, (uint32_t)(scMask >> 32), voxelCursor, 0);
+        subChunk.forEachVoxel([&](glm::uvec3, const VoxelData& voxel) { this->voxelPool[voxelCursor++] = voxel; });
+    });
+
+    return sizeof(glm::uvec4) + (size_t)slot.subChunks.count * sizeof(glm::uvec4) + (size_t)slot.voxels.count * sizeof(VoxelData);
+}
+
+void VoxelPool::writeChunks(const std::vector<std::pair<size_t, const VoxelChunk *>>& chunks, unsigned int workers) {
+    std::atomic<size_t> bytes(0);
+
+    parallelFor(chunks.size(), workers, 16, [&](size_t begin, size_t end) {
+        size_t written = 0;
+        for (size_t i = begin; i < end; i++) {
+            written += this->writeChunk(chunks[i].first, chunks[i].second);
+        }
+        bytes += written;
+    });
+
+    this->repackedBytes += bytes;
+}
+
+void VoxelPool::pack(const ChunkMap& chunks, unsigned int workers) {
+    std::vector<std::pair<size_t, const VoxelChunk *>> ordered;
+    ordered.reserve(chunks.size());
+
+    for (const auto& [position, chunk] : chunks) {
+        if (!chunk || chunk->getBitmask() == 0) continue;
+        if (position.x >= this->dim.x || position.y >= this->dim.y || position.z >= this->dim.z) continue; // outside the object
+
+        size_t offset = position.x + position.y*this->dim.x + position.z*this->dim.x*this->dim.y;
+        ordered.emplace_back(offset, chunk.get());
+    }
+        // pack in chunk table order so the output doesn't depend on hash map iteration order
+    std::sort(ordered.begin(), ordered.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+
+    this->chunkTable.assign((size_t)this->dim.x * this->dim.y * this->dim.z, glm::uvec4(0));
+    this->slots.assign(this->chunkTable.size(), ChunkSlot());
+    this->freeSubChunks.clear();
+    this->freeVoxels.clear();
+    this->subChunkTop = 0;
+    this->voxelTop = 0;
+
+    std::vector<glm::uvec2> counts(ordered.size());
+    parallelFor(ordered.size(), workers, 64, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            countChunk(ordered[i].second, counts[i].x, counts[i].y);
+        }
+    });
+
+        // tight segments, back to back
+    for (size_t i = 0; i < ordered.size(); i++) {
+        size_t offset = ordered[i].first;
+        uint32_t scCount = counts[i].x, voxelCount = counts[i].y;
+
+        ChunkSlot& slot = this->slots[offset];
+        slot.subChunks = { this->subChunkTop, scCount, scCount };
+        slot.voxels = { this->voxelTop, voxelCount, voxelCount };
+        this->subChunkTop += scCount;
+        this->voxelTop += voxelCount;
+    }
+    this->numSubChunks = this->subChunkTop;
+    this->numVoxels = this->voxelTop;
+
+    this->subChunkPool.assign(extentSize(textureExtent(this->subChunkTop)), glm::uvec4(0));
+    this->voxelPool.assign(extentSize(textureExtent(this->voxelTop)), VoxelData());
+
+    this->writeChunks(ordered, workers);
+
+    this->clearDirty();
+    this->fullyDirty = true;
+}
+
+void VoxelPool::update(const ChunkMap& dirty, unsigned int workers) {
+        // segments are (re)allocated serially, then the chunks are written in parallel
+    std::vector<std::pair<size_t, const VoxelChunk *>> written;
+    written.reserve(dirty.size());
+
+    for (const auto& [position, chunk] : dirty) {
+        if (position.x >= this->dim.x || position.y >= this->dim.y || position.z >= this->dim.z) continue; // outside the object
+
+        size_t offset = position.x + position.y*this->dim.x + position.z*this->dim.x*this->dim.y;
+        ChunkSlot& slot = this->slots[offset];
+
+        uint32_t scCount, voxelCount;
+        countChunk(chunk.get(), scCount, voxelCount);
+
+        this->numSubChunks = this->numSubChunks - slot.subChunks.count + scCount;
+        this->numVoxels = this->numVoxels - slot.voxels.count + voxelCount;
+
+            // relocate segments that outgrew their capacity, leaving some room for the chunk to keep growing
+        if (scCount == 0 || scCount > slot.subChunks.capacity) {
+            release(this->freeSubChunks, slot.subChunks);
+            uint32_t capacity = scCount + scCount / 4;
+            if (capacity) slot.subChunks = { allocate(this->freeSubChunks, this->subChunkTop, capacity), capacity, 0 };
+        }
+        if (voxelCount == 0 || voxelCount > slot.voxels.capacity) {
+            release(this->freeVoxels, slot.voxels);
+            uint32_t capacity = voxelCount + voxelCount / 4;
+            if (capacity) slot.voxels = { allocate(this->freeVoxels, this->voxelTop, capacity), capacity, 0 };
+        }
+        slot.subChunks.count = scCount;
+        slot.voxels.count = voxelCount;
+
+        written.emplace_back(offset, chunk.get());
+
+        this->dirtyChunks.push_back(offset);
+        if (scCount) this->dirtySubChunks.push_back({ slot.subChunks.base, slot.subChunks.base + scCount });
+        if (voxelCount) this->dirtyVoxels.push_back({ slot.voxels.base, slot.voxels.base + voxelCount });
+    }
+
+    this->growPools();
+    this->writeChunks(written, workers);
+
+    std::sort(this->dirtyChunks.begin(), this->dirtyChunks.end());
+    this->dirtyChunks.erase(std::unique(this->dirtyChunks.begin(), this->dirtyChunks.end()), this->dirtyChunks.end());
+}
+
+bool VoxelPool::needsCompaction() const {
+    const size_t slice = (size_t)WIDTH * WIDTH;
+
+        // only worth it once the waste is at least a texture slice
+    size_t scWaste = this->subChunkTop - this->numSubChunks;
+    size_t voxelWaste = this->voxelTop - this->numVoxels;
+    return (scWaste > slice && scWaste > this->numSubChunks) || (voxelWaste > slice && voxelWaste > this->numVoxels);
+}
+
+void VoxelPool::clearDirty() {
+    this->dirtyChunks.clear();
+    this->dirtySubChunks.clear();
+    this->dirtyVoxels.clear();
+    this->fullyDirty = false;
+}
+
+std::optional<VoxelData> VoxelPool::lookup(glm::uvec3 position) const {
+    return lookup(this->dim, this->chunkTable.data(), this->subChunkPool.data(), this->voxelPool.data(), position);
+}
+
+std::optional<VoxelData> VoxelPool::lookup(glm::uvec3 dim, const glm::uvec4 *chunkTable, const glm::uvec4 *subChunkPool, const VoxelData *voxelPool, glm::uvec3 position) {
+    glm::uvec3 chunkPos = position / 16u;
+    if (chunkPos.x >= dim.x || chunkPos.y >= dim.y || chunkPos.z >= dim.z) return std::nullopt;
+
+    const glm::uvec4& chunk = chunkTable[chunkPos.x + chunkPos.y*dim.x + chunkPos.z*dim.x*dim.y];
+    uint64_t chunkMask = (uint64_t)chunk.x | ((uint64_t)chunk.y << 32);
+
+    glm::uvec3 scPos = (position / 4u) % 4u;
+    unsigned int scBit = internal::bitIndex(scPos.x, scPos.y, scPos.z);
+    if (!(chunkMask & (1ull << scBit))) return std::nullopt;
+
+    const glm::uvec4& subChunk = subChunkPool[chunk.z + internal::bitRank(chunkMask, scBit)];
+    uint64_t scMask = (uint64_t)subChunk.x | ((uint64_t)subChunk.y << 32);
+
+    glm::uvec3 voxelPos = position % 4u;
+    unsigned int voxelBit = internal::bitIndex(voxelPos.x, voxelPos.y, voxelPos.z);
+    if (!(scMask & (1ull << voxelBit))) return std::nullopt;
+
+    return voxelPool[subChunk.z + internal::bitRank(scMask, voxelBit)];
+}
+
+size_t VoxelPool::memoryUsage() const {
+    return this->chunkTable.size() * sizeof(glm::uvec4)
+         + this->subChunkPool.size() * sizeof(glm::uvec4)
+         + this->voxelPool.size() * sizeof(VoxelData);
+}
+
+size_t VoxelPool::denseMemoryUsage(glm::uvec3 dim) {
+    size_t chunks = (size_t)dim.x * dim.y * dim.z;
+        // RG32UI chunk and subchunk bitmasks, RGBA32UI per voxel
+    return chunks * 8 + chunks * 64 * 8 + chunks * 4096 * 16;
+}
+}
@@ -0,0 +1,196 @@
+#include <vforge/object.hpp>
+#include <vforge/threads.hpp>
+#include "traversal.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace voxelforge {
+
+    // maps world space onto object voxel space, where the object spans [0, dim * 16)
+glm::mat4 VoxelObject::voxelFromWorld(const glm::mat4& modelMatrix) const {
+    glm::mat4 m = glm::scale(glm::identity<glm::mat4>(), glm::vec3(16.0f));
+    m = glm::translate(m, glm::vec3(this->dim) * 0.5f);
+    return m * glm::inverse(modelMatrix);
+}
+
+    // DDA over whole chunks. chunks the ray passes at an edge or corner (within rounding) are generated as well, the
+    // voxel traversal may round such a crossing to either side
+void VoxelObject::generateAlong(glm::vec3 origin, glm::vec3 direction, float maxDistance) const {
+    if (!this->generation || this->generation->getRemaining() == 0) return;
+
+    const glm::ivec3 dim(this->dim);
+    internal::RayTraversal ray;
+    if (!internal::beginTraversal(origin, direction, maxDistance, dim * 16, ray)) return;
+
+    glm::ivec3 chunk(ray.cell.x >> 4, ray.cell.y >> 4, ray.cell.z >> 4);
+    for (;;) {
+        this->generation->generateShared(glm::uvec3(chunk));
+
+        int axis = -1;
+        float tAxis[3], tNext = std::numeric_limits<float>::infinity();
+        for (int a = 0; a < 3; a++) {
+            tAxis[a] = std::numeric_limits<float>::infinity();
+            if (ray.step[a] == 0) continue;
+
+            int boundary = (ray.step[a] > 0 ? chunk[a] + 1 : chunk[a]) * 16;
+            tAxis[a] = ((float)boundary - ray.origin[a]) * ray.invDirection[a];
+            if (tAxis[a] < tNext) {
+                tNext = tAxis[a];
+                axis = a;
+            }
+        }
+        if (axis < 0 || tNext > ray.tExit) return;
+
+        for (int a = 0; a < 3; a++) {
+            if (a == axis || tAxis[a] > tNext + 1e-4f * (1.0f + std::abs(tNext))) continue;
+
+            glm::ivec3 side = chunk;
+            side[a] += ray.step[a];
+            if (side[a] >= 0 && side[a] < dim[a]) this->generation->generateShared(glm::uvec3(side));
+        }
+        chunk[axis] += ray.step[axis];
+        if (chunk[axis] < 0 || chunk[axis] >= dim[axis]) return;
+    }
+}
+
+RaycastHit VoxelObject::raycastWorld(const glm::mat4& toVoxels, const Ray& ray) const {
+    glm::vec3 o, d;
+    internal::toVoxelSpace(toVoxels, ray, o, d);
+    return this->raycastVoxels(o, d, ray.maxDistance);
+}
+
+RaycastHit VoxelObject::raycast(glm::vec3 origin, glm::vec3 direction, float maxDistance) const {
+    return this->raycastAt(this->modelMatrix, origin, direction, maxDistance);
+}
+
+std::vector<RaycastHit> VoxelObject::raycast(const std::vector<Ray>& rays, unsigned int workers, RaycastKernel kernel) const {
+    return this->raycastAt(this->modelMatrix, rays, workers, kernel);
+}
+
+RaycastHit VoxelObject::raycastAt(const glm::mat4& modelMatrix, glm::vec3 origin, glm::vec3 direction, float maxDistance) const {
+    return this->raycastWorld(this->voxelFromWorld(modelMatrix), Ray(origin, direction, maxDistance));
+}
+
+std::vector<RaycastHit> VoxelObject::raycastAt(const glm::mat4& modelMatrix, const std::vector<Ray>& rays, unsigned int workers, RaycastKernel kernel) const {
+    glm::mat4 toVoxels = this->voxelFromWorld(modelMatrix);
+    std::vector<RaycastHit> hits(rays.size());
+    if (kernel == RaycastKernel::Auto || kernel > bestRaycastKernel()) kernel = bestRaycastKernel();
+
+    parallelFor(rays.size(), workers, 256, [&](size_t begin, size_t end) {
+        if (kernel != RaycastKernel::Scalar) {
+            for (size_t i = begin; this->generation && i < end; i++) {
+                glm::vec3 o, d;
+                internal::toVoxelSpace(toVoxels, rays[i], o, d);
+                this->generateAlong(o, d, rays[i].maxDistance);
+            }
+            internal::tracePackets(*this, this->currentDistanceField(), toVoxels, rays.data() + begin, hits.data() + begin, end - begin, kernel);
+            return;
+        }
+        for (size_t i = begin; i < end; i++) {
+            hits[i] = this->raycastWorld(toVoxels, rays[i]);
+        }
+    });
+    return hits;
+}
+
+/**
+ * Integer DDA over the voxel grid that leaves empty chunks and subchunks in one step.
+ * Every crossing time is computed directly from an integer cell boundary, so there is no accumulated error
+ * and no epsilon nudging. After leaving a coarse cell, the other two coordinates are re-derived from the
+ * crossing point and clamped into the cell that was just left, which they can't have exited.
+ *
+ * With an up to date distance field, the ray jumps straight across empty space whenever the field allows a longer
+ * step than the DDA. Everything within the jump is empty, so the hit that follows is still the exact one.
+ */
+RaycastHit VoxelObject::raycastVoxels(glm::vec3 origin, glm::vec3 direction, float maxDistance) const {
+    this->generateAlong(origin, direction, maxDistance);
+
+    const glm::ivec3 extent = glm::ivec3(this->dim) * 16;
+    RaycastHit result;
+    internal::RayTraversal ray;
+    if (!internal::beginTraversal(origin, direction, maxDistance, extent, ray)) return result;
+
+    const glm::vec3 o = ray.origin, d = ray.direction, invD = ray.invDirection;
+    const glm::ivec3 step = ray.step;
+    glm::ivec3 cell = ray.cell;
+    float t = ray.t, tExit = ray.tExit;
+    int lastAxis = ray.lastAxis;
+    const DistanceField *field = this->currentDistanceField();
+
+    glm::ivec3 cachedChunkPos(-1);
+    const VoxelChunk *chunk = nullptr;
+
+    for (;;) {
+        result.steps++;
+
+        glm::ivec3 chunkPos(cell.x >> 4, cell.y >> 4, cell.z >> 4);
+        if (chunkPos != cachedChunkPos) {
+            cachedChunkPos = chunkPos;
+            auto it = this->chunks.find(glm::uvec3(chunkPos));
+            chunk = it == this->chunks.end() ? nullptr : it->second.get();
+        }
+
+            // edge length of the empty cell around `cell`
+        int size = 16;
+        if (chunk) {
+            glm::ivec3 sc = (cell >> 2) & 3;
+            if (chunk->getBitmask() & (1ull << internal::bitIndex(sc.x, sc.y, sc.z))) {
+                const VoxelSubChunk& subChunk = *chunk->getSubChunk(sc.x, sc.y, sc.z);
+                unsigned int voxelBit = internal::bitIndex(cell.x & 3, cell.y & 3, cell.z & 3);
+
+                if (subChunk.getBitmask() & (1ull << voxelBit)) {
+                    result.hit = true;
+                    result.voxel = glm::uvec3(cell);
+                    if (lastAxis >= 0) result.normal[lastAxis] = -step[lastAxis];
+                    result.distance = t;
+                    result.data = subChunk.getVoxel(internal::bitRank(subChunk.getBitmask(), voxelBit));
+                    return result;
+                }
+                size = 1;
+            } else {
+                size = 4;
+            }
+        }
+
+            // leave the empty cell through its nearest face
+        int axis = -1, boundary = 0;
+        float tNext = std::numeric_limits<float>::infinity();
+        for (int a = 0; a < 3; a++) {
+            if (step[a] == 0) continue;
+
+            int lo = cell[a] & ~(size - 1);
+            int b = step[a] > 0 ? lo + size : lo;
+            float ta = ((float)b - o[a]) * invD[a];
+            if (ta < tNext) {
+                tNext = ta;
+                axis = a;
+                boundary = b;
+            }
+        }
+
+        float skip = field ? internal::skipDistance(field, cell, size) : 0.0f;
+        float tJump = t + skip * ray.invLength;
+        if (skip > 0.0f && tJump > tNext) {
+            if (tJump > tExit) return result;
+            for (int a = 0; a < 3; a++) cell[a] = std::clamp((int)std::floor(o[a] + d[a] * tJump), 0, extent[a] - 1);
+            t = tJump;
+            continue;
+        }
+        if (axis < 0 || tNext > tExit) return result;
+
+        if (size > 1) {
+            for (int a = 0; a < 3; a++) {
+                if (a == axis || step[a] == 0) continue;
+
+                int lo = cell[a] & ~(size - 1);
+                cell[a] = std::clamp((int)std::floor(o[a] + d[a] * tNext), lo, lo + size - 1);
+            }
+        }
+        cell[axis] = step[axis] > 0 ? boundary : boundary - 1;
+        if (cell[axis] < 0 || cell[axis] >= extent[axis]) return result;
+
+        t = std::max(t, tNext);
+        lastAxis = axis;
+    }
+}
+}
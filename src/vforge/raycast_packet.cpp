@@ -0,0 +1,137 @@
+#include <vforge/object.hpp>
+#include "traversal.hpp"
+#include <limits>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define VFORGE_X86
+#include <immintrin.h>
+#endif
+
+namespace voxelforge {
+
+RaycastKernel bestRaycastKernel() {
+#ifdef VFORGE_X86
+    static const RaycastKernel best = __builtin_cpu_supports("avx2") ? RaycastKernel::AVX2
+                                    : __builtin_cpu_supports("sse4.1") ? RaycastKernel::SSE41
+                                    : RaycastKernel::Scalar;
+    return best;
+#else
+    return RaycastKernel::Scalar;
+#endif
+}
+
+#ifdef VFORGE_X86
+    // the kernels are compiled with per-function target attributes rather than per-file flags,
+    // so nothing outside of them (glm, std) ends up with instructions the CPU might not have
+namespace internal::sse41 {
+#define VFORGE_TARGET __attribute__((target("sse4.1")))
+
+struct Lanes {
+    static constexpr int width = 4;
+    using F = __m128;
+    using I = __m128i;
+
+    VFORGE_TARGET static F load(const float *p) { return _mm_load_ps(p); }
+    VFORGE_TARGET static I load(const int32_t *p) { return _mm_load_si128((const __m128i *)p); }
+    VFORGE_TARGET static void store(float *p, F a) { _mm_store_ps(p, a); }
+    VFORGE_TARGET static void store(int32_t *p, I a) { _mm_store_si128((__m128i *)p, a); }
+    VFORGE_TARGET static F set(float a) { return _mm_set1_ps(a); }
+    VFORGE_TARGET static I set(int32_t a) { return _mm_set1_epi32(a); }
+
+    VFORGE_TARGET static F add(F a, F b) { return _mm_add_ps(a, b); }
+    VFORGE_TARGET static F sub(F a, F b) { return _mm_sub_ps(a, b); }
+    VFORGE_TARGET static F mul(F a, F b) { return _mm_mul_ps(a, b); }
+    VFORGE_TARGET static F floor(F a) { return _mm_floor_ps(a); }
+    VFORGE_TARGET static I toInt(F a) { return _mm_cvttps_epi32(a); }
+    VFORGE_TARGET static F toFloat(I a) { return _mm_cvtepi32_ps(a); }
+
+    VFORGE_TARGET static I add(I a, I b) { return _mm_add_epi32(a, b); }
+    VFORGE_TARGET static I sub(I a, I b) { return _mm_sub_epi32(a, b); }
+    VFORGE_TARGET static I min(I a, I b) { return _mm_min_epi32(a, b); }
+    VFORGE_TARGET static I max(I a, I b) { return _mm_max_epi32(a, b); }
+    VFORGE_TARGET static I bitAnd(I a, I b) { return _mm_and_si128(a, b); }
+    VFORGE_TARGET static I bitOr(I a, I b) { return _mm_or_si128(a, b); }
+    VFORGE_TARGET static I andNot(I a, I b) { return _mm_andnot_si128(a, b); }     // ~a & b
+    VFORGE_TARGET static I shiftLeft(I a, int n) { return _mm_sll_epi32(a, _mm_cvtsi32_si128(n)); }
+
+        // no per-lane shifts before AVX2
+    VFORGE_TARGET static I shiftRightLanes(I a, I n) {
+        alignas(16) uint32_t va[4], vn[4];
+        _mm_store_si128((__m128i *)va, a);
+        _mm_store_si128((__m128i *)vn, n);
+        for (int i = 0; i < 4; i++) va[i] >>= vn[i];
+        return _mm_load_si128((const __m128i *)va);
+    }
+
+        // comparisons give all ones in true lanes
+    VFORGE_TARGET static I less(F a, F b) { return _mm_castps_si128(_mm_cmplt_ps(a, b)); }
+    VFORGE_TARGET static I less(I a, I b) { return _mm_cmplt_epi32(a, b); }
+    VFORGE_TARGET static I equal(I a, I b) { return _mm_cmpeq_epi32(a, b); }
+    VFORGE_TARGET static F select(I mask, F a, F b) { return _mm_blendv_ps(b, a, _mm_castsi128_ps(mask)); }
+    VFORGE_TARGET static I select(I mask, I a, I b) { return _mm_blendv_epi8(b, a, mask); }
+    VFORGE_TARGET static int mask(I a) { return _mm_movemask_ps(_mm_castsi128_ps(a)); }
+};
+
+#include "raycast_packet.inl"
+#undef VFORGE_TARGET
+}
+
+namespace internal::avx2 {
+#define VFORGE_TARGET __attribute__((target("avx2")))
+
+struct Lanes {
+    static constexpr int width = 8;
+    using F = __m256;
+    using I = __m256i;
+
+    VFORGE_TARGET static F load(const float *p) { return _mm256_load_ps(p); }
+    VFORGE_TARGET static I load(const int32_t *p) { return _mm256_load_si256((const __m256i *)p); }
+    VFORGE_TARGET static void store(float *p, F a) { _mm256_store_ps(p, a); }
+    VFORGE_TARGET static void store(int32_t *p, I a) { _mm256_store_si256((__m256i *)p, a); }
+    VFORGE_TARGET static F set(float a) { return _mm256_set1_ps(a); }
+    VFORGE_TARGET static I set(int32_t a) { return _mm256_set1_epi32(a); }
+
+    VFORGE_TARGET static F add(F a, F b) { return _mm256_add_ps(a, b); }
+    VFORGE_TARGET static F sub(F a, F b) { return _mm256_sub_ps(a, b); }
+    VFORGE_TARGET static F mul(F a, F b) { return _mm256_mul_ps(a, b); }
+    VFORGE_TARGET static F floor(F a) { return _mm256_floor_ps(a); }
+    VFORGE_TARGET static I toInt(F a) { return _mm256_cvttps_epi32(a); }
+    VFORGE_TARGET static F toFloat(I a) { return _mm256_cvtepi32_ps(a); }
+
+    VFORGE_TARGET static I add(I a, I b) { return _mm256_add_epi32(a, b); }
+    VFORGE_TARGET static I sub(I a, I b) { return _mm256_sub_epi32(a, b); }
+    VFORGE_TARGET static I min(I a, I b) { return _mm256_min_epi32(a, b); }
+    VFORGE_TARGET static I max(I a, I b) { return _mm256_max_epi32(a, b); }
+    VFORGE_TARGET static I bitAnd(I a, I b) { return _mm256_and_si256(a, b); }
+    VFORGE_TARGET static I bitOr(I a, I b) { return _mm256_or_si256(a, b); }
+    VFORGE_TARGET static I andNot(I a, I b) { return _mm256_andnot_si256(a, b); }  // ~a & b
+    VFORGE_TARGET static I shiftLeft(I a, int n) { return _mm256_sll_epi32(a, _mm_cvtsi32_si128(n)); }
+    VFORGE_TARGET static I shiftRightLanes(I a, I n) { return _mm256_srlv_epi32(a, n); }
+
+        // comparisons give all ones in true lanes
+    VFORGE_TARGET static I less(F a, F b) { return _mm256_castps_si256(_mm256_cmp_ps(a, b, _CMP_LT_OQ)); }
+    VFORGE_TARGET static I less(I a, I b) { return _mm256_cmpgt_epi32(b, a); }
+    VFORGE_TARGET static I equal(I a, I b) { return _mm256_cmpeq_epi32(a, b); }
+    VFORGE_TARGET static F select(I mask, F a, F b) { return _mm256_blendv_ps(b, a, _mm256_castsi256_ps(mask)); }
+    VFORGE_TARGET static I select(I mask, I a, I b) { return _mm256_blendv_epi8(b, a, mask); }
+    VFORGE_TARGET static int mask(I a) { return _mm256_movemask_ps(_mm256_castsi256_ps(a)); }
+};
+
+#include "raycast_packet.inl"
+#undef VFORGE_TARGET
+}
+#endif
+
+void internal::tracePackets(const VoxelObject& object, const DistanceField *field, const glm::mat4& toVoxels, const Ray *rays, RaycastHit *hits, size_t count, RaycastKernel kernel) {
+#ifdef VFORGE_X86
+    if (kernel == RaycastKernel::AVX2) return avx2::tracePackets(object, field, toVoxels, rays, hits, count);
+    if (kernel == RaycastKernel::SSE41) return sse41::tracePackets(object, field, toVoxels, rays, hits, count);
+#endif
+
+    for (size_t i = 0; i < count; i++) {
+        glm::vec3 o, d;
+        toVoxelSpace(toVoxels, rays[i], o, d);
+        hits[i] = object.raycastVoxels(o, d, rays[i].maxDistance);
+    }
+}
+}
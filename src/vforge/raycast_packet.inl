@@ -0,0 +1,187 @@
+// Packet traversal, compiled once per instruction set by raycast_packet.cpp.
+// Expects `Lanes` (the vector operations) and VFORGE_TARGET (the target attribute) to be defined by the includer.
+//
+// Every lane runs exactly the arithmetic of VoxelObject::raycastVoxels, so the hits are bit for bit the same.
+// Lanes that hit or leave the object are masked off and the packet runs until all of them are done.
+
+VFORGE_TARGET static void tracePacket(const ChunkMap& chunks, const DistanceField *field, glm::ivec3 extent,
+                                      const glm::mat4& toVoxels, const Ray *rays, RaycastHit *hits, int count) {
+    using F = Lanes::F;
+    using I = Lanes::I;
+    constexpr int W = Lanes::width;
+
+    alignas(32) float origin[3][W] = {}, direction[3][W] = {}, invDirection[3][W] = {}, tEnter[W] = {}, tExit[W] = {}, invLength[W] = {};
+    alignas(32) int32_t step[3][W] = {}, cell[3][W] = {}, lastAxis[W] = {}, active[W] = {};
+
+    for (int i = 0; i < count; i++) {
+        hits[i] = RaycastHit();
+
+        glm::vec3 o, d;
+        RayTraversal ray;
+        toVoxelSpace(toVoxels, rays[i], o, d);
+        if (!beginTraversal(o, d, rays[i].maxDistance, extent, ray)) continue;
+
+        for (int a = 0; a < 3; a++) {
+            origin[a][i] = ray.origin[a];
+            direction[a][i] = ray.direction[a];
+            invDirection[a][i] = ray.invDirection[a];
+            step[a][i] = ray.step[a];
+            cell[a][i] = ray.cell[a];
+        }
+        tEnter[i] = ray.t;
+        tExit[i] = ray.tExit;
+        invLength[i] = ray.invLength;
+        lastAxis[i] = ray.lastAxis;
+        active[i] = -1;
+    }
+
+    F o[3], d[3], invD[3];
+    I s[3], c[3];
+    for (int a = 0; a < 3; a++) {
+        o[a] = Lanes::load(origin[a]);
+        d[a] = Lanes::load(direction[a]);
+        invD[a] = Lanes::load(invDirection[a]);
+        s[a] = Lanes::load(step[a]);
+        c[a] = Lanes::load(cell[a]);
+    }
+    F t = Lanes::load(tEnter), tOut = Lanes::load(tExit), invLen = Lanes::load(invLength);
+    I last = Lanes::load(lastAxis), live = Lanes::load(active), steps = Lanes::set(0);
+
+    const I zero = Lanes::set(0), one = Lanes::set(1), three = Lanes::set(3);
+
+    glm::ivec3 cachedChunkPos[W];
+    const VoxelChunk *chunk[W] = {};
+    const VoxelSubChunk *subChunk[W] = {};
+    for (auto& p : cachedChunkPos) p = glm::ivec3(-1);
+
+    alignas(32) int32_t size[W], maskLo[W], maskHi[W];
+    alignas(32) float skip[W] = {};
+
+    for (;;) {
+        int liveBits = Lanes::mask(live);
+        if (!liveBits) break;
+        steps = Lanes::sub(steps, live);
+
+            // the chunk and subchunk lookups chase pointers, one lane at a time
+        for (int a = 0; a < 3; a++) Lanes::store(cell[a], c[a]);
+        for (int i = 0; i < W; i++) {
+            size[i] = 16;
+            maskLo[i] = maskHi[i] = 0;
+            if (!(liveBits >> i & 1)) continue;
+
+            glm::ivec3 p(cell[0][i], cell[1][i], cell[2][i]);
+            glm::ivec3 chunkPos(p.x >> 4, p.y >> 4, p.z >> 4);
+            if (chunkPos != cachedChunkPos[i]) {
+                cachedChunkPos[i] = chunkPos;
+                auto it = chunks.find(glm::uvec3(chunkPos));
+                chunk[i] = it == chunks.end() ? nullptr : it->second.get();
+            }
+            if (!chunk[i]) continue;
+
+            glm::ivec3 sc = (p >> 2) & 3;
+            size[i] = 4;
+            if (!(chunk[i]->getBitmask() & (1ull << internal::bitIndex(sc.x, sc.y, sc.z)))) continue;
+
+            subChunk[i] = chunk[i]->getSubChunk(sc.x, sc.y, sc.z).get();
+            uint64_t bitmask = subChunk[i]->getBitmask();
+            maskLo[i] = (int32_t)(uint32_t)bitmask;
+            maskHi[i] = (int32_t)(uint32_t)(bitmask >> 32);
+            size[i] = 1;
+        }
+        if (field) {
+            for (int i = 0; i < W; i++) {
+                if (liveBits >> i & 1) skip[i] = skipDistance(field, glm::ivec3(cell[0][i], cell[1][i], cell[2][i]), size[i]);
+            }
+        }
+
+            // voxel bit test on all lanes, on whichever half of the subchunk bitmask holds the bit
+        I voxelBit = Lanes::bitOr(Lanes::bitAnd(c[0], three),
+                     Lanes::bitOr(Lanes::shiftLeft(Lanes::bitAnd(c[1], three), 2), Lanes::shiftLeft(Lanes::bitAnd(c[2], three), 4)));
+        I word = Lanes::select(Lanes::less(voxelBit, Lanes::set(32)), Lanes::load(maskLo), Lanes::load(maskHi));
+        I occupied = Lanes::bitAnd(Lanes::shiftRightLanes(word, Lanes::bitAnd(voxelBit, Lanes::set(31))), one);
+        I hit = Lanes::andNot(Lanes::equal(occupied, zero), live);
+
+        if (int hitBits = Lanes::mask(hit)) {
+            alignas(32) float hitT[W];
+            alignas(32) int32_t hitAxis[W], hitSteps[W], hitBit[W];
+            Lanes::store(hitT, t);
+            Lanes::store(hitAxis, last);
+            Lanes::store(hitSteps, steps);
+            Lanes::store(hitBit, voxelBit);
+
+            for (int i = 0; i < W; i++) {
+                if (!(hitBits >> i & 1)) continue;
+
+                RaycastHit& result = hits[i];
+                result.hit = true;
+                result.voxel = glm::uvec3(cell[0][i], cell[1][i], cell[2][i]);
+                if (hitAxis[i] >= 0) result.normal[hitAxis[i]] = -step[hitAxis[i]][i];
+                result.distance = hitT[i];
+                result.data = subChunk[i]->getVoxel(internal::bitRank(subChunk[i]->getBitmask(), hitBit[i]));
+                result.steps = hitSteps[i];
+            }
+            live = Lanes::andNot(hit, live);
+        }
+
+            // leave the empty cell through its nearest face, ties go to the lowest axis
+        I cellSize = Lanes::load(size);
+        I lo[3];
+        F tNext = Lanes::set(std::numeric_limits<float>::infinity());
+        I axis = Lanes::set(-1), boundary = zero;
+        for (int a = 0; a < 3; a++) {
+            lo[a] = Lanes::bitAnd(c[a], Lanes::sub(zero, cellSize));
+            I b = Lanes::select(Lanes::less(zero, s[a]), Lanes::add(lo[a], cellSize), lo[a]);
+            F ta = Lanes::mul(Lanes::sub(Lanes::toFloat(b), o[a]), invD[a]);
+
+            I closer = Lanes::andNot(Lanes::equal(s[a], zero), Lanes::less(ta, tNext));
+            tNext = Lanes::select(closer, ta, tNext);
+            axis = Lanes::select(closer, Lanes::set(a), axis);
+            boundary = Lanes::select(closer, b, boundary);
+        }
+            // lanes the distance field lets jump further than the DDA step do that instead
+        I jump = zero;
+        F tJump = t;
+        if (field) {
+            F skipped = Lanes::load(skip);
+            tJump = Lanes::add(t, Lanes::mul(skipped, invLen));
+            jump = Lanes::bitAnd(Lanes::less(Lanes::set(0.0f), skipped), Lanes::less(tNext, tJump));
+            live = Lanes::andNot(Lanes::bitAnd(jump, Lanes::less(tOut, tJump)), live);
+        }
+        live = Lanes::andNot(Lanes::andNot(jump, Lanes::bitOr(Lanes::less(axis, zero), Lanes::less(tOut, tNext))), live);
+
+            // after a coarse step the other axes are re-derived from the crossing point
+        I coarse = Lanes::andNot(jump, Lanes::less(one, cellSize));
+        for (int a = 0; a < 3; a++) {
+            I onAxis = Lanes::andNot(jump, Lanes::equal(axis, Lanes::set(a)));
+            I moved = Lanes::toInt(Lanes::floor(Lanes::add(o[a], Lanes::mul(d[a], tNext))));
+            moved = Lanes::min(Lanes::max(moved, lo[a]), Lanes::add(lo[a], Lanes::sub(cellSize, one)));
+            c[a] = Lanes::select(Lanes::andNot(Lanes::bitOr(onAxis, Lanes::equal(s[a], zero)), coarse), moved, c[a]);
+
+            I next = Lanes::select(Lanes::less(zero, s[a]), boundary, Lanes::sub(boundary, one));
+            c[a] = Lanes::select(onAxis, next, c[a]);
+
+            I outside = Lanes::bitOr(Lanes::less(next, zero), Lanes::less(Lanes::set(extent[a] - 1), next));
+            live = Lanes::andNot(Lanes::bitAnd(onAxis, outside), live);
+
+            I landed = Lanes::toInt(Lanes::floor(Lanes::add(o[a], Lanes::mul(d[a], tJump))));
+            landed = Lanes::min(Lanes::max(landed, zero), Lanes::set(extent[a] - 1));
+            c[a] = Lanes::select(jump, landed, c[a]);
+        }
+
+        t = Lanes::select(jump, tJump, Lanes::select(Lanes::less(t, tNext), tNext, t));
+        last = Lanes::select(jump, last, axis);
+    }
+
+    alignas(32) int32_t missSteps[W];
+    Lanes::store(missSteps, steps);
+    for (int i = 0; i < count; i++) {
+        if (!hits[i].hit) hits[i].steps = missSteps[i];
+    }
+}
+
+VFORGE_TARGET static void tracePackets(const VoxelObject& object, const DistanceField *field, const glm::mat4& toVoxels, const Ray *rays, RaycastHit *hits, size_t count) {
+    glm::ivec3 extent = glm::ivec3(object.size()) * 16;
+    for (size_t i = 0; i < count; i += Lanes::width) {
+        tracePacket(object.getChunks(), field, extent, toVoxels, rays + i, hits + i, (int)std::min<size_t>(Lanes::width, count - i));
+    }
+}
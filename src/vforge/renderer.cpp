@@ -0,0 +1,107 @@
+#include <vforge/renderer.hpp>
+#include <vforge/threads.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+
+namespace voxelforge {
+
+VoxelRenderer::VoxelRenderer(unsigned int width, unsigned int height) : w(width), h(height), color(width * height), depth(width * height) {}
+
+void VoxelRenderer::render(const VoxelWorld& world, glm::mat4 view, glm::mat4 proj) {
+    auto start = std::chrono::steady_clock::now();
+
+    std::fill(this->color.begin(), this->color.end(), this->clearColor);
+    std::fill(this->depth.begin(), this->depth.end(), 1.0f);
+
+    const glm::mat4 viewProj = proj * view;
+    const glm::mat4 inverseViewProj = glm::inverse(viewProj);
+    const RaycastKernel kernel = bestRaycastKernel();
+
+        // detail level of every object and instance, chosen once per frame
+    auto level = [&](const VoxelObject& object, const glm::mat4& modelMatrix) {
+        return this->lodPixels > 0.0f ? object.selectLOD(modelMatrix, view, proj, (float)this->h, this->lodPixels) : 0u;
+    };
+    std::vector<unsigned int> objectLevels(world.getObjects().size(), 0), instanceLevels(world.getInstances().size(), 0);
+    for (size_t i = 0; i < objectLevels.size(); i++) {
+        const auto& object = world.getObjects()[i];
+        if (object) objectLevels[i] = level(*object, object->getModelMatrix());
+    }
+    for (size_t i = 0; i < instanceLevels.size(); i++) {
+        const auto& instance = world.getInstances()[i];
+        if (instance && instance->getModel()) instanceLevels[i] = level(*instance->getModel(), instance->getModelMatrix());
+    }
+    std::atomic<uint64_t> steps(0);
+
+    const unsigned int tilesX = (this->w + this->tileSize - 1) / this->tileSize;
+    const unsigned int tilesY = (this->h + this->tileSize - 1) / this->tileSize;
+
+    workStealingFor(tilesX * tilesY, this->workers, [&](size_t tile) {
+        unsigned int x0 = tile % tilesX * this->tileSize, y0 = tile / tilesX * this->tileSize;
+        unsigned int x1 = std::min(x0 + this->tileSize, this->w), y1 = std::min(y0 + this->tileSize, this->h);
+
+            // rays run from the near to the far plane, so voxels outside the frustum depth range are clipped like in GL
+        std::vector<Ray> rays;
+        rays.reserve((x1 - x0) * (y1 - y0));
+        for (unsigned int y = y0; y < y1; y++) {
+            for (unsigned int x = x0; x < x1; x++) {
+                glm::vec2 ndc((x + 0.5f) / this->w * 2.0f - 1.0f, 1.0f - (y + 0.5f) / this->h * 2.0f);
+                glm::vec4 nearPoint = inverseViewProj * glm::vec4(ndc.x, ndc.y, -1.0f, 1.0f);
+                glm::vec4 farPoint = inverseViewProj * glm::vec4(ndc.x, ndc.y, 1.0f, 1.0f);
+                glm::vec3 origin = glm::vec3(nearPoint) / nearPoint.w;
+                glm::vec3 span = glm::vec3(farPoint) / farPoint.w - origin;
+                rays.emplace_back(origin, span, glm::length(span));
+            }
+        }
+
+        uint64_t tileSteps = 0;
+        auto trace = [&](const VoxelObject& object, const glm::mat4& modelMatrix, unsigned int level) {
+            auto hits = object.raycastLOD(level, modelMatrix, rays, 1, kernel);
+            for (size_t i = 0; i < hits.size(); i++) {
+                tileSteps += hits[i].steps;
+                if (!hits[i]) continue;
+
+                glm::vec3 position = rays[i].origin + glm::normalize(rays[i].direction) * hits[i].distance;
+                glm::vec4 clipPos = viewProj * glm::vec4(position, 1.0f);
+                float z = (clipPos.z / clipPos.w + 1.0f) * 0.5f;
+
+                size_t pixel = (y0 + i / (x1 - x0)) * this->w + x0 + i % (x1 - x0);
+                if (z < this->depth[pixel]) {
+                    this->depth[pixel] = z;
+                    this->color[pixel] = glm::vec4(glm::vec3(object.getMaterial(hits[i].data.matID)), 1.0f);
+                }
+            }
+        };
+        for (size_t i = 0; i < world.getObjects().size(); i++) {
+            const auto& object = world.getObjects()[i];
+            if (object) trace(*object, object->getModelMatrix(), objectLevels[i]);
+        }
+        for (size_t i = 0; i < world.getInstances().size(); i++) {
+            const auto& instance = world.getInstances()[i];
+            if (instance && instance->getModel()) trace(*instance->getModel(), instance->getModelMatrix(), instanceLevels[i]);
+        }
+        steps += tileSteps;
+    });
+
+    this->stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    this->stats.rays = (uint64_t)this->w * this->h;
+    this->stats.steps = steps;
+}
+
+bool VoxelRenderer::savePPM(const char *filename) const {
+    std::ofstream file(filename, std::ios::binary);
+    if (!file) return false;
+
+    file << "P6\n" << this->w << " " << this->h << "\n255\n";
+    std::vector<unsigned char> row(this->w * 3);
+    for (unsigned int y = 0; y < this->h; y++) {
+        for (unsigned int x = 0; x < this->w; x++) {
+            glm::vec4 c = glm::clamp(this->color[y * this->w + x], 0.0f, 1.0f);
+            for (int i = 0; i < 3; i++) row[x * 3 + i] = (unsigned char)(c[i] * 255.0f + 0.5f);
+        }
+        file.write((const char *)row.data(), row.size());
+    }
+    return (bool)file;
+}
+}
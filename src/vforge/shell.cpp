@@ -0,0 +1,122 @@
+#include <vforge/object.hpp>
+#include <vforge/threads.hpp>
+
+namespace voxelforge {
+
+    // cells of a 4x4x4 bitmask on each face, see internal::bitIndex()
+static constexpr uint64_t X0 = 0x1111111111111111ull, X3 = 0x8888888888888888ull;
+static constexpr uint64_t Y0 = 0x000F000F000F000Full, Y3 = 0xF000F000F000F000ull;
+static constexpr uint64_t Z0 = 0x000000000000FFFFull, Z3 = 0xFFFF000000000000ull;
+
+    // occupancy of the voxels with all 6 face neighbours occupied, the neighbouring subchunks supply the face halos
+static uint64_t interior(uint64_t m, uint64_t xn, uint64_t xp, uint64_t yn, uint64_t yp, uint64_t zn, uint64_t zp) {
+    uint64_t px = ((m >> 1) & ~X3) | ((xp & X0) << 3);
+    uint64_t nx = ((m << 1) & ~X0) | ((xn & X3) >> 3);
+    uint64_t py = ((m >> 4) & ~Y3) | ((yp & Y0) << 12);
+    uint64_t ny = ((m << 4) & ~Y0) | ((yn & Y3) >> 12);
+    uint64_t pz = (m >> 16) | ((zp & Z0) << 48);
+    uint64_t nz = (m << 16) | ((zn & Z3) >> 48);
+    return m & px & nx & py & ny & pz & nz;
+}
+
+    // subchunk occupancy of a chunk and the touching faces of its 6 neighbours, as a 6x6x6 grid with a one subchunk border
+static void gatherOccupancy(const ChunkMap& chunks, glm::uvec3 dim, glm::uvec3 position, const VoxelChunk& chunk, uint64_t grid[6][6][6]) {
+    std::fill(&grid[0][0][0], &grid[0][0][0] + 6 * 6 * 6, 0ull);
+    chunk.forEachSubChunk([&](glm::uvec3 corner, const VoxelSubChunk& sub) {
+        glm::uvec3 sc = corner / 4u + 1u;
+        grid[sc.z][sc.y][sc.x] = sub.getBitmask();
+    });
+
+    for (int axis = 0; axis < 3; axis++)
+    for (int side = 0; side < 2; side++) {
+        glm::ivec3 offset(0);
+        offset[axis] = side ? 1 : -1;
+        glm::ivec3 neighbourPos = glm::ivec3(position) + offset;
+        if (neighbourPos[axis] < 0 || neighbourPos[axis] >= (int)dim[axis]) continue;
+
+        auto it = chunks.find(glm::uvec3(neighbourPos));
+        if (it == chunks.end() || !it->second) continue;
+        const VoxelChunk& neighbour = *it->second;
+
+            // the layer of the neighbour's subchunks facing this chunk
+        unsigned int layer = side ? 0 : 3;
+        for (unsigned int a = 0; a < 4; a++)
+        for (unsigned int b = 0; b < 4; b++) {
+            glm::uvec3 sc(0);
+            sc[axis] = layer;
+            sc[(axis + 1) % 3] = a;
+            sc[(axis + 2) % 3] = b;
+            if (!(neighbour.getBitmask() & (1ull << internal::bitIndex(sc.x, sc.y, sc.z)))) continue;
+
+            glm::uvec3 cell = sc + 1u;
+            cell[axis] = side ? 5 : 0;
+            grid[cell.z][cell.y][cell.x] = neighbour.getSubChunk(sc)->getBitmask();
+        }
+    }
+}
+
+std::vector<ShellChunk> VoxelObject::findShell(unsigned int workers) const {
+    std::vector<std::pair<glm::uvec3, const VoxelChunk *>> occupied;
+    occupied.reserve(this->chunks.size());
+    for (const auto& [position, chunk] : this->chunks) {
+        bool inside = position.x < this->dim.x && position.y < this->dim.y && position.z < this->dim.z;
+        if (inside && chunk && chunk->getBitmask()) occupied.emplace_back(position, chunk.get());
+    }
+
+    std::vector<ShellChunk> shell(occupied.size());
+    parallelFor(occupied.size(), workers, 4, [&](size_t begin, size_t end) {
+        uint64_t grid[6][6][6];
+        for (size_t i = begin; i < end; i++) {
+            const auto& [position, chunk] = occupied[i];
+            ShellChunk& result = shell[i];
+            result.position = position;
+            gatherOccupancy(this->chunks, this->dim, position, *chunk, grid);
+
+            for (uint64_t mask = chunk->getBitmask(); mask; mask &= mask - 1) {
+                unsigned int bit = __builtin_ctzll(mask);
+                glm::uvec3 c = internal::bitPosition(bit) + 1u;
+                uint64_t m = grid[c.z][c.y][c.x];
+                uint64_t visible = m & ~interior(m, grid[c.z][c.y][c.x - 1], grid[c.z][c.y][c.x + 1], grid[c.z][c.y - 1][c.x],
+                                                 grid[c.z][c.y + 1][c.x], grid[c.z - 1][c.y][c.x], grid[c.z + 1][c.y][c.x]);
+                if (!visible) continue;
+
+                result.voxels[bit] = visible;
+                result.subChunks |= 1ull << bit;
+            }
+        }
+    });
+    return shell;
+}
+
+std::shared_ptr<VoxelObject> VoxelObject::extractShell(unsigned int workers) const {
+    std::vector<ShellChunk> shell = this->findShell(workers);
+
+        // chunks are independent, build them in parallel and hand them over afterwards
+    std::vector<std::shared_ptr<VoxelChunk>> built(shell.size());
+    parallelFor(shell.size(), workers, 4, [&](size_t begin, size_t end) {
+        VoxelData values[64];
+        for (size_t i = begin; i < end; i++) {
+            const ShellChunk& s = shell[i];
+            const VoxelChunk& source = *this->chunks.find(s.position)->second;
+            auto chunk = std::make_shared<VoxelChunk>();
+
+            for (uint64_t mask = s.subChunks; mask; mask &= mask - 1) {
+                unsigned int bit = __builtin_ctzll(mask);
+                const VoxelSubChunk& sub = *source.getSubChunk(internal::bitPosition(bit));
+
+                size_t n = 0;
+                for (uint64_t voxels = s.voxels[bit]; voxels; voxels &= voxels - 1) {
+                    values[n++] = sub.getVoxel(internal::bitRank(sub.getBitmask(), __builtin_ctzll(voxels)));
+                }
+                chunk->apply(bit, s.voxels[bit], 0, values);
+            }
+            built[i] = chunk;
+        }
+    });
+
+    auto object = std::make_shared<VoxelObject>(this->dim, this->modelMatrix);
+    for (uint32_t m = 0; m < this->materials.size(); m++) object->setMaterial(m, this->materials[m]);
+    for (size_t i = 0; i < shell.size(); i++) object->setChunk(shell[i].position, built[i]);
+    return object;
+}
+}
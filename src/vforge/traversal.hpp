@@ -0,0 +1,77 @@
+#pragma once
+
+#include <vforge/object.hpp>
+#include <algorithm>
+#include <cmath>
+
+namespace voxelforge::internal {
+
+    // one ray walking the voxel grid of an object, shared by the scalar and the packet traversal
+struct RayTraversal {
+    glm::vec3 origin;
+    glm::vec3 direction;
+    glm::vec3 invDirection;     // +-inf on axes the ray doesn't move along
+    float invLength;            // t per voxel of distance travelled
+    glm::ivec3 step;            // -1, 0 or 1 per axis
+    glm::ivec3 cell;            // current voxel
+    float t;                    // where the ray entered `cell`
+    float tExit;                // where the ray leaves the object or reaches its max distance
+    int lastAxis;               // axis of the last crossed face, -1 if the ray started in `cell`
+};
+
+    // world space to object voxel space. t stays the same across the transform, so distances come out in world units
+inline void toVoxelSpace(const glm::mat4& toVoxels, const Ray& ray, glm::vec3& origin, glm::vec3& direction) {
+    origin = glm::vec3(toVoxels * glm::vec4(ray.origin, 1.0f));
+    direction = glm::vec3(toVoxels * glm::vec4(glm::normalize(ray.direction), 0.0f));
+}
+
+    // clips a voxel space ray to [0, extent) and finds its first cell. false if the ray misses the object
+inline bool beginTraversal(glm::vec3 o, glm::vec3 d, float maxDistance, glm::ivec3 extent, RayTraversal& ray) {
+    ray.origin = o;
+    ray.direction = d;
+    ray.invLength = 1.0f / glm::length(d);
+    for (int a = 0; a < 3; a++) {
+        ray.step[a] = d[a] > 0.0f ? 1 : (d[a] < 0.0f ? -1 : 0);
+        ray.invDirection[a] = 1.0f / d[a];
+    }
+
+    float tEnter = 0.0f, tExit = maxDistance;
+    int enterAxis = -1;
+    for (int a = 0; a < 3; a++) {
+        if (ray.step[a] == 0) {
+            if (o[a] < 0.0f || o[a] >= (float)extent[a]) return false; // parallel to and outside of this slab
+            continue;
+        }
+        float t0 = ((ray.step[a] > 0 ? 0.0f : (float)extent[a]) - o[a]) * ray.invDirection[a];
+        float t1 = ((ray.step[a] > 0 ? (float)extent[a] : 0.0f) - o[a]) * ray.invDirection[a];
+        if (t0 > tEnter) {
+            tEnter = t0;
+            enterAxis = a;
+        }
+        tExit = std::min(tExit, t1);
+    }
+    if (tEnter > tExit) return false;
+
+    for (int a = 0; a < 3; a++) {
+        if (a == enterAxis) ray.cell[a] = ray.step[a] > 0 ? 0 : extent[a] - 1;
+        else ray.cell[a] = std::clamp((int)std::floor(o[a] + d[a] * tEnter), 0, extent[a] - 1);
+    }
+    ray.t = tEnter;
+    ray.tExit = tExit;
+    ray.lastAxis = enterAxis;
+    return true;
+}
+
+    // voxels of empty space the distance field guarantees around any point inside `cell`, 0 if too little to be worth a jump.
+    // the field value is a floored center to center distance, minus sqrt(3) for the two half diagonals and some slack for rounding.
+    // only empty subchunks and chunks (size > 1) consult it, through the subchunk minimum: inside an occupied subchunk the
+    // nearest solid voxel is a few voxels away at most, so a lookup there costs a random read and almost never pays off
+inline float skipDistance(const DistanceField *field, glm::ivec3 cell, int size) {
+    if (size == 1) return 0.0f;
+    unsigned int distance = field->getSubChunk(glm::uvec3(cell >> 2));
+    return distance > 2 ? (float)(distance - 2) : 0.0f;
+}
+
+    // traces `count` rays in packets with the given SIMD kernel (not Auto or Scalar), results are identical to VoxelObject::raycastVoxels
+void tracePackets(const VoxelObject& object, const DistanceField *field, const glm::mat4& toVoxels, const Ray *rays, RaycastHit *hits, size_t count, RaycastKernel kernel);
+}
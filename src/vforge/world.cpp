@@ -1,11 +1,101 @@
 #include <vforge/world.hpp>
+#include <algorithm>
 
 namespace voxelforge {
 
+const VoxelObject *VoxelWorld::itemModel(size_t item) const {
+    if (item < this->objects.size()) return this->objects[item].get();
+
+    const auto& instance = this->instances[item - this->objects.size()];
+    return instance ? instance->getModel().get() : nullptr;
+}
+
+glm::mat4 VoxelWorld::itemModelMatrix(size_t item) const {
+    if (item < this->objects.size()) return this->objects[item] ? this->objects[item]->getModelMatrix() : glm::mat4(1.0f);
+
+    const auto& instance = this->instances[item - this->objects.size()];
+    return instance ? instance->getModelMatrix() : glm::mat4(1.0f);
+}
+
+    // an object spans [-size / 2, size / 2] in model space, see VoxelObject::voxelFromWorld()
+AABB VoxelWorld::itemBounds(size_t item) const {
+    const VoxelObject *model = this->itemModel(item);
+    if (!model) return AABB();
+
+    glm::vec3 half = glm::vec3(model->size()) * 0.5f;
+    return AABB(-half, half).transformed(this->itemModelMatrix(item));
+}
+
+void VoxelWorld::updateBounds() {
+    if (this->bvhDirty) {
+        this->rebuildBounds();
+        return;
+    }
+
+    std::vector<AABB> bounds(this->itemCount());
+    for (size_t i = 0; i < bounds.size(); i++) bounds[i] = this->itemBounds(i);
+    this->bvh.refit(bounds);
+}
+
+void VoxelWorld::rebuildBounds() {
+    std::vector<AABB> bounds(this->itemCount());
+    for (size_t i = 0; i < bounds.size(); i++) bounds[i] = this->itemBounds(i);
+    this->bvh.build(bounds);
+    this->bvhDirty = false;
+}
+
+void VoxelWorld::updateBounds(size_t item) {
+    if (this->bvhDirty) {
+        this->rebuildBounds();
+        return;
+    }
+    this->bvh.refit(item, this->itemBounds(item));
+}
+
+std::vector<size_t> VoxelWorld::cull(glm::mat4 view, glm::mat4 proj) const {
+    std::vector<std::pair<float, size_t>> visible;
+    glm::vec3 eye = glm::vec3(glm::inverse(view)[3]);
+    this->bvh.cull(Frustum(proj * view), [&](uint32_t item) {
+        const AABB& box = this->bvh.getBounds(item);
+        glm::vec3 nearest = glm::clamp(eye, box.lo, box.hi);
+        visible.emplace_back(glm::dot(nearest - eye, nearest - eye), item);
+    });
+    std::sort(visible.begin(), visible.end());
+
+    std::vector<size_t> items(visible.size());
+    for (size_t i = 0; i < visible.size(); i++) items[i] = visible[i].second;
+    return items;
+}
+
+VoxelWorld::Hit VoxelWorld::raycast(glm::vec3 origin, glm::vec3 direction, float maxDistance) const {
+    Hit result;
+    this->bvh.raycast(origin, direction, maxDistance, [&](uint32_t item, float maxDistance) {
+        RaycastHit hit = this->itemModel(item)->raycastAt(this->itemModelMatrix(item), origin, direction, maxDistance);
+        if (!hit || hit.distance >= maxDistance) return maxDistance;
+
+        static_cast<RaycastHit&>(result) = hit;
+        result.item = item;
+        return hit.distance;
+    });
+    return result;
+}
+
+std::vector<size_t> VoxelWorld::query(const AABB& box) const {
+    std::vector<size_t> items;
+    this->bvh.overlap(box, [&](uint32_t item) { items.push_back(item); });
+    return items;
+}
+
+    // front to back, so the depth test can reject the fragments of objects behind nearer ones early
 void VoxelWorld::draw(fglw::RenderTarget& fb, glm::mat4x4 view, glm::mat4x4 proj) {
-    for (const auto& object : this->objects) {
-        if (!object) continue;
-        object->draw(fb, view, proj);
+    this->updateBounds();
+
+    for (size_t item : this->cull(view, proj)) {
+        if (item < this->objects.size()) {
+            this->objects[item]->draw(fb, view, proj);
+        } else {
+            this->instances[item - this->objects.size()]->draw(fb, view, proj);
+        }
     }
 }
-}
\ No newline at end of file
+}
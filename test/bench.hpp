@@ -0,0 +1,60 @@
+#pragma once
+
+#include <vforge/batch.hpp>
+#include <vforge/object.hpp>
+#include <glm/gtc/noise.hpp>
+#include <chrono>
+#include <cstdint>
+
+    // helpers shared by the tests. a header, so the test/*.cpp glob doesn't turn it into a test of its own
+
+    // wall clock seconds fn() takes
+template <typename F>
+double timeSeconds(F&& fn) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+    // same voxels at the same positions. both iterate in ChunkMap order, so equal contents means equal sequences
+inline bool sameVoxels(const voxelforge::VoxelObject& a, const voxelforge::VoxelObject& b) {
+    if (a.getChunks().size() != b.getChunks().size()) return false;
+
+    auto ra = a.voxels(), rb = b.voxels();
+    auto ia = ra.begin(), ib = rb.begin();
+    for (; ia != ra.end() && ib != rb.end(); ++ia, ++ib) {
+        if ((*ia).position != (*ib).position || (*ia).data != (*ib).data) return false;
+    }
+    return ia == ra.end() && ib == rb.end();
+}
+
+    // the terrain of test_voxel_raytrace.cpp frozen at t = 0, 1024 x 1024 columns for an object of 64 x 1 x 64 chunks.
+    // height of the column at (x, z), at most 12 voxels
+inline float terrainHeight(int x, int z) {
+    return 12.0 * (0.5 + 0.5 * glm::perlin(glm::vec3(x, z, 0.0f) / 16.0f));
+}
+
+    // calls fn(position, high) for every terrain voxel in the columns [lo, hi) (x, z), `high` in the columns higher than 6.
+    // returns the number of voxels
+template <typename F>
+uint64_t forEachTerrainVoxel(F&& fn, glm::ivec2 lo = glm::ivec2(0), glm::ivec2 hi = glm::ivec2(16 * 64)) {
+    uint64_t count = 0;
+    for (int x = lo.x; x < hi.x; x++) {
+        for (int z = lo.y; z < hi.y; z++) {
+            float height = terrainHeight(x, z);
+            for (int i = 0; i < height; i++) {
+                fn(glm::uvec3(x, i, z), height > 6);
+                count++;
+            }
+        }
+    }
+    return count;
+}
+
+    // the terrain over as much of it as the object covers, in one batch. material 1 in the high columns, 0 elsewhere
+inline void fillTerrain(voxelforge::VoxelObject& object) {
+    voxelforge::VoxelEditBatch batch;
+    glm::ivec2 hi = glm::min(glm::ivec2(object.size().x, object.size().z) * 16, glm::ivec2(16 * 64));
+    forEachTerrainVoxel([&](glm::uvec3 p, bool high) { batch.set(p, voxelforge::VoxelData(glm::vec3(0.0, 1.0, 0.0), high)); }, glm::ivec2(0), hi);
+    object.apply(batch);
+}
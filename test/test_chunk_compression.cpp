@@ -0,0 +1,144 @@
+#include <vforge/vforge.hpp>
+#include <vforge/vox_file.hpp>
+#include <glm/glm.hpp>
+#include <iostream>
+#include <vector>
+#include "bench.hpp"
+
+    // get() everywhere and forEachVoxel() have to agree with the uncompressed copy too
+static bool sameEverywhere(const voxelforge::VoxelObject& a, const voxelforge::VoxelObject& b) {
+    if (!sameVoxels(a, b)) return false;
+
+    glm::uvec3 extent = a.size() * 16u;
+    for (unsigned int z = 0; z < extent.z; z++)
+    for (unsigned int y = 0; y < extent.y; y++)
+    for (unsigned int x = 0; x < extent.x; x++) {
+        if (a.get(glm::uvec3(x, y, z)) != b.get(glm::uvec3(x, y, z))) return false;
+    }
+
+    std::vector<voxelforge::VoxelData> fromA, fromB;
+    a.forEachVoxel([&](glm::uvec3, const voxelforge::VoxelData& voxel) { fromA.push_back(voxel); });
+    b.forEachVoxel([&](glm::uvec3, const voxelforge::VoxelData& voxel) { fromB.push_back(voxel); });
+    return fromA == fromB;
+}
+
+    // chunk x holds half its voxels drawn from distinct[x] values: one encoding and index width per chunk, then a
+    // single voxel that is cheaper left as it is
+static bool testEncodings() {
+    const unsigned int distinct[] = { 1, 2, 4, 16, 200, 1000 };
+    const unsigned int expectedBits[] = { 0, 1, 2, 4, 8 };
+    voxelforge::VoxelObject object(glm::uvec3(7, 1, 1)), reference(glm::uvec3(7, 1, 1));
+
+    uint32_t seed = 22;
+    auto next = [&]() { return seed = seed * 1664525u + 1013904223u; };
+    auto edit = [&](glm::uvec3 p, bool set, uint32_t value) {
+        voxelforge::VoxelData voxel(glm::normalize(glm::vec3(value % 3, 1.0f, value % 5)), value / 7);
+        if (set) {
+            object.set(p, voxel);
+            reference.set(p, voxel);
+        } else {
+            object.clear(p);
+            reference.clear(p);
+        }
+    };
+    for (unsigned int chunk = 0; chunk < 6; chunk++) {
+        for (unsigned int i = 0; i < 4096; i++) {
+            if (next() >> 31) edit(glm::uvec3(chunk * 16 + i % 16, i / 16 % 16, i / 256), true, (next() >> 8) % distinct[chunk]);
+        }
+    }
+    edit(glm::uvec3(6 * 16 + 3, 5, 7), true, 9);
+
+    object.compress();
+    for (unsigned int chunk = 0; chunk < 7; chunk++) {
+        const voxelforge::VoxelChunk& c = *object.getChunks().find(glm::uvec3(chunk, 0, 0))->second;
+        if (chunk < 5) {
+            auto encoding = chunk == 0 ? voxelforge::VoxelChunk::Encoding::Uniform : voxelforge::VoxelChunk::Encoding::Palette;
+            if (c.getEncoding() != encoding || c.getPalette()->bits != expectedBits[chunk] || c.getPalette()->values.size() != distinct[chunk]) return false;
+        } else if (c.getEncoding() != voxelforge::VoxelChunk::Encoding::Raw) {
+            return false;
+        }
+    }
+    if (!sameEverywhere(object, reference) || object.memoryUsage() >= reference.memoryUsage()) return false;
+
+        // edits decode what they touch and leave the chunk Raw, the next compress() picks it up again
+    for (int i = 0; i < 3000; i++) {
+        glm::uvec3 p(next() % 112, (next() >> 8) % 16, (next() >> 16) % 16);
+        edit(p, i % 3 != 0, (next() >> 8) % 4);
+        if (i % 1000 == 999) {
+            if (!sameEverywhere(object, reference)) return false;
+            object.compress();
+            if (!sameEverywhere(object, reference)) return false;
+        }
+    }
+    if (object.getChunks().find(glm::uvec3(0, 0, 0))->second->getEncoding() != voxelforge::VoxelChunk::Encoding::Palette) return false;
+
+        // whole subchunks overwritten through apply() and whole chunks replaced
+    voxelforge::VoxelData values[64];
+    for (unsigned int i = 0; i < 64; i++) values[i] = voxelforge::VoxelData(glm::vec3(0.0f, 1.0f, 0.0f), 3);
+    for (auto *target : { &object, &reference }) {
+        auto chunk = std::make_shared<voxelforge::VoxelChunk>();
+        object.getChunks().find(glm::uvec3(1, 0, 0))->second->forEachVoxel([&](glm::uvec3 p, const voxelforge::VoxelData& voxel) { chunk->set(p.x, p.y, p.z, voxel); });
+        chunk->apply(5, ~0ull, 0, values);
+        target->setChunk(glm::uvec3(2, 0, 0), chunk);
+    }
+    object.compress();
+    return sameEverywhere(object, reference);
+}
+
+static size_t countVoxels(const voxelforge::VoxelObject& object) {
+    size_t count = 0;
+    for (const auto& [position, chunk] : object.getChunks()) {
+        if (chunk) chunk->forEachSubChunk([&](glm::uvec3, const voxelforge::VoxelSubChunk& sub) { count += sub.size(); });
+    }
+    return count;
+}
+
+static void report(const char *name, const std::vector<std::shared_ptr<voxelforge::VoxelObject>>& objects) {
+    size_t voxels = 0, before = 0, after = 0;
+    size_t encodings[3] = {}, bits[9] = {};
+    double readRaw = 0.0, readCompressed = 0.0, compress = 0.0;
+    for (const auto& object : objects) {
+        voxels += countVoxels(*object);
+        before += object->memoryUsage();
+        uint64_t sum = 0;
+        auto read = [&]() { object->forEachVoxel([&](glm::uvec3, const voxelforge::VoxelData& voxel) { sum += voxel.matID; }); };
+
+        readRaw += timeSeconds(read);
+        compress += timeSeconds([&]() { object->compress(); });
+        readCompressed += timeSeconds(read);
+        after += object->memoryUsage();
+        for (const auto& [position, chunk] : object->getChunks()) {
+            if (!chunk) continue;
+            encodings[(int)chunk->getEncoding()]++;
+            if (chunk->getPalette()) bits[chunk->getPalette()->bits]++;
+        }
+        if (sum == 1) std::cout << std::endl;    // keeps the reads
+    }
+
+    std::cout << name << ": " << voxels << " voxels, " << (double)before / voxels << " -> " << (double)after / voxels << " bytes/voxel ("
+              << 100.0 * after / before << "%), compressed in " << compress * 1000.0 << " ms" << std::endl;
+    std::cout << "  chunks: " << encodings[0] << " raw, " << encodings[1] << " uniform, " << encodings[2] << " palette ("
+              << bits[1] << " 1-bit, " << bits[2] << " 2-bit, " << bits[4] << " 4-bit, " << bits[8] << " 8-bit)" << std::endl;
+    std::cout << "  forEachVoxel " << readRaw * 1000.0 << " -> " << readCompressed * 1000.0 << " ms" << std::endl;
+}
+
+static std::shared_ptr<voxelforge::VoxelObject> terrain() {
+    auto object = std::make_shared<voxelforge::VoxelObject>(glm::uvec3(64, 1, 64));
+    fillTerrain(*object);
+    return object;
+}
+
+int main() {
+    if (!testEncodings()) {
+        std::cerr << "compressed chunks don't read back as they were written" << std::endl;
+        return 1;
+    }
+    std::cout << "chunk compression OK" << std::endl;
+
+    report("terrain", { terrain() });
+    for (const char *model : { "models/Ak74.vox", "models/dragon.vox", "models/tiger1.vox" }) {
+        auto world = voxelforge::files::MagicaVoxelVOX(model).getWorld();
+        if (world) report(model, world->getObjects());
+    }
+    return 0;
+}
@@ -0,0 +1,228 @@
+#include <vforge/vforge.hpp>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "bench.hpp"
+
+    // the voxels of bench.hpp's fillTerrain(), for one column at a time
+static int columnHeight(int x, int y) {
+    return (int)std::ceil(terrainHeight(x, y));
+}
+
+static voxelforge::VoxelData columnVoxel(int height) {
+    return voxelforge::VoxelData(glm::vec3(0.0, 1.0, 0.0), height > 6);
+}
+
+    // the same terrain a chunk at a time, counting how often each chunk is asked for
+class TerrainGenerator : public voxelforge::ChunkGenerator {
+public:
+    explicit TerrainGenerator(glm::uvec3 dim) : dim(dim), calls(dim.x * dim.y * dim.z) {}
+
+    std::shared_ptr<voxelforge::VoxelChunk> generate(glm::uvec3 position) override {
+        this->calls[(position.z * this->dim.y + position.y) * this->dim.x + position.x]++;
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->order.push_back(position);
+        }
+        if (position.y > 0) return nullptr;
+
+        auto chunk = std::make_shared<voxelforge::VoxelChunk>();
+        for (unsigned int z = 0; z < 16; z++)
+        for (unsigned int x = 0; x < 16; x++) {
+            int height = columnHeight(position.x * 16 + x, position.z * 16 + z);
+            for (int i = 0; i < height; i++) chunk->set(x, i, z, columnVoxel(height));
+        }
+        return chunk;
+    }
+
+    int callsAt(glm::uvec3 position) const { return this->calls[(position.z * this->dim.y + position.y) * this->dim.x + position.x]; }
+    bool calledAtMostOnce() const {
+        for (const auto& c : this->calls) {
+            if (c > 1) return false;
+        }
+        return true;
+    }
+    size_t callCount() const {
+        size_t count = 0;
+        for (const auto& c : this->calls) count += c;
+        return count;
+    }
+    std::vector<glm::uvec3> getOrder() {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        return this->order;
+    }
+private:
+    glm::uvec3 dim;
+    std::vector<std::atomic<int>> calls;
+    std::mutex mutex;
+    std::vector<glm::uvec3> order;
+};
+
+    // the view of test_voxel_raytrace.cpp on its first frame, looking at the corner of the object at `center`
+static void renderFirstFrame(voxelforge::VoxelRenderer& renderer, const voxelforge::VoxelWorld& world, glm::vec3 center = glm::vec3(32, 0, 32)) {
+    glm::mat4 view = glm::lookAt(center + glm::vec3(2.0f, 1.5f, 0.0f) * 2.0f, center, glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), (float)renderer.width() / renderer.height(), 0.1f, 100.0f);
+    renderer.render(world, view, projection);
+}
+
+    // lookups, raycasts and edits see exactly what an eagerly filled object holds, each chunk is generated once
+static bool testLazy() {
+    const glm::uvec3 size(16, 2, 16);
+    auto reference = std::make_shared<voxelforge::VoxelObject>(size);
+    fillTerrain(*reference);
+    auto generator = std::make_shared<TerrainGenerator>(size);
+    auto object = std::make_shared<voxelforge::VoxelObject>(size);
+    object->setGenerator(generator, 2);
+
+        // chunks replaced whole are never generated
+    for (auto *target : { object.get(), reference.get() }) {
+        auto chunk = std::make_shared<voxelforge::VoxelChunk>();
+        chunk->set(1, 2, 3, voxelforge::VoxelData(glm::vec3(0.0f, 1.0f, 0.0f), 5));
+        target->setChunk(glm::uvec3(9, 0, 9), chunk);
+    }
+
+    uint32_t seed = 25;
+    auto next = [&]() { return seed = seed * 1664525u + 1013904223u; };
+    for (int i = 0; i < 300; i++) {
+        glm::uvec3 p(next() % 256, (next() >> 8) % 16, (next() >> 16) % 256);
+        if (object->get(p) != reference->get(p)) return false;
+    }
+
+        // rays from several threads at once, through both kernels
+    std::vector<voxelforge::Ray> rays;
+    for (int i = 0; i < 4000; i++) {
+        glm::vec3 origin(-0.5f + (next() % 1000) / 1000.0f * 3.0f, 0.8f, 6.0f);
+        glm::vec3 target((next() % 1000) / 1000.0f * 16.0f - 8.0f, -1.0f, (next() % 1000) / 1000.0f * 16.0f - 8.0f);
+        rays.emplace_back(origin, target - origin);
+    }
+    for (auto kernel : { voxelforge::RaycastKernel::Scalar, voxelforge::RaycastKernel::Auto }) {
+        auto hits = object->raycast(rays, 6, kernel);
+        auto expected = reference->raycast(rays, 1, kernel);
+        for (size_t i = 0; i < rays.size(); i++) {
+            if (hits[i].hit != expected[i].hit || hits[i].voxel != expected[i].voxel || hits[i].data != expected[i].data) return false;
+        }
+    }
+    if (object->getGeneration()->getRemaining() == 0) return false;
+
+        // edits go to the generated chunks
+    for (auto *target : { object.get(), reference.get() }) {
+        target->set(glm::uvec3(200, 20, 200), voxelforge::VoxelData(glm::vec3(0.0f, 1.0f, 0.0f), 9));
+        target->clear(glm::uvec3(3, 2, 250));
+        voxelforge::VoxelEditBatch batch;
+        for (unsigned int x = 0; x < 40; x++) batch.set(glm::uvec3(100 + x, 3, 180), voxelforge::VoxelData(glm::vec3(0.0f, 0.0f, 1.0f), 4));
+        target->apply(batch);
+        std::vector<uint8_t> grid(20 * 8 * 40, 7);
+        target->importDense(grid.data(), glm::uvec3(20, 8, 40), glm::uvec3(150, 2, 16));
+    }
+    std::vector<uint8_t> exported(24 * 16 * 24), expected(exported.size());
+    object->exportDense(exported.data(), glm::uvec3(24, 16, 24), glm::uvec3(60, 0, 90));
+    reference->exportDense(expected.data(), glm::uvec3(24, 16, 24), glm::uvec3(60, 0, 90));
+    if (exported != expected) return false;
+
+        // the frame renders the same from a half generated object
+    voxelforge::VoxelWorld lazyWorld, eagerWorld;
+    lazyWorld.addObject(object);
+    eagerWorld.addObject(reference);
+    voxelforge::VoxelRenderer lazy(96, 64), eager(96, 64);
+    lazy.setWorkerCount(6);
+    renderFirstFrame(lazy, lazyWorld, glm::vec3(8, 0, 8));
+    renderFirstFrame(eager, eagerWorld, glm::vec3(8, 0, 8));
+    if (lazy.getColor() != eager.getColor() || lazy.getDepth() != eager.getDepth()) return false;
+
+    object->generateAll();
+    return object->getGeneration()->getRemaining() == 0 && generator->calledAtMostOnce() &&
+           generator->callsAt(glm::uvec3(9, 0, 9)) == 0 && sameVoxels(*object, *reference);
+}
+
+    // the background thread works nearest first, concurrent edits and clear() keep their meaning
+static bool testBackground() {
+    const glm::uvec3 size(12, 1, 12);
+    auto generator = std::make_shared<TerrainGenerator>(size);
+    voxelforge::VoxelObject object(size), reference(size);
+    fillTerrain(reference);
+    object.setGenerator(generator, 1);
+
+    object.requestChunks(glm::uvec3(88, 0, 88), 3);
+    for (int i = 0; i < 2000 && generator->callCount() < 49; i++) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    std::vector<glm::uvec3> order = generator->getOrder();
+    if (order.size() != 49) return false;
+    for (size_t i = 1; i < order.size(); i++) {
+        glm::ivec3 a = glm::ivec3(order[i - 1]) - 5, b = glm::ivec3(order[i]) - 5;
+        if (a.x * a.x + a.z * a.z > b.x * b.x + b.z * b.z) return false;
+    }
+
+    object.beginConcurrentEdits();
+    std::vector<std::thread> threads;
+    for (unsigned int t = 0; t < 4; t++) {
+        threads.emplace_back([&, t]() {
+            for (unsigned int x = t; x < 192; x += 4) object.set(glm::uvec3(x, 14, 100), voxelforge::VoxelData(glm::vec3(0.0f, 1.0f, 0.0f), 3));
+        });
+    }
+    for (auto& thread : threads) thread.join();
+    object.endConcurrentEdits();
+    for (unsigned int x = 0; x < 192; x++) reference.set(glm::uvec3(x, 14, 100), voxelforge::VoxelData(glm::vec3(0.0f, 1.0f, 0.0f), 3));
+
+    object.generateAll();
+    if (!sameVoxels(object, reference) || !generator->calledAtMostOnce()) return false;
+
+    object.clear();
+    object.generateAll();
+    return object.getChunks().size() == 0 && !object.get(glm::uvec3(5, 1, 5));
+}
+
+    // time to the first frame of test_voxel_raytrace.cpp, traced on the CPU: filling all 1024 x 1024 columns first,
+    // against generating what the frame's rays reach
+static void benchmark() {
+    const glm::uvec3 size(64, 1, 64);
+    const unsigned int width = 480, height = 270;
+
+    auto eager = std::make_shared<voxelforge::VoxelObject>(size);
+    voxelforge::VoxelWorld eagerWorld;
+    eagerWorld.addObject(eager);
+    voxelforge::VoxelRenderer eagerRenderer(width, height);
+    double fill = timeSeconds([&]() { fillTerrain(*eager); });
+    double eagerFrame = timeSeconds([&]() { renderFirstFrame(eagerRenderer, eagerWorld); });
+
+    auto generator = std::make_shared<TerrainGenerator>(size);
+    auto lazy = std::make_shared<voxelforge::VoxelObject>(size);
+    voxelforge::VoxelWorld lazyWorld;
+    lazyWorld.addObject(lazy);
+    voxelforge::VoxelRenderer lazyRenderer(width, height);
+    double lazyFrame = timeSeconds([&]() {
+        lazy->setGenerator(generator);
+        renderFirstFrame(lazyRenderer, lazyWorld);
+    });
+    size_t firstFrameChunks = generator->callCount();
+    double secondFrame = timeSeconds([&]() { renderFirstFrame(lazyRenderer, lazyWorld); });
+    double rest = timeSeconds([&]() { lazy->generateAll(); });
+    bool same = lazyRenderer.getColor() == eagerRenderer.getColor() && sameVoxels(*lazy, *eager);
+
+    std::cout << "first frame of the raytrace test (" << width << " x " << height << " rays, " << std::thread::hardware_concurrency() << " hardware threads)" << std::endl;
+    std::cout << "  eager: fill " << fill * 1000.0 << " ms + frame " << eagerFrame * 1000.0 << " ms = " << (fill + eagerFrame) * 1000.0 << " ms, "
+              << eager->getChunks().size() << " chunks" << std::endl;
+    std::cout << "  lazy:  first frame " << lazyFrame * 1000.0 << " ms generating " << firstFrameChunks << " of " << size.x * size.y * size.z
+              << " chunks, " << (fill + eagerFrame) / lazyFrame << "x sooner; next frame " << secondFrame * 1000.0 << " ms" << std::endl;
+    std::cout << "  rest generated in " << rest * 1000.0 << " ms, " << lazy->getGeneration()->getStats().seconds * 1000.0
+              << " ms in the generator" << (same ? "" : " (MISMATCH)") << std::endl;
+}
+
+int main() {
+    if (!testLazy()) {
+        std::cerr << "generated object doesn't match the one filled up front" << std::endl;
+        return 1;
+    }
+    if (!testBackground()) {
+        std::cerr << "background generation broke order or edits" << std::endl;
+        return 1;
+    }
+    std::cout << "chunk generator OK" << std::endl;
+
+    benchmark();
+    return 0;
+}
@@ -0,0 +1,145 @@
+#include <vforge/vforge.hpp>
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <iostream>
+#include <random>
+#include <unordered_map>
+#include "bench.hpp"
+
+using ReferenceMap = std::unordered_map<glm::uvec3, std::shared_ptr<voxelforge::VoxelChunk>, voxelforge::internal::uvec3Hash>;
+
+static bool sameContents(const voxelforge::ChunkMap& map, const ReferenceMap& reference) {
+    if (map.size() != reference.size()) return false;
+
+    size_t visited = 0;
+    for (const auto& [position, chunk] : map) {
+        auto it = reference.find(position);
+        if (it == reference.end() || it->second != chunk) return false;
+        visited++;
+    }
+    for (const auto& [position, chunk] : reference) {
+        auto it = map.find(position);
+        if (it == map.end() || it->second != chunk) return false;
+    }
+    return visited == reference.size();
+}
+
+    // both storages against std::unordered_map, positions partly outside the bounds to hit the open addressing table
+static bool testRandomOperations(glm::uvec3 bounds) {
+    voxelforge::ChunkMap map(bounds);
+    ReferenceMap reference;
+    std::mt19937 rng(7);
+    std::vector<std::shared_ptr<voxelforge::VoxelChunk>> chunks;
+    for (int i = 0; i < 64; i++) chunks.push_back(std::make_shared<voxelforge::VoxelChunk>());
+
+    for (int i = 0; i < 200000; i++) {
+        glm::uvec3 p(rng() % 40, rng() % 40, rng() % 40);
+        switch (rng() % 4) {
+        case 0:
+        case 1: {
+            auto chunk = chunks[rng() % chunks.size()];
+            map[p] = chunk;
+            reference[p] = chunk;
+            break;
+        }
+        case 2:
+            if (map.erase(p) != reference.erase(p)) return false;
+            break;
+        case 3: {
+            auto it = map.find(p);
+            if (it != map.end()) map.erase(it);
+            reference.erase(p);
+            break;
+        }
+        }
+        if (i % 20000 == 0 && !sameContents(map, reference)) return false;
+    }
+    if (!sameContents(map, reference)) return false;
+
+    voxelforge::ChunkMap copy = map;
+    map.clear();
+    return map.empty() && map.begin() == map.end() && sameContents(copy, reference);
+}
+
+static bool testZOrder(glm::uvec3 bounds, glm::uvec3 range) {
+    voxelforge::ChunkMap map(bounds);
+    std::vector<glm::uvec3> expected;
+    for (unsigned int x = 0; x < range.x; x++)
+    for (unsigned int y = 0; y < range.y; y++)
+    for (unsigned int z = 0; z < range.z; z++) {
+        map[glm::uvec3(x, y, z)] = std::make_shared<voxelforge::VoxelChunk>();
+        expected.push_back(glm::uvec3(x, y, z));
+    }
+    std::sort(expected.begin(), expected.end(), voxelforge::ChunkMap::zLess);
+
+        // dense entries come first, each part is in Z-order on its own
+    std::vector<glm::uvec3> inside, outside;
+    for (glm::uvec3 p : expected) {
+        bool in = p.x < bounds.x && p.y < bounds.y && p.z < bounds.z;
+        (in && map.isDense() ? inside : outside).push_back(p);
+    }
+    inside.insert(inside.end(), outside.begin(), outside.end());
+
+    size_t i = 0;
+    for (const auto& entry : map) {
+        if (i >= inside.size() || entry.first != inside[i]) return false;
+        i++;
+    }
+    return i == inside.size();
+}
+
+template <typename Map>
+static void benchmark(const char *name, Map&& map, const std::vector<glm::uvec3>& positions, const std::vector<glm::uvec3>& queries) {
+    auto chunk = std::make_shared<voxelforge::VoxelChunk>();
+    double insertTime = timeSeconds([&]() {
+        for (glm::uvec3 p : positions) map[p] = chunk;
+    });
+
+    size_t found = 0;
+    double lookupTime = timeSeconds([&]() {
+        for (int r = 0; r < 8; r++) {
+            for (glm::uvec3 p : queries) found += map.find(p) != map.end();
+        }
+    });
+
+    size_t visited = 0;
+    double iterateTime = timeSeconds([&]() {
+        for (int r = 0; r < 8; r++) {
+            for (const auto& entry : map) visited += entry.second != nullptr;
+        }
+    });
+
+    std::cout << name << ": insert " << insertTime * 1e9 / positions.size() << " ns, lookup " << lookupTime * 1e9 / (8 * queries.size())
+              << " ns, iterate " << iterateTime * 1e9 / (8 * positions.size()) << " ns/chunk (" << found / 8 << " hits, " << visited / 8 << " visited)" << std::endl;
+}
+
+int main() {
+    if (!testRandomOperations(glm::uvec3(32, 32, 32)) || !testRandomOperations(glm::uvec3(0))) {
+        std::cerr << "chunk map doesn't match std::unordered_map" << std::endl;
+        return 1;
+    }
+    if (!testZOrder(glm::uvec3(8, 4, 16), glm::uvec3(8, 4, 16)) || !testZOrder(glm::uvec3(0), glm::uvec3(12, 5, 9))
+        || !testZOrder(glm::uvec3(6, 6, 6), glm::uvec3(9, 9, 9))) {
+        std::cerr << "chunk map isn't iterated in Z-order" << std::endl;
+        return 1;
+    }
+
+        // a 64 x 4 x 64 chunk terrain, half the columns filled, queried at random with about half misses
+    glm::uvec3 bounds(64, 4, 64);
+    std::mt19937 rng(3);
+    std::vector<glm::uvec3> positions, queries;
+    for (unsigned int x = 0; x < bounds.x; x++)
+    for (unsigned int z = 0; z < bounds.z; z++) {
+        unsigned int height = rng() % (2 * bounds.y);
+        for (unsigned int y = 0; y < std::min(height, bounds.y); y++) positions.push_back(glm::uvec3(x, y, z));
+    }
+    std::shuffle(positions.begin(), positions.end(), rng);
+    for (int i = 0; i < 1000000; i++) queries.push_back(glm::uvec3(rng() % bounds.x, rng() % bounds.y, rng() % bounds.z));
+
+    std::cout << positions.size() << " chunks, " << queries.size() << " queries" << std::endl;
+    benchmark("std::unordered_map", ReferenceMap(), positions, queries);
+    benchmark("dense Morton      ", voxelforge::ChunkMap(bounds), positions, queries);
+    benchmark("open addressing   ", voxelforge::ChunkMap(), positions, queries);
+
+    return 0;
+}
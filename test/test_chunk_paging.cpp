@@ -0,0 +1,217 @@
+#include <vforge/vforge.hpp>
+#include <glm/glm.hpp>
+#include <glm/gtc/noise.hpp>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include "bench.hpp"
+
+    // terrain whose materials vary voxel to voxel, so chunks need 8-bit palettes and don't compress away
+static int height(unsigned int x, unsigned int z, unsigned int top) {
+    return (int)(top * (0.5f + 0.45f * glm::perlin(glm::vec3(x, z, 0.0f) / 48.0f)));
+}
+
+static voxelforge::VoxelData material(glm::uvec3 p) {
+    return voxelforge::VoxelData(glm::vec3(0.0f, 1.0f, 0.0f), 1 + (p.x * 7 + p.y * 3 + p.z * 5) % 37);
+}
+
+    // every encoding survives a trip through a spill record, and damaged records are refused
+static bool testRecords() {
+    for (unsigned int distinct : { 1u, 3u, 200u, 0u }) {
+        voxelforge::VoxelChunk chunk;
+        for (unsigned int i = 0; i < 4096; i += 1 + i % 5) {
+            uint32_t id = distinct ? i % distinct : i;
+            chunk.set(i % 16, i / 16 % 16, i / 256, voxelforge::VoxelData(glm::vec3(0.0f, 0.0f, 1.0f), id));
+        }
+        chunk.compress();
+
+        std::vector<uint8_t> record;
+        voxelforge::ChunkPager::encode(chunk, record);
+        auto decoded = voxelforge::ChunkPager::decode(record.data(), record.size());
+        if (!decoded || decoded->getBitmask() != chunk.getBitmask() || decoded->getEncoding() != chunk.getEncoding()) return false;
+        for (unsigned int i = 0; i < 4096; i++) {
+            if (decoded->get(i % 16, i / 16 % 16, i / 256) != chunk.get(i % 16, i / 16 % 16, i / 256)) return false;
+        }
+
+        if (voxelforge::ChunkPager::decode(record.data(), record.size() - 1)) return false;
+        record.push_back(0);
+        if (voxelforge::ChunkPager::decode(record.data(), record.size())) return false;
+    }
+    return true;
+}
+
+    // a world six times the budget, edited through every paged entry point against a copy that keeps everything in memory
+static bool testPaging() {
+    const glm::uvec3 size(24, 2, 24);
+    voxelforge::VoxelObject reference(size), paged(size);
+    for (unsigned int x = 0; x < size.x * 16; x++)
+    for (unsigned int z = 0; z < size.z * 16; z++)
+    for (int y = 0; y < height(x, z, 32); y++) reference.set(glm::uvec3(x, y, z), material(glm::uvec3(x, y, z)));
+    reference.compress();
+
+    const size_t budget = reference.memoryUsage() / 6;
+    if (!paged.enablePaging(budget)) return false;
+    const voxelforge::ChunkPager& pager = *paged.getPager();
+
+    size_t largest = 0;
+    for (const auto& [position, chunk] : reference.getChunks()) largest = std::max(largest, chunk->memoryUsage() * 2);
+    for (unsigned int x = 0; x < size.x * 16; x++) {
+        for (unsigned int z = 0; z < size.z * 16; z++)
+        for (int y = 0; y < height(x, z, 32); y++) paged.set(glm::uvec3(x, y, z), material(glm::uvec3(x, y, z)));
+        if (pager.getResidentBytes() > budget + largest) return false;
+    }
+    if (pager.getStats().evictions == 0 || pager.getPagedOutCount() == 0) return false;
+
+        // reads in an order that keeps evicting, then edits of every kind
+    uint32_t seed = 23;
+    auto next = [&]() { return seed = seed * 1664525u + 1013904223u; };
+    for (int i = 0; i < 200000; i++) {
+        glm::uvec3 p(next() % (size.x * 16), (next() >> 8) % (size.y * 16), (next() >> 16) % (size.z * 16));
+        if (paged.get(p) != reference.get(p)) return false;
+    }
+    for (int i = 0; i < 50000; i++) {
+        glm::uvec3 p(next() % (size.x * 16), (next() >> 8) % (size.y * 16), (next() >> 16) % (size.z * 16));
+        if (i % 3 == 0) {
+            paged.clear(p);
+            reference.clear(p);
+        } else {
+            paged.set(p, voxelforge::VoxelData(glm::vec3(1.0f, 0.0f, 0.0f), i % 50));
+            reference.set(p, voxelforge::VoxelData(glm::vec3(1.0f, 0.0f, 0.0f), i % 50));
+        }
+    }
+    voxelforge::VoxelEditBatch batch, referenceBatch;
+    for (int i = 0; i < 20000; i++) {
+        glm::uvec3 p(next() % (size.x * 16), (next() >> 8) % (size.y * 16), (next() >> 16) % (size.z * 16));
+        batch.set(p, voxelforge::VoxelData(glm::vec3(0.0f, 0.0f, 1.0f), 60));
+        referenceBatch.set(p, voxelforge::VoxelData(glm::vec3(0.0f, 0.0f, 1.0f), 60));
+    }
+    paged.apply(batch);
+    reference.apply(referenceBatch);
+
+    std::vector<uint8_t> grid(40 * 20 * 40);
+    for (size_t i = 0; i < grid.size(); i++) grid[i] = next() % 3 == 0 ? 0 : 1 + (next() >> 8) % 9;
+    paged.importDense(grid.data(), glm::uvec3(40, 20, 40), glm::uvec3(100, 3, 250));
+    reference.importDense(grid.data(), glm::uvec3(40, 20, 40), glm::uvec3(100, 3, 250));
+    std::vector<uint8_t> exported(grid.size()), expected(grid.size());
+    paged.exportDense(exported.data(), glm::uvec3(40, 20, 40), glm::uvec3(3, 0, 7));
+    reference.exportDense(expected.data(), glm::uvec3(40, 20, 40), glm::uvec3(3, 0, 7));
+    if (exported != expected) return false;
+
+        // chunks removed while paged out stay removed
+    for (unsigned int x = 0; x < size.x; x += 5) {
+        paged.setChunk(glm::uvec3(x, 0, 3), nullptr);
+        reference.setChunk(glm::uvec3(x, 0, 3), nullptr);
+    }
+
+        // prefetched chunks arrive without faults
+    paged.prefetch(glm::uvec3(8, 8, 8), 3);
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    paged.prefetch(glm::uvec3(8, 8, 8), 3);
+    size_t faults = pager.getStats().faults;
+    for (unsigned int x = 0; x < 32; x++) paged.get(glm::uvec3(x, 8, 8));
+    if (pager.getStats().prefetched == 0 || pager.getStats().faults != faults) return false;
+
+    paged.disablePaging();
+    if (!sameVoxels(paged, reference)) return false;
+
+    paged.enablePaging(budget);
+    paged.clear();
+    return paged.getPager()->getPagedOutCount() == 0 && paged.getChunks().size() == 0 && !paged.get(glm::uvec3(5));
+}
+
+    // saving writes the paged-out chunks too, without paging them in
+static bool testSave() {
+    const glm::uvec3 size(12, 2, 12);
+    auto reference = std::make_shared<voxelforge::VoxelObject>(size);
+    auto paged = std::make_shared<voxelforge::VoxelObject>(size);
+    for (unsigned int x = 0; x < size.x * 16; x++)
+    for (unsigned int z = 0; z < size.z * 16; z++)
+    for (int y = 0; y < height(x, z, 32); y++) reference->set(glm::uvec3(x, y, z), material(glm::uvec3(x, y, z)));
+    reference->compress();
+
+    if (!paged->enablePaging(reference->memoryUsage() / 6)) return false;
+    reference->forEachVoxel([&](glm::uvec3 p, const voxelforge::VoxelData& voxel) { paged->set(p, voxel); });
+    size_t pagedOut = paged->getPager()->getPagedOutCount();
+    if (pagedOut == 0) return false;
+
+    const char *path = "test_chunk_paging.vfg";
+    voxelforge::VoxelWorld world;
+    world.addObject(paged);
+    if (!voxelforge::files::save_native_file(path, world) || paged->getPager()->getPagedOutCount() != pagedOut) return false;
+
+    auto loaded = voxelforge::files::load_native_file(path);
+    std::remove(path);
+    return loaded && loaded->getObjects().size() == 1 && sameVoxels(*loaded->getObjects()[0], *reference);
+}
+
+    // a focus walking across a 1024 x 64 x 1024 world with a budget several times smaller, reading around itself
+static void benchmark() {
+    const glm::uvec3 size(64, 4, 64);
+    const size_t budget = 24 << 20;
+    voxelforge::VoxelObject object(size);
+    object.enablePaging(budget);
+    const voxelforge::ChunkPager& pager = *object.getPager();
+
+    size_t voxels = 0;
+    double fill = timeSeconds([&]() {
+        for (unsigned int x = 0; x < size.x * 16; x++)
+        for (unsigned int z = 0; z < size.z * 16; z++) {
+            int top = height(x, z, 64);
+            for (int y = 0; y < top; y++) object.set(glm::uvec3(x, y, z), material(glm::uvec3(x, y, z)));
+            voxels += top;
+        }
+    });
+    size_t resident = pager.getResidentBytes(), pagedOut = pager.getPagedOutCount(), chunks = pagedOut + pager.getResidentCount();
+    std::cout << voxels << " voxels in " << chunks << " chunks, " << budget / (1 << 20) << " MiB budget, filled in " << fill << " s" << std::endl;
+    std::cout << "  resident " << resident / (1 << 20) << " MiB in " << pager.getResidentCount() << " chunks, " << pagedOut << " paged out, "
+              << pager.getStats().bytesOut / (1 << 20) << " MiB written; about " << (double)chunks / pager.getResidentCount()
+              << "x the chunks that fit the budget" << std::endl;
+
+    for (bool prefetch : { false, true }) {
+        const voxelforge::ChunkPager::Stats before = pager.getStats();
+        uint32_t seed = 24;
+        uint64_t found = 0;
+        double seconds = timeSeconds([&]() {
+            for (int step = 0; step < 200; step++) {
+                glm::uvec3 focus(32 + step * 4.5f, 40, 32 + step * 4.5f);
+                if (prefetch) object.prefetch(focus + glm::uvec3(40, 0, 40), 2);
+                for (int i = 0; i < 5000; i++) {
+                    seed = seed * 1664525u + 1013904223u;
+                    glm::uvec3 p = focus + glm::uvec3(seed % 64, (seed >> 8) % 24, (seed >> 16) % 64) - glm::uvec3(32, 12, 32);
+                    found += (bool)object.get(p);
+                }
+            }
+        });
+
+        const auto& stats = pager.getStats();
+        size_t hits = stats.hits - before.hits, faults = stats.faults - before.faults;
+        std::cout << (prefetch ? "with prefetch:    " : "without prefetch: ") << seconds * 1000.0 << " ms, hit rate "
+                  << 100.0 * hits / (hits + faults) << "% (" << faults << " faults), fault latency "
+                  << (faults ? (stats.faultSeconds - before.faultSeconds) / faults * 1e6 : 0.0) << " us mean, "
+                  << stats.prefetched - before.prefetched << " chunks prefetched, " << (stats.bytesIn - before.bytesIn) / 1024 << " KiB in, "
+                  << (stats.bytesOut - before.bytesOut) / 1024 << " KiB out, " << stats.evictions - before.evictions << " evictions" << std::endl;
+        if (found == 0) std::cout << std::endl;
+    }
+    std::cout << "  worst fault " << pager.getStats().maxFaultSeconds * 1e6 << " us" << std::endl;
+}
+
+int main() {
+    if (!testRecords()) {
+        std::cerr << "spill records don't decode to the chunk they were made from" << std::endl;
+        return 1;
+    }
+    if (!testPaging()) {
+        std::cerr << "paged object doesn't match the one kept in memory" << std::endl;
+        return 1;
+    }
+    if (!testSave()) {
+        std::cerr << "saved paged object doesn't match the one kept in memory" << std::endl;
+        return 1;
+    }
+    std::cout << "chunk paging OK" << std::endl;
+
+    benchmark();
+    return 0;
+}
@@ -0,0 +1,133 @@
+#include <vforge/vforge.hpp>
+#include <glm/glm.hpp>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include "bench.hpp"
+
+    // runs fn(thread) on `threads` threads at once
+template <typename F>
+static void onThreads(unsigned int threads, F&& fn) {
+    std::vector<std::thread> running;
+    for (unsigned int t = 0; t < threads; t++) running.emplace_back([&fn, t]() { fn(t); });
+    for (auto& thread : running) thread.join();
+}
+
+    // edit i of the stress test, the same for every run
+static void stressEdit(voxelforge::VoxelObject& object, uint32_t i) {
+    uint32_t hash = i * 2654435761u;
+    glm::uvec3 p(hash % 96, (hash >> 8) % 48, (hash >> 16) % 96);
+    if (hash >> 30 == 0) object.clear(p);
+    else object.set(p, voxelforge::VoxelData(glm::vec3(0.0f, 1.0f, 0.0f), 1 + i % 7));
+}
+
+    // threads take turns on every chunk: thread t makes the edits along x == t (mod threads), so each chunk is edited by
+    // all of them. later edits of a voxel have to win on each thread, which holds because a voxel has a single x
+static bool testStress() {
+    const unsigned int threads = 8, edits = 400000;
+    voxelforge::VoxelObject reference(glm::uvec3(6, 3, 6)), object(glm::uvec3(6, 3, 6));
+
+    auto editsOf = [&](unsigned int t, auto&& fn) {
+        for (uint32_t i = 0; i < edits; i++) {
+            if ((i * 2654435761u) % 96 % threads == t) fn(i);
+        }
+    };
+    for (unsigned int t = 0; t < threads; t++) editsOf(t, [&](uint32_t i) { stressEdit(reference, i); });
+
+    object.beginConcurrentEdits();
+    onThreads(threads, [&](unsigned int t) { editsOf(t, [&](uint32_t i) { stressEdit(object, i); }); });
+        // and one chunk emptied again by all of them
+    onThreads(threads, [&](unsigned int t) {
+        for (unsigned int i = t; i < 4096; i += threads) object.clear(glm::uvec3(32 + i % 16, 16 + i / 16 % 16, 48 + i / 256));
+    });
+    object.endConcurrentEdits();
+    for (unsigned int i = 0; i < 4096; i++) reference.clear(glm::uvec3(32 + i % 16, 16 + i / 16 % 16, 48 + i / 256));
+
+    return sameVoxels(object, reference) && object.getChunks().find(glm::uvec3(2, 1, 3)) == object.getChunks().end();
+}
+
+    // everything derived from the chunks catches up with concurrent edits: level of detail, distance field, compression
+static bool testDirty() {
+    const glm::uvec3 size(8, 2, 8);
+    voxelforge::VoxelObject object(size);
+    for (unsigned int x = 0; x < size.x * 16; x++)
+    for (unsigned int z = 0; z < size.z * 16; z++)
+    for (unsigned int y = 0; y < 10 + x % 7; y++) object.set(glm::uvec3(x, y, z), voxelforge::VoxelData(glm::vec3(0.0f, 1.0f, 0.0f), 1));
+    object.updateLOD(2);
+    object.updateDistanceField();
+    object.compress();
+
+    object.beginConcurrentEdits();
+    onThreads(4, [&](unsigned int t) {
+            // a pillar per thread on chunks of their own, plus a hole dug by each in a shared chunk
+        for (unsigned int y = 0; y < 30; y++)
+        for (unsigned int i = 0; i < 4; i++) object.set(glm::uvec3(20 + 30 * t + i, y, 90 - 20 * t), voxelforge::VoxelData(glm::vec3(1.0f, 0.0f, 0.0f), 2 + t));
+        for (unsigned int y = 0; y < 10; y++) object.clear(glm::uvec3(66 + t, y, 66));
+    });
+    object.endConcurrentEdits();
+    object.updateLOD(2);
+    object.updateDistanceField();
+    object.compress();
+
+    voxelforge::VoxelObject fresh(size);
+    object.forEachVoxel([&](glm::uvec3 p, const voxelforge::VoxelData& voxel) { fresh.set(p, voxel); });
+    fresh.updateLOD(2);
+    fresh.updateDistanceField();
+    fresh.compress();
+
+    for (unsigned int level = 1; level < 3; level++) {
+        if (!sameVoxels(object.getLOD(level), fresh.getLOD(level))) return false;
+    }
+    const voxelforge::DistanceField& field = *object.getDistanceField();
+    const voxelforge::DistanceField& expected = *fresh.getDistanceField();
+    for (unsigned int z = 0; z < field.size().z; z++)
+    for (unsigned int y = 0; y < field.size().y; y++)
+    for (unsigned int x = 0; x < field.size().x; x++) {
+        if (field.get(glm::uvec3(x, y, z)) != expected.get(glm::uvec3(x, y, z))) return false;
+    }
+    for (const auto& [position, chunk] : object.getChunks()) {
+        if (chunk->getEncoding() != fresh.getChunks().find(position)->second->getEncoding()) return false;
+    }
+    return true;
+}
+
+    // the shared terrain set voxel by voxel, columns split across threads in bands of x
+static void benchmark() {
+    const glm::uvec3 size(64, 1, 64);
+    auto columns = [](voxelforge::VoxelObject& object, int x0, int x1) {
+        forEachTerrainVoxel([&](glm::uvec3 p, bool high) { object.set(p, voxelforge::VoxelData(glm::vec3(1.0, 0.0, 0.0), high)); },
+                            glm::ivec2(x0, 0), glm::ivec2(x1, 16 * 64));
+    };
+
+    voxelforge::VoxelObject serial(size);
+    double base = timeSeconds([&]() { columns(serial, 0, 16 * 64); });
+    std::cout << "terrain fill, 1024 x 1024 columns (" << std::thread::hardware_concurrency() << " hardware threads)" << std::endl;
+    std::cout << "  serial set():   " << base * 1000.0 << " ms" << std::endl;
+
+    for (unsigned int threads : { 1u, 2u, 4u, 8u, 16u, 32u }) {
+        voxelforge::VoxelObject object(size);
+        double seconds = timeSeconds([&]() {
+            object.beginConcurrentEdits();
+            onThreads(threads, [&](unsigned int t) { columns(object, 16 * 64 * t / threads, 16 * 64 * (t + 1) / threads); });
+            object.endConcurrentEdits();
+        });
+        std::cout << "  " << std::setw(2) << threads << " threads:     " << seconds * 1000.0 << " ms, "
+                  << base / seconds << "x serial" << (sameVoxels(object, serial) ? "" : " (MISMATCH)") << std::endl;
+    }
+}
+
+int main() {
+    if (!testStress()) {
+        std::cerr << "concurrent edits don't match the same edits made serially" << std::endl;
+        return 1;
+    }
+    if (!testDirty()) {
+        std::cerr << "derived data doesn't catch up with concurrent edits" << std::endl;
+        return 1;
+    }
+    std::cout << "concurrent edits OK" << std::endl;
+
+    benchmark();
+    return 0;
+}
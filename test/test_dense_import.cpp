@@ -0,0 +1,113 @@
+#include <vforge/vforge.hpp>
+#include <glm/glm.hpp>
+#include <glm/gtc/noise.hpp>
+#include <iostream>
+#include <vector>
+#include "bench.hpp"
+
+    // per-voxel set and clear over the same box, the behaviour importDense() has to reproduce
+template <typename T>
+static void setEach(voxelforge::VoxelObject& object, const std::vector<T>& data, glm::uvec3 dims, glm::uvec3 offset) {
+    for (uint32_t z = 0; z < dims.z; z++)
+    for (uint32_t y = 0; y < dims.y; y++)
+    for (uint32_t x = 0; x < dims.x; x++) {
+        glm::uvec3 p = offset + glm::uvec3(x, y, z);
+        if (p.x >= object.size().x * 16 || p.y >= object.size().y * 16 || p.z >= object.size().z * 16) continue;
+
+        T value = data[((size_t)z * dims.y + y) * dims.x + x];
+        if (value) object.set(p, voxelforge::VoxelData(glm::vec3(0.0f), value));
+        else object.clear(p);
+    }
+}
+
+    // imports at unaligned offsets, partly outside the object and over existing voxels, then reads them back
+template <typename T>
+static bool testRoundTrip(uint32_t seed) {
+    const glm::uvec3 size(3, 2, 4);
+    voxelforge::VoxelObject direct(size), imported(size);
+    for (uint32_t i = 0; i < 5000; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        glm::uvec3 p((seed >> 4) % 48, (seed >> 12) % 32, (seed >> 20) % 64);
+        direct.set(p, voxelforge::VoxelData(glm::vec3(0.0f, 1.0f, 0.0f), 7));
+        imported.set(p, voxelforge::VoxelData(glm::vec3(0.0f, 1.0f, 0.0f), 7));
+    }
+
+    for (int round = 0; round < 6; round++) {
+        seed = seed * 1664525u + 1013904223u;
+        glm::uvec3 dims(1 + seed % 40, 1 + (seed >> 8) % 30, 1 + (seed >> 16) % 50);
+        glm::uvec3 offset((seed >> 3) % 40, (seed >> 11) % 20, (seed >> 19) % 40);
+
+            // blobs of material with empty gaps, and an all-empty slab to clear with
+        std::vector<T> data((size_t)dims.x * dims.y * dims.z);
+        for (size_t i = 0; i < data.size(); i++) {
+            seed = seed * 1664525u + 1013904223u;
+            data[i] = round == 3 || (seed >> 16) % 3 == 0 ? 0 : (T)(1 + (seed >> 20) % (sizeof(T) == 1 ? 255 : 4000));
+        }
+
+        setEach(direct, data, dims, offset);
+        imported.importDense(data.data(), dims, offset);
+        if (!sameVoxels(direct, imported)) return false;
+
+        std::vector<T> exported(data.size(), (T)1);
+        imported.exportDense(exported.data(), dims, offset);
+        for (uint32_t z = 0; z < dims.z; z++)
+        for (uint32_t y = 0; y < dims.y; y++)
+        for (uint32_t x = 0; x < dims.x; x++) {
+            glm::uvec3 p = offset + glm::uvec3(x, y, z);
+            auto voxel = direct.get(p);
+            bool inside = p.x < size.x * 16 && p.y < size.y * 16 && p.z < size.z * 16;
+            T expected = inside && voxel ? (T)voxel->matID : 0;
+            if (exported[((size_t)z * dims.y + y) * dims.x + x] != expected) return false;
+        }
+    }
+    return true;
+}
+
+    // 1024^3 grid holding perlin terrain of up to 96 voxels, as a dense generator would produce it
+static void benchmark() {
+    const glm::uvec3 dims(1024, 1024, 1024);
+    std::vector<uint8_t> grid((size_t)dims.x * dims.y * dims.z, 0);
+    for (uint32_t z = 0; z < dims.z; z++)
+    for (uint32_t x = 0; x < dims.x; x++) {
+        int height = (int)(48.0f * (1.0f + glm::perlin(glm::vec3(x, z, 0.0f) / 64.0f)));
+        for (int y = 0; y < height; y++) grid[((size_t)z * dims.y + y) * dims.x + x] = 1 + y % 200;
+    }
+
+    voxelforge::VoxelObject perVoxel(dims / 16u), imported(dims / 16u);
+    double setTime = timeSeconds([&]() {
+        for (uint32_t z = 0; z < dims.z; z++)
+        for (uint32_t y = 0; y < dims.y; y++)
+        for (uint32_t x = 0; x < dims.x; x++) {
+            uint8_t value = grid[((size_t)z * dims.y + y) * dims.x + x];
+            if (value) perVoxel.set(glm::uvec3(x, y, z), voxelforge::VoxelData(glm::vec3(0.0f), value));
+        }
+    });
+    double importTime = timeSeconds([&]() { imported.importDense(grid.data(), dims); });
+    double singleTime = timeSeconds([&]() { voxelforge::VoxelObject(dims / 16u).importDense(grid.data(), dims, glm::uvec3(0), 1); });
+    if (!sameVoxels(perVoxel, imported)) {
+        std::cerr << "1024^3 import doesn't match per-voxel set" << std::endl;
+        return;
+    }
+
+    size_t voxels = 0;
+    imported.forEachVoxel([&](glm::uvec3, const voxelforge::VoxelData&) { voxels++; });
+    perVoxel.clear();
+
+    double exportTime = timeSeconds([&]() { imported.exportDense(grid.data(), dims); });
+
+    std::cout << "1024^3 grid, " << voxels << " voxels in " << imported.getChunks().size() << " chunks" << std::endl;
+    std::cout << "  per-voxel set " << setTime << " s, importDense " << importTime << " s (" << singleTime << " s on one thread), "
+              << setTime / importTime << "x" << std::endl;
+    std::cout << "  exportDense " << exportTime << " s" << std::endl;
+}
+
+int main() {
+    if (!testRoundTrip<uint8_t>(20) || !testRoundTrip<uint16_t>(21)) {
+        std::cerr << "dense import/export doesn't match per-voxel edits" << std::endl;
+        return 1;
+    }
+    std::cout << "dense import OK" << std::endl;
+
+    benchmark();
+    return 0;
+}
@@ -0,0 +1,195 @@
+#include <vforge/vforge.hpp>
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include "bench.hpp"
+
+static bool sameObject(const voxelforge::VoxelObject& a, const voxelforge::VoxelObject& b) {
+    if (a.size() != b.size() || a.getModelMatrix() != b.getModelMatrix()) return false;
+    for (uint32_t m = 0; m < 256; m++) {
+        if (a.getMaterial(m) != b.getMaterial(m)) return false;
+    }
+
+    auto ra = a.voxels(), rb = b.voxels();
+    auto ia = ra.begin(), ib = rb.begin();
+    for (; ia != ra.end() && ib != rb.end(); ++ia, ++ib) {
+        if ((*ia).position != (*ib).position || (*ia).data != (*ib).data) return false;
+    }
+    return ia == ra.end() && ib == rb.end();
+}
+
+    // index of an instance's model among the world's objects
+static size_t modelIndex(const voxelforge::VoxelWorld& world, const voxelforge::VoxelInstance& instance) {
+    const auto& objects = world.getObjects();
+    return std::find(objects.begin(), objects.end(), instance.getModel()) - objects.begin();
+}
+
+static bool sameWorld(const voxelforge::VoxelWorld& a, const voxelforge::VoxelWorld& b) {
+    if (a.getObjects().size() != b.getObjects().size() || a.getInstances().size() != b.getInstances().size()) return false;
+    for (size_t i = 0; i < a.getObjects().size(); i++) {
+        if (!sameObject(*a.getObjects()[i], *b.getObjects()[i])) return false;
+    }
+    for (size_t i = 0; i < a.getInstances().size(); i++) {
+        const auto& ia = *a.getInstances()[i];
+        const auto& ib = *b.getInstances()[i];
+        if (ia.getModelMatrix() != ib.getModelMatrix() || modelIndex(a, ia) != modelIndex(b, ib)) return false;
+    }
+    return true;
+}
+
+    // random objects survive a round trip, lookups through the mapping agree with the object
+static bool testRoundTrip(const char *path) {
+    voxelforge::VoxelWorld world;
+    std::mt19937 rng(5);
+    for (int o = 0; o < 3; o++) {
+        glm::uvec3 dim(1 + o, 2, 3);
+        auto object = std::make_shared<voxelforge::VoxelObject>(dim, glm::translate(glm::mat4(1.0f), glm::vec3(o, 2 * o, -o)));
+        for (int i = 0; i < 3000; i++) {
+            glm::uvec3 p(rng() % (dim.x * 16), rng() % (dim.y * 16), rng() % (dim.z * 16));
+            object->set(p, voxelforge::VoxelData(glm::normalize(glm::vec3(p) + 1.0f), rng() % 256));
+        }
+        for (uint32_t m = 0; m < 256; m++) object->setMaterial(m, glm::vec4(m / 255.0f, o, 0.5f, 1.0f));
+        world.addObject(object);
+    }
+    world.addObject(std::make_shared<voxelforge::VoxelObject>(glm::uvec3(2, 2, 2)));
+    world.addInstance(std::make_shared<voxelforge::VoxelInstance>(world.getObjects()[1], glm::translate(glm::mat4(1.0f), glm::vec3(9, 0, 0))));
+
+    if (!voxelforge::files::save_native_file(path, world)) return false;
+
+    voxelforge::files::NativeFile file(path);
+    if (!file.isOpen() || file.objectCount() != world.getObjects().size() + world.getInstances().size()) return false;
+        // the instance's record points at its model's sections
+    if (file.getObject(4).chunkTable != file.getObject(1).chunkTable) return false;
+    for (size_t o = 0; o < world.getObjects().size(); o++) {
+        const auto& view = file.getObject(o);
+        const auto& object = *world.getObjects()[o];
+        for (unsigned int x = 0; x < object.size().x * 16; x++)
+        for (unsigned int y = 0; y < object.size().y * 16; y++)
+        for (unsigned int z = 0; z < object.size().z * 16; z++) {
+            if (view.lookup(glm::uvec3(x, y, z)) != object.get(glm::uvec3(x, y, z))) return false;
+        }
+    }
+
+    auto loaded = file.getWorld();
+    return loaded && sameWorld(world, *loaded);
+}
+
+    // null objects, instances and models are left out like they are when drawing
+static bool testNullItems(const char *path) {
+    voxelforge::VoxelWorld world, expected;
+    auto object = std::make_shared<voxelforge::VoxelObject>(glm::uvec3(1, 1, 1));
+    object->set(glm::uvec3(3, 4, 5), voxelforge::VoxelData(glm::vec3(0.0f, 1.0f, 0.0f), 7));
+    auto instance = std::make_shared<voxelforge::VoxelInstance>(object, glm::translate(glm::mat4(1.0f), glm::vec3(4, 0, 0)));
+
+    world.addObject(nullptr);
+    world.addObject(object);
+    world.addInstance(nullptr);
+    world.addInstance(std::make_shared<voxelforge::VoxelInstance>(nullptr));
+    world.addInstance(instance);
+    expected.addObject(object);
+    expected.addInstance(instance);
+
+    if (!voxelforge::files::save_native_file(path, world)) return false;
+    auto loaded = voxelforge::files::load_native_file(path);
+    return loaded && sameWorld(expected, *loaded);
+}
+
+    // truncated or corrupted files are rejected instead of mapped
+static bool testRejectsMalformed(const char *path, const char *broken) {
+    std::ifstream in(path, std::ios::binary);
+    std::vector<char> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+    auto rejected = [&](const std::vector<char>& data) {
+        std::ofstream out(broken, std::ios::binary | std::ios::trunc);
+        out.write(data.data(), data.size());
+        out.close();
+        return !voxelforge::files::NativeFile(broken).isOpen();
+    };
+
+    std::vector<char> truncated(bytes.begin(), bytes.begin() + bytes.size() / 2);
+    std::vector<char> badVersion = bytes;
+    badVersion[8] = 99;
+    std::vector<char> badOffset = bytes;
+    badOffset[24 + 80 + 8] = 0x7f; // chunk table offset of the first object, now unaligned and past the end
+    std::vector<char> badChunk = bytes;
+    uint64_t chunkTable;
+    std::memcpy(&chunkTable, &bytes[24 + 80 + 8], sizeof(chunkTable));
+    uint32_t far = 0x7fffffff;
+    std::memcpy(&badChunk[chunkTable + 8], &far, sizeof(far)); // first chunk's subchunk base
+    badChunk[chunkTable] |= 1;
+
+        // sizes whose chunk count wraps around to 0, or doesn't fit the 32 bit chunk table index
+    auto badDim = [&](uint32_t x, uint32_t y, uint32_t z) {
+        std::vector<char> data = bytes;
+        const uint32_t dim[3] = { x, y, z };
+        std::memcpy(&data[24], dim, sizeof(dim));
+        return data;
+    };
+
+    return rejected(truncated) && rejected(badVersion) && rejected(badOffset) && rejected(badChunk) &&
+           rejected(badDim(1u << 22, 1u << 21, 1u << 21)) && rejected(badDim(1u << 20, 1u << 20, 1u << 20));
+}
+
+static void benchmarkModel(const char *filename, const char *path) {
+    const int repeats = 10;
+    std::shared_ptr<voxelforge::VoxelWorld> vox;
+    double voxTime = timeSeconds([&]() {
+        for (int r = 0; r < repeats; r++) vox = voxelforge::files::MagicaVoxelVOX(filename).getWorld();
+    }) / repeats;
+    if (!vox) return;
+
+    voxelforge::files::save_native_file(path, *vox);
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    size_t bytes = in.tellg();
+
+    size_t objects = 0;
+    double mapTime = timeSeconds([&]() {
+        for (int r = 0; r < repeats; r++) objects += voxelforge::files::NativeFile(path).objectCount();
+    }) / repeats;
+
+    std::shared_ptr<voxelforge::VoxelWorld> native;
+    double loadTime = timeSeconds([&]() {
+        for (int r = 0; r < repeats; r++) native = voxelforge::files::load_native_file(path);
+    }) / repeats;
+
+    if (!native || !sameWorld(*vox, *native) || objects != repeats * (vox->getObjects().size() + vox->getInstances().size())) {
+        std::cerr << filename << ": native file doesn't match the .vox load" << std::endl;
+        std::exit(1);
+    }
+
+    std::cout << filename << ": " << bytes / 1024 << " KiB native" << std::endl;
+    std::cout << "  MagicaVoxelVOX:        " << voxTime * 1000.0 << " ms" << std::endl;
+    std::cout << "  NativeFile (mapped):   " << mapTime * 1000.0 << " ms (" << voxTime / mapTime << "x)" << std::endl;
+    std::cout << "  load_native_file:      " << loadTime * 1000.0 << " ms (" << voxTime / loadTime << "x)" << std::endl;
+}
+
+int main() {
+    const char *path = "test_native_file.vfg";
+    const char *broken = "test_native_file_broken.vfg";
+
+    if (!testRoundTrip(path)) {
+        std::cerr << "native file round trip failed" << std::endl;
+        return 1;
+    }
+    if (!testRejectsMalformed(path, broken)) {
+        std::cerr << "malformed native file was accepted" << std::endl;
+        return 1;
+    }
+    if (!testNullItems(path)) {
+        std::cerr << "native file with null items didn't round trip" << std::endl;
+        return 1;
+    }
+    std::cout << "native file round trip OK" << std::endl;
+
+    benchmarkModel("models/Ak74.vox", path);
+    benchmarkModel("models/dragon.vox", path);
+    benchmarkModel("models/tiger1.vox", path);
+
+    std::remove(path);
+    std::remove(broken);
+    return 0;
+}
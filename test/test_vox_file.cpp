@@ -0,0 +1,304 @@
+#include <vforge/vforge.hpp>
+#include <vforge/threads.hpp>
+#include <glm/glm.hpp>
+#include <vox_file/vox_file.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <string>
+#include "bench.hpp"
+
+    // every heap allocation in the process, to report allocations per load
+static std::atomic<size_t> allocations(0);
+
+void *operator new(size_t size) {
+    allocations++;
+    if (void *p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, size_t) noexcept { std::free(p); }
+
+static void appendInt(std::string& out, int32_t value) {
+    out.append((const char *)&value, 4);
+}
+
+static std::string chunk(const char *id, const std::string& content, const std::string& children = "") {
+    std::string out(id, 4);
+    appendInt(out, content.size());
+    appendInt(out, children.size());
+    return out + content + children;
+}
+
+    // a 3 x 4 x 5 model with a few voxels and a palette, followed by the chunks in `scene`
+static std::string minimalFile(int32_t voxelCount = 3, int32_t mainChildren = -1, const std::string& scene = "") {
+    std::string size, xyzi, rgba;
+    appendInt(size, 3);
+    appendInt(size, 4);
+    appendInt(size, 5);
+    appendInt(xyzi, voxelCount);
+    const uint8_t voxels[] = { 0, 0, 0, 1,  2, 3, 4, 2,  1, 2, 0, 255 };
+    xyzi.append((const char *)voxels, sizeof(voxels));
+    for (int i = 0; i < 256; i++) rgba += std::string({ (char)i, (char)(255 - i), 0, (char)255 });
+
+    std::string children = chunk("SIZE", size) + chunk("XYZI", xyzi) + chunk("RGBA", rgba) + scene;
+    std::string main = chunk("MAIN", "", children);
+    if (mainChildren >= 0) std::memcpy(&main[8], &mainChildren, 4);
+
+    std::string out = "VOX ";
+    appendInt(out, 150);
+    return out + main;
+}
+
+static std::shared_ptr<voxelforge::VoxelWorld> load(const std::string& bytes, const char *path) {
+    std::ofstream(path, std::ios::binary | std::ios::trunc).write(bytes.data(), bytes.size());
+    return voxelforge::files::MagicaVoxelVOX(path).getWorld();
+}
+
+static bool testMinimal(const char *path) {
+    auto world = load(minimalFile(), path);
+    if (!world || world->getObjects().size() != 1) return false;
+
+        // z up in the file, y up in the object
+    const auto& object = *world->getObjects()[0];
+    auto a = object.get(glm::uvec3(0, 0, 0)), b = object.get(glm::uvec3(2, 4, 3)), c = object.get(glm::uvec3(1, 0, 2));
+    size_t count = 0;
+    for (auto it = object.voxels().begin(); it != object.voxels().end(); ++it) count++;
+    return a && a->matID == 1 && b && b->matID == 2 && c && c->matID == 255 && count == 3
+        && object.getMaterial(1) == glm::vec4(0, 255, 0, 255) / 256.0f;
+}
+
+    // sizes that point past their chunk or the file must fail cleanly
+static bool testMalformed(const char *path) {
+    std::string valid = minimalFile();
+    const std::string broken[] = {
+        valid.substr(0, valid.size() - 100),        // truncated RGBA
+        valid.substr(0, 30),                        // truncated in the middle of SIZE
+        minimalFile(1 << 28),                       // voxel count past the end of XYZI
+        minimalFile(-5),                            // negative voxel count
+        minimalFile(3, 1 << 30),                    // MAIN children past the end of the file
+        minimalFile(3, 7),                          // MAIN children ending inside a chunk header
+        "VOX!" + valid.substr(4),                   // bad magic
+    };
+    for (const auto& bytes : broken) {
+        if (load(bytes, path)) return false;
+    }
+
+    std::string outside = valid;
+    outside[outside.find("XYZI") + 16] = 9;         // x of the first voxel, past the model's size
+    return !load(outside, path);
+}
+
+static std::string transformNode(int32_t id, int32_t child) {
+    std::string content;
+    for (int32_t value : { id, 0, child, -1, 0, 1, 0 }) appendInt(content, value);   // no attributes, one empty frame
+    return chunk("nTRN", content);
+}
+
+static std::string groupNode(int32_t id, std::initializer_list<int32_t> children) {
+    std::string content;
+    appendInt(content, id);
+    appendInt(content, 0);
+    appendInt(content, children.size());
+    for (int32_t child : children) appendInt(content, child);
+    return chunk("nGRP", content);
+}
+
+static std::string shapeNode(int32_t id, int32_t model) {
+    std::string content;
+    for (int32_t value : { id, 0, 1, model, 0 }) appendInt(content, value);
+    return chunk("nSHP", content);
+}
+
+    // a scene graph that isn't a tree must fail, rather than recurse forever or once per path through it
+static bool testSceneGraph(const char *path) {
+    auto world = load(minimalFile(3, -1, transformNode(0, 1) + groupNode(1, { 2, 4 }) + transformNode(2, 3) + shapeNode(3, 0) +
+                                         transformNode(4, 5) + shapeNode(5, 0)), path);
+    if (!world || world->getObjects().size() != 1 || world->getInstances().size() != 1) return false;
+
+    std::string chain;
+    for (int32_t i = 0; i < 40; i++) chain += groupNode(i, { i + 1, i + 1 });
+    const std::string broken[] = {
+        minimalFile(3, -1, groupNode(0, { 0, 0 })),                                             // a group holding itself twice
+        minimalFile(3, -1, transformNode(0, 1) + groupNode(1, { 2 }) + transformNode(2, 0)),    // the root under its grandchild
+        minimalFile(3, -1, chain + shapeNode(40, 0)),                                           // 2^40 paths to the shape
+    };
+    for (const auto& bytes : broken) {
+        if (load(bytes, path)) return false;
+    }
+    return true;
+}
+
+    // the standalone magicavoxel::VoxFile reader on the same files, throwing instead of returning null
+static bool testVoxFile(const char *path) {
+    std::string valid = minimalFile();
+    std::ofstream(path, std::ios::binary | std::ios::trunc).write(valid.data(), valid.size());
+
+    magicavoxel::VoxFile file(true, true, false);
+    file.Load(path);
+    if (file.denseModels().size() != 1 || file.sparseModels().size() != 1 || file.sparseModels()[0].voxels().size() != 3) return false;
+    for (const auto& voxel : file.sparseModels()[0].voxels()) {
+        if (file.denseModels()[0].voxel(voxel.x, voxel.y, voxel.z) != voxel.color) return false;
+    }
+    if (file.denseModels()[0].palette()[1].r != 1 || file.denseModels()[0].palette()[1].g != 254) return false;
+
+    std::string outside = valid;
+    outside[outside.find("XYZI") + 16] = 9;         // x of the first voxel, past the model's size
+    const std::string broken[] = { valid.substr(0, valid.size() - 100), valid.substr(0, 30), minimalFile(1 << 28), minimalFile(3, 1 << 30), outside };
+    for (const auto& bytes : broken) {
+        std::ofstream(path, std::ios::binary | std::ios::trunc).write(bytes.data(), bytes.size());
+        try {
+            file.Load(path);
+            return false;
+        } catch (const magicavoxel::VoxException&) {
+        }
+    }
+    return true;
+}
+
+static bool sameWorld(const voxelforge::VoxelWorld& a, const voxelforge::VoxelWorld& b) {
+    if (a.getObjects().size() != b.getObjects().size()) return false;
+    for (size_t i = 0; i < a.getObjects().size(); i++) {
+        const auto& oa = *a.getObjects()[i];
+        const auto& ob = *b.getObjects()[i];
+        if (oa.getModelMatrix() != ob.getModelMatrix() || oa.size() != ob.size()) return false;
+
+        auto ra = oa.voxels(), rb = ob.voxels();
+        auto ia = ra.begin(), ib = rb.begin();
+        for (; ia != ra.end() && ib != rb.end(); ++ia, ++ib) {
+            if ((*ia).position != (*ib).position || (*ia).data != (*ib).data) return false;
+        }
+        if (ia != ra.end() || ib != rb.end()) return false;
+    }
+
+    if (a.getInstances().size() != b.getInstances().size()) return false;
+    for (size_t i = 0; i < a.getInstances().size(); i++) {
+        const auto& ia = *a.getInstances()[i];
+        const auto& ib = *b.getInstances()[i];
+        auto model = [](const voxelforge::VoxelWorld& world, const voxelforge::VoxelInstance& instance) {
+            return std::find(world.getObjects().begin(), world.getObjects().end(), instance.getModel()) - world.getObjects().begin();
+        };
+        if (ia.getModelMatrix() != ib.getModelMatrix() || model(a, ia) != model(b, ib)) return false;
+    }
+    return true;
+}
+
+    // the objects must not depend on how the shapes were spread over the workers
+static bool testDeterministic(const char *filename) {
+    auto serial = voxelforge::files::MagicaVoxelVOX(filename, 1).getWorld();
+    if (!serial) return true; // model not available
+    for (unsigned int workers : { 2, 4, 8 }) {
+        for (int r = 0; r < 3; r++) {
+            auto world = voxelforge::files::MagicaVoxelVOX(filename, workers).getWorld();
+            if (!world || !sameWorld(*serial, *world)) return false;
+        }
+    }
+    return true;
+}
+
+static void benchmarkScaling(const char *filename) {
+    std::ifstream in(filename, std::ios::binary | std::ios::ate);
+    if (!in.is_open()) return;
+
+    const int repeats = 10;
+    double serial = 0.0;
+    for (unsigned int workers : { 1, 2, 4, 8, 16 }) {
+        double seconds = timeSeconds([&]() {
+            for (int r = 0; r < repeats; r++) voxelforge::files::MagicaVoxelVOX(filename, workers);
+        }) / repeats;
+        if (workers == 1) serial = seconds;
+        std::cout << filename << ": " << workers << " workers, " << seconds * 1000.0 << " ms, " << serial / seconds << "x" << std::endl;
+    }
+}
+
+static void benchmarkVoxFile(const char *filename) {
+    std::ifstream in(filename, std::ios::binary | std::ios::ate);
+    if (!in.is_open()) return;
+    double megabytes = (double)in.tellg() / (1024.0 * 1024.0);
+
+    const int repeats = 20;
+    for (bool removeHidden : { false, true }) {
+        size_t voxels = 0;
+        size_t before = allocations;
+        double seconds = timeSeconds([&]() {
+            for (int r = 0; r < repeats; r++) {
+                magicavoxel::VoxFile file(true, true, removeHidden);
+                file.Load(filename);
+                if (r == 0) for (const auto& model : file.sparseModels()) voxels += model.voxels().size();
+            }
+        }) / repeats;
+        double perLoad = (double)(allocations - before) / repeats;
+
+        std::cout << filename << ": VoxFile" << (removeHidden ? " (hidden removed)" : "") << ", " << voxels << " voxels, " << seconds * 1000.0 << " ms, "
+                  << megabytes / seconds << " MB/s, " << perLoad << " allocations per load" << std::endl;
+    }
+}
+
+static void benchmarkModel(const char *filename) {
+    std::ifstream in(filename, std::ios::binary | std::ios::ate);
+    if (!in.is_open()) return;
+    double megabytes = (double)in.tellg() / (1024.0 * 1024.0);
+
+    const int repeats = 20;
+    size_t objects = 0, voxels = 0;
+    size_t before = allocations;
+    double seconds = timeSeconds([&]() {
+        for (int r = 0; r < repeats; r++) {
+            auto world = voxelforge::files::MagicaVoxelVOX(filename).getWorld();
+            if (!world) continue;
+            objects = world->getObjects().size();
+            if (r == 0) {
+                for (const auto& object : world->getObjects()) {
+                    for (auto it = object->voxels().begin(); it != object->voxels().end(); ++it) voxels++;
+                }
+            }
+        }
+    }) / repeats;
+    double perLoad = (double)(allocations - before) / repeats;
+
+    std::cout << filename << ": " << objects << " objects, " << voxels << " voxels, " << seconds * 1000.0 << " ms, "
+              << megabytes / seconds << " MB/s, " << perLoad << " allocations per load" << std::endl;
+}
+
+int main() {
+    const char *path = "test_vox_file.vox";
+    if (!testMinimal(path)) {
+        std::cerr << "minimal .vox file didn't load" << std::endl;
+        return 1;
+    }
+    if (!testMalformed(path)) {
+        std::cerr << "malformed .vox file was accepted" << std::endl;
+        return 1;
+    }
+    if (!testSceneGraph(path)) {
+        std::cerr << "malformed .vox scene graph was accepted" << std::endl;
+        return 1;
+    }
+    if (!testVoxFile(path)) {
+        std::cerr << "VoxFile doesn't match the .vox file" << std::endl;
+        return 1;
+    }
+    std::remove(path);
+    for (const char *filename : { "models/Ak74.vox", "models/tiger1.vox" }) {
+        if (!testDeterministic(filename)) {
+            std::cerr << filename << " loads differently on several workers" << std::endl;
+            return 1;
+        }
+    }
+    std::cout << ".vox parsing OK" << std::endl;
+
+    benchmarkModel("models/Ak74.vox");
+    benchmarkModel("models/dragon.vox");
+    benchmarkModel("models/tiger1.vox");
+    benchmarkVoxFile("models/dragon.vox");
+    benchmarkVoxFile("models/tiger1.vox");
+    std::cout << "hardware threads: " << voxelforge::defaultWorkerCount() << std::endl;
+    benchmarkScaling("models/dragon.vox");
+    benchmarkScaling("models/tiger1.vox");
+    return 0;
+}
@@ -0,0 +1,214 @@
+#include <vforge/vforge.hpp>
+#include <vforge/threads.hpp>
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <random>
+#include "bench.hpp"
+
+static void randomVoxels(voxelforge::VoxelObject& object, std::mt19937& rng, int count) {
+    glm::uvec3 extent = object.size() * 16u;
+    for (int i = 0; i < count; i++) {
+        glm::uvec3 p(rng() % extent.x, rng() % extent.y, rng() % extent.z);
+        object.set(p, voxelforge::VoxelData(glm::vec3(0.0f, 1.0f, 0.0f), i % 4));
+    }
+}
+
+    // brute force nearest solid voxel for every voxel
+static bool matchesBruteForce(const voxelforge::VoxelObject& object, const voxelforge::DistanceField& field) {
+    glm::ivec3 extent(object.size() * 16u);
+    std::vector<glm::ivec3> solid;
+    for (int z = 0; z < extent.z; z++)
+    for (int y = 0; y < extent.y; y++)
+    for (int x = 0; x < extent.x; x++) {
+        if (object.get(glm::uvec3(x, y, z))) solid.emplace_back(x, y, z);
+    }
+
+    for (int z = 0; z < extent.z; z++)
+    for (int y = 0; y < extent.y; y++)
+    for (int x = 0; x < extent.x; x++) {
+        int64_t best = INT64_MAX;
+        for (const auto& s : solid) {
+            glm::ivec3 v = s - glm::ivec3(x, y, z);
+            best = std::min<int64_t>(best, (int64_t)v.x * v.x + (int64_t)v.y * v.y + (int64_t)v.z * v.z);
+        }
+        unsigned int expected = best == INT64_MAX ? field.getMaxDistance()
+                              : std::min((unsigned int)std::sqrt((double)best), field.getMaxDistance());
+        if (field.get(glm::uvec3(x, y, z)) != expected) {
+            std::cerr << "distance at " << x << " " << y << " " << z << " is " << (int)field.get(glm::uvec3(x, y, z)) << ", expected " << expected << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool sameField(const voxelforge::DistanceField& a, const voxelforge::DistanceField& b) {
+    glm::uvec3 extent = a.size();
+    for (unsigned int z = 0; z < extent.z; z++)
+    for (unsigned int y = 0; y < extent.y; y++)
+    for (unsigned int x = 0; x < extent.x; x++) {
+        if (a.get(glm::uvec3(x, y, z)) != b.get(glm::uvec3(x, y, z))) return false;
+    }
+    return true;
+}
+
+static bool testExact() {
+    std::mt19937 rng(3);
+    voxelforge::VoxelObject object(glm::uvec3(3, 2, 2));
+    randomVoxels(object, rng, 40);
+
+    for (unsigned int maxDistance : { 4u, 32u }) {
+        voxelforge::DistanceField field(object.size() * 16u, maxDistance);
+        field.build(object.getChunks(), 4);
+        if (!matchesBruteForce(object, field)) return false;
+    }
+    return true;
+}
+
+    // recomputing around edited chunks has to give the same field as building from scratch
+static bool testRegionUpdate() {
+    std::mt19937 rng(9);
+    voxelforge::VoxelObject object(glm::uvec3(8, 2, 8));
+    randomVoxels(object, rng, 400);
+    object.updateDistanceField(12);
+
+    for (int round = 0; round < 20; round++) {
+        glm::uvec3 center(rng() % 128, rng() % 32, rng() % 128);
+        for (int i = 0; i < 30; i++) {
+            glm::uvec3 p = glm::min(center + glm::uvec3(rng() % 8, rng() % 8, rng() % 8), glm::uvec3(127, 31, 127));
+            if (i % 3 == 0) object.clear(p);
+            else object.set(p, voxelforge::VoxelData(glm::vec3(1.0f, 0.0f, 0.0f), 1));
+        }
+        object.updateDistanceField(12);
+
+        voxelforge::DistanceField full(object.size() * 16u, 12);
+        full.build(object.getChunks());
+        if (!sameField(*object.getDistanceField(), full)) {
+            std::cerr << "region update " << round << " differs from a full build" << std::endl;
+            return false;
+        }
+    }
+
+        // a maxDistance past the cap keeps the capped field rather than rebuilding it on every call
+    object.updateDistanceField(1000);
+    const voxelforge::DistanceField *capped = object.getDistanceField();
+    object.set(glm::uvec3(5, 5, 5), voxelforge::VoxelData(glm::vec3(1.0f, 0.0f, 0.0f), 1));
+    object.updateDistanceField(1000);
+    if (object.getDistanceField() != capped || capped->getMaxDistance() != voxelforge::DistanceField::MAX_DISTANCE) {
+        std::cerr << "capped distance field was rebuilt" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+    // rays from above a 64x4x64 chunk object, looking across the terrain at a low angle
+static std::vector<voxelforge::Ray> terrainRays(size_t count) {
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    std::vector<voxelforge::Ray> rays;
+    for (size_t i = 0; i < count; i++) {
+        glm::vec3 origin(unit(rng) * 30.0f, 1.5f + unit(rng) * 0.4f, unit(rng) * 30.0f);
+        glm::vec3 dir = glm::normalize(glm::vec3(unit(rng), -0.05f - 0.1f * std::abs(unit(rng)), unit(rng)));
+        rays.emplace_back(origin, dir);
+    }
+    return rays;
+}
+
+static bool sameHits(const std::vector<voxelforge::RaycastHit>& a, const std::vector<voxelforge::RaycastHit>& b) {
+    for (size_t i = 0; i < a.size(); i++) {
+        if (a[i].hit != b[i].hit) return false;
+        if (a[i].hit && (a[i].voxel != b[i].voxel || a[i].normal != b[i].normal || a[i].distance != b[i].distance || a[i].data != b[i].data)) return false;
+    }
+    return true;
+}
+
+static uint64_t totalSteps(const std::vector<voxelforge::RaycastHit>& hits) {
+    uint64_t steps = 0;
+    for (const auto& hit : hits) steps += hit.steps;
+    return steps;
+}
+
+    // hits with the field have to be exactly the ones without it, for the scalar and the packet traversal
+static bool compareTraversal(voxelforge::VoxelObject& object, const std::vector<voxelforge::Ray>& rays, const char *name) {
+        // best of three, so no variant pays for warming the caches alone
+    auto bestOf = [](auto&& fn) {
+        double best = std::numeric_limits<double>::infinity();
+        for (int r = 0; r < 3; r++) best = std::min(best, timeSeconds(fn));
+        return best;
+    };
+
+    object.dropDistanceField();
+    std::vector<voxelforge::RaycastHit> plain, skipped, packets;
+    double plainTime = bestOf([&]() { plain = object.raycast(rays, 1, voxelforge::RaycastKernel::Scalar); });
+
+    double buildTime = timeSeconds([&]() { object.updateDistanceField(); });
+    double skippedTime = bestOf([&]() { skipped = object.raycast(rays, 1, voxelforge::RaycastKernel::Scalar); });
+    double packetTime = bestOf([&]() { packets = object.raycast(rays, 1); });
+
+    if (!sameHits(plain, skipped) || !sameHits(plain, packets) || totalSteps(skipped) != totalSteps(packets)) {
+        std::cerr << name << ": distance field changed the hits" << std::endl;
+        return false;
+    }
+
+    std::cout << name << ": field built in " << buildTime * 1000.0 << " ms, "
+              << object.getDistanceField()->memoryUsage() / 1024 << " KiB" << std::endl;
+    std::cout << "  hierarchy only:   " << (double)totalSteps(plain) / rays.size() << " steps/ray, " << rays.size() / plainTime / 1e6 << " MRays/s" << std::endl;
+    std::cout << "  distance field:   " << (double)totalSteps(skipped) / rays.size() << " steps/ray, " << rays.size() / skippedTime / 1e6 << " MRays/s" << std::endl;
+    std::cout << "  field + packets:  " << rays.size() / packetTime / 1e6 << " MRays/s" << std::endl;
+    return true;
+}
+
+static bool benchmarkTerrain() {
+    voxelforge::VoxelObject object(glm::uvec3(64, 4, 64));
+    fillTerrain(object);
+
+    voxelforge::DistanceField field(object.size() * 16u);
+    for (unsigned int workers : { 1u, voxelforge::defaultWorkerCount() }) {
+        double seconds = timeSeconds([&]() { field.build(object.getChunks(), workers); });
+        std::cout << "terrain field, " << workers << " threads: " << seconds * 1000.0 << " ms" << std::endl;
+        if (workers == voxelforge::defaultWorkerCount()) break;
+    }
+
+    if (!compareTraversal(object, terrainRays(1 << 18), "terrain")) return false;
+
+        // one edited chunk, recomputed with and without the bounded region
+    object.set(glm::uvec3(500, 20, 500), voxelforge::VoxelData(glm::vec3(0.0f, 1.0f, 0.0f), 1));
+    double regionTime = timeSeconds([&]() { object.updateDistanceField(); });
+    double fullTime = timeSeconds([&]() { field.build(object.getChunks()); });
+    std::cout << "one edited chunk: region update " << regionTime * 1000.0 << " ms, full rebuild " << fullTime * 1000.0 << " ms" << std::endl;
+    return true;
+}
+
+static bool benchmarkModel(const char *filename) {
+    voxelforge::files::MagicaVoxelVOX file(filename);
+    if (!file.getWorld() || file.getWorld()->getObjects().empty()) return true;
+
+    auto& object = *file.getWorld()->getObjects().front();
+    glm::vec3 half = glm::vec3(object.size()) * 0.5f;
+    std::mt19937 rng(77);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+        // rays from a sphere around the object towards random points inside it
+    std::vector<voxelforge::Ray> rays;
+    for (int i = 0; i < (1 << 18); i++) {
+        glm::vec3 from = glm::normalize(glm::vec3(unit(rng), unit(rng), unit(rng))) * glm::length(half) * 1.5f;
+        glm::vec3 to = glm::vec3(unit(rng), unit(rng), unit(rng)) * half * 0.5f;
+        glm::mat4 model = object.getModelMatrix();
+        rays.emplace_back(glm::vec3(model * glm::vec4(from, 1.0f)), glm::vec3(model * glm::vec4(to - from, 0.0f)));
+    }
+    return compareTraversal(object, rays, filename);
+}
+
+int main() {
+    if (!testExact()) return 1;
+    std::cout << "distance transform matches brute force" << std::endl;
+    if (!testRegionUpdate()) return 1;
+    std::cout << "region updates match full builds" << std::endl;
+
+    if (!benchmarkTerrain()) return 1;
+    if (!benchmarkModel("models/dragon.vox")) return 1;
+    if (!benchmarkModel("models/tiger1.vox")) return 1;
+    return 0;
+}
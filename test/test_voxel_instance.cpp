@@ -0,0 +1,181 @@
+#include <vforge/vforge.hpp>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include "bench.hpp"
+
+static void appendInt(std::string& out, int32_t value) {
+    out.append((const char *)&value, 4);
+}
+
+static void appendString(std::string& out, const std::string& value) {
+    appendInt(out, value.size());
+    out += value;
+}
+
+static std::string chunk(const char *id, const std::string& content, const std::string& children = "") {
+    std::string out(id, 4);
+    appendInt(out, content.size());
+    appendInt(out, children.size());
+    return out + content + children;
+}
+
+    // one 64^3 model with a sphere in it, placed `placements` times side by side through the scene graph
+static std::string placedModelFile(int placements) {
+    std::string size, xyzi, voxels;
+    appendInt(size, 64);
+    appendInt(size, 64);
+    appendInt(size, 64);
+    int32_t count = 0;
+    for (int z = 0; z < 64; z++)
+    for (int y = 0; y < 64; y++)
+    for (int x = 0; x < 64; x++) {
+        glm::vec3 d = glm::vec3(x, y, z) - 31.5f;
+        if (glm::dot(d, d) > 30.0f * 30.0f) continue;
+        voxels += std::string({ (char)x, (char)y, (char)z, (char)(1 + (x + y + z) % 8) });
+        count++;
+    }
+    appendInt(xyzi, count);
+    xyzi += voxels;
+
+        // root transform 0 -> group 1 -> transform 2 + 2i -> shape 3 + 2i
+    std::string scene, root, group;
+    appendInt(root, 0);
+    appendInt(root, 0);
+    appendInt(root, 1);
+    appendInt(root, -1);
+    appendInt(root, -1);
+    appendInt(root, 1);
+    appendInt(root, 0);
+    scene += chunk("nTRN", root);
+
+    appendInt(group, 1);
+    appendInt(group, 0);
+    appendInt(group, placements);
+    for (int i = 0; i < placements; i++) appendInt(group, 2 + 2 * i);
+    scene += chunk("nGRP", group);
+
+    for (int i = 0; i < placements; i++) {
+        std::string transform, shape;
+        appendInt(transform, 2 + 2 * i);
+        appendInt(transform, 0);
+        appendInt(transform, 3 + 2 * i);
+        appendInt(transform, -1);
+        appendInt(transform, -1);
+        appendInt(transform, 1);
+        appendInt(transform, 1);
+        appendString(transform, "_t");
+        appendString(transform, std::to_string(i % 10 * 80) + " " + std::to_string(i / 10 * 80) + " 0");
+        scene += chunk("nTRN", transform);
+
+        appendInt(shape, 3 + 2 * i);
+        appendInt(shape, 0);
+        appendInt(shape, 1);
+        appendInt(shape, 0);
+        appendInt(shape, 0);
+        scene += chunk("nSHP", shape);
+    }
+
+    std::string out = "VOX ";
+    appendInt(out, 150);
+    return out + chunk("MAIN", "", chunk("SIZE", size) + chunk("XYZI", xyzi) + scene);
+}
+
+    // an instance has to render and raycast exactly like an object of its own at the same place
+static bool testMatchesObject() {
+    auto fill = [](voxelforge::VoxelObject& object) {
+        for (unsigned int x = 4; x < 28; x++)
+        for (unsigned int y = 0; y < 20; y++)
+        for (unsigned int z = 2; z < 30; z += 3) object.set(glm::uvec3(x, y, z), voxelforge::VoxelData(glm::vec3(0.0f, 1.0f, 0.0f), 1 + (x ^ y) % 4));
+        for (uint32_t m = 0; m < 256; m++) object.setMaterial(m, glm::vec4(m / 4.0f, 0.5f, 1.0f - m / 4.0f, 1.0f));
+    };
+    glm::mat4 placement = glm::rotate(glm::translate(glm::mat4(1.0f), glm::vec3(0.3f, -0.2f, 0.0f)), 0.7f, glm::vec3(0.0f, 1.0f, 0.0f));
+
+    auto model = std::make_shared<voxelforge::VoxelObject>(glm::uvec3(2, 2, 2), glm::translate(glm::mat4(1.0f), glm::vec3(500.0f, 0.0f, 0.0f)));
+    auto object = std::make_shared<voxelforge::VoxelObject>(glm::uvec3(2, 2, 2), placement);
+    fill(*model);
+    fill(*object);
+    auto instance = std::make_shared<voxelforge::VoxelInstance>(model, placement);
+
+    voxelforge::VoxelWorld instanced, plain;
+    instanced.addObject(model);         // far off screen at its own transform
+    instanced.addInstance(instance);
+    plain.addObject(object);
+
+    glm::mat4 view = glm::lookAt(glm::vec3(1.0f, 1.5f, 4.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 proj = glm::perspective(glm::radians(45.0f), 1.0f, 0.1f, 100.0f);
+
+    voxelforge::VoxelRenderer a(96, 96), b(96, 96);
+    a.render(instanced, view, proj);
+    b.render(plain, view, proj);
+    if (a.getColor() != b.getColor() || a.getDepth() != b.getDepth()) return false;
+
+    size_t hits = 0;
+    for (int i = 0; i < 200; i++) {
+        glm::vec3 origin(-3.0f + i * 0.03f, 0.4f - i * 0.004f, 3.0f);
+        glm::vec3 direction = glm::vec3(0.0f) - origin;
+        auto hi = instance->raycast(origin, direction);
+        auto hp = object->raycast(origin, direction);
+        if ((bool)hi != (bool)hp || (hi && (hi.distance != hp.distance || hi.data != hp.data))) return false;
+        hits += (bool)hi;
+    }
+    return hits > 0;
+}
+
+    // placements of one model share its voxels, so the loaded world has one object and the rest are instances
+static bool testLoaderShares(const char *path) {
+    std::string bytes = placedModelFile(5);
+    std::ofstream(path, std::ios::binary | std::ios::trunc).write(bytes.data(), bytes.size());
+    auto world = voxelforge::files::MagicaVoxelVOX(path).getWorld();
+    if (!world || world->getObjects().size() != 1 || world->getInstances().size() != 4) return false;
+
+    for (size_t i = 0; i < 4; i++) {
+        const auto& instance = *world->getInstances()[i];
+        glm::vec3 expected((i + 1) % 10 * 5.0f, 0.0f, (i + 1) / 10 * 5.0f);
+        if (instance.getModel() != world->getObjects()[0] || glm::vec3(instance.getModelMatrix()[3]) != expected) return false;
+    }
+    return true;
+}
+
+    // load time and memory against the number of placements, both should follow the single unique model
+static void benchmarkPlacements(const char *path) {
+    for (int placements : { 1, 10, 100 }) {
+        std::string bytes = placedModelFile(placements);
+        std::ofstream(path, std::ios::binary | std::ios::trunc).write(bytes.data(), bytes.size());
+
+        const int repeats = 5;
+        std::shared_ptr<voxelforge::VoxelWorld> world;
+        double seconds = timeSeconds([&]() {
+            for (int r = 0; r < repeats; r++) world = voxelforge::files::MagicaVoxelVOX(path).getWorld();
+        }) / repeats;
+
+        size_t shared = 0;
+        for (const auto& object : world->getObjects()) shared += object->memoryUsage();
+        shared += world->getInstances().size() * sizeof(voxelforge::VoxelInstance);
+        size_t copies = world->getObjects()[0]->memoryUsage() * placements;
+
+        std::cout << placements << " placements: " << world->getObjects().size() << " objects, " << world->getInstances().size() << " instances, "
+                  << seconds * 1000.0 << " ms, " << shared / 1024 << " KiB (" << copies / 1024 << " KiB as separate objects)" << std::endl;
+    }
+}
+
+int main() {
+    const char *path = "test_voxel_instance.vox";
+
+    if (!testMatchesObject()) {
+        std::cerr << "instance doesn't match an object at the same transform" << std::endl;
+        return 1;
+    }
+    if (!testLoaderShares(path)) {
+        std::cerr << "repeated shapes weren't loaded as instances" << std::endl;
+        return 1;
+    }
+    std::cout << "instancing OK" << std::endl;
+
+    benchmarkPlacements(path);
+    std::remove(path);
+    return 0;
+}
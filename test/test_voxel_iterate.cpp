@@ -0,0 +1,145 @@
+#include <vforge/vforge.hpp>
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <iostream>
+#include <random>
+#include <vector>
+#include "bench.hpp"
+
+static uint64_t checksum(glm::uvec3 p, const voxelforge::VoxelData& data) {
+    return ((uint64_t)p.x * 73856093u ^ (uint64_t)p.y * 19349663u ^ (uint64_t)p.z * 83492791u) + data.matID;
+}
+
+static bool lessXYZ(glm::uvec3 a, glm::uvec3 b) {
+    return a.x != b.x ? a.x < b.x : (a.y != b.y ? a.y < b.y : a.z < b.z);
+}
+
+    // every voxel exactly once with its global position, callbacks and ranges in the same order
+static bool testIteration() {
+    voxelforge::VoxelObject object(glm::uvec3(5, 3, 4));
+    std::mt19937 rng(11);
+    std::vector<glm::uvec3> expected;
+    for (int i = 0; i < 20000; i++) {
+        glm::uvec3 p(rng() % 80, rng() % 48, rng() % 64);
+        object.set(p, voxelforge::VoxelData(glm::vec3(0.0, 1.0, 0.0), (p.x + p.y + p.z) % 256));
+        expected.push_back(p);
+    }
+    for (int i = 0; i < 5000; i++) {
+        glm::uvec3 p = expected[rng() % expected.size()];
+        object.clear(p);
+    }
+    expected.clear();
+    for (unsigned int x = 0; x < 80; x++)
+    for (unsigned int y = 0; y < 48; y++)
+    for (unsigned int z = 0; z < 64; z++) {
+        if (object.get(glm::uvec3(x, y, z))) expected.push_back(glm::uvec3(x, y, z));
+    }
+
+    std::vector<glm::uvec3> visited, ranged;
+    bool dataMatches = true;
+    object.forEachVoxel([&](glm::uvec3 p, const voxelforge::VoxelData& data) {
+        visited.push_back(p);
+        dataMatches &= data.matID == (p.x + p.y + p.z) % 256;
+    });
+    for (const auto& voxel : object.voxels()) ranged.push_back(voxel.position);
+    if (!dataMatches || visited != ranged) return false;
+
+    size_t subChunks = 0;
+    object.forEachSubChunk([&](glm::uvec3 corner, const voxelforge::VoxelSubChunk& sub) {
+        subChunks++;
+        dataMatches &= corner.x % 4 == 0 && corner.y % 4 == 0 && corner.z % 4 == 0 && sub.getBitmask() != 0;
+    });
+    if (!dataMatches || subChunks == 0) return false;
+
+        // ordering: subchunks of a chunk stay together, each voxel belongs to the chunk iterated at that point
+    for (size_t i = 1; i < visited.size(); i++) {
+        if (visited[i] / 16u == visited[i - 1] / 16u && visited[i] / 4u != visited[i - 1] / 4u) {
+            glm::uvec3 a = visited[i - 1] % 16u / 4u, b = visited[i] % 16u / 4u;
+            if (voxelforge::internal::bitIndex(a.x, a.y, a.z) >= voxelforge::internal::bitIndex(b.x, b.y, b.z)) return false;
+        }
+    }
+
+    std::sort(visited.begin(), visited.end(), lessXYZ);
+    return visited == expected;
+}
+
+static void benchmarkModel(const char *filename) {
+    voxelforge::files::MagicaVoxelVOX file(filename);
+    if (!file.getWorld()) return;
+
+    uint64_t voxels[3] = {0, 0, 0}, sums[3] = {0, 0, 0};
+    size_t chunks = 0;
+    const int repeats = 5;
+
+        // the traversal this replaces: every subchunk slot, then every voxel of the subchunks that exist
+    double probeTime = timeSeconds([&]() {
+        for (int r = 0; r < repeats; r++)
+        for (const auto& object : file.getWorld()->getObjects()) {
+            for (const auto& [position, chunk] : object->getChunks()) {
+                if (!chunk) continue;
+                if (r == 0) chunks++;
+                for (unsigned int sx = 0; sx < 4; sx++)
+                for (unsigned int sy = 0; sy < 4; sy++)
+                for (unsigned int sz = 0; sz < 4; sz++) {
+                    const auto& sub = chunk->getSubChunk(sx, sy, sz);
+                    if (!sub) continue;
+                    for (unsigned int x = 0; x < 4; x++)
+                    for (unsigned int y = 0; y < 4; y++)
+                    for (unsigned int z = 0; z < 4; z++) {
+                        auto voxel = sub->get(x, y, z);
+                        if (!voxel) continue;
+                        glm::uvec3 p = position * 16u + glm::uvec3(sx, sy, sz) * 4u + glm::uvec3(x, y, z);
+                        voxels[0]++;
+                        sums[0] += checksum(p, *voxel);
+                    }
+                }
+            }
+        }
+    });
+
+    double callbackTime = timeSeconds([&]() {
+        for (int r = 0; r < repeats; r++)
+        for (const auto& object : file.getWorld()->getObjects()) {
+            object->forEachVoxel([&](glm::uvec3 p, const voxelforge::VoxelData& data) {
+                voxels[1]++;
+                sums[1] += checksum(p, data);
+            });
+        }
+    });
+
+    double rangeTime = timeSeconds([&]() {
+        for (int r = 0; r < repeats; r++)
+        for (const auto& object : file.getWorld()->getObjects()) {
+            for (const auto& voxel : object->voxels()) {
+                voxels[2]++;
+                sums[2] += checksum(voxel.position, voxel.data);
+            }
+        }
+    });
+
+    if (voxels[0] != voxels[1] || voxels[0] != voxels[2] || sums[0] != sums[1] || sums[0] != sums[2]) {
+        std::cerr << filename << ": iterators disagree with the nested loops" << std::endl;
+        std::exit(1);
+    }
+
+    double n = (double)voxels[0];
+    std::cout << filename << ": " << voxels[0] / repeats << " voxels in " << chunks << " chunks ("
+              << (double)voxels[0] / repeats / (chunks * 4096.0) * 100.0 << "% occupied)" << std::endl;
+    std::cout << "  nested loops:  " << probeTime * 1e9 / n << " ns/voxel" << std::endl;
+    std::cout << "  forEachVoxel:  " << callbackTime * 1e9 / n << " ns/voxel (" << probeTime / callbackTime << "x)" << std::endl;
+    std::cout << "  voxels() range: " << rangeTime * 1e9 / n << " ns/voxel (" << probeTime / rangeTime << "x)" << std::endl;
+}
+
+int main() {
+    if (!testIteration()) {
+        std::cerr << "sparse iteration doesn't visit the set voxels" << std::endl;
+        return 1;
+    }
+    std::cout << "sparse iteration OK" << std::endl;
+
+    benchmarkModel("models/Ak74.vox");
+    benchmarkModel("models/dragon.vox");
+    benchmarkModel("models/tiger1.vox");
+
+    return 0;
+}
@@ -0,0 +1,181 @@
+#include <vforge/vforge.hpp>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include "bench.hpp"
+
+    // every voxel of a level has to stand for the 4x4x4 voxels below it: occupied if any is, with their most common
+    // material. normals are left out here, they are all the same
+static bool checkLevel(const voxelforge::VoxelObject& fine, const voxelforge::VoxelObject& coarse) {
+    std::map<std::tuple<unsigned int, unsigned int, unsigned int>, std::map<uint32_t, int>> expected;
+    fine.forEachVoxel([&](glm::uvec3 p, const voxelforge::VoxelData& voxel) { expected[{ p.x / 4, p.y / 4, p.z / 4 }][voxel.matID]++; });
+
+    size_t count = 0;
+    bool ok = true;
+    coarse.forEachVoxel([&](glm::uvec3 p, const voxelforge::VoxelData& voxel) {
+        auto it = expected.find({ p.x, p.y, p.z });
+        if (it == expected.end()) {
+            ok = false;
+            return;
+        }
+        auto dominant = std::max_element(it->second.begin(), it->second.end(), [](const auto& a, const auto& b) { return a.second < b.second; });
+        ok = ok && voxel.matID == dominant->first && voxel.normal().y > 0.99f;
+        count++;
+    });
+    return ok && count == expected.size();
+}
+
+static voxelforge::VoxelData voxel(uint32_t material) {
+    return voxelforge::VoxelData(glm::vec3(0.0f, 1.0f, 0.0f), material);
+}
+
+static bool testLevels() {
+    auto object = std::make_shared<voxelforge::VoxelObject>(glm::uvec3(5, 3, 6));
+    uint32_t seed = 21;
+    auto scatter = [&](int count) {
+        for (int i = 0; i < count; i++) {
+            seed = seed * 1664525u + 1013904223u;
+            glm::uvec3 p((seed >> 4) % 80, (seed >> 12) % 48, (seed >> 20) % 96);
+            if (i % 4 == 0) object->clear(p);
+            else object->set(p, voxel(1 + (seed >> 8) % 3));
+        }
+    };
+    scatter(20000);
+
+    object->updateLOD(2);
+    if (object->getLODCount() != 3 || object->getLOD(1).size() != glm::uvec3(2, 1, 2) || object->getLOD(2).size() != glm::uvec3(1)) return false;
+    if (!checkLevel(*object, object->getLOD(1)) || !checkLevel(object->getLOD(1), object->getLOD(2))) return false;
+
+        // edits in one corner and a cleared chunk, updated incrementally, have to match a fresh build
+    for (unsigned int x = 0; x < 10; x++) object->set(glm::uvec3(x, 2, 3), voxel(9));
+    object->setChunk(glm::uvec3(4, 2, 5), nullptr);
+    scatter(500);
+    object->updateLOD(2);
+
+    voxelforge::VoxelObject fresh(object->size());
+    object->forEachVoxel([&](glm::uvec3 p, const voxelforge::VoxelData& data) { fresh.set(p, data); });
+    fresh.updateLOD(2);
+    for (unsigned int level = 1; level < 3; level++) {
+        if (!sameVoxels(object->getLOD(level), fresh.getLOD(level))) return false;
+    }
+
+    object->clear();
+    object->updateLOD(2);
+    return object->getLOD(1).getChunks().size() == 0 && object->getLOD(2).getChunks().size() == 0;
+}
+
+    // whole subchunks and chunks of one material look the same at every level, so rays have to hit at the same distance
+static bool testPlacement() {
+    glm::mat4 placement = glm::rotate(glm::translate(glm::mat4(1.0f), glm::vec3(3.0f, -1.0f, 2.0f)), 0.4f, glm::vec3(0.3f, 1.0f, 0.0f));
+    voxelforge::VoxelObject object(glm::uvec3(3, 2, 5), placement);
+    for (unsigned int x = 0; x < 16; x++)
+    for (unsigned int y = 0; y < 16; y++)
+    for (unsigned int z = 16; z < 48; z++) object.set(glm::uvec3(x, y, z), voxel(2));
+    object.updateLOD(2);
+
+    std::vector<voxelforge::Ray> rays;
+    for (int i = 0; i < 400; i++) {
+        glm::vec3 origin(-4.0f + (i % 20) * 0.45f, 3.0f, -4.0f + (i / 20) * 0.45f);
+        rays.emplace_back(origin, glm::vec3(3.0f, -1.5f, 2.0f) - origin);
+    }
+
+    size_t hits = 0;
+    auto full = object.raycast(rays);
+    for (unsigned int level = 1; level < 3; level++) {
+        auto placed = object.getLOD(level).raycastAt(object.lodMatrix(level, placement), rays);
+        auto clipped = object.raycastLOD(level, placement, rays);
+        for (size_t i = 0; i < rays.size(); i++) {
+            if ((bool)full[i] != (bool)placed[i] || (full[i] && std::abs(full[i].distance - placed[i].distance) > 1e-3f)) return false;
+            if ((bool)full[i] != (bool)clipped[i] || (full[i] && std::abs(full[i].distance - clipped[i].distance) > 1e-3f)) return false;
+            hits += (bool)full[i];
+        }
+    }
+    return hits > 0;
+}
+
+static bool testSelection() {
+    voxelforge::VoxelObject object(glm::uvec3(4, 4, 4));
+    object.set(glm::uvec3(1), voxel(1));
+    glm::mat4 proj = glm::perspective(glm::radians(60.0f), 1.0f, 0.1f, 10000.0f);
+    auto at = [&](float distance) {
+        glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 0.0f, 2.0f + distance), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+        return object.selectLOD(object.getModelMatrix(), view, proj, 1080.0f);
+    };
+
+    if (at(100.0f) != 0) return false;  // no levels yet
+    object.updateLOD(2);
+
+        // a voxel is 1/16 of a unit, 1080 / tan(30 deg) / 2 pixels per unit at distance 1: level 1 from ~ 235, level 2 from ~ 940
+    if (at(1.0f) != 0 || at(200.0f) != 0 || at(300.0f) != 1 || at(900.0f) != 1 || at(1000.0f) != 2 || at(5000.0f) != 2) return false;
+
+    object.set(glm::uvec3(2), voxel(1));
+    if (at(5000.0f) != 0) return false; // stale levels aren't used
+    object.updateLOD(2);
+    return at(5000.0f) == 2;
+}
+
+    // the shared terrain, with its two materials as 1 and 2
+static std::shared_ptr<voxelforge::VoxelObject> terrain() {
+    auto object = std::make_shared<voxelforge::VoxelObject>(glm::uvec3(64, 1, 64));
+    forEachTerrainVoxel([&](glm::uvec3 p, bool high) { object->set(p, voxel(high ? 1 : 2)); });
+    object->setMaterial(1, glm::vec4(0.2f, 0.7f, 0.2f, 1.0f));
+    object->setMaterial(2, glm::vec4(0.3f, 0.3f, 0.8f, 1.0f));
+    return object;
+}
+
+static void benchmark() {
+    auto object = terrain();
+    double build = timeSeconds([&]() { object->updateLOD(2); });
+    object->set(glm::uvec3(500, 15, 500), voxel(1));
+    double update = timeSeconds([&]() { object->updateLOD(2); });
+
+    size_t full = object->memoryUsage(), levels = 0;
+    for (unsigned int level = 1; level < object->getLODCount(); level++) levels += object->getLOD(level).memoryUsage();
+    std::cout << "terrain: LOD build " << build * 1000.0 << " ms, update after one edit " << update * 1000.0 << " ms, levels use "
+              << levels / 1024 << " KiB over " << full / 1024 << " KiB (+" << 100.0 * levels / full << "%)" << std::endl;
+
+    voxelforge::VoxelWorld world;
+    world.addObject(object);
+    glm::mat4 proj = glm::perspective(glm::radians(45.0f), 1.0f, 0.1f, 1000.0f);
+    voxelforge::VoxelRenderer renderer(256, 256);
+    for (float distance : { 60.0f, 150.0f, 400.0f }) {
+        glm::mat4 view = glm::lookAt(glm::vec3(0.0f, distance * 0.5f, distance), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+        unsigned int level = object->selectLOD(object->getModelMatrix(), view, proj, 256.0f);
+
+        renderer.setLODPixels(0.0f);
+        renderer.render(world, view, proj);
+        auto fullStats = renderer.getRenderStats();
+        auto fullColor = renderer.getColor();
+
+        renderer.setLODPixels(1.0f);
+        renderer.render(world, view, proj);
+        auto lodStats = renderer.getRenderStats();
+
+        size_t changed = 0;
+        for (size_t i = 0; i < fullColor.size(); i++) changed += fullColor[i] != renderer.getColor()[i];
+        std::cout << "  distance " << distance << ", level " << level << ": " << (double)fullStats.steps / fullStats.rays << " -> "
+                  << (double)lodStats.steps / lodStats.rays << " steps/ray, " << fullStats.seconds * 1000.0 << " -> " << lodStats.seconds * 1000.0
+                  << " ms, " << 100.0 * changed / fullColor.size() << "% of pixels differ" << std::endl;
+    }
+}
+
+int main() {
+    if (!testLevels()) {
+        std::cerr << "levels of detail don't match the voxels below them" << std::endl;
+        return 1;
+    }
+    if (!testPlacement()) {
+        std::cerr << "levels of detail aren't placed over the object" << std::endl;
+        return 1;
+    }
+    if (!testSelection()) {
+        std::cerr << "wrong level of detail selected" << std::endl;
+        return 1;
+    }
+    std::cout << "levels of detail OK" << std::endl;
+
+    benchmark();
+    return 0;
+}
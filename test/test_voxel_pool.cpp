@@ -0,0 +1,137 @@
+#include <vforge/vforge.hpp>
+#include <glm/glm.hpp>
+#include <iostream>
+#include <random>
+#include <chrono>
+#include <cstring>
+#include "bench.hpp"
+
+static bool comparePool(const voxelforge::VoxelObject& object, const voxelforge::VoxelPool& pool) {
+    size_t voxels = 0;
+    for (unsigned int x = 0; x < 64; x++)
+    for (unsigned int y = 0; y < 32; y++)
+    for (unsigned int z = 0; z < 48; z++) {
+        auto expected = object.get(glm::uvec3(x, y, z));
+        auto packed = pool.lookup(glm::uvec3(x, y, z));
+
+        if (expected.has_value() != packed.has_value() || (expected && *expected != *packed)) {
+            std::cerr << "pool mismatch at " << x << " " << y << " " << z << std::endl;
+            return false;
+        }
+        if (expected) voxels++;
+    }
+
+    if (voxels != pool.voxelCount()) {
+        std::cerr << "pool holds " << pool.voxelCount() << " voxels, expected " << voxels << std::endl;
+        return false;
+    }
+    return true;
+}
+
+static void randomEdits(voxelforge::VoxelObject& object, std::mt19937& rng, int count, glm::uvec3 lo, glm::uvec3 hi, voxelforge::ChunkMap *dirty) {
+    for (int i = 0; i < count; i++) {
+        glm::uvec3 p(lo.x + rng() % (hi.x - lo.x), lo.y + rng() % (hi.y - lo.y), lo.z + rng() % (hi.z - lo.z));
+        if (i % 5 == 0) object.clear(p);
+        else object.set(p, voxelforge::VoxelData(glm::normalize(glm::vec3(p) + 1.0f), i % 256));
+
+        if (dirty) {
+            auto it = object.getChunks().find(p / 16u);
+            (*dirty)[p / 16u] = it == object.getChunks().end() ? nullptr : it->second;
+        }
+    }
+}
+
+    // packs a random object and reads every voxel back through the pool layout
+static bool testRoundTrip() {
+    voxelforge::VoxelObject object(glm::uvec3(4, 2, 3));
+    std::mt19937 rng(1234);
+    randomEdits(object, rng, 20000, glm::uvec3(0), glm::uvec3(64, 32, 48), nullptr);
+
+    voxelforge::VoxelPool pool(object.size());
+    pool.pack(object.getChunks());
+
+    return comparePool(object, pool);
+}
+
+    // repacks only edited chunks and checks the pool still matches the object
+static bool testIncremental() {
+    voxelforge::VoxelObject object(glm::uvec3(4, 2, 3));
+    std::mt19937 rng(5678);
+    randomEdits(object, rng, 20000, glm::uvec3(0), glm::uvec3(64, 32, 48), nullptr);
+
+    voxelforge::VoxelPool pool(object.size());
+    pool.pack(object.getChunks());
+    size_t fullBytes = pool.bytesRepacked();
+
+    for (int round = 0; round < 50; round++) {
+        voxelforge::ChunkMap dirty;
+        glm::uvec3 lo(rng() % 48, rng() % 16, rng() % 32);
+        randomEdits(object, rng, 200, lo, lo + 16u, &dirty);
+
+        pool.update(dirty);
+        pool.clearDirty();
+        if (!comparePool(object, pool)) return false;
+    }
+
+    std::cout << "full pack: " << fullBytes << " bytes, 50 incremental updates: " << (pool.bytesRepacked() - fullBytes) / 50 << " bytes each" << std::endl;
+    return true;
+}
+
+template <typename T>
+static bool sameBytes(const std::vector<T>& a, const std::vector<T>& b) {
+    return a.size() == b.size() && std::memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0;
+}
+
+    // packs the test_voxel_raytrace terrain with 1-32 threads, the output must not depend on the thread count
+static bool benchPackScaling() {
+    voxelforge::VoxelObject terrain(glm::uvec3(64, 1, 64));
+    forEachTerrainVoxel([&](glm::uvec3 p, bool high) { terrain.set(p, voxelforge::VoxelData(glm::vec3(1.0, 0.0, 0.0), high)); });
+
+    voxelforge::VoxelPool serial(terrain.size());
+    serial.pack(terrain.getChunks(), 1);
+
+    for (unsigned int workers : { 1u, 2u, 4u, 8u, 16u, 32u }) {
+        voxelforge::VoxelPool pool(terrain.size());
+
+        auto start = std::chrono::steady_clock::now();
+        pool.pack(terrain.getChunks(), workers);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        if (!sameBytes(pool.getChunkTable(), serial.getChunkTable()) || !sameBytes(pool.getSubChunkPool(), serial.getSubChunkPool()) || !sameBytes(pool.getVoxelPool(), serial.getVoxelPool())) {
+            std::cerr << "pack with " << workers << " threads differs from the serial pack" << std::endl;
+            return false;
+        }
+        std::cout << "terrain pack, " << workers << " threads: " << seconds * 1000.0 << " ms" << std::endl;
+    }
+    return true;
+}
+
+static void reportModel(const char *filename) {
+    voxelforge::files::MagicaVoxelVOX file(filename);
+    if (!file.getWorld()) return;
+
+    size_t dense = 0, packed = 0;
+    for (const auto& object : file.getWorld()->getObjects()) {
+        voxelforge::VoxelPool pool(object->size());
+        pool.pack(object->getChunks());
+
+        dense += voxelforge::VoxelPool::denseMemoryUsage(object->size());
+        packed += pool.memoryUsage();
+    }
+
+    std::cout << filename << ": dense " << dense / 1024 << " KiB, pooled " << packed / 1024 << " KiB" << std::endl;
+}
+
+int main() {
+    if (!testRoundTrip()) return 1;
+    std::cout << "pool round trip OK" << std::endl;
+    if (!testIncremental()) return 1;
+    std::cout << "incremental pool update OK" << std::endl;
+    if (!benchPackScaling()) return 1;
+
+    reportModel("models/Ak74.vox");
+    reportModel("models/dragon.vox");
+    reportModel("models/tiger1.vox");
+
+    return 0;
+}
@@ -0,0 +1,238 @@
+#include <vforge/vforge.hpp>
+#include <glm/glm.hpp>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <thread>
+#include "bench.hpp"
+
+    // plain one-voxel-at-a-time DDA, the traversal every level skip has to agree with
+static voxelforge::RaycastHit referenceRaycast(const voxelforge::VoxelObject& object, glm::vec3 o, glm::vec3 d, float maxDistance) {
+    voxelforge::RaycastHit result;
+    glm::ivec3 extent = glm::ivec3(object.size()) * 16;
+    glm::ivec3 step = glm::ivec3(glm::sign(d));
+    glm::vec3 invD = 1.0f / d;
+
+    float tEnter = 0.0f, tExit = maxDistance;
+    int axis = -1;
+    for (int a = 0; a < 3; a++) {
+        if (step[a] == 0) {
+            if (o[a] < 0.0f || o[a] >= (float)extent[a]) return result;
+            continue;
+        }
+        float t0 = ((step[a] > 0 ? 0.0f : (float)extent[a]) - o[a]) * invD[a];
+        float t1 = ((step[a] > 0 ? (float)extent[a] : 0.0f) - o[a]) * invD[a];
+        if (t0 > tEnter) { tEnter = t0; axis = a; }
+        tExit = std::min(tExit, t1);
+    }
+    if (tEnter > tExit) return result;
+
+    glm::ivec3 cell;
+    for (int a = 0; a < 3; a++) {
+        cell[a] = a == axis ? (step[a] > 0 ? 0 : extent[a] - 1) : glm::clamp((int)std::floor(o[a] + d[a] * tEnter), 0, extent[a] - 1);
+    }
+
+    float t = tEnter;
+    for (;;) {
+        if (auto voxel = object.get(glm::uvec3(cell))) {
+            result.hit = true;
+            result.voxel = glm::uvec3(cell);
+            if (axis >= 0) result.normal[axis] = -step[axis];
+            result.distance = t;
+            result.data = *voxel;
+            return result;
+        }
+
+        int next = -1;
+        float tNext = INFINITY;
+        for (int a = 0; a < 3; a++) {
+            if (step[a] == 0) continue;
+            float ta = ((float)(cell[a] + (step[a] > 0)) - o[a]) * invD[a];
+            if (ta < tNext) { tNext = ta; next = a; }
+        }
+        if (next < 0 || tNext > tExit) return result;
+
+        cell[next] += step[next];
+        if (cell[next] < 0 || cell[next] >= extent[next]) return result;
+        t = std::max(t, tNext);
+        axis = next;
+    }
+}
+
+static glm::vec3 randomUnit(uint32_t& seed) {
+    auto next = [&]() {
+        seed = seed * 1664525u + 1013904223u;
+        return (float)(seed >> 8) / (float)(1u << 24);
+    };
+    glm::vec3 v(next() * 2.0f - 1.0f, next() * 2.0f - 1.0f, next() * 2.0f - 1.0f);
+    return glm::normalize(v + glm::vec3(0.0f, 0.0f, 1e-4f));
+}
+
+    // rays from above the terrain, at grazing angles so they cross many empty chunks before hitting anything
+static std::vector<voxelforge::Ray> terrainRays(size_t count, uint32_t seed) {
+    std::vector<voxelforge::Ray> rays;
+    rays.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        glm::vec3 dir = randomUnit(seed);
+        dir.y = -std::abs(dir.y) * 0.25f;
+        glm::vec3 origin = randomUnit(seed) * glm::vec3(30.0f, 0.0f, 30.0f) + glm::vec3(0.0f, 0.45f, 0.0f);
+        rays.emplace_back(origin, dir);
+    }
+    return rays;
+}
+
+static bool sameHit(const voxelforge::RaycastHit& a, const voxelforge::RaycastHit& b) {
+    if (a.hit != b.hit) return false;
+    return !a.hit || (a.voxel == b.voxel && a.normal == b.normal && a.distance == b.distance && a.data == b.data);
+}
+
+static bool testAgainstReference(const voxelforge::VoxelObject& object) {
+    glm::vec3 extent = glm::vec3(object.size()) * 16.0f;
+    uint32_t seed = 7;
+    size_t hits = 0;
+
+    for (int i = 0; i < 20000; i++) {
+            // voxel space rays from inside and outside the object, including axis aligned ones
+        glm::vec3 o = (randomUnit(seed) * 0.75f + 0.5f) * extent;
+        glm::vec3 d = randomUnit(seed);
+        if (i % 4 == 0) d[i % 3] = 0.0f;
+        if (i % 8 == 0) o = glm::floor(o);
+
+        auto expected = referenceRaycast(object, o, d, INFINITY);
+        auto actual = object.raycastVoxels(o, d);
+        if (!sameHit(expected, actual)) {
+            std::cerr << "ray " << i << " differs from the reference traversal" << std::endl;
+            return false;
+        }
+        hits += expected.hit;
+    }
+    std::cout << "reference: 20000 rays agree, " << hits << " hits" << std::endl;
+    return true;
+}
+
+    // every packet kernel has to reproduce the scalar traversal exactly, step counts included
+static bool testKernels(const voxelforge::VoxelObject& object, const std::vector<voxelforge::Ray>& rays) {
+    auto expected = object.raycast(rays, 0, voxelforge::RaycastKernel::Scalar);
+    for (auto kernel : { voxelforge::RaycastKernel::SSE41, voxelforge::RaycastKernel::AVX2 }) {
+        if (kernel > voxelforge::bestRaycastKernel()) continue;
+
+        auto actual = object.raycast(rays, 0, kernel);
+        for (size_t i = 0; i < rays.size(); i++) {
+            if (!sameHit(expected[i], actual[i]) || expected[i].steps != actual[i].steps) {
+                std::cerr << "packet kernel " << (int)kernel << " differs from the scalar traversal on ray " << i << std::endl;
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static const char *kernelName(voxelforge::RaycastKernel kernel) {
+    switch (kernel) {
+        case voxelforge::RaycastKernel::SSE41: return "sse4.1";
+        case voxelforge::RaycastKernel::AVX2: return "avx2";
+        default: return "scalar";
+    }
+}
+
+static void benchmark(const voxelforge::VoxelObject& object, const std::vector<voxelforge::Ray>& rays, unsigned int workers,
+                      voxelforge::RaycastKernel kernel = voxelforge::RaycastKernel::Scalar) {
+    auto start = std::chrono::steady_clock::now();
+    auto hits = object.raycast(rays, workers, kernel);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    uint64_t steps = 0, hitCount = 0;
+    for (const auto& hit : hits) {
+        steps += hit.steps;
+        hitCount += hit.hit;
+    }
+    std::cout << kernelName(kernel) << ", " << workers << " threads: " << rays.size() / seconds / 1e6 << " MRays/s, "
+              << (double)steps / rays.size() << " steps/ray, " << hitCount << " hits" << std::endl;
+}
+
+    // the same rays through the per-voxel reference, as the baseline the level skipping is measured against
+static void benchmarkReference(const voxelforge::VoxelObject& object, const std::vector<voxelforge::Ray>& rays) {
+    glm::vec3 half = glm::vec3(object.size()) * 0.5f;
+    uint64_t hitCount = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (const auto& ray : rays) {
+        hitCount += referenceRaycast(object, (ray.origin + half) * 16.0f, glm::normalize(ray.direction) * 16.0f, ray.maxDistance).hit;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "per-voxel reference: " << rays.size() / seconds / 1e6 << " MRays/s, " << hitCount << " hits" << std::endl;
+}
+
+    // a pinhole camera looking at the object from outside its bounding sphere, one ray per pixel
+static std::vector<voxelforge::Ray> cameraRays(const voxelforge::VoxelObject& object, int width, int height) {
+    glm::mat4 model = object.getModelMatrix();
+    glm::vec3 center = glm::vec3(model * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+    float radius = glm::length(glm::vec3(model * glm::vec4(glm::vec3(object.size()) * 0.5f, 0.0f)));
+
+    glm::vec3 eye = center + glm::normalize(glm::vec3(0.6f, 0.5f, 0.8f)) * radius * 2.0f;
+    glm::vec3 forward = glm::normalize(center - eye);
+    glm::vec3 right = glm::normalize(glm::cross(forward, glm::vec3(0.0f, 1.0f, 0.0f)));
+    glm::vec3 up = glm::cross(right, forward);
+
+    std::vector<voxelforge::Ray> rays;
+    rays.reserve(width * height);
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            glm::vec2 ndc = (glm::vec2(x, y) + 0.5f) / glm::vec2(width, height) * 2.0f - 1.0f;
+            rays.emplace_back(eye, forward + (ndc.x * right + ndc.y * up) * 0.6f);
+        }
+    }
+    return rays;
+}
+
+    // rays/s over every object of a model, one camera view each
+static bool benchmarkModel(const char *filename) {
+    voxelforge::files::MagicaVoxelVOX file(filename);
+    if (!file.getWorld() || file.getWorld()->getObjects().empty()) {
+        std::cerr << "couldn't load " << filename << std::endl;
+        return true;
+    }
+
+    const auto& objects = file.getWorld()->getObjects();
+    std::vector<std::vector<voxelforge::Ray>> rays;
+    size_t rayCount = 0;
+    for (const auto& object : objects) {
+        rays.push_back(cameraRays(*object, 512, 512));
+        rayCount += rays.back().size();
+        if (!testKernels(*object, rays.back())) return false;
+    }
+
+    for (auto kernel : { voxelforge::RaycastKernel::Scalar, voxelforge::RaycastKernel::SSE41, voxelforge::RaycastKernel::AVX2 }) {
+        if (kernel > voxelforge::bestRaycastKernel()) continue;
+
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < objects.size(); i++) objects[i]->raycast(rays[i], 1, kernel);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        std::cout << filename << ", " << kernelName(kernel) << ", 1 thread: " << rayCount / seconds / 1e6 << " MRays/s" << std::endl;
+    }
+    return true;
+}
+
+int main() {
+    voxelforge::VoxelObject object(glm::uvec3(64, 1, 64));
+    fillTerrain(object);
+
+    if (!testAgainstReference(object)) return 1;
+
+    auto rays = terrainRays(1 << 20, 1234);
+    benchmarkReference(object, rays);
+    benchmark(object, rays, 1);
+    unsigned int threads = std::max(1u, std::thread::hardware_concurrency());
+    if (threads > 1) benchmark(object, rays, threads);
+
+    if (!testKernels(object, rays)) return 1;
+    benchmark(object, rays, 1, voxelforge::bestRaycastKernel());
+    if (threads > 1) benchmark(object, rays, threads, voxelforge::bestRaycastKernel());
+
+    if (!benchmarkModel("models/tiger1.vox")) return 1;
+    if (!benchmarkModel("models/dragon.vox")) return 1;
+
+    return 0;
+}
@@ -17,8 +17,7 @@ public:
             for (int y = 0; y < 16 * 64; y++) {
                 float height = 12.0 * (0.5 + 0.5 * glm::perlin(glm::vec3(x,y, this->win.run_time() * 8.0f) / 16.0f));
                 for (int i = 0; i < height; i++) {
-                    auto vd = std::make_shared<voxelforge::VoxelData>(glm::vec3(1.0, 0.0, 0.0), height > 6);
-                    this->world.set(glm::uvec3(x, i, y), vd);
+                    this->world.set(glm::uvec3(x, i, y), voxelforge::VoxelData(glm::vec3(1.0, 0.0, 0.0), height > 6));
                 }
             }
         }
@@ -0,0 +1,116 @@
+#include <vforge/vforge.hpp>
+#include <vforge/threads.hpp>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <atomic>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+
+    // every index has to run exactly once, however the shares get stolen
+static bool testWorkStealing() {
+    for (size_t count : { 1, 7, 1000, 100003 }) {
+        std::vector<std::atomic<int>> runs(count);
+        voxelforge::workStealingFor(count, 8, [&](size_t i) {
+            if (i % 97 == 0) std::this_thread::yield();
+            runs[i]++;
+        });
+        for (const auto& r : runs) {
+            if (r != 1) return false;
+        }
+    }
+    return true;
+}
+
+    // a single 16^3 block in the middle of the object, seen head on
+static bool testSingleBlock() {
+    auto object = std::make_shared<voxelforge::VoxelObject>(glm::uvec3(3, 3, 3));
+    object->setMaterial(5, glm::vec4(1.0f, 0.5f, 0.25f, 0.5f));
+    for (unsigned int x = 16; x < 32; x++)
+    for (unsigned int y = 16; y < 32; y++)
+    for (unsigned int z = 16; z < 32; z++) object->set(glm::uvec3(x, y, z), voxelforge::VoxelData(glm::vec3(0.0f, 0.0f, 1.0f), 5));
+
+    voxelforge::VoxelWorld world;
+    world.addObject(object);
+
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 0.0f, 5.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 proj = glm::perspective(glm::radians(45.0f), 1.0f, 0.1f, 100.0f);
+
+    voxelforge::VoxelRenderer renderer(64, 64);
+    renderer.setClearColor(glm::vec4(0.5f, 0.5f, 0.5f, 1.0f));
+    renderer.render(world, view, proj);
+
+        // the block spans [-0.5, 0.5] in world space, its front face is at z = 0.5
+    glm::vec4 center = renderer.getColor()[32 * 64 + 32];
+    glm::vec4 corner = renderer.getColor()[0];
+    glm::vec4 clip = proj * view * glm::vec4(0.0f, 0.0f, 0.5f, 1.0f);
+    float expectedDepth = (clip.z / clip.w + 1.0f) * 0.5f;
+
+    if (center != glm::vec4(1.0f, 0.5f, 0.25f, 1.0f) || corner != glm::vec4(0.5f, 0.5f, 0.5f, 1.0f)) return false;
+    if (std::abs(renderer.getDepth()[32 * 64 + 32] - expectedDepth) > 1e-5f || renderer.getDepth()[0] != 1.0f) return false;
+    return true;
+}
+
+static bool renderModel(const char *filename) {
+    voxelforge::files::MagicaVoxelVOX file(filename);
+    if (!file.getWorld() || file.getWorld()->getObjects().empty()) {
+        std::cerr << "couldn't load " << filename << std::endl;
+        return false;
+    }
+    const auto& world = *file.getWorld();
+
+        // frame every object
+    glm::vec3 lo(INFINITY), hi(-INFINITY);
+    for (const auto& object : world.getObjects()) {
+        glm::vec3 half = glm::vec3(object->size()) * 0.5f;
+        for (int corner = 0; corner < 8; corner++) {
+            glm::vec3 p = glm::vec3(corner & 1 ? half.x : -half.x, corner & 2 ? half.y : -half.y, corner & 4 ? half.z : -half.z);
+            glm::vec3 ws = glm::vec3(object->getModelMatrix() * glm::vec4(p, 1.0f));
+            lo = glm::min(lo, ws);
+            hi = glm::max(hi, ws);
+        }
+    }
+    glm::vec3 center = (lo + hi) * 0.5f;
+    float radius = glm::length(hi - lo) * 0.5f;
+
+    glm::mat4 view = glm::lookAt(center + glm::normalize(glm::vec3(1.0f, 0.7f, 1.2f)) * radius * 2.5f, center, glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 proj = glm::perspective(glm::radians(45.0f), 1.0f, 0.1f, radius * 10.0f);
+
+    voxelforge::VoxelRenderer single(512, 512), parallel(512, 512);
+    single.setWorkerCount(1);
+    single.render(world, view, proj);
+    parallel.render(world, view, proj);
+
+    if (single.getColor() != parallel.getColor() || single.getDepth() != parallel.getDepth()) {
+        std::cerr << filename << ": multithreaded render differs from the single threaded one" << std::endl;
+        return false;
+    }
+    const char *path = "test_voxel_render.ppm";
+    bool saved = parallel.savePPM(path);
+    std::remove(path);
+    if (!saved) {
+        std::cerr << filename << ": couldn't save the render" << std::endl;
+        return false;
+    }
+
+    std::cout << filename << std::endl;
+    std::cout << "RPS (1 thread): " << (unsigned long long)single.getRenderStats().raysPerSecond() << std::endl;
+    std::cout << "RPS (" << voxelforge::defaultWorkerCount() << " threads): " << (unsigned long long)parallel.getRenderStats().raysPerSecond() << std::endl;
+    return true;
+}
+
+int main() {
+    if (!testWorkStealing()) {
+        std::cerr << "work stealing ran an index more or less than once" << std::endl;
+        return 1;
+    }
+    if (!testSingleBlock()) {
+        std::cerr << "single block render is wrong" << std::endl;
+        return 1;
+    }
+
+    if (!renderModel("models/dragon.vox")) return 1;
+    if (!renderModel("models/tiger1.vox")) return 1;
+
+    return 0;
+}
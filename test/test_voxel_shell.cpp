@@ -0,0 +1,129 @@
+#include <vforge/vforge.hpp>
+#include <glm/glm.hpp>
+#include <vox_file/vox_file.h>
+#include <iostream>
+#include <random>
+#include <thread>
+#include "bench.hpp"
+
+    // per-voxel version: six get() calls per voxel, anything outside the object is empty
+static bool visibleReference(const voxelforge::VoxelObject& object, glm::uvec3 p) {
+    glm::uvec3 extent = object.size() * 16u;
+    for (int axis = 0; axis < 3; axis++) {
+        if (p[axis] == 0 || p[axis] + 1 >= extent[axis]) return true;
+
+        glm::uvec3 a = p, b = p;
+        a[axis]--;
+        b[axis]++;
+        if (!object.get(a) || !object.get(b)) return true;
+    }
+    return false;
+}
+
+static size_t shellCount(const std::vector<voxelforge::ShellChunk>& shell) {
+    size_t count = 0;
+    for (const auto& chunk : shell) {
+        for (uint64_t voxels : chunk.voxels) count += __builtin_popcountll(voxels);
+    }
+    return count;
+}
+
+static bool matchesReference(const voxelforge::VoxelObject& object, unsigned int workers) {
+    auto shell = object.extractShell(workers);
+
+    size_t expected = 0;
+    bool ok = true;
+    object.forEachVoxel([&](glm::uvec3 p, const voxelforge::VoxelData& data) {
+        bool visible = visibleReference(object, p);
+        auto kept = shell->get(p);
+        expected += visible;
+        ok &= visible ? (kept && *kept == data) : !kept;
+    });
+
+    size_t kept = 0;
+    for (auto it = shell->voxels().begin(); it != shell->voxels().end(); ++it) kept++;
+    return ok && kept == expected && shellCount(object.findShell(workers)) == expected && shell->getMaterial(7) == object.getMaterial(7);
+}
+
+    // solid boxes straddling subchunk and chunk borders, plus noise, so every halo direction is exercised
+static bool testAgainstReference() {
+    voxelforge::VoxelObject object(glm::uvec3(3, 3, 3));
+    std::mt19937 rng(9);
+    for (int box = 0; box < 12; box++) {
+        glm::uvec3 lo(rng() % 40, rng() % 40, rng() % 40);
+        glm::uvec3 size = glm::min(glm::uvec3(4 + rng() % 12, 4 + rng() % 12, 4 + rng() % 12), glm::uvec3(48) - lo);
+        for (unsigned int x = lo.x; x < lo.x + size.x; x++)
+        for (unsigned int y = lo.y; y < lo.y + size.y; y++)
+        for (unsigned int z = lo.z; z < lo.z + size.z; z++) {
+            object.set(glm::uvec3(x, y, z), voxelforge::VoxelData(glm::vec3(0.0, 1.0, 0.0), (x * 7 + y) % 256));
+        }
+    }
+    for (int i = 0; i < 20000; i++) {
+        glm::uvec3 p(rng() % 48, rng() % 48, rng() % 48);
+        if (rng() % 3) object.set(p, voxelforge::VoxelData(glm::vec3(1.0, 0.0, 0.0), rng() % 256));
+        else object.clear(p);
+    }
+    object.setMaterial(7, glm::vec4(0.25f, 0.5f, 0.75f, 1.0f));
+
+    return matchesReference(object, 1) && matchesReference(object, 4);
+}
+
+static void benchmark(const char *name, const std::vector<std::shared_ptr<voxelforge::VoxelObject>>& objects, double voxFileTime = -1.0) {
+    size_t voxels = 0, reference = 0;
+    double referenceTime = timeSeconds([&]() {
+        for (const auto& object : objects) {
+            object->forEachVoxel([&](glm::uvec3 p, const voxelforge::VoxelData&) {
+                voxels++;
+                reference += visibleReference(*object, p);
+            });
+        }
+    });
+
+    std::cout << name << ": " << voxels << " voxels, " << reference << " in the shell" << std::endl;
+    std::cout << "  per-voxel get():             " << referenceTime * 1000.0 << " ms" << std::endl;
+    if (voxFileTime >= 0.0) std::cout << "  VoxFile::RemoveHiddenVoxels: " << voxFileTime * 1000.0 << " ms" << std::endl;
+
+    unsigned int cores = std::thread::hardware_concurrency();
+    for (unsigned int workers : { 1u, 2u, 4u, 8u }) {
+        if (workers > 1 && workers > cores) break;
+
+        size_t found = 0;
+        double maskTime = timeSeconds([&]() { for (const auto& object : objects) found += shellCount(object->findShell(workers)); });
+        double extractTime = timeSeconds([&]() { for (const auto& object : objects) object->extractShell(workers); });
+        if (found != reference) {
+            std::cerr << name << ": shell doesn't match the per-voxel version" << std::endl;
+            std::exit(1);
+        }
+        std::cout << "  findShell, " << workers << " threads:         " << maskTime * 1000.0 << " ms (" << referenceTime / maskTime << "x), extractShell "
+                  << extractTime * 1000.0 << " ms" << std::endl;
+    }
+}
+
+    // what VoxFile spends on its own per-voxel hidden voxel removal, for comparison
+static double voxFileRemovalTime(const char *filename) {
+    const int repeats = 10;
+    double with = timeSeconds([&]() { for (int r = 0; r < repeats; r++) magicavoxel::VoxFile(true, true, true).Load(filename); });
+    double without = timeSeconds([&]() { for (int r = 0; r < repeats; r++) magicavoxel::VoxFile(true, true, false).Load(filename); });
+    return std::max(0.0, with - without) / repeats;
+}
+
+int main() {
+    if (!testAgainstReference()) {
+        std::cerr << "shell doesn't match the per-voxel version" << std::endl;
+        return 1;
+    }
+    std::cout << "shell extraction OK" << std::endl;
+
+    for (const char *filename : { "models/Ak74.vox", "models/dragon.vox", "models/tiger1.vox" }) {
+        voxelforge::files::MagicaVoxelVOX file(filename);
+        if (!file.getWorld()) continue;
+
+        benchmark(filename, file.getWorld()->getObjects(), voxFileRemovalTime(filename));
+    }
+
+    auto terrain = std::make_shared<voxelforge::VoxelObject>(glm::uvec3(64, 1, 64));
+    fillTerrain(*terrain);
+    benchmark("terrain", { terrain });
+
+    return 0;
+}
@@ -0,0 +1,117 @@
+#include <vforge/vforge.hpp>
+#include <glm/glm.hpp>
+#include <iostream>
+#include <unordered_map>
+#include "bench.hpp"
+
+    // the storage layout before VoxelData became a value type, kept here as the benchmark baseline
+namespace legacy {
+struct VoxelData {
+    VoxelData(glm::vec3 norm, uint32_t mat) : normal(norm), matID(mat) {}
+
+    glm::vec3 normal;
+    uint32_t matID;
+};
+
+struct VoxelSubChunk {
+    uint64_t bitmask = 0;
+    std::shared_ptr<VoxelData> data[4][4][4];
+};
+
+struct VoxelChunk {
+    uint64_t bitmask = 0;
+    std::shared_ptr<VoxelSubChunk> data[4][4][4];
+
+    void set(glm::uvec3 p, std::shared_ptr<VoxelData> vox) {
+        auto& sub = this->data[p.x >> 2][p.y >> 2][p.z >> 2];
+        if (!sub) sub = std::make_shared<VoxelSubChunk>();
+        sub->data[p.x % 4][p.y % 4][p.z % 4] = vox;
+        sub->bitmask |= 1ull << voxelforge::internal::bitIndex(p.x % 4, p.y % 4, p.z % 4);
+        this->bitmask |= 1ull << voxelforge::internal::bitIndex(p.x >> 2, p.y >> 2, p.z >> 2);
+    }
+
+    size_t memoryUsage() const {
+        size_t bytes = sizeof(*this);
+        for (const auto& sub : this->data) for (const auto& row : sub) for (const auto& s : row) {
+            if (!s) continue;
+            bytes += sizeof(VoxelSubChunk) + 2 * sizeof(void *);
+            for (const auto& v : s->data) for (const auto& vr : v) for (const auto& vox : vr) {
+                if (vox) bytes += sizeof(VoxelData) + 2 * sizeof(void *);
+            }
+        }
+        return bytes;
+    }
+};
+}
+
+    // repeated and cleared voxels must end up the same as applying the edits one by one
+static bool testBatchOrder() {
+    voxelforge::VoxelObject direct(glm::uvec3(4, 4, 4));
+    voxelforge::VoxelObject batched(glm::uvec3(4, 4, 4));
+    voxelforge::VoxelEditBatch batch;
+
+    uint32_t seed = 42;
+    for (int i = 0; i < 200000; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        glm::uvec3 p((seed >> 8) % 64, (seed >> 14) % 64, (seed >> 20) % 64);
+        if (i % 3 == 0) {
+            direct.clear(p);
+            batch.clear(p);
+        } else {
+            direct.set(p, voxelforge::VoxelData(glm::vec3(0.0, 1.0, 0.0), i % 256));
+            batch.set(p, voxelforge::VoxelData(glm::vec3(0.0, 1.0, 0.0), i % 256));
+        }
+        if (i % 50000 == 49999) batched.apply(batch);
+    }
+
+    return sameVoxels(direct, batched);
+}
+
+int main() {
+    if (!testBatchOrder()) {
+        std::cerr << "batched edits don't match per-voxel edits" << std::endl;
+        return 1;
+    }
+
+    uint64_t voxels = 0;
+    size_t legacyBytes = 0;
+    double legacyTime = timeSeconds([&]() {
+        std::unordered_map<glm::uvec3, std::shared_ptr<legacy::VoxelChunk>, voxelforge::internal::uvec3Hash> chunks;
+        voxels = forEachTerrainVoxel([&](glm::uvec3 p, uint32_t mat) {
+            auto& chunk = chunks[p / 16u];
+            if (!chunk) chunk = std::make_shared<legacy::VoxelChunk>();
+            chunk->set(p % 16u, std::make_shared<legacy::VoxelData>(glm::vec3(1.0, 0.0, 0.0), mat));
+        });
+        legacyBytes = chunks.size() * (sizeof(glm::uvec3) + sizeof(std::shared_ptr<legacy::VoxelChunk>) + 2 * sizeof(void *));
+        for (const auto& [pos, chunk] : chunks) legacyBytes += chunk->memoryUsage() + 2 * sizeof(void *);
+    });
+
+    voxelforge::VoxelObject object(glm::uvec3(64, 1, 64));
+    double valueTime = timeSeconds([&]() {
+        forEachTerrainVoxel([&](glm::uvec3 p, uint32_t mat) {
+            object.set(p, voxelforge::VoxelData(glm::vec3(1.0, 0.0, 0.0), mat));
+        });
+    });
+    size_t valueBytes = object.memoryUsage();
+
+    voxelforge::VoxelObject batched(glm::uvec3(64, 1, 64));
+    double batchTime = timeSeconds([&]() {
+        voxelforge::VoxelEditBatch batch;
+        batch.reserve(voxels);
+        forEachTerrainVoxel([&](glm::uvec3 p, uint32_t mat) {
+            batch.set(p, voxelforge::VoxelData(glm::vec3(1.0, 0.0, 0.0), mat));
+        });
+        batched.apply(batch);
+    });
+    if (!sameVoxels(object, batched)) {
+        std::cerr << "batched terrain doesn't match per-voxel terrain" << std::endl;
+        return 1;
+    }
+
+    std::cout << voxels << " voxels" << std::endl;
+    std::cout << "shared_ptr storage: " << legacyTime << " s, " << (double)legacyBytes / voxels << " bytes/voxel" << std::endl;
+    std::cout << "value storage:      " << valueTime << " s, " << (double)valueBytes / voxels << " bytes/voxel" << std::endl;
+    std::cout << "batched edits:      " << batchTime << " s, " << (double)batched.memoryUsage() / voxels << " bytes/voxel" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,191 @@
+#include <vforge/vforge.hpp>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <iostream>
+#include <random>
+#include "bench.hpp"
+
+static glm::mat4 randomPlacement(std::mt19937& rng, float spread) {
+    std::uniform_real_distribution<float> position(-spread, spread), angle(0.0f, 6.2831853f);
+    glm::mat4 m = glm::translate(glm::mat4(1.0f), glm::vec3(position(rng), position(rng) * 0.25f, position(rng)));
+    return glm::rotate(m, angle(rng), glm::normalize(glm::vec3(position(rng), spread, position(rng))));
+}
+
+    // `count` items spread over a (2 * spread)^2 area: a few dozen small models, each placed many times
+static voxelforge::VoxelWorld makeWorld(size_t count, float spread, std::mt19937& rng) {
+    voxelforge::VoxelWorld world;
+    const size_t models = std::min<size_t>(count, 64);
+    for (size_t m = 0; m < models; m++) {
+        glm::uvec3 dim(1 + rng() % 2, 1 + rng() % 2, 1 + rng() % 2);
+        auto object = std::make_shared<voxelforge::VoxelObject>(dim, randomPlacement(rng, spread));
+        for (int i = 0; i < 200; i++) {
+            glm::uvec3 p(rng() % (dim.x * 16), rng() % (dim.y * 16), rng() % (dim.z * 16));
+            object->set(p, voxelforge::VoxelData(glm::vec3(0.0f, 1.0f, 0.0f), 1 + rng() % 255));
+        }
+        world.addObject(object);
+    }
+    for (size_t i = models; i < count; i++) {
+        world.addInstance(std::make_shared<voxelforge::VoxelInstance>(world.getObjects()[i % models], randomPlacement(rng, spread)));
+    }
+    world.updateBounds();
+    return world;
+}
+
+static std::vector<size_t> bruteCull(const voxelforge::VoxelWorld& world, const glm::mat4& view, const glm::mat4& proj) {
+    voxelforge::Frustum frustum(proj * view);
+    std::vector<size_t> items;
+    for (size_t i = 0; i < world.itemCount(); i++) {
+        if (frustum.test(world.itemBounds(i)) != voxelforge::Frustum::Outside) items.push_back(i);
+    }
+    return items;
+}
+
+static std::vector<size_t> bruteQuery(const voxelforge::VoxelWorld& world, const voxelforge::AABB& box) {
+    std::vector<size_t> items;
+    for (size_t i = 0; i < world.itemCount(); i++) {
+        if (world.itemBounds(i).overlaps(box)) items.push_back(i);
+    }
+    return items;
+}
+
+static float bruteRaycast(const voxelforge::VoxelWorld& world, glm::vec3 origin, glm::vec3 direction) {
+    float nearest = std::numeric_limits<float>::infinity();
+    for (size_t i = 0; i < world.itemCount(); i++) {
+        if (!world.itemModel(i)) continue;
+        auto hit = world.itemModel(i)->raycastAt(world.itemModelMatrix(i), origin, direction, nearest);
+        if (hit && hit.distance < nearest) nearest = hit.distance;
+    }
+    return nearest;
+}
+
+static glm::mat4 viewFrom(std::mt19937& rng, float spread) {
+    std::uniform_real_distribution<float> position(-spread, spread);
+    glm::vec3 eye(position(rng), spread * 0.2f, position(rng));
+    return glm::lookAt(eye, glm::vec3(position(rng), 0.0f, position(rng)), glm::vec3(0.0f, 1.0f, 0.0f));
+}
+
+static voxelforge::AABB randomBox(std::mt19937& rng, float spread, float size) {
+    std::uniform_real_distribution<float> position(-spread, spread);
+    glm::vec3 lo(position(rng), position(rng) * 0.25f, position(rng));
+    return voxelforge::AABB(lo, lo + size);
+}
+
+    // every query has to agree with testing each item on its own
+static bool checkQueries(const voxelforge::VoxelWorld& world, std::mt19937& rng, float spread) {
+    glm::mat4 proj = glm::perspective(glm::radians(60.0f), 1.5f, 0.1f, spread);
+    for (int v = 0; v < 20; v++) {
+        glm::mat4 view = viewFrom(rng, spread);
+        std::vector<size_t> culled = world.cull(view, proj);
+
+        glm::vec3 eye = glm::vec3(glm::inverse(view)[3]);
+        float last = 0.0f;
+        for (size_t item : culled) {
+            voxelforge::AABB box = world.itemBounds(item);
+            glm::vec3 nearest = glm::clamp(eye, box.lo, box.hi);
+            float distance = glm::dot(nearest - eye, nearest - eye);
+            if (distance < last) return false; // not front to back
+            last = distance;
+        }
+
+        std::sort(culled.begin(), culled.end());
+        if (culled != bruteCull(world, view, proj)) return false;
+    }
+
+    for (int q = 0; q < 50; q++) {
+        voxelforge::AABB box = randomBox(rng, spread, spread * 0.1f);
+        std::vector<size_t> found = world.query(box);
+        std::sort(found.begin(), found.end());
+        if (found != bruteQuery(world, box)) return false;
+    }
+
+    size_t hits = 0;
+    std::uniform_real_distribution<float> position(-spread, spread);
+    for (int r = 0; r < 30; r++) {
+        glm::vec3 origin(position(rng), spread * 0.1f, position(rng));
+        glm::vec3 direction = glm::vec3(position(rng), -spread * 0.1f, position(rng)) * 0.5f - origin;
+        auto hit = world.raycast(origin, direction);
+        float expected = bruteRaycast(world, origin, direction);
+        if ((bool)hit != (expected != std::numeric_limits<float>::infinity()) || (hit && hit.distance != expected)) return false;
+        if (hit && world.itemModel(hit.item)->raycastAt(world.itemModelMatrix(hit.item), origin, direction).distance != hit.distance) return false;
+        hits += (bool)hit;
+    }
+    return hits > 0;
+}
+
+static bool testQueries() {
+    std::mt19937 rng(18);
+    const float spread = 40.0f;
+    voxelforge::VoxelWorld world = makeWorld(2000, spread, rng);
+    if (!checkQueries(world, rng, spread)) return false;
+
+        // move a third of the items and refit the whole tree
+    for (size_t i = 0; i < world.getInstances().size(); i += 3) world.getInstances()[i]->setModelMatrix(randomPlacement(rng, spread));
+    world.getObjects()[0]->setModelMatrix(randomPlacement(rng, spread));
+    world.updateBounds();
+    if (!checkQueries(world, rng, spread)) return false;
+
+        // single item refits
+    for (size_t i = 0; i < 100; i++) {
+        size_t item = world.getObjects().size() + rng() % world.getInstances().size();
+        world.getInstances()[item - world.getObjects().size()]->setModelMatrix(randomPlacement(rng, spread));
+        world.updateBounds(item);
+    }
+    if (!checkQueries(world, rng, spread)) return false;
+
+        // items added after the last build
+    world.addInstance(std::make_shared<voxelforge::VoxelInstance>(world.getObjects()[1], randomPlacement(rng, spread)));
+    world.addObject(nullptr);
+    world.updateBounds();
+    return checkQueries(world, rng, spread);
+}
+
+static void benchmark(size_t count) {
+    std::mt19937 rng(7);
+    const float spread = 400.0f;
+    voxelforge::VoxelWorld world = makeWorld(count, spread, rng);
+    std::cout << count << " items, " << world.getBVH().getNodes().size() << " nodes" << std::endl;
+
+    const int repeats = 20;
+    double build = timeSeconds([&]() { for (int r = 0; r < repeats; r++) world.rebuildBounds(); }) / repeats;
+    double refit = timeSeconds([&]() { for (int r = 0; r < repeats; r++) world.updateBounds(); }) / repeats;
+    double refitOne = timeSeconds([&]() { for (size_t i = 0; i < 10000; i++) world.updateBounds(i % count); }) / 10000;
+    std::cout << "  build " << build * 1000.0 << " ms, full refit " << refit * 1000.0 << " ms, single refit " << refitOne * 1e9 << " ns" << std::endl;
+
+    glm::mat4 proj = glm::perspective(glm::radians(60.0f), 1.5f, 0.1f, spread * 0.5f);
+    std::vector<glm::mat4> views;
+    for (int v = 0; v < 100; v++) views.push_back(viewFrom(rng, spread));
+    size_t visible = 0;
+    double cull = timeSeconds([&]() { for (const auto& view : views) visible += world.cull(view, proj).size(); }) / views.size();
+    double bruteCullTime = timeSeconds([&]() { for (const auto& view : views) bruteCull(world, view, proj); }) / views.size();
+    std::cout << "  cull (sorted) " << cull * 1e6 << " us, brute force " << bruteCullTime * 1e6 << " us, " << visible / views.size() << " visible on average" << std::endl;
+
+    std::vector<voxelforge::AABB> boxes;
+    for (int q = 0; q < 1000; q++) boxes.push_back(randomBox(rng, spread, 20.0f));
+    size_t found = 0;
+    double query = timeSeconds([&]() { for (const auto& box : boxes) found += world.query(box).size(); }) / boxes.size();
+    double bruteQueryTime = timeSeconds([&]() { for (const auto& box : boxes) bruteQuery(world, box); }) / boxes.size();
+    std::cout << "  box query " << query * 1e6 << " us, brute force " << bruteQueryTime * 1e6 << " us, " << (double)found / boxes.size() << " items on average" << std::endl;
+
+    std::vector<voxelforge::Ray> rays;
+    std::uniform_real_distribution<float> position(-spread, spread);
+    for (int r = 0; r < 200; r++) {
+        glm::vec3 origin(position(rng), spread * 0.1f, position(rng));
+        rays.emplace_back(origin, glm::vec3(position(rng), 0.0f, position(rng)) - origin);
+    }
+    size_t hits = 0;
+    double ray = timeSeconds([&]() { for (const auto& r : rays) hits += (bool)world.raycast(r.origin, r.direction); }) / rays.size();
+    double bruteRay = timeSeconds([&]() { for (size_t r = 0; r < 20; r++) bruteRaycast(world, rays[r].origin, rays[r].direction); }) / 20;
+    std::cout << "  raycast " << ray * 1e6 << " us, brute force " << bruteRay * 1e6 << " us, " << hits << "/" << rays.size() << " hit" << std::endl;
+}
+
+int main() {
+    if (!testQueries()) {
+        std::cerr << "BVH queries don't match testing every object" << std::endl;
+        return 1;
+    }
+    std::cout << "world BVH OK" << std::endl;
+
+    benchmark(10000);
+    return 0;
+}
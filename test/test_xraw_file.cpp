@@ -0,0 +1,176 @@
+#include <vforge/vforge.hpp>
+#include <vforge/xraw_file.hpp>
+#include <glm/glm.hpp>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+#include <malloc.h>
+#include "bench.hpp"
+
+    // live and peak heap bytes, to show the importer never holds the dense volume
+static std::atomic<size_t> heapBytes{0}, heapPeak{0};
+
+void *operator new(size_t size) {
+    void *p = std::malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    size_t now = heapBytes += malloc_usable_size(p);
+    size_t peak = heapPeak.load();
+    while (now > peak && !heapPeak.compare_exchange_weak(peak, now)) {}
+    return p;
+}
+
+void operator delete(void *p) noexcept {
+    if (!p) return;
+    heapBytes -= malloc_usable_size(p);
+    std::free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+    operator delete(p);
+}
+
+static void appendInt(std::string& out, uint32_t value) {
+    out.append((const char *)&value, 4);
+}
+
+static std::string header(uint8_t channelType, uint8_t channels, uint8_t bitsPerChannel, uint8_t bitsPerIndex, glm::uvec3 size, uint32_t paletteSize) {
+    std::string out = "XRAW";
+    out += std::string({ (char)channelType, (char)channels, (char)bitsPerChannel, (char)bitsPerIndex });
+    appendInt(out, size.x);
+    appendInt(out, size.y);
+    appendInt(out, size.z);
+    appendInt(out, paletteSize);
+    return out;
+}
+
+    // palette index at a file position (z up), 0 for empty
+static uint8_t indexAt(uint32_t x, uint32_t y, uint32_t z) {
+    uint32_t h = (x * 73856093u) ^ (y * 19349663u) ^ (z * 83492791u);
+    return h % 3 == 0 ? 0 : 1 + h % 255;
+}
+
+static void writeFile(const char *path, const std::string& bytes) {
+    std::ofstream(path, std::ios::binary | std::ios::trunc).write(bytes.data(), bytes.size());
+}
+
+    // sizes that aren't multiples of 16 and a palette of every format, checked voxel by voxel
+static bool testContents(const char *path) {
+    const glm::uvec3 size(37, 21, 50);
+    std::string voxels;
+    for (uint32_t z = 0; z < size.z; z++)
+    for (uint32_t y = 0; y < size.y; y++)
+    for (uint32_t x = 0; x < size.x; x++) voxels += (char)indexAt(x, y, z);
+
+    std::string bytes = header(0, 4, 8, 8, size, 256) + voxels;
+    for (uint32_t i = 0; i < 256; i++) bytes += std::string({ (char)i, (char)(255 - i), (char)(i / 2), (char)255 });
+    writeFile(path, bytes);
+
+    auto object = voxelforge::files::load_xraw_file(path);
+    if (!object || object->size() != glm::uvec3(3, 4, 2)) return false;
+
+    size_t count = 0;
+    for (uint32_t z = 0; z < size.z; z++)
+    for (uint32_t y = 0; y < size.y; y++)
+    for (uint32_t x = 0; x < size.x; x++) {
+        auto voxel = object->get(glm::uvec3(x, z, y));
+        uint8_t index = indexAt(x, y, z);
+        if ((bool)voxel != (index != 0) || (voxel && voxel->matID != index)) return false;
+        count += index != 0;
+    }
+    size_t loaded = 0;
+    object->forEachVoxel([&](glm::uvec3, const voxelforge::VoxelData&) { loaded++; });
+    if (loaded != count) return false;
+
+    for (uint32_t i = 0; i < 256; i++) {
+        if (object->getMaterial(i) != glm::vec4(i, 255 - i, i / 2, 255) / 256.0f) return false;
+    }
+
+        // float RGB colors, alpha defaulting to opaque
+    bytes = header(2, 3, 32, 8, glm::uvec3(1, 1, 1), 2) + std::string(1, (char)1);
+    for (float c : { 0.0f, 0.0f, 0.0f, 0.25f, 0.5f, 0.75f }) bytes.append((const char *)&c, 4);
+    writeFile(path, bytes);
+    object = voxelforge::files::load_xraw_file(path);
+    return object && object->get(glm::uvec3(0)) && object->getMaterial(1) == glm::vec4(0.25f, 0.5f, 0.75f, 1.0f);
+}
+
+    // every one of these has to be refused rather than read
+static bool testMalformed(const char *path) {
+    const glm::uvec3 size(4, 4, 4);
+    std::string voxels(64, (char)1), palette(256 * 4, (char)0);
+    std::string files[] = {
+        "XRAV" + header(0, 4, 8, 8, size, 256).substr(4) + voxels + palette,
+        header(0, 4, 8, 16, size, 256) + voxels + voxels + palette,     // 16-bit indices
+        header(0, 4, 8, 0, size, 0) + voxels + voxels + voxels + voxels,    // colors in the voxels
+        header(0, 5, 8, 8, size, 256) + voxels + palette,
+        header(1, 4, 8, 8, size, 256) + voxels + palette,
+        header(0, 4, 8, 8, size, 512) + voxels + palette + palette,
+        header(0, 4, 8, 8, size, 256) + voxels + palette.substr(1),     // truncated
+        header(0, 4, 8, 8, size, 256) + voxels + palette + "x",
+        header(0, 4, 8, 8, glm::uvec3(0, 4, 4), 256) + palette,
+        header(0, 4, 8, 8, glm::uvec3(1u << 31, 1u << 31, 1), 256) + voxels + palette,
+        "XRAW",
+    };
+    for (const std::string& bytes : files) {
+        writeFile(path, bytes);
+        if (voxelforge::files::load_xraw_file(path)) return false;
+    }
+    return !voxelforge::files::load_xraw_file("missing.xraw");
+}
+
+    // a 512 x 512 x 256 terrain-like volume: throughput and the peak heap against the size of the dense volume
+static void benchmark(const char *path) {
+    const glm::uvec3 size(512, 512, 256);
+    {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file.write(header(0, 4, 8, 8, size, 256).data(), 24);
+        std::vector<char> layer(size.x * size.y);
+        for (uint32_t z = 0; z < size.z; z++) {
+            for (uint32_t y = 0; y < size.y; y++)
+            for (uint32_t x = 0; x < size.x; x++) {
+                uint32_t height = 64 + (x * 7 + y * 13) % 97 + (x ^ y) % 31;
+                layer[y * size.x + x] = z < height ? (char)(1 + z % 200) : 0;
+            }
+            file.write(layer.data(), layer.size());
+        }
+        std::vector<char> palette(256 * 4, (char)128);
+        file.write(palette.data(), palette.size());
+    }
+
+    const uint64_t dense = (uint64_t)size.x * size.y * size.z;
+    std::shared_ptr<voxelforge::VoxelObject> object;
+    size_t before = heapBytes;
+    heapPeak = before;
+    double seconds = timeSeconds([&]() { object = voxelforge::files::load_xraw_file(path); });
+    size_t peak = heapPeak - before, result = heapBytes - before;
+
+    size_t count = 0;
+    object->forEachVoxel([&](glm::uvec3, const voxelforge::VoxelData&) { count++; });
+    std::cout << size.x << "x" << size.y << "x" << size.z << ": " << count << " voxels in " << seconds * 1000.0 << " ms, "
+              << dense / seconds / 1e6 << " M dense voxels/s (" << dense / seconds / (1 << 20) << " MB/s)" << std::endl;
+    std::cout << "  peak heap " << peak / 1024 << " KiB, of which the result is " << result / 1024 << " KiB ("
+              << dense / 1024 << " KiB dense)" << std::endl;
+}
+
+int main() {
+    const char *path = "test_xraw_file.xraw";
+
+    if (!testContents(path)) {
+        std::cerr << "loaded XRAW doesn't match the file" << std::endl;
+        return 1;
+    }
+    if (!testMalformed(path)) {
+        std::cerr << "malformed XRAW file was accepted" << std::endl;
+        return 1;
+    }
+    std::cout << "XRAW loading OK" << std::endl;
+
+    benchmark(path);
+    std::remove(path);
+    return 0;
+}